@@ -0,0 +1,132 @@
+#ifdef FASTER_ART_INCLUDE
+#else
+
+#include "aster/faster_core.h"
+#include <stdlib.h>
+
+// adaptive radix tree over the bytes of the keys: inner nodes grow from 4 to 16, 48 and 256 children as they fill,
+// chains of single child nodes are compressed into a prefix stored in the node below them.
+// Keys are ordered byte by byte, a key that is a prefix of another comes first (unlike the length-first order of AVL and B+ trees)
+
+// prefix bytes kept in the node, longer prefixes are checked against a leaf below the node
+#define FASTER_ART_MAX_PREFIX 10
+
+// references pack the node kind in the low bits and the index in its array above them, 0 is the empty reference
+typedef uint32_t ARTRef;
+#define FASTER_ART_REF_NULL 0
+#define FASTER_ART_KIND_BITS 3
+#define FASTER_ART_LEAF 1
+#define FASTER_ART_NODE4 2
+#define FASTER_ART_NODE16 3
+#define FASTER_ART_NODE48 4
+#define FASTER_ART_NODE256 5
+#define FASTER_ART_KIND(ref) ((ref) & ((1u << FASTER_ART_KIND_BITS) - 1))
+#define FASTER_ART_INDEX(ref) ((ref) >> FASTER_ART_KIND_BITS)
+#define FASTER_ART_MAKE_REF(index, kind) ((ARTRef)(((index) << FASTER_ART_KIND_BITS) | (kind)))
+
+struct ARTLeaf_t_s {
+  faster_str_t key;
+  faster_value_ptr value;
+} FASTER_ALIGNED;
+typedef struct ARTLeaf_t_s ARTLeaf_t;
+
+// shared by all inner nodes, terminal holds the key that ends at this node
+struct ARTHeader_t_s {
+  ARTRef terminal;
+  uint32_t prefix_length;
+  uint16_t count;
+  uint8_t prefix[FASTER_ART_MAX_PREFIX];
+} FASTER_ALIGNED;
+typedef struct ARTHeader_t_s ARTHeader_t;
+
+// Node4 and Node16 keep their key bytes sorted, Node16 is searched with one SIMD compare
+struct ARTNode4_t_s {
+  ARTHeader_t header;
+  uint8_t keys[4];
+  ARTRef children[4];
+} FASTER_ALIGNED;
+typedef struct ARTNode4_t_s ARTNode4_t;
+
+struct ARTNode16_t_s {
+  ARTHeader_t header;
+  uint8_t keys[16];
+  ARTRef children[16];
+} FASTER_ALIGNED;
+typedef struct ARTNode16_t_s ARTNode16_t;
+
+// index maps a byte to its slot in children plus one, 0 when absent
+struct ARTNode48_t_s {
+  ARTHeader_t header;
+  uint8_t index[256];
+  ARTRef children[48];
+} FASTER_ALIGNED;
+typedef struct ARTNode48_t_s ARTNode48_t;
+
+struct ARTNode256_t_s {
+  ARTHeader_t header;
+  ARTRef children[256];
+} FASTER_ALIGNED;
+typedef struct ARTNode256_t_s ARTNode256_t;
+
+// lists
+DEFINE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(ARTLeaf_t);
+DEFINE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(ARTNode4_t);
+DEFINE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(ARTNode16_t);
+DEFINE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(ARTNode48_t);
+DEFINE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(ARTNode256_t);
+
+struct ARTree_t_s {
+  ARTRef root;
+  faster_indexing_t elements;
+  ARTLeaf_t_arr_t leaves;
+  ARTNode4_t_arr_t node4_list;
+  ARTNode16_t_arr_t node16_list;
+  ARTNode48_t_arr_t node48_list;
+  ARTNode256_t_arr_t node256_list;
+};
+typedef struct ARTree_t_s ARTree_t;
+typedef struct ARTree_t_s *ARTreePtr;
+
+struct faster_art_iterator_frame_s {
+  ARTRef node;
+  int position; // -1 before the terminal key, then the next slot (Node4, Node16) or byte (Node48, Node256)
+};
+
+// the stack grows with the depth of the tree, ART_iterator_free releases it
+typedef struct {
+  struct faster_art_iterator_frame_s *stack;
+  int top;
+  int capacity;
+  int initialized; // Flag to indicate if the iterator has been positioned
+} faster_art_iterator_helper_t;
+
+#define FASTER_ART_EMPTY_ITERATOR {.stack = NULL, .top = -1, .capacity = 0, .initialized = 0}
+
+#define DECLARE_ART_WITH_DYNAMIC_ALLOCATION(name, initial_capacity)                                                                \
+  DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(name##_leaves, ARTLeaf_t, initial_capacity);                                          \
+  DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(name##_node4, ARTNode4_t, ((initial_capacity) / 2) + 1);                              \
+  DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(name##_node16, ARTNode16_t, ((initial_capacity) / 8) + 1);                            \
+  DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(name##_node48, ARTNode48_t, ((initial_capacity) / 32) + 1);                           \
+  DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(name##_node256, ARTNode256_t, ((initial_capacity) / 128) + 1);                        \
+  ARTree_t name = {.root = FASTER_ART_REF_NULL,                                                                                    \
+                   .elements = 0,                                                                                                  \
+                   .leaves = name##_leaves,                                                                                        \
+                   .node4_list = name##_node4,                                                                                     \
+                   .node16_list = name##_node16,                                                                                   \
+                   .node48_list = name##_node48,                                                                                   \
+                   .node256_list = name##_node256}
+
+bool ART_insert_or_update(const ARTreePtr tree, const faster_str_ptr_t key, const faster_value_ptr value);
+faster_value_ptr ART_get(const ARTreePtr tree, const faster_str_ptr_t key);
+bool ART_remove(const ARTreePtr tree, const faster_str_ptr_t key);
+// walks the keys in byte order, returns false past the last one
+bool ART_iterator(ARTreePtr tree, faster_art_iterator_helper_t *it, const faster_str_t **key, faster_value_ptr *value);
+// positions the iterator on the keys starting with prefix, the prefix only has to live until the call returns
+bool ART_seek_prefix(ARTreePtr tree, const faster_str_ptr_t prefix, faster_art_iterator_helper_t *it);
+void ART_iterator_free(faster_art_iterator_helper_t *it);
+// bytes held by the node and leaf arrays
+size_t ART_memory_usage(const ARTreePtr tree);
+void ART_reset_and_free(const ARTreePtr tree);
+
+#define FASTER_ART_INCLUDE
+#endif // FASTER_ART_INCLUDE
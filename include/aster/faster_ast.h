@@ -1,7 +1,7 @@
 #ifdef FASTER_AST_INCLUDE
 #else
 
-#include "faster_avl.h"
+#include "faster_om.h"
 #include "faster_core.h"
 #include "faster_is.h"
 
@@ -78,7 +78,7 @@ typedef struct faster_ast_runtime_state_t_s *faster_ast_runtime_state_ptr_t;
 
 struct faster_ast_t_s {
   // declared
-  AVLNodesTree_t context_tree;
+  faster_ordered_map_t context_tree;
   faster_token_t_arr_t token_list;
   faster_indexing_t ast_root_id;
   faster_ast_node_t_arr_t ast_list;
@@ -92,7 +92,7 @@ typedef struct faster_ast_t_s *faster_ast_ptr_t;
 
 // we take node capacity to be the same as token capacity
 // we will have less nodes than tokens, but we will need more nodes during
-// actual execution we use the AVL tree structure to store the context of the
+// actual execution we use the ordered map structure to store the context of the
 // AST but runtime status will be kept directly for speed ast is actually a tree
 // of nodes, but we use a flat array to store the nodes
 
@@ -100,7 +100,7 @@ typedef struct faster_ast_t_s *faster_ast_ptr_t;
   DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(name##_token_array, faster_token_t, token_capacity);                                  \
   DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(name##_ast_array, faster_ast_node_t, token_capacity);                                 \
   DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(name##_float_array, faster_value_float_holder_t, token_capacity);                     \
-  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(name##faster_ast_context_tree, 16);                                                \
+  DECLARE_ORDERED_MAP_WITH_DYNAMIC_ALLOCATION(name##faster_ast_context_tree, 16);                                                  \
   faster_ast_t name = {.token_list = name##_token_array,                                                                           \
                        .ast_list = name##_ast_array,                                                                               \
                        .context_tree = name##_faster_ast_context_tree,                                                             \
@@ -114,6 +114,10 @@ typedef struct faster_ast_t_s *faster_ast_ptr_t;
 faster_error_code_t faster_ast_init(faster_ast_ptr_t ast);
 faster_error_code_t faster_ast_free(faster_ast_ptr_t ast);
 faster_error_code_t faster_tokenize(faster_ast_ptr_t ast, const faster_str_ptr_t str);
+// len bytes of UTF-8, FAST_AST_ERROR_INVALID_STRING when they are not well formed. In the wide builds token text
+// is interned in ast->interned_strings (the views hold until that table is swept), in the byte builds tokens view
+// src as faster_tokenize does
+faster_error_code_t faster_tokenize_utf8(faster_ast_ptr_t ast, const char *src, size_t len);
 faster_error_code_t faster_parse(faster_ast_ptr_t ast);
 faster_error_code_t faster_execute(faster_ast_ptr_t ast, faster_value_ptr *result);
 
@@ -8,22 +8,72 @@
 #define FASTER_AVL_NODE_VALID(node) ((node) != FASTER_AVL_NODE_INDEX_INVALID)
 #define FASTER_AVL_NODE_INVALID(node) ((node) == FASTER_AVL_NODE_INDEX_INVALID)
 
-#define FASTER_MAX_AVL_ITERATOR_STACK_SIZE 64
+// an AVL tree of 2^32 nodes is at most 1.44 * 32 levels deep
+#define FASTER_AVL_MAX_HEIGHT 48
+// iterators keep at most one node per level on their stack
+#define FASTER_MAX_AVL_ITERATOR_STACK_SIZE FASTER_AVL_MAX_HEIGHT
 #define FASTER_AVL_TREE_EMPTY_ITERATOR {.top = -1, .initialized = 0}
 
+// keep subtree sizes in the nodes for AVL_select, AVL_rank and AVL_count_range
+#ifndef FASTER_AVL_ORDER_STATISTICS
+#define FASTER_AVL_ORDER_STATISTICS 0
+#endif
+
+// set operations fork the top FASTER_AVL_PARALLEL_DEPTH levels of their recursion to threads,
+// as long as the operand driving the recursion is at least FASTER_AVL_PARALLEL_MIN_HEIGHT high
+#ifndef FASTER_AVL_PARALLEL_DEPTH
+#define FASTER_AVL_PARALLEL_DEPTH 2
+#endif
+#ifndef FASTER_AVL_PARALLEL_MIN_HEIGHT
+#define FASTER_AVL_PARALLEL_MIN_HEIGHT 12
+#endif
+
+// keep node keys as faster_sstr_t: keys of up to FASTER_SSTR_INLINE_UNITS units are copied into the node, so a
+// descent compares them against the searched key without leaving the node, longer keys refer to their units
+// as before. The view AVL_node_key gives of an inline key points into the node list, valid until the tree changes
+#ifndef FASTER_AVL_SSTR_KEYS
+#define FASTER_AVL_SSTR_KEYS 0
+#endif
+
 typedef faster_indexing_t AVLNodeIndex;
+#if FASTER_AVL_SSTR_KEYS
+typedef faster_sstr_t AVLNodeKey_t;
+#else
+typedef faster_str_t AVLNodeKey_t;
+#endif
 
 // Node structure for AVL Tree
+// the fields read on every step of a descent come first: the inline key prefix decides most
+// comparisons without touching the key bytes, the children are indexed by the comparison result
 struct AVLNode_t_s {
-  faster_str_t key;
+  faster_str_prefix_t key_prefix;
+  union {
+    struct {
+      AVLNodeIndex left;
+      AVLNodeIndex right;
+    };
+    AVLNodeIndex child[2];
+  };
+  AVLNodeKey_t key;
   faster_value_ptr value;
-  AVLNodeIndex left;
-  AVLNodeIndex right;
-  int height;
+#if FASTER_AVL_ORDER_STATISTICS
+  faster_indexing_t size; // nodes in the subtree, this one included
+#endif
+  int8_t height;
 } FASTER_ALIGNED;
+static_assert(FASTER_AVL_MAX_HEIGHT <= INT8_MAX, "AVL node height must fit in int8_t");
 typedef struct AVLNode_t_s AVLNode_t;
 typedef struct AVLNode_t_s *AVLNodePtr;
 
+// the key of a node as a faster_str_t, whichever form the nodes keep
+static inline faster_str_t AVL_node_key(const AVLNode_t *node) {
+#if FASTER_AVL_SSTR_KEYS
+  return faster_sstr_view(&node->key);
+#else
+  return node->key;
+#endif
+}
+
 // list
 DEFINE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(AVLNode_t);
 
@@ -37,7 +87,12 @@ typedef struct AVLNodesTree_t_s *AVLNodesTreePtr;
 typedef struct {
   AVLNodeIndex stack[FASTER_MAX_AVL_ITERATOR_STACK_SIZE];
   int top;         // Index of the top element in the stack (-1 when empty)
-  int initialized; // Flag to indicate if the iterator has been initialized
+  int initialized; // Flag to indicate if the iterator has been positioned
+  int reverse;     // walk in descending key order
+  // forward walks stop at the first key not below bound, reverse walks at the first key below it (NULL when unbounded)
+  faster_str_ptr_t bound;
+  faster_str_ptr_t prefix;                // only keys starting with prefix are returned (NULL for all keys)
+  faster_system_indexing_t prefix_length; // key length scanned by a prefix walk, keys are ordered by length first
 } faster_avl_tree_iterator_helper_t;
 
 #define DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(name, initial_capacity)                                                      \
@@ -45,10 +100,38 @@ typedef struct {
   AVLNodesTree_t name = {.root_node = FASTER_AVL_NODE_INDEX_INVALID, .node_list = name##_array}
 
 AVLNodeIndex AVL_iterator(AVLNodesTreePtr tree, faster_avl_tree_iterator_helper_t *it);
+// iterator positioning, all in O(log n); keys passed as bounds or prefixes must outlive the walk
+void AVL_seek_lower_bound(AVLNodesTreePtr tree, const faster_str_ptr_t key, faster_avl_tree_iterator_helper_t *it);
+void AVL_seek_upper_bound(AVLNodesTreePtr tree, const faster_str_ptr_t key, faster_avl_tree_iterator_helper_t *it);
+void AVL_seek_range(AVLNodesTreePtr tree, const faster_str_ptr_t from, const faster_str_ptr_t to,
+                    faster_avl_tree_iterator_helper_t *it);
+void AVL_seek_prefix(AVLNodesTreePtr tree, const faster_str_ptr_t prefix, faster_avl_tree_iterator_helper_t *it);
+void AVL_seek_reverse(AVLNodesTreePtr tree, const faster_str_ptr_t key, faster_avl_tree_iterator_helper_t *it);
+void AVL_seek_reverse_range(AVLNodesTreePtr tree, const faster_str_ptr_t from, const faster_str_ptr_t to,
+                            faster_avl_tree_iterator_helper_t *it);
 bool AVL_insert_or_update(const AVLNodesTreePtr tree, const faster_str_ptr_t key, const faster_value_ptr value);
 faster_value_ptr AVL_get(const AVLNodesTreePtr tree, const faster_str_ptr_t key);
 bool AVL_remove(const AVLNodesTreePtr tree, const faster_str_ptr_t key);
+bool AVL_bulk_load(AVLNodesTreePtr tree, const faster_str_t *keys, const faster_value_ptr *values, const faster_indexing_t count);
 void AVL_reset_and_free(const AVLNodesTreePtr tree);
 
+// join and split work on subtrees held in the node list of one tree, in O(log n); tree->root_node is left to the caller.
+// join needs every key of left below the key of middle and every key of right above it
+AVLNodeIndex AVL_join(const AVLNodesTreePtr tree, AVLNodeIndex left, AVLNodeIndex middle, AVLNodeIndex right);
+AVLNodeIndex AVL_join2(const AVLNodesTreePtr tree, AVLNodeIndex left, AVLNodeIndex right);
+AVLNodeIndex AVL_split(const AVLNodesTreePtr tree, AVLNodeIndex root, const faster_str_ptr_t key, AVLNodeIndex *left,
+                       AVLNodeIndex *right);
+// set algebra in O(m log(n/m + 1)), the result replaces the content of tree and other is left untouched
+bool AVL_union(AVLNodesTreePtr tree, const AVLNodesTreePtr other);
+void AVL_intersection(AVLNodesTreePtr tree, const AVLNodesTreePtr other);
+void AVL_difference(AVLNodesTreePtr tree, const AVLNodesTreePtr other);
+
+#if FASTER_AVL_ORDER_STATISTICS
+// order statistics in O(log n), ranks are 0 based
+AVLNodeIndex AVL_select(const AVLNodesTreePtr tree, faster_indexing_t rank);
+faster_indexing_t AVL_rank(const AVLNodesTreePtr tree, const faster_str_ptr_t key);
+faster_indexing_t AVL_count_range(const AVLNodesTreePtr tree, const faster_str_ptr_t from, const faster_str_ptr_t to);
+#endif
+
 #define FASTER_AVL_INCLUDE
 #endif // FASTER_AVL_INCLUDE
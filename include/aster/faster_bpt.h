@@ -0,0 +1,72 @@
+#ifdef FASTER_BPT_INCLUDE
+#else
+
+#include "aster/faster_core.h"
+#include <stdlib.h>
+
+// keys per node, the default gives nodes of about 1KB
+#ifndef FASTER_BPT_ORDER
+#define FASTER_BPT_ORDER 32
+#endif
+static_assert(FASTER_BPT_ORDER >= 4 && FASTER_BPT_ORDER % 2 == 0, "FASTER_BPT_ORDER must be even and at least 4");
+#define FASTER_BPT_MIN_KEYS (FASTER_BPT_ORDER / 2)
+#define FASTER_BPT_MAX_HEIGHT 16
+
+#define FASTER_BPT_NODE_INDEX_INVALID FASTER_ARRAY_COUNT_INVALID
+#define FASTER_BPT_NODE_VALID(node) ((node) != FASTER_BPT_NODE_INDEX_INVALID)
+#define FASTER_BPT_NODE_INVALID(node) ((node) == FASTER_BPT_NODE_INDEX_INVALID)
+
+#define FASTER_BPT_EMPTY_ITERATOR {.leaf = FASTER_BPT_NODE_INDEX_INVALID, .slot = 0, .initialized = 0}
+
+typedef faster_indexing_t BPTNodeIndex;
+
+// Node structure for B+ Tree
+// prefixes are kept apart from the keys, so the in-node search runs over one contiguous array,
+// internal nodes route with keys[i] being the smallest key below children[i + 1],
+// leaves hold the values and are linked in key order for scans
+struct BPTNode_t_s {
+  faster_indexing_t count;
+  faster_indexing_t is_leaf;
+  BPTNodeIndex prev;
+  BPTNodeIndex next;
+  faster_str_prefix_t prefixes[FASTER_BPT_ORDER];
+  faster_str_t keys[FASTER_BPT_ORDER];
+  union {
+    faster_value_ptr values[FASTER_BPT_ORDER];
+    BPTNodeIndex children[FASTER_BPT_ORDER + 1];
+  };
+} FASTER_ALIGNED;
+typedef struct BPTNode_t_s BPTNode_t;
+typedef struct BPTNode_t_s *BPTNodePtr;
+
+// list
+DEFINE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(BPTNode_t);
+
+struct BPTree_t_s {
+  BPTNodeIndex root_node;
+  faster_indexing_t elements;
+  BPTNode_t_arr_t node_list;
+};
+typedef struct BPTree_t_s BPTree_t;
+typedef struct BPTree_t_s *BPTreePtr;
+
+typedef struct {
+  BPTNodeIndex leaf;
+  faster_indexing_t slot;
+  int initialized; // Flag to indicate if the iterator has been positioned
+} faster_bpt_tree_iterator_helper_t;
+
+// initial capacity is given in keys, nodes are allocated half full in the worst case
+#define DECLARE_BPT_TREE_WITH_DYNAMIC_ALLOCATION(name, initial_capacity)                                                           \
+  DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(name##_array, BPTNode_t, ((initial_capacity) / FASTER_BPT_MIN_KEYS) + 1);            \
+  BPTree_t name = {.root_node = FASTER_BPT_NODE_INDEX_INVALID, .elements = 0, .node_list = name##_array}
+
+bool BPT_iterator(BPTreePtr tree, faster_bpt_tree_iterator_helper_t *it, const faster_str_t **key, faster_value_ptr *value);
+void BPT_seek(BPTreePtr tree, const faster_str_ptr_t key, faster_bpt_tree_iterator_helper_t *it);
+bool BPT_insert_or_update(const BPTreePtr tree, const faster_str_ptr_t key, const faster_value_ptr value);
+faster_value_ptr BPT_get(const BPTreePtr tree, const faster_str_ptr_t key);
+bool BPT_remove(const BPTreePtr tree, const faster_str_ptr_t key);
+void BPT_reset_and_free(const BPTreePtr tree);
+
+#define FASTER_BPT_INCLUDE
+#endif // FASTER_BPT_INCLUDE
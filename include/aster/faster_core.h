@@ -131,8 +131,8 @@ static inline faster_indexing_t _assume_within_range(const size_t value) {
   [[maybe_unused]] static inline void type##_arr_reset_and_free(type##_arr_ptr_t v, faster_indexing_t initial_capacity) {          \
     _arr_reset_and_free((_faster_default_array_ptr_t)v, initial_capacity);                                                         \
   }                                                                                                                                \
-  [[maybe_unused]] static inline faster_indexing_t type##_arr_count(type##_arr_ptr_t v) {                                          \
-    return _arr_count((_faster_default_array_ptr_t)v);                                                                             \
+  [[maybe_unused]] static inline faster_indexing_t type##_arr_count(const type##_arr_t *v) {                                       \
+    return _arr_count((const _faster_default_array_t *)v);                                                                         \
   }                                                                                                                                \
   [[maybe_unused]] static inline faster_indexing_t type##_arr_get_next(type##_arr_ptr_t v) {                                       \
     return _arr_get_next((_faster_default_array_ptr_t)v, sizeof(type));                                                            \
@@ -140,6 +140,9 @@ static inline faster_indexing_t _assume_within_range(const size_t value) {
   [[maybe_unused]] static inline void type##_arr_release(type##_arr_ptr_t v, const faster_indexing_t idx) {                        \
     _arr_release((_faster_default_array_ptr_t)v, idx, sizeof(type));                                                               \
   }                                                                                                                                \
+  [[maybe_unused]] static inline bool type##_arr_fill(type##_arr_ptr_t v, const faster_indexing_t count) {                         \
+    return _arr_fill((_faster_default_array_ptr_t)v, count, sizeof(type));                                                         \
+  }                                                                                                                                \
   static_assert(0 == 0)
 
 #define DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(name, type, initial_capacity)                                                   \
@@ -153,9 +156,11 @@ struct _default_array_struct {
 typedef struct _default_array_struct _faster_default_array_t;
 typedef struct _default_array_struct *_faster_default_array_ptr_t;
 void _arr_reset_and_free(_faster_default_array_ptr_t v, faster_indexing_t initial_capacity);
-faster_indexing_t _arr_count(_faster_default_array_ptr_t v);
+faster_indexing_t _arr_count(const _faster_default_array_t *v);
 faster_indexing_t _arr_get_next(_faster_default_array_ptr_t v, size_t element_size);
 void _arr_release(_faster_default_array_ptr_t v, const faster_indexing_t idx, size_t element_size);
+// drops every element and hands out [0, count) as used, for bulk builders
+bool _arr_fill(_faster_default_array_ptr_t v, const faster_indexing_t count, size_t element_size);
 
 // allocation helpers
 size_t faster_get_optimal_block_size(const size_t element_size, const size_t initial_count);
@@ -163,17 +168,168 @@ size_t faster_get_optimal_growth_increment(const size_t current_size);
 
 // local string comparison function dedicated for faster_str_t
 int faster_str_cmp_binary(const faster_str_t *str1, const faster_str_t *str2);
+
+// first 8 bytes of a string in memcmp order (big-endian, zero padded), kept next to keys
+// so that ordered containers can resolve most comparisons without touching the key bytes
+typedef uint64_t faster_str_prefix_t;
+#define FASTER_STR_PREFIX_BYTES sizeof(faster_str_prefix_t)
+#define FASTER_STR_PREFIX_UNITS (FASTER_STR_PREFIX_BYTES / sizeof(fchar_t))
+
+static inline faster_str_prefix_t faster_str_prefix(const faster_str_t *str) {
+  faster_str_prefix_t prefix = 0;
+  size_t bytes = FASTER_STRING_MEMORY_SIZE(str->str_len);
+  if (bytes > 0) {
+    memcpy(&prefix, str->str_ptr, (bytes < FASTER_STR_PREFIX_BYTES) ? bytes : FASTER_STR_PREFIX_BYTES);
+  }
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  prefix = __builtin_bswap64(prefix);
+#endif
+  return prefix;
+}
+
 faster_str_t faster_str_create(const fchar_t *null_terminated_str);
 
+// short strings in place: up to FASTER_SSTR_INLINE_UNITS units are kept inside the 16 bytes, longer ones refer
+// to the units of their owner as faster_str_t does. The last byte tells them apart, 0 for a reference and
+// FASTER_SSTR_INLINE_TAG | length inline. A string is inline whenever it fits, so equal strings always have the
+// same form and two inline strings compare as two 64-bit words without a dereference
+#define FASTER_SSTR_BYTES 16
+#define FASTER_SSTR_INLINE_UNITS ((FASTER_SSTR_BYTES - 1) / sizeof(fchar_t))
+#define FASTER_SSTR_INLINE_TAG 0x80
+
+union faster_sstr_u {
+  struct {
+    const fchar_t *ptr;
+    faster_str_len_t len;
+    unsigned char fill[FASTER_SSTR_BYTES - sizeof(const fchar_t *) - sizeof(faster_str_len_t) - 1];
+    unsigned char tag;
+  } ref;
+  fchar_t units[FASTER_SSTR_INLINE_UNITS];
+  uint64_t words[2];
+} FASTER_ALIGNED; // packed like faster_str_t, so it takes its place in container nodes
+typedef union faster_sstr_u faster_sstr_t;
+static_assert(sizeof(faster_sstr_t) == FASTER_SSTR_BYTES, "faster_sstr_t must stay 16 bytes");
+static_assert(FASTER_SSTR_INLINE_UNITS < FASTER_SSTR_INLINE_TAG, "inline length must fit below the tag bit");
+
+// copies str inline when it fits, otherwise refers to its units, which must outlive sstr. A reference keeps a
+// faster_str_len_t length, strings longer than FAST_LIMIT_INDEXING_MAX units are refused: false, sstr left empty
+bool faster_sstr_init(faster_sstr_t *sstr, const faster_str_t *str);
+// faster_prim_hash of the units, whichever the form
+uint32_t faster_sstr_hash(const faster_sstr_t *sstr);
+
+static inline bool faster_sstr_is_inline(const faster_sstr_t *sstr) { return (sstr->ref.tag & FASTER_SSTR_INLINE_TAG) != 0; }
+
+static inline size_t faster_sstr_len(const faster_sstr_t *sstr) {
+  return faster_sstr_is_inline(sstr) ? (size_t)(sstr->ref.tag & ~FASTER_SSTR_INLINE_TAG) : (size_t)sstr->ref.len;
+}
+
+static inline const fchar_t *faster_sstr_ptr(const faster_sstr_t *sstr) {
+  return faster_sstr_is_inline(sstr) ? sstr->units : sstr->ref.ptr;
+}
+
+// a view of the units, valid as long as sstr stays where it is
+static inline faster_str_t faster_sstr_view(const faster_sstr_t *sstr) {
+  return (faster_str_t){.str_ptr = faster_sstr_ptr(sstr), .str_len = faster_sstr_len(sstr)};
+}
+
+static inline bool faster_sstr_equal(const faster_sstr_t *sstr1, const faster_sstr_t *sstr2) {
+  if (sstr1->words[0] == sstr2->words[0] && sstr1->words[1] == sstr2->words[1]) {
+    return true;
+  }
+  // an inline string only equals an inline string, and those compared whole
+  if (faster_sstr_is_inline(sstr1) || faster_sstr_is_inline(sstr2) || sstr1->ref.len != sstr2->ref.len) {
+    return false;
+  }
+  return memcmp(sstr1->ref.ptr, sstr2->ref.ptr, FASTER_STRING_MEMORY_SIZE(sstr1->ref.len)) == 0;
+}
+
+// same ordering as faster_str_cmp_binary
+static inline int faster_sstr_cmp_binary(const faster_sstr_t *sstr1, const faster_sstr_t *sstr2) {
+  bool inline1 = faster_sstr_is_inline(sstr1), inline2 = faster_sstr_is_inline(sstr2);
+  if (inline1 && inline2) {
+    // the tags order by length, equal tags leave the units, zero padded, in both words
+    if (sstr1->ref.tag != sstr2->ref.tag) {
+      return (sstr1->ref.tag > sstr2->ref.tag) ? 1 : -1;
+    }
+    for (int word = 0; word < 2; word++) {
+      uint64_t word1 = sstr1->words[word], word2 = sstr2->words[word];
+      if (word1 != word2) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        word1 = __builtin_bswap64(word1);
+        word2 = __builtin_bswap64(word2);
+#endif
+        return (word1 > word2) ? 1 : -1;
+      }
+    }
+    return 0;
+  }
+  if (inline1 != inline2) {
+    // inline strings are the shorter ones
+    return inline1 ? -1 : 1;
+  }
+  faster_str_t view1 = faster_sstr_view(sstr1), view2 = faster_sstr_view(sstr2);
+  return faster_str_cmp_binary(&view1, &view2);
+}
+
 // dedicated implemenations for string
 size_t faster_strlen(const fchar_t *s);
 fchar_t *faster_strdup(const fchar_t *s);
 size_t faster_str_bytelen(const fchar_t *s);
 
-// these are implemented as simple copy functions in case of non-unicode support
+// these are implemented as simple copy functions in case of non-unicode support,
+// otherwise the multibyte side is UTF-8 whatever the locale. ASCII runs are vectorized in both directions,
+// from AVX2 on so are UTF-8 validation and runs of 1- to 3-byte sequences into fchar_t; 4-byte sequences, broken
+// input and the way back from non-ASCII units take the scalar path
 size_t faster_mb_to_unicode(const char *src, fchar_t *dest, size_t dest_size);
 size_t faster_unicode_to_mb(const fchar_t *src, char *dest, size_t dest_size);
 
+// streaming conversions: the input comes in chunks split anywhere and nothing is terminated, NUL is an ordinary
+// character. A sequence cut by the end of a chunk waits in the stream for the next one; last marks the final chunk,
+// whatever is still incomplete then is handled as invalid. Output stops before the first character that does
+// not fit whole, *consumed tells how much of src was taken (bytes or units), the return value how much was written.
+// dest must have room for FASTER_STREAM_MIN_ROOM units / bytes for every call to make progress
+#define FASTER_STREAM_MIN_ROOM 4
+
+struct faster_mb_stream_s {
+  unsigned char pending[4];
+  unsigned char pending_len;
+};
+typedef struct faster_mb_stream_s faster_mb_stream_t;
+
+struct faster_unicode_stream_s {
+  fchar_t pending[4];
+  unsigned char pending_len;
+};
+typedef struct faster_unicode_stream_s faster_unicode_stream_t;
+
+void faster_mb_stream_init(faster_mb_stream_t *stream);
+size_t faster_mb_stream_to_unicode(faster_mb_stream_t *stream, const char *src, size_t src_len, size_t *consumed, fchar_t *dest,
+                                   size_t dest_size, bool last);
+void faster_unicode_stream_init(faster_unicode_stream_t *stream);
+size_t faster_unicode_stream_to_mb(faster_unicode_stream_t *stream, const fchar_t *src, size_t src_len, size_t *consumed,
+                                   char *dest, size_t dest_size, bool last);
+
+// UTF-8 native processing: in the one-byte build (and without Unicode support) fchar_t text is the input bytes
+// themselves, so a buffer that is valid UTF-8 is tokenized, interned and hashed in place, with no conversion pass.
+// Structural characters are ASCII and never occur inside a multibyte sequence, so byte classification finds them;
+// code points are decoded only where they are needed. The wide builds take the same UTF-8 buffers through
+// faster_tokenize_utf8 and faster_interned_strings_symbol_utf8: structure is still classified byte by byte and only
+// the text of a token is decoded, when it is interned, so interned strings and their hash index stay fchar_t
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_ONE_BYTE || FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_NONE
+#define FASTER_UNICODE_NATIVE_BYTES 1
+static inline faster_str_t faster_str_from_utf8(const char *src, size_t len) {
+  return (faster_str_t){.str_ptr = (const fchar_t *)src, .str_len = len};
+}
+#else
+#define FASTER_UNICODE_NATIVE_BYTES 0
+#endif
+
+// length of the well-formed UTF-8 prefix of src, len when all of it is
+size_t faster_utf8_valid(const char *src, size_t len);
+// the code point at *pos, which moves past it; a unit that starts no character decodes to U+FFFD and is passed by one.
+// Without Unicode support the code is the byte
+uint_least32_t faster_str_decode(const fchar_t *str, size_t len, size_t *pos);
+
 #ifdef NDEBUG
 #warning "Debug mode enabled"
 #endif
@@ -0,0 +1,40 @@
+#ifdef FASTER_FROZEN_INCLUDE
+#else
+
+#include "aster/faster_avl.h"
+
+// frozen ordered map: the keys of a finished AVL tree laid out in Eytzinger (breadth-first) order,
+// slot k has its children at 2k and 2k + 1, so a lookup walks the array front to back without branching on the result
+// and the line holding the grandchildren of a slot can be prefetched one level ahead
+
+// slots are 1 based, entries stay 64 byte aligned so the four grandchildren of a slot share a cache line
+#define FASTER_FROZEN_ALIGNMENT 64
+#define FASTER_FROZEN_PREFETCH_DISTANCE 4
+
+// what the descent reads: ordering is by length first, then by the inline prefix
+struct faster_frozen_entry_s {
+  faster_str_prefix_t prefix;
+  size_t length;
+};
+
+struct faster_frozen_s {
+  faster_indexing_t count;
+  struct faster_frozen_entry_s *entries; // count + 1 slots, slot 0 unused
+  const fchar_t **keys;                  // key bytes, only read past the prefix and on the final match
+  faster_value_ptr *values;
+};
+typedef struct faster_frozen_s faster_frozen_t;
+typedef struct faster_frozen_s *faster_frozen_ptr_t;
+
+#define FASTER_FROZEN_EMPTY {.count = 0, .entries = NULL, .keys = NULL, .values = NULL}
+
+// freeze copies the keys and values of tree, the key bytes are shared and must outlive frozen; with
+// FASTER_AVL_SSTR_KEYS the short keys are read from the nodes, so tree must then stay unchanged as long as frozen
+faster_error_code_t AVL_freeze(const AVLNodesTreePtr tree, faster_frozen_ptr_t frozen);
+// thaw loads every key of frozen into tree in O(n) when tree is empty, frozen is left untouched
+faster_error_code_t AVL_thaw(const faster_frozen_ptr_t frozen, AVLNodesTreePtr tree);
+faster_value_ptr faster_frozen_get(const faster_frozen_ptr_t frozen, const faster_str_ptr_t key);
+void faster_frozen_free(faster_frozen_ptr_t frozen);
+
+#define FASTER_FROZEN_INCLUDE
+#endif // FASTER_FROZEN_INCLUDE
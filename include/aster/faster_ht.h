@@ -15,18 +15,54 @@ struct faster_ht_key_data_s {
 typedef struct faster_ht_key_data_s faster_ht_key_data_t;
 typedef struct faster_ht_key_data_s *faster_ht_key_data_ptr_t;
 
-struct faster_ht_entry_linked_s {
+// keep entry keys as faster_sstr_t: keys of up to FASTER_SSTR_INLINE_UNITS units are copied into the entry and
+// matched as two words, longer ones refer to the key bytes as before. Keys are then fchar_t strings, len a multiple
+// of sizeof(fchar_t); faster_ht_hash of the key data is the faster_sstr_hash of the stored key
+#ifndef FASTER_HT_SSTR_KEYS
+#define FASTER_HT_SSTR_KEYS 0
+#endif
+
+#if FASTER_HT_SSTR_KEYS
+typedef faster_sstr_t faster_ht_stored_key_t;
+#else
+typedef faster_ht_key_data_t faster_ht_stored_key_t;
+#endif
+
+// dense, insertion-ordered entry; removed entries stay in place as holes
+// (hash == FASTER_HASH_VALUE_INVALID) until the next resize compacts them
+struct faster_ht_entry_s {
   faster_hash_value_t hash;
-  faster_ht_key_data_t key;
+#if FASTER_HT_SSTR_KEYS
+  uint32_t fill;
+#endif
+  faster_ht_stored_key_t key;
   faster_value_ptr value;
-  faster_indexing_t next;
 } FASTER_ALIGNED;
-typedef struct faster_ht_entry_linked_s faster_ht_entry_linked_t;
+static_assert(sizeof(struct faster_ht_entry_s) % sizeof(faster_value_ptr) == 0, "faster_ht_entry_t values must stay aligned");
+typedef struct faster_ht_entry_s faster_ht_entry_t;
+typedef struct faster_ht_entry_s *faster_ht_entry_ptr_t;
+
+// sparse index slots are 1, 2 or 4 bytes wide depending on the table size,
+// the two highest values of each width are reserved for empty and deleted slots
+#define FASTER_HT_INDEX_MIN_CAPACITY 8
+#define FASTER_HT_INDEX_WIDTH_FOR_CAPACITY(capacity) (((capacity) <= 0x100) ? 1 : (((capacity) <= 0x10000) ? 2 : 4))
+
+// tables with up to FASTER_HT_INLINE_CAPACITY elements keep their entries inside faster_ht_t
+// and are searched linearly by cached hash, the index is only allocated once that is exceeded
+#ifndef FASTER_HT_INLINE_CAPACITY
+#define FASTER_HT_INLINE_CAPACITY 4
+#endif
+static_assert(FASTER_HT_INLINE_CAPACITY > 0, "FASTER_HT_INLINE_CAPACITY must be at least 1");
 
-typedef faster_indexing_t faster_ht_entry_t;
-typedef faster_indexing_t *faster_ht_entry_ptr_t;
+// iteration over the dense entries, in insertion order
+typedef faster_indexing_t faster_ht_iterator_t;
+#define FASTER_HT_EMPTY_ITERATOR ((faster_ht_iterator_t)0)
 
-DEFINE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(faster_ht_entry_linked_t);
+// handle to an entry (its position in the dense entries), valid until the next insertion of a new key,
+// removal or clear: growing and shrinking compact the holes and renumber the entries. Upserts of keys
+// already present keep it
+typedef faster_indexing_t faster_ht_handle_t;
+#define FASTER_HT_HANDLE_INVALID ((faster_ht_handle_t)FASTER_ARRAY_INDEX_INVALID)
 
 // hash function type for supporting custom hash functions
 typedef faster_hash_value_t (*faster_ht_hash_func_t)(faster_ht_key_data_ptr_t key);
@@ -37,9 +73,12 @@ struct faster_ht_s {
   faster_indexing_t requested_capacity;
   faster_indexing_t next_grow_at;
   faster_indexing_t next_shrink_at;
+  faster_indexing_t entries_used;
   faster_ht_hash_func_t hash_func;
+  faster_value_ptr index;
   faster_ht_entry_ptr_t entries;
-  faster_ht_entry_linked_t_arr_t entries_linked;
+  unsigned char index_width;
+  faster_ht_entry_t inline_entries[FASTER_HT_INLINE_CAPACITY] __attribute__((aligned(sizeof(faster_value_ptr))));
 };
 typedef struct faster_ht_s faster_ht_t;
 typedef struct faster_ht_s *faster_ht_ptr_t;
@@ -54,4 +93,24 @@ faster_value_ptr faster_ht_get(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key)
 faster_error_code_t faster_ht_set(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, faster_value_ptr value);
 faster_error_code_t faster_ht_remove(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key);
 
+// prehashed variants take the value the table's hash function returns for the key
+faster_value_ptr faster_ht_get_prehashed(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, faster_hash_value_t hash);
+faster_error_code_t faster_ht_set_prehashed(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, faster_hash_value_t hash,
+                                            faster_value_ptr value);
+faster_error_code_t faster_ht_remove_prehashed(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, faster_hash_value_t hash);
+
+// get-or-insert in a single probe, new entries start with FASTER_NULL_VALUE
+faster_ht_handle_t faster_ht_upsert(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, bool *inserted);
+faster_ht_handle_t faster_ht_upsert_prehashed(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, faster_hash_value_t hash,
+                                              bool *inserted);
+faster_ht_handle_t faster_ht_find(const faster_ht_t *ht, faster_ht_key_data_ptr_t key);
+faster_ht_handle_t faster_ht_find_prehashed(const faster_ht_t *ht, faster_ht_key_data_ptr_t key, faster_hash_value_t hash);
+
+// handle based access, no hashing and no key comparison
+faster_value_ptr *faster_ht_handle_value(faster_ht_ptr_t ht, faster_ht_handle_t handle);
+faster_value_ptr faster_ht_handle_get(const faster_ht_t *ht, faster_ht_handle_t handle);
+faster_error_code_t faster_ht_handle_remove(faster_ht_ptr_t ht, faster_ht_handle_t handle);
+
+faster_ht_entry_ptr_t faster_ht_iterator(faster_ht_ptr_t ht, faster_ht_iterator_t *it);
+
 #endif // FASTER_HT_H
@@ -1,7 +1,9 @@
 #ifdef FASTER_IS_INCLUDE
 #else
 
-#include "faster_avl.h"
+#include "faster_ht.h"
+#include <stdatomic.h>
+#include <threads.h>
 
 // interned strings implementation
 enum faster_interned_string_purpose_e {
@@ -17,18 +19,182 @@ typedef faster_value_int_holder_t faster_interned_string_purpose_t;
 
 #define FASTER_INTERNED_STRING_PURPOSE_HAS_PURPOSE(purpose, check_purpose) (((purpose) & (check_purpose)) != 0)
 
+// every interned string gets a dense symbol id, two interned strings are equal exactly when their ids are
+typedef faster_base_32_bit_unsigned_t faster_symbol_t;
+#define FASTER_SYMBOL_INVALID ((faster_symbol_t)FASTER_ARRAY_INDEX_INVALID)
+
+// string arena: the bytes of interned strings are appended to chunks that are never moved or reallocated,
+// so the views handed out stay valid until the table is freed; strings longer than a chunk get a chunk of their own
+#ifndef FASTER_IS_ARENA_CHUNK_SIZE
+#define FASTER_IS_ARENA_CHUNK_SIZE 65536
+#endif
+
+struct faster_is_arena_chunk_s {
+  struct faster_is_arena_chunk_s *next;
+  size_t used;
+  size_t size;
+  fchar_t data[];
+};
+
+struct faster_is_arena_s {
+  struct faster_is_arena_chunk_s *chunks; // the chunk being filled comes first
+  size_t bytes;                           // string bytes stored, terminators included
+  size_t garbage;                         // bytes of swept strings still in the chunks
+};
+typedef struct faster_is_arena_s faster_is_arena_t;
+
+// symbol table entry, indexed by symbol id; str is a zero terminated copy in the arena.
+// a symbol is reclaimed by a sweep once its references drop to 0, its id is then handed out again
+struct faster_interned_symbol_s {
+  faster_str_t str;
+  faster_interned_string_purpose_t purpose;
+  faster_hash_value_t hash;
+  faster_indexing_t references;
+} FASTER_ALIGNED;
+#define FASTER_IS_SYMBOL_FREE ((faster_indexing_t)FASTER_ARRAY_INDEX_INVALID)
+// a sweep compacts the arena once swept strings take up this fraction of it
+#ifndef FASTER_IS_COMPACT_PERCENT
+#define FASTER_IS_COMPACT_PERCENT 50
+#endif
+typedef struct faster_interned_symbol_s faster_interned_symbol_t;
+DEFINE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(faster_interned_symbol_t);
+
+// the hash index maps the string bytes to the symbol id, the symbol table maps the id back in O(1).
+// a layered table is an overlay on a frozen base table: the base is searched first, symbols below base_count
+// are the symbols of the base and the overlay numbers its own symbols from base_count on
 struct faster_interned_strings_t_s {
-  AVLNodesTree_t avl_tree;
+  faster_ht_t index;
+  faster_interned_symbol_t_arr_t symbols;
+  faster_indexing_t symbols_used; // ids below this were handed out at least once
+  faster_is_arena_t arena;
+  const struct faster_interned_strings_t_s *base; // NULL for a standalone table
+  faster_indexing_t base_count;
+  faster_interned_string_purpose_t *base_purposes; // purposes the overlay added to base symbols, allocated on first use
 };
 typedef struct faster_interned_strings_t_s faster_interned_strings_t;
 typedef struct faster_interned_strings_t_s *faster_interned_strings_ptr_t;
 
 void faster_interned_strings_init(faster_interned_strings_ptr_t interned_strings);
+// an overlay allocates nothing until it interns a string the base does not have; base must outlive it and never change
+void faster_interned_strings_init_layered(faster_interned_strings_ptr_t interned_strings, const faster_interned_strings_t *base);
+// the process wide base table of operator names and reserved words, built once on first use and shared by every thread
+const faster_interned_strings_t *faster_interned_strings_base(void);
 void faster_interned_strings_free(faster_interned_strings_ptr_t interned_strings);
-faster_interned_string_purpose_t faster_interned_strings_get(faster_interned_strings_ptr_t interned_strings,
+faster_interned_string_purpose_t faster_interned_strings_get(const faster_interned_strings_t *interned_strings,
                                                              const faster_str_ptr_t str);
 void faster_interned_strings_intern(const faster_interned_strings_ptr_t interned_strings, const faster_str_ptr_t str,
                                     const faster_interned_string_purpose_t purpose);
 
+// interns str, adds purpose to it and takes a reference on the symbol, FASTER_SYMBOL_INVALID when out of memory;
+// strings interned through faster_interned_strings_intern keep that reference for good
+faster_symbol_t faster_interned_strings_symbol(const faster_interned_strings_ptr_t interned_strings, const faster_str_ptr_t str,
+                                               const faster_interned_string_purpose_t purpose);
+// the symbol of str without interning it, FASTER_SYMBOL_INVALID when str was never interned
+faster_symbol_t faster_interned_strings_find(const faster_interned_strings_t *interned_strings, const faster_str_ptr_t str);
+// the same for len bytes of UTF-8: the byte builds take them as they are, the wide builds decode them to fchar_t
+// first (a broken sequence becomes a replacement character), so both forms of a string meet in one symbol
+faster_symbol_t faster_interned_strings_symbol_utf8(const faster_interned_strings_ptr_t interned_strings, const char *src, size_t len,
+                                                    const faster_interned_string_purpose_t purpose);
+faster_symbol_t faster_interned_strings_find_utf8(const faster_interned_strings_t *interned_strings, const char *src, size_t len);
+faster_indexing_t faster_interned_strings_count(const faster_interned_strings_t *interned_strings);
+// references on symbols of the overlay, the symbols of a base are never reclaimed
+void faster_interned_strings_acquire(const faster_interned_strings_ptr_t interned_strings, const faster_symbol_t symbol);
+void faster_interned_strings_release(const faster_interned_strings_ptr_t interned_strings, const faster_symbol_t symbol);
+// reclaims the symbols without references and returns how many; their ids are reused by later interning.
+// the string views of every symbol move when the sweep compacts the arena, the ids of live symbols stay
+faster_indexing_t faster_interned_strings_sweep(const faster_interned_strings_ptr_t interned_strings);
+// bytes held by the symbol table and the arena, the hash index and the base not included
+size_t faster_interned_strings_memory_usage(const faster_interned_strings_ptr_t interned_strings);
+
+// id to string in O(1), symbol must come from the same interned strings; the view lives as long as the table
+static inline const faster_str_t *faster_interned_strings_str(const faster_interned_strings_t *interned_strings,
+                                                              const faster_symbol_t symbol) {
+  if (symbol < interned_strings->base_count) {
+    return faster_interned_strings_str(interned_strings->base, symbol);
+  }
+  return &interned_strings->symbols.list[symbol - interned_strings->base_count].str;
+}
+static inline faster_interned_string_purpose_t faster_interned_strings_purpose(const faster_interned_strings_t *interned_strings,
+                                                                               const faster_symbol_t symbol) {
+  if (symbol < interned_strings->base_count) {
+    return faster_interned_strings_purpose(interned_strings->base, symbol) |
+           ((interned_strings->base_purposes != NULL) ? interned_strings->base_purposes[symbol] : 0);
+  }
+  return interned_strings->symbols.list[symbol - interned_strings->base_count].purpose;
+}
+
+// concurrent interned strings: one symbol space shared by every thread.
+// lookups never lock: they probe an open addressing index of atomic slots, each holding the hash and the symbol id.
+// interning a string that is already there takes the same path, only a miss takes the lock to add the symbol;
+// a grown index is published with a single pointer store and the old one is kept until the table is freed.
+// symbols live in segments that double in size and never move, so id to string stays O(1) without locking
+#define FASTER_CIS_FIRST_SEGMENT_BITS 8
+#define FASTER_CIS_SEGMENTS (32 - FASTER_CIS_FIRST_SEGMENT_BITS + 1)
+#define FASTER_CIS_INDEX_MIN_CAPACITY 256
+
+struct faster_concurrent_symbol_s {
+  faster_str_t str;
+  faster_hash_value_t hash;
+  _Atomic faster_interned_string_purpose_t purpose;
+};
+
+struct faster_concurrent_index_s {
+  struct faster_concurrent_index_s *retired; // the index this one replaced
+  size_t mask;
+  _Atomic uint64_t slots[]; // hash << 32 | (id + 1), 0 when empty
+};
+
+struct faster_concurrent_interned_strings_s {
+  _Atomic(struct faster_concurrent_index_s *) index;
+  _Atomic(struct faster_concurrent_symbol_s *) segments[FASTER_CIS_SEGMENTS];
+  _Atomic faster_indexing_t count; // symbols published, the base not included
+  mtx_t lock;                      // taken by misses only
+  faster_is_arena_t arena;         // written under the lock
+  const faster_interned_strings_t *base;
+  faster_indexing_t base_count;
+  _Atomic faster_interned_string_purpose_t *base_purposes; // purposes the table added to base symbols
+};
+typedef struct faster_concurrent_interned_strings_s faster_concurrent_interned_strings_t;
+typedef struct faster_concurrent_interned_strings_s *faster_concurrent_interned_strings_ptr_t;
+
+// base may be NULL, else it must outlive the table and never change; symbols of a concurrent table are never reclaimed
+faster_error_code_t faster_concurrent_interned_strings_init(faster_concurrent_interned_strings_ptr_t interned_strings,
+                                                           const faster_interned_strings_t *base);
+void faster_concurrent_interned_strings_free(faster_concurrent_interned_strings_ptr_t interned_strings);
+faster_symbol_t faster_concurrent_interned_strings_symbol(const faster_concurrent_interned_strings_ptr_t interned_strings,
+                                                          const faster_str_ptr_t str, const faster_interned_string_purpose_t purpose);
+// lock free
+faster_symbol_t faster_concurrent_interned_strings_find(const faster_concurrent_interned_strings_ptr_t interned_strings,
+                                                        const faster_str_ptr_t str);
+faster_interned_string_purpose_t faster_concurrent_interned_strings_get(const faster_concurrent_interned_strings_ptr_t interned_strings,
+                                                                       const faster_str_ptr_t str);
+faster_indexing_t faster_concurrent_interned_strings_count(const faster_concurrent_interned_strings_ptr_t interned_strings);
+
+// the segment of an id and its place in it, segment k holds 2^(k + FASTER_CIS_FIRST_SEGMENT_BITS) symbols
+static inline struct faster_concurrent_symbol_s *
+_faster_concurrent_symbol(const faster_concurrent_interned_strings_ptr_t interned_strings, const faster_indexing_t local) {
+  unsigned int segment = (unsigned int)(31 - __builtin_clz((local >> FASTER_CIS_FIRST_SEGMENT_BITS) + 1));
+  faster_indexing_t first = (((faster_indexing_t)1 << segment) - 1) << FASTER_CIS_FIRST_SEGMENT_BITS;
+  return atomic_load_explicit(&interned_strings->segments[segment], memory_order_acquire) + (local - first);
+}
+
+// id to string and purpose, lock free; symbol must have been returned by the table
+static inline const faster_str_t *faster_concurrent_interned_strings_str(const faster_concurrent_interned_strings_ptr_t interned_strings,
+                                                                         const faster_symbol_t symbol) {
+  if (symbol < interned_strings->base_count) {
+    return faster_interned_strings_str(interned_strings->base, symbol);
+  }
+  return &_faster_concurrent_symbol(interned_strings, symbol - interned_strings->base_count)->str;
+}
+static inline faster_interned_string_purpose_t
+faster_concurrent_interned_strings_purpose(const faster_concurrent_interned_strings_ptr_t interned_strings, const faster_symbol_t symbol) {
+  if (symbol < interned_strings->base_count) {
+    return faster_interned_strings_purpose(interned_strings->base, symbol) |
+           atomic_load_explicit(&interned_strings->base_purposes[symbol], memory_order_relaxed);
+  }
+  return atomic_load_explicit(&_faster_concurrent_symbol(interned_strings, symbol - interned_strings->base_count)->purpose,
+                              memory_order_relaxed);
+}
+
 #define FASTER_IS_INCLUDE
 #endif // FASTER_IS_INCLUDE
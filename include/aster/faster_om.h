@@ -0,0 +1,51 @@
+#ifdef FASTER_OM_INCLUDE
+#else
+
+#include "aster/faster_core.h"
+
+// ordered string map, backed by the AVL tree or the B+ tree depending on FASTER_ORDERED_MAP
+
+#if FASTER_ORDERED_MAP == FASTER_ORDERED_MAP_BPT
+
+#include "faster_bpt.h"
+
+typedef BPTree_t faster_ordered_map_t;
+typedef BPTree_t *faster_ordered_map_ptr_t;
+
+#define DECLARE_ORDERED_MAP_WITH_DYNAMIC_ALLOCATION(name, initial_capacity)                                                        \
+  DECLARE_BPT_TREE_WITH_DYNAMIC_ALLOCATION(name, initial_capacity)
+
+static inline faster_value_ptr faster_om_get(const faster_ordered_map_ptr_t map, const faster_str_ptr_t key) {
+  return BPT_get(map, key);
+}
+static inline bool faster_om_insert_or_update(const faster_ordered_map_ptr_t map, const faster_str_ptr_t key,
+                                              const faster_value_ptr value) {
+  return BPT_insert_or_update(map, key, value);
+}
+static inline bool faster_om_remove(const faster_ordered_map_ptr_t map, const faster_str_ptr_t key) { return BPT_remove(map, key); }
+static inline void faster_om_reset_and_free(const faster_ordered_map_ptr_t map) { BPT_reset_and_free(map); }
+
+#else
+
+#include "faster_avl.h"
+
+typedef AVLNodesTree_t faster_ordered_map_t;
+typedef AVLNodesTree_t *faster_ordered_map_ptr_t;
+
+#define DECLARE_ORDERED_MAP_WITH_DYNAMIC_ALLOCATION(name, initial_capacity)                                                        \
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(name, initial_capacity)
+
+static inline faster_value_ptr faster_om_get(const faster_ordered_map_ptr_t map, const faster_str_ptr_t key) {
+  return AVL_get(map, key);
+}
+static inline bool faster_om_insert_or_update(const faster_ordered_map_ptr_t map, const faster_str_ptr_t key,
+                                              const faster_value_ptr value) {
+  return AVL_insert_or_update(map, key, value);
+}
+static inline bool faster_om_remove(const faster_ordered_map_ptr_t map, const faster_str_ptr_t key) { return AVL_remove(map, key); }
+static inline void faster_om_reset_and_free(const faster_ordered_map_ptr_t map) { AVL_reset_and_free(map); }
+
+#endif
+
+#define FASTER_OM_INCLUDE
+#endif // FASTER_OM_INCLUDE
@@ -0,0 +1,72 @@
+#ifdef FASTER_PAR_INCLUDE
+#else
+
+#include "aster/faster_avl.h"
+#include "aster/faster_ht.h"
+#include <threads.h>
+
+// thread pool and parallel traversals: an AVL tree is cut into subtrees plus the nodes above them,
+// a hash table into ranges of its dense entries; the pieces are handed out to the pool in key / entry order
+
+// an AVL walk splits the top levels of the tree into up to 2^(depth + 1) - 1 pieces,
+// aiming at FASTER_PAR_TASKS_PER_THREAD pieces per thread so that uneven subtrees even out
+#define FASTER_PAR_TASKS_PER_THREAD 4
+#define FASTER_PAR_AVL_MAX_SPLIT_DEPTH 10
+// a hash table walk never hands out fewer entries than this to a task
+#ifndef FASTER_PAR_HT_MIN_RANGE
+#define FASTER_PAR_HT_MIN_RANGE 4096
+#endif
+
+typedef void (*faster_pool_task_func_t)(void *arg, size_t task);
+
+struct _faster_pool_batch_s;
+
+// the calling thread of faster_pool_run works along with the pool threads
+struct faster_pool_s {
+  thrd_t *threads;
+  unsigned int thread_count; // threads started, the caller not included
+  mtx_t lock;
+  cnd_t wake;     // a batch was posted or the pool is stopping
+  cnd_t finished; // the last worker left the batch
+  mtx_t run_lock; // one batch at a time
+  struct _faster_pool_batch_s *batch;
+  size_t generation;
+  unsigned int active;
+  bool stopping;
+};
+typedef struct faster_pool_s faster_pool_t;
+typedef struct faster_pool_s *faster_pool_ptr_t;
+
+// threads counts the calling thread, 0 or 1 starts no thread; when the system refuses threads the pool runs with fewer
+faster_error_code_t faster_pool_init(faster_pool_ptr_t pool, const unsigned int threads);
+void faster_pool_free(faster_pool_ptr_t pool);
+// runs func(arg, task) for every task in [0, count) and returns once all are done; a NULL pool runs them on the caller.
+// tasks must not run batches on the same pool
+void faster_pool_run(faster_pool_ptr_t pool, faster_pool_task_func_t func, void *arg, const size_t count);
+
+// the walks must not change the shape of the structure, callbacks may update values in place
+typedef void (*faster_avl_visit_func_t)(AVLNodePtr node, void *context);
+typedef void (*faster_ht_visit_func_t)(faster_ht_entry_ptr_t entry, void *context);
+typedef void (*faster_avl_fold_func_t)(void *accumulator, AVLNodePtr node, void *context);
+typedef void (*faster_ht_fold_func_t)(void *accumulator, faster_ht_entry_ptr_t entry, void *context);
+
+// every piece is folded into its own accumulator, starting from init, and the partial results are combined
+// in key / entry order: combine only has to be associative, and init must be its identity
+struct faster_reduction_s {
+  size_t size; // bytes of an accumulator
+  void (*init)(void *accumulator, void *context);
+  void (*combine)(void *accumulator, const void *other, void *context);
+  void *context; // passed to init, combine and the fold function
+};
+typedef struct faster_reduction_s faster_reduction_t;
+
+void AVL_for_each_parallel(faster_pool_ptr_t pool, const AVLNodesTreePtr tree, faster_avl_visit_func_t visit, void *context);
+faster_error_code_t AVL_reduce_parallel(faster_pool_ptr_t pool, const AVLNodesTreePtr tree, faster_avl_fold_func_t fold,
+                                        const faster_reduction_t *reduction, void *result);
+void faster_ht_for_each_parallel(faster_pool_ptr_t pool, const faster_ht_ptr_t ht, faster_ht_visit_func_t visit,
+                                 void *context);
+faster_error_code_t faster_ht_reduce_parallel(faster_pool_ptr_t pool, const faster_ht_ptr_t ht, faster_ht_fold_func_t fold,
+                                              const faster_reduction_t *reduction, void *result);
+
+#define FASTER_PAR_INCLUDE
+#endif // FASTER_PAR_INCLUDE
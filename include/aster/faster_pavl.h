@@ -0,0 +1,115 @@
+#ifdef FASTER_PAVL_INCLUDE
+#else
+
+#include "aster/faster_core.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+// persistent AVL tree: a single writer copies the path it touches and publishes a new root,
+// readers take O(1) snapshots and never lock, nodes are reclaimed once no snapshot can reach them
+
+#define FASTER_PAVL_NODE_INDEX_INVALID FASTER_ARRAY_COUNT_INVALID
+#define FASTER_PAVL_NODE_VALID(node) ((node) != FASTER_PAVL_NODE_INDEX_INVALID)
+#define FASTER_PAVL_NODE_INVALID(node) ((node) == FASTER_PAVL_NODE_INDEX_INVALID)
+
+#define FASTER_PAVL_MAX_HEIGHT 48
+// nodes a single write can allocate: the copied path plus the rotated children
+#define FASTER_PAVL_MAX_WRITE_NODES (3 * FASTER_PAVL_MAX_HEIGHT + 2)
+
+// node storage grows by segments of doubling size that never move, so readers can follow
+// indices while the writer allocates; segment k holds FASTER_PAVL_SEGMENT_BASE << k nodes
+#ifndef FASTER_PAVL_SEGMENT_BASE
+#define FASTER_PAVL_SEGMENT_BASE 1024
+#endif
+#define FASTER_PAVL_MAX_SEGMENTS 22
+
+#ifndef FASTER_PAVL_MAX_READERS
+#define FASTER_PAVL_MAX_READERS 64
+#endif
+#define FASTER_PAVL_READER_FREE UINT64_MAX
+#define FASTER_PAVL_READER_IDLE 0
+
+#define FASTER_PAVL_EMPTY_ITERATOR {.top = -1, .initialized = 0}
+
+typedef faster_indexing_t PAVLNodeIndex;
+
+// same layout as the AVL node, fresh marks copies of the write in progress that can still change in place
+struct PAVLNode_t_s {
+  faster_str_prefix_t key_prefix;
+  union {
+    struct {
+      PAVLNodeIndex left;
+      PAVLNodeIndex right;
+    };
+    PAVLNodeIndex child[2];
+  };
+  faster_str_t key;
+  faster_value_ptr value;
+  int8_t height;
+  uint8_t fresh;
+} FASTER_ALIGNED;
+typedef struct PAVLNode_t_s PAVLNode_t;
+typedef struct PAVLNode_t_s *PAVLNodePtr;
+
+struct faster_pavl_retired_s {
+  PAVLNodeIndex node;
+  uint64_t epoch; // epoch in which the node left the tree
+};
+
+struct faster_pavl_s {
+  // shared with the readers
+  _Atomic PAVLNodeIndex root;
+  _Atomic uint64_t epoch;
+  _Atomic uint64_t readers[FASTER_PAVL_MAX_READERS]; // epoch announced by each reader slot
+  PAVLNodePtr segments[FASTER_PAVL_MAX_SEGMENTS];
+  // writer only
+  faster_indexing_t elements;
+  faster_indexing_t allocated; // nodes handed out from the segments so far
+  faster_indexing_t capacity;  // nodes the allocated segments can hold
+  PAVLNodeIndex free_list;
+  faster_indexing_t free_count;
+  struct faster_pavl_retired_s *retired;
+  size_t retired_count;
+  size_t retired_capacity;
+  PAVLNodeIndex fresh[FASTER_PAVL_MAX_WRITE_NODES];
+  faster_indexing_t fresh_count;
+};
+typedef struct faster_pavl_s faster_pavl_t;
+typedef struct faster_pavl_s *faster_pavl_ptr_t;
+
+typedef struct {
+  PAVLNodeIndex root;
+  int reader;
+} faster_pavl_snapshot_t;
+
+typedef struct {
+  PAVLNodeIndex stack[FASTER_PAVL_MAX_HEIGHT];
+  int top;
+  int initialized;
+} faster_pavl_iterator_helper_t;
+
+static inline PAVLNodePtr faster_pavl_node(const faster_pavl_ptr_t tree, const PAVLNodeIndex node) {
+  size_t block = (size_t)node / FASTER_PAVL_SEGMENT_BASE + 1;
+  unsigned int segment = (unsigned int)(63 - __builtin_clzll(block));
+  size_t first = (size_t)FASTER_PAVL_SEGMENT_BASE * (((size_t)1 << segment) - 1);
+  return tree->segments[segment] + ((size_t)node - first);
+}
+
+faster_error_code_t faster_pavl_init(faster_pavl_ptr_t tree);
+void faster_pavl_free(faster_pavl_ptr_t tree);
+
+// writer side, one thread at a time
+bool faster_pavl_insert_or_update(faster_pavl_ptr_t tree, const faster_str_ptr_t key, const faster_value_ptr value);
+bool faster_pavl_remove(faster_pavl_ptr_t tree, const faster_str_ptr_t key);
+
+// reader side, a reader slot holds one snapshot at a time
+int faster_pavl_reader_register(faster_pavl_ptr_t tree);
+void faster_pavl_reader_unregister(faster_pavl_ptr_t tree, int reader);
+faster_pavl_snapshot_t faster_pavl_snapshot(faster_pavl_ptr_t tree, int reader);
+void faster_pavl_snapshot_release(faster_pavl_ptr_t tree, faster_pavl_snapshot_t *snapshot);
+faster_value_ptr faster_pavl_get(const faster_pavl_ptr_t tree, const faster_pavl_snapshot_t *snapshot, const faster_str_ptr_t key);
+PAVLNodeIndex faster_pavl_iterator(const faster_pavl_ptr_t tree, const faster_pavl_snapshot_t *snapshot,
+                                   faster_pavl_iterator_helper_t *it);
+
+#define FASTER_PAVL_INCLUDE
+#endif // FASTER_PAVL_INCLUDE
@@ -0,0 +1,94 @@
+#ifdef FASTER_PRIM_INCLUDE
+#else
+
+#include "aster/faster_core.h"
+
+// string primitives over fchar_t units: length, equality and order, character set scans and hashing.
+// Each has SSE2, AVX2 and AVX-512 kernels for the fchar_t width of the build next to the scalar reference;
+// the widest level the CPU runs is picked from CPUID at startup, and the conversions of str.c follow it too
+
+enum faster_simd_level_e {
+  FASTER_SIMD_SCALAR = 0,
+  FASTER_SIMD_SSE2,
+  FASTER_SIMD_AVX2,
+  FASTER_SIMD_AVX512,
+};
+typedef enum faster_simd_level_e faster_simd_level_t;
+
+faster_simd_level_t faster_simd_level(void);
+// caps the kernels at level, for comparisons and tests; returns the level in effect
+faster_simd_level_t faster_simd_select(const faster_simd_level_t level);
+
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_FOUR_BYTE
+typedef uint32_t faster_prim_unit_t;
+#elif FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+typedef uint16_t faster_prim_unit_t;
+#else
+typedef uint8_t faster_prim_unit_t;
+#endif
+static_assert(sizeof(faster_prim_unit_t) == sizeof(fchar_t), "primitive units must match fchar_t");
+
+// a character set is kept as sorted, merged ranges plus a bitmap of its ASCII members
+#define FASTER_PRIM_SET_RANGES 16
+
+struct faster_prim_set_s {
+  uint64_t ascii[2];
+  faster_prim_unit_t low[FASTER_PRIM_SET_RANGES];
+  faster_prim_unit_t high[FASTER_PRIM_SET_RANGES];
+  unsigned int ranges;
+};
+typedef struct faster_prim_set_s faster_prim_set_t;
+
+// fails when the characters do not merge into FASTER_PRIM_SET_RANGES ranges
+faster_error_code_t faster_prim_set_init(faster_prim_set_t *set, const fchar_t *chars, const size_t count);
+
+static inline bool faster_prim_set_contains(const faster_prim_set_t *set, const fchar_t item) {
+  faster_prim_unit_t unit = (faster_prim_unit_t)item;
+  if (unit < 0x80) {
+    return (set->ascii[unit >> 6] >> (unit & 63)) & 1;
+  }
+  for (unsigned int range = 0; range < set->ranges; range++) {
+    if (unit >= set->low[range] && unit <= set->high[range]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t faster_prim_strlen(const fchar_t *str);
+// index of the first unit where the strings differ, len when they do not
+size_t faster_prim_mismatch(const fchar_t *str1, const fchar_t *str2, const size_t len);
+static inline bool faster_prim_equal(const fchar_t *str1, const fchar_t *str2, const size_t len) {
+  return faster_prim_mismatch(str1, str2, len) == len;
+}
+// sign of memcmp over the bytes of the units
+int faster_prim_compare(const fchar_t *str1, const fchar_t *str2, const size_t len);
+
+// same ordering as faster_str_cmp_binary, the key units are only read when lengths and prefixes tie
+static inline int faster_str_cmp_prefixed(const faster_str_t *str1, const faster_str_prefix_t prefix1, const faster_str_t *str2,
+                                          const faster_str_prefix_t prefix2) {
+  if (str1->str_len != str2->str_len) {
+    return (str1->str_len > str2->str_len) ? 1 : -1;
+  }
+  if (prefix1 != prefix2) {
+    return (prefix1 > prefix2) ? 1 : -1;
+  }
+  if (str1->str_len <= FASTER_STR_PREFIX_UNITS) {
+    return 0;
+  }
+  return faster_prim_compare(str1->str_ptr + FASTER_STR_PREFIX_UNITS, str2->str_ptr + FASTER_STR_PREFIX_UNITS,
+                             str1->str_len - FASTER_STR_PREFIX_UNITS);
+}
+// index of the first unit in / not in the set, len when there is none
+size_t faster_prim_find_first_of(const fchar_t *str, const size_t len, const faster_prim_set_t *set);
+size_t faster_prim_span(const fchar_t *str, const size_t len, const faster_prim_set_t *set);
+
+// MurmurHash2 below FASTER_PRIM_HASH_STRIPED_MIN bytes, so short keys hash as they always did; longer data
+// is first folded into 16 independent 32-bit lanes, 64 bytes per stripe, which the kernels run side by side.
+// The value does not depend on the level
+#define FASTER_PRIM_HASH_STRIPE 64
+#define FASTER_PRIM_HASH_STRIPED_MIN 128
+uint32_t faster_prim_hash(const void *data, const size_t bytes);
+
+#define FASTER_PRIM_INCLUDE
+#endif // FASTER_PRIM_INCLUDE
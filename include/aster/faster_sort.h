@@ -0,0 +1,25 @@
+#ifdef FASTER_SORT_INCLUDE
+#else
+
+#include "aster/faster_core.h"
+
+// sorting of faster_str_t arrays in the order of faster_str_cmp_binary: by length, then byte by byte.
+// MSD radix sort over the length bytes followed by the key bytes, buckets are permuted in place
+// (American flag sort) while 8 bytes of every key are cached next to the array, so the key bytes are read
+// once every 8 passes; small buckets go to a multikey quicksort and tiny ones to insertion sort
+
+#ifndef FASTER_SORT_RADIX_MIN
+#define FASTER_SORT_RADIX_MIN 64
+#endif
+#define FASTER_SORT_INSERTION_MAX 12
+// below this many keys the parallel sort runs on the calling thread only
+#ifndef FASTER_SORT_PARALLEL_MIN
+#define FASTER_SORT_PARALLEL_MIN 65536
+#endif
+
+void faster_str_sort(faster_str_t *strs, const size_t count);
+// threads workers share the buckets left by the first passes, 0 or 1 sorts on the calling thread
+void faster_str_sort_parallel(faster_str_t *strs, const size_t count, const unsigned int threads);
+
+#define FASTER_SORT_INCLUDE
+#endif // FASTER_SORT_INCLUDE
@@ -14,5 +14,13 @@
 #define FASTER_UNICODE_SUPPORT FASTER_UNICODE_SUPPORT_AUTODETECT
 #endif
 
+#define FASTER_ORDERED_MAP_AVL (0)
+#define FASTER_ORDERED_MAP_BPT (1)
+
+// backing store of the AST context, interned strings are hash indexed whatever the choice
+#ifndef FASTER_ORDERED_MAP
+#define FASTER_ORDERED_MAP FASTER_ORDERED_MAP_AVL
+#endif
+
 #else
 #endif
\ No newline at end of file
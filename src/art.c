@@ -0,0 +1,783 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "aster/faster_art.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Utility functions
+static size_t min_size(const size_t a, const size_t b) { return (a < b) ? a : b; }
+static inline const uint8_t *key_bytes(const faster_str_t *key) { return (const uint8_t *)key->str_ptr; }
+static inline size_t key_size(const faster_str_t *key) { return FASTER_STRING_MEMORY_SIZE(key->str_len); }
+
+static inline ARTLeaf_t *_art_leaf(const ARTreePtr tree, const ARTRef ref) { return tree->leaves.list + FASTER_ART_INDEX(ref); }
+static inline ARTNode4_t *_art_node4(const ARTreePtr tree, const ARTRef ref) { return tree->node4_list.list + FASTER_ART_INDEX(ref); }
+static inline ARTNode16_t *_art_node16(const ARTreePtr tree, const ARTRef ref) {
+  return tree->node16_list.list + FASTER_ART_INDEX(ref);
+}
+static inline ARTNode48_t *_art_node48(const ARTreePtr tree, const ARTRef ref) {
+  return tree->node48_list.list + FASTER_ART_INDEX(ref);
+}
+static inline ARTNode256_t *_art_node256(const ARTreePtr tree, const ARTRef ref) {
+  return tree->node256_list.list + FASTER_ART_INDEX(ref);
+}
+
+// every inner node starts with its header
+static ARTHeader_t *_art_header(const ARTreePtr tree, const ARTRef node) {
+  switch (FASTER_ART_KIND(node)) {
+  case FASTER_ART_NODE4:
+    return (ARTHeader_t *)_art_node4(tree, node);
+  case FASTER_ART_NODE16:
+    return (ARTHeader_t *)_art_node16(tree, node);
+  case FASTER_ART_NODE48:
+    return (ARTHeader_t *)_art_node48(tree, node);
+  default:
+    return (ARTHeader_t *)_art_node256(tree, node);
+  }
+}
+
+static inline bool _art_leaf_matches(const ARTLeaf_t *leaf, const uint8_t *bytes, const size_t size) {
+  return key_size(&leaf->key) == size && memcmp(key_bytes(&leaf->key), bytes, size) == 0;
+}
+
+// slot of byte in a Node16, -1 when absent
+static inline int _art_node16_find(const ARTNode16_t *node, const uint8_t byte) {
+#if defined(__SSE2__)
+  __m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8((char)byte), _mm_loadu_si128((const __m128i *)node->keys));
+  unsigned int mask = (unsigned int)_mm_movemask_epi8(matches) & ((1u << node->header.count) - 1);
+  return mask ? __builtin_ctz(mask) : -1;
+#else
+  for (int i = 0; i < node->header.count; i++) {
+    if (node->keys[i] == byte)
+      return i;
+  }
+  return -1;
+#endif
+}
+
+// number of keys below byte, the slot where byte goes
+static inline int _art_node16_position(const ARTNode16_t *node, const uint8_t byte) {
+#if defined(__SSE2__)
+  // signed compare on bytes shifted by 0x80 gives the unsigned order
+  __m128i bias = _mm_set1_epi8((char)0x80);
+  __m128i below = _mm_cmplt_epi8(_mm_xor_si128(_mm_loadu_si128((const __m128i *)node->keys), bias),
+                                 _mm_xor_si128(_mm_set1_epi8((char)byte), bias));
+  unsigned int mask = (unsigned int)_mm_movemask_epi8(below) & ((1u << node->header.count) - 1);
+  return __builtin_popcount(mask);
+#else
+  int position = 0;
+  while (position < node->header.count && node->keys[position] < byte)
+    position++;
+  return position;
+#endif
+}
+
+static ARTRef _art_find_child(const ARTreePtr tree, const ARTRef node, const uint8_t byte) {
+  switch (FASTER_ART_KIND(node)) {
+  case FASTER_ART_NODE4: {
+    ARTNode4_t *node_ptr = _art_node4(tree, node);
+    for (int i = 0; i < node_ptr->header.count; i++) {
+      if (node_ptr->keys[i] == byte)
+        return node_ptr->children[i];
+    }
+    return FASTER_ART_REF_NULL;
+  }
+  case FASTER_ART_NODE16: {
+    ARTNode16_t *node_ptr = _art_node16(tree, node);
+    int slot = _art_node16_find(node_ptr, byte);
+    return (slot >= 0) ? node_ptr->children[slot] : FASTER_ART_REF_NULL;
+  }
+  case FASTER_ART_NODE48: {
+    ARTNode48_t *node_ptr = _art_node48(tree, node);
+    return node_ptr->index[byte] ? node_ptr->children[node_ptr->index[byte] - 1] : FASTER_ART_REF_NULL;
+  }
+  default:
+    return _art_node256(tree, node)->children[byte];
+  }
+}
+
+static void _art_replace_child(const ARTreePtr tree, const ARTRef node, const uint8_t byte, const ARTRef child) {
+  switch (FASTER_ART_KIND(node)) {
+  case FASTER_ART_NODE4: {
+    ARTNode4_t *node_ptr = _art_node4(tree, node);
+    for (int i = 0; i < node_ptr->header.count; i++) {
+      if (node_ptr->keys[i] == byte)
+        node_ptr->children[i] = child;
+    }
+    break;
+  }
+  case FASTER_ART_NODE16: {
+    ARTNode16_t *node_ptr = _art_node16(tree, node);
+    node_ptr->children[_art_node16_find(node_ptr, byte)] = child;
+    break;
+  }
+  case FASTER_ART_NODE48: {
+    ARTNode48_t *node_ptr = _art_node48(tree, node);
+    node_ptr->children[node_ptr->index[byte] - 1] = child;
+    break;
+  }
+  default:
+    _art_node256(tree, node)->children[byte] = child;
+  }
+}
+
+// smallest key below node, the key ending at a node comes before its children
+static ARTRef _art_minimum(const ARTreePtr tree, ARTRef node) {
+  while (node != FASTER_ART_REF_NULL && FASTER_ART_KIND(node) != FASTER_ART_LEAF) {
+    ARTHeader_t *header = _art_header(tree, node);
+    if (header->terminal != FASTER_ART_REF_NULL)
+      return header->terminal;
+    switch (FASTER_ART_KIND(node)) {
+    case FASTER_ART_NODE4:
+      node = _art_node4(tree, node)->children[0];
+      break;
+    case FASTER_ART_NODE16:
+      node = _art_node16(tree, node)->children[0];
+      break;
+    case FASTER_ART_NODE48: {
+      ARTNode48_t *node_ptr = _art_node48(tree, node);
+      int byte = 0;
+      while (node_ptr->index[byte] == 0)
+        byte++;
+      node = node_ptr->children[node_ptr->index[byte] - 1];
+      break;
+    }
+    default: {
+      ARTNode256_t *node_ptr = _art_node256(tree, node);
+      int byte = 0;
+      while (node_ptr->children[byte] == FASTER_ART_REF_NULL)
+        byte++;
+      node = node_ptr->children[byte];
+    }
+    }
+  }
+  return node;
+}
+
+// how many bytes of the compressed prefix of node the key matches from depth on; prefix bytes
+// beyond the ones kept in the node are read from a leaf below it, which shares them all
+static size_t _art_prefix_mismatch(const ARTreePtr tree, const ARTRef node, const uint8_t *bytes, const size_t size,
+                                   const size_t depth) {
+  ARTHeader_t *header = _art_header(tree, node);
+  size_t limit = min_size(header->prefix_length, size - depth);
+  size_t stored = min_size(limit, FASTER_ART_MAX_PREFIX);
+  size_t matched = 0;
+  while (matched < stored && header->prefix[matched] == bytes[depth + matched])
+    matched++;
+  if (matched == stored && limit > FASTER_ART_MAX_PREFIX) {
+    const uint8_t *leaf_bytes = key_bytes(&_art_leaf(tree, _art_minimum(tree, node))->key);
+    while (matched < limit && leaf_bytes[depth + matched] == bytes[depth + matched])
+      matched++;
+  }
+  return matched;
+}
+
+static ARTRef _art_new_leaf(const ARTreePtr tree, const faster_str_ptr_t key, const faster_value_ptr value) {
+  faster_indexing_t leaf = ARTLeaf_t_arr_get_next(&tree->leaves);
+  if (leaf == FASTER_ARRAY_INDEX_INVALID)
+    return FASTER_ART_REF_NULL;
+  ARTLeaf_t *leaf_ptr = tree->leaves.list + leaf;
+  memcpy((void *)&leaf_ptr->key, key, sizeof(faster_str_t));
+  leaf_ptr->value = value;
+  return FASTER_ART_MAKE_REF(leaf, FASTER_ART_LEAF);
+}
+
+static void _art_copy_header(ARTHeader_t *to, const ARTHeader_t *from) { memcpy(to, from, sizeof(ARTHeader_t)); }
+
+static ARTRef _art_new_node4(const ARTreePtr tree, const uint8_t *prefix, const size_t prefix_length) {
+  faster_indexing_t node = ARTNode4_t_arr_get_next(&tree->node4_list);
+  if (node == FASTER_ARRAY_INDEX_INVALID)
+    return FASTER_ART_REF_NULL;
+  ARTHeader_t *header = &tree->node4_list.list[node].header;
+  header->terminal = FASTER_ART_REF_NULL;
+  header->count = 0;
+  header->prefix_length = (uint32_t)prefix_length;
+  memcpy(header->prefix, prefix, min_size(prefix_length, FASTER_ART_MAX_PREFIX));
+  return FASTER_ART_MAKE_REF(node, FASTER_ART_NODE4);
+}
+
+static void _art_release(const ARTreePtr tree, const ARTRef ref) {
+  switch (FASTER_ART_KIND(ref)) {
+  case FASTER_ART_LEAF:
+    ARTLeaf_t_arr_release(&tree->leaves, FASTER_ART_INDEX(ref));
+    break;
+  case FASTER_ART_NODE4:
+    ARTNode4_t_arr_release(&tree->node4_list, FASTER_ART_INDEX(ref));
+    break;
+  case FASTER_ART_NODE16:
+    ARTNode16_t_arr_release(&tree->node16_list, FASTER_ART_INDEX(ref));
+    break;
+  case FASTER_ART_NODE48:
+    ARTNode48_t_arr_release(&tree->node48_list, FASTER_ART_INDEX(ref));
+    break;
+  default:
+    ARTNode256_t_arr_release(&tree->node256_list, FASTER_ART_INDEX(ref));
+  }
+}
+
+// add child under byte, growing node into the next kind when it is full;
+// returns the node holding the child now, FASTER_ART_REF_NULL when memory runs out (node is unchanged then)
+static ARTRef _art_add_child(const ARTreePtr tree, const ARTRef node, const uint8_t byte, const ARTRef child) {
+  switch (FASTER_ART_KIND(node)) {
+  case FASTER_ART_NODE4: {
+    ARTNode4_t *node_ptr = _art_node4(tree, node);
+    if (node_ptr->header.count < 4) {
+      int position = 0;
+      while (position < node_ptr->header.count && node_ptr->keys[position] < byte)
+        position++;
+      memmove(node_ptr->keys + position + 1, node_ptr->keys + position, (size_t)(node_ptr->header.count - position));
+      memmove(node_ptr->children + position + 1, node_ptr->children + position,
+              (size_t)(node_ptr->header.count - position) * sizeof(ARTRef));
+      node_ptr->keys[position] = byte;
+      node_ptr->children[position] = child;
+      node_ptr->header.count++;
+      return node;
+    }
+    faster_indexing_t grown = ARTNode16_t_arr_get_next(&tree->node16_list);
+    if (grown == FASTER_ARRAY_INDEX_INVALID)
+      return FASTER_ART_REF_NULL;
+    ARTNode16_t *grown_ptr = tree->node16_list.list + grown;
+    _art_copy_header(&grown_ptr->header, &node_ptr->header);
+    memcpy(grown_ptr->keys, node_ptr->keys, 4);
+    memcpy(grown_ptr->children, node_ptr->children, 4 * sizeof(ARTRef));
+    _art_release(tree, node);
+    return _art_add_child(tree, FASTER_ART_MAKE_REF(grown, FASTER_ART_NODE16), byte, child);
+  }
+  case FASTER_ART_NODE16: {
+    ARTNode16_t *node_ptr = _art_node16(tree, node);
+    if (node_ptr->header.count < 16) {
+      int position = _art_node16_position(node_ptr, byte);
+      memmove(node_ptr->keys + position + 1, node_ptr->keys + position, (size_t)(node_ptr->header.count - position));
+      memmove(node_ptr->children + position + 1, node_ptr->children + position,
+              (size_t)(node_ptr->header.count - position) * sizeof(ARTRef));
+      node_ptr->keys[position] = byte;
+      node_ptr->children[position] = child;
+      node_ptr->header.count++;
+      return node;
+    }
+    faster_indexing_t grown = ARTNode48_t_arr_get_next(&tree->node48_list);
+    if (grown == FASTER_ARRAY_INDEX_INVALID)
+      return FASTER_ART_REF_NULL;
+    ARTNode48_t *grown_ptr = tree->node48_list.list + grown;
+    _art_copy_header(&grown_ptr->header, &node_ptr->header);
+    memset(grown_ptr->index, 0, sizeof(grown_ptr->index));
+    memset(grown_ptr->children, 0, sizeof(grown_ptr->children));
+    for (int i = 0; i < 16; i++) {
+      grown_ptr->index[node_ptr->keys[i]] = (uint8_t)(i + 1);
+      grown_ptr->children[i] = node_ptr->children[i];
+    }
+    _art_release(tree, node);
+    return _art_add_child(tree, FASTER_ART_MAKE_REF(grown, FASTER_ART_NODE48), byte, child);
+  }
+  case FASTER_ART_NODE48: {
+    ARTNode48_t *node_ptr = _art_node48(tree, node);
+    if (node_ptr->header.count < 48) {
+      // removals leave holes, take the first free slot
+      int slot = 0;
+      while (node_ptr->children[slot] != FASTER_ART_REF_NULL)
+        slot++;
+      node_ptr->index[byte] = (uint8_t)(slot + 1);
+      node_ptr->children[slot] = child;
+      node_ptr->header.count++;
+      return node;
+    }
+    faster_indexing_t grown = ARTNode256_t_arr_get_next(&tree->node256_list);
+    if (grown == FASTER_ARRAY_INDEX_INVALID)
+      return FASTER_ART_REF_NULL;
+    ARTNode256_t *grown_ptr = tree->node256_list.list + grown;
+    _art_copy_header(&grown_ptr->header, &node_ptr->header);
+    for (int i = 0; i < 256; i++)
+      grown_ptr->children[i] = node_ptr->index[i] ? node_ptr->children[node_ptr->index[i] - 1] : FASTER_ART_REF_NULL;
+    _art_release(tree, node);
+    return _art_add_child(tree, FASTER_ART_MAKE_REF(grown, FASTER_ART_NODE256), byte, child);
+  }
+  default: {
+    ARTNode256_t *node_ptr = _art_node256(tree, node);
+    node_ptr->children[byte] = child;
+    node_ptr->header.count++;
+    return node;
+  }
+  }
+}
+
+static void _art_remove_child(const ARTreePtr tree, const ARTRef node, const uint8_t byte) {
+  switch (FASTER_ART_KIND(node)) {
+  case FASTER_ART_NODE4: {
+    ARTNode4_t *node_ptr = _art_node4(tree, node);
+    int position = 0;
+    while (node_ptr->keys[position] != byte)
+      position++;
+    memmove(node_ptr->keys + position, node_ptr->keys + position + 1, (size_t)(node_ptr->header.count - position - 1));
+    memmove(node_ptr->children + position, node_ptr->children + position + 1,
+            (size_t)(node_ptr->header.count - position - 1) * sizeof(ARTRef));
+    node_ptr->header.count--;
+    break;
+  }
+  case FASTER_ART_NODE16: {
+    ARTNode16_t *node_ptr = _art_node16(tree, node);
+    int position = _art_node16_find(node_ptr, byte);
+    memmove(node_ptr->keys + position, node_ptr->keys + position + 1, (size_t)(node_ptr->header.count - position - 1));
+    memmove(node_ptr->children + position, node_ptr->children + position + 1,
+            (size_t)(node_ptr->header.count - position - 1) * sizeof(ARTRef));
+    node_ptr->header.count--;
+    break;
+  }
+  case FASTER_ART_NODE48: {
+    ARTNode48_t *node_ptr = _art_node48(tree, node);
+    node_ptr->children[node_ptr->index[byte] - 1] = FASTER_ART_REF_NULL;
+    node_ptr->index[byte] = 0;
+    node_ptr->header.count--;
+    break;
+  }
+  default: {
+    ARTNode256_t *node_ptr = _art_node256(tree, node);
+    node_ptr->children[byte] = FASTER_ART_REF_NULL;
+    node_ptr->header.count--;
+  }
+  }
+}
+
+// after a removal: drop empty nodes, fold a lone child into its parent's prefix and move sparse nodes
+// to the smaller kind; shrinking stops short of the growth thresholds so nodes do not flip back and forth
+static ARTRef _art_shrink(const ARTreePtr tree, const ARTRef node) {
+  ARTHeader_t *header = _art_header(tree, node);
+  if (header->count == 0) {
+    ARTRef terminal = header->terminal;
+    _art_release(tree, node);
+    return terminal;
+  }
+  switch (FASTER_ART_KIND(node)) {
+  case FASTER_ART_NODE4: {
+    if (header->count > 1 || header->terminal != FASTER_ART_REF_NULL)
+      return node;
+    ARTNode4_t *node_ptr = _art_node4(tree, node);
+    ARTRef child = node_ptr->children[0];
+    if (FASTER_ART_KIND(child) != FASTER_ART_LEAF) {
+      // child prefix becomes node prefix + branch byte + child prefix
+      ARTHeader_t *child_header = _art_header(tree, child);
+      uint8_t merged[FASTER_ART_MAX_PREFIX];
+      size_t filled = min_size(header->prefix_length, FASTER_ART_MAX_PREFIX);
+      memcpy(merged, header->prefix, filled);
+      if (filled < FASTER_ART_MAX_PREFIX)
+        merged[filled++] = node_ptr->keys[0];
+      size_t from_child = min_size(child_header->prefix_length, FASTER_ART_MAX_PREFIX - filled);
+      memcpy(merged + filled, child_header->prefix, from_child);
+      child_header->prefix_length += header->prefix_length + 1;
+      memcpy(child_header->prefix, merged, filled + from_child);
+    }
+    _art_release(tree, node);
+    return child;
+  }
+  case FASTER_ART_NODE16: {
+    if (header->count > 3)
+      return node;
+    faster_indexing_t shrunk = ARTNode4_t_arr_get_next(&tree->node4_list);
+    if (shrunk == FASTER_ARRAY_INDEX_INVALID)
+      return node;
+    ARTNode16_t *node_ptr = _art_node16(tree, node);
+    ARTNode4_t *shrunk_ptr = tree->node4_list.list + shrunk;
+    _art_copy_header(&shrunk_ptr->header, &node_ptr->header);
+    memcpy(shrunk_ptr->keys, node_ptr->keys, node_ptr->header.count);
+    memcpy(shrunk_ptr->children, node_ptr->children, node_ptr->header.count * sizeof(ARTRef));
+    _art_release(tree, node);
+    return FASTER_ART_MAKE_REF(shrunk, FASTER_ART_NODE4);
+  }
+  case FASTER_ART_NODE48: {
+    if (header->count > 12)
+      return node;
+    faster_indexing_t shrunk = ARTNode16_t_arr_get_next(&tree->node16_list);
+    if (shrunk == FASTER_ARRAY_INDEX_INVALID)
+      return node;
+    ARTNode48_t *node_ptr = _art_node48(tree, node);
+    ARTNode16_t *shrunk_ptr = tree->node16_list.list + shrunk;
+    _art_copy_header(&shrunk_ptr->header, &node_ptr->header);
+    int slot = 0;
+    for (int byte = 0; byte < 256; byte++) {
+      if (node_ptr->index[byte]) {
+        shrunk_ptr->keys[slot] = (uint8_t)byte;
+        shrunk_ptr->children[slot++] = node_ptr->children[node_ptr->index[byte] - 1];
+      }
+    }
+    _art_release(tree, node);
+    return FASTER_ART_MAKE_REF(shrunk, FASTER_ART_NODE16);
+  }
+  default: {
+    if (header->count > 37)
+      return node;
+    faster_indexing_t shrunk = ARTNode48_t_arr_get_next(&tree->node48_list);
+    if (shrunk == FASTER_ARRAY_INDEX_INVALID)
+      return node;
+    ARTNode256_t *node_ptr = _art_node256(tree, node);
+    ARTNode48_t *shrunk_ptr = tree->node48_list.list + shrunk;
+    _art_copy_header(&shrunk_ptr->header, &node_ptr->header);
+    memset(shrunk_ptr->index, 0, sizeof(shrunk_ptr->index));
+    memset(shrunk_ptr->children, 0, sizeof(shrunk_ptr->children));
+    int slot = 0;
+    for (int byte = 0; byte < 256; byte++) {
+      if (node_ptr->children[byte] != FASTER_ART_REF_NULL) {
+        shrunk_ptr->index[byte] = (uint8_t)(slot + 1);
+        shrunk_ptr->children[slot++] = node_ptr->children[byte];
+      }
+    }
+    _art_release(tree, node);
+    return FASTER_ART_MAKE_REF(shrunk, FASTER_ART_NODE48);
+  }
+  }
+}
+
+struct _art_operation_s {
+  faster_str_ptr_t key;
+  const uint8_t *bytes;
+  size_t size;
+  faster_value_ptr value;
+  bool changed; // a key was inserted or removed
+};
+
+// hang child under a fresh Node4, as its terminal when the key ends at depth
+static void _art_attach(const ARTreePtr tree, const ARTRef node4, const faster_str_t *key, const size_t depth, const ARTRef child) {
+  if (depth == key_size(key)) {
+    _art_node4(tree, node4)->header.terminal = child;
+  } else {
+    _art_add_child(tree, node4, key_bytes(key)[depth], child);
+  }
+}
+
+// insert below node, which sits depth bytes into the key; returns what takes the place of node
+// (node itself when memory runs out, with the tree unchanged)
+static ARTRef _art_insert(const ARTreePtr tree, struct _art_operation_s *op, const ARTRef node, size_t depth) {
+  if (node == FASTER_ART_REF_NULL) {
+    ARTRef leaf = _art_new_leaf(tree, op->key, op->value);
+    op->changed = leaf != FASTER_ART_REF_NULL;
+    return leaf;
+  }
+
+  if (FASTER_ART_KIND(node) == FASTER_ART_LEAF) {
+    ARTLeaf_t *leaf_ptr = _art_leaf(tree, node);
+    if (_art_leaf_matches(leaf_ptr, op->bytes, op->size)) {
+      leaf_ptr->value = op->value;
+      return node;
+    }
+    // both keys go below a new node holding the bytes they share
+    const faster_str_t *leaf_key = &leaf_ptr->key;
+    const uint8_t *leaf_bytes = key_bytes(leaf_key);
+    size_t limit = min_size(key_size(leaf_key), op->size);
+    size_t common = depth;
+    while (common < limit && leaf_bytes[common] == op->bytes[common])
+      common++;
+    ARTRef leaf = _art_new_leaf(tree, op->key, op->value);
+    if (leaf == FASTER_ART_REF_NULL)
+      return node;
+    ARTRef split = _art_new_node4(tree, op->bytes + depth, common - depth);
+    if (split == FASTER_ART_REF_NULL) {
+      _art_release(tree, leaf);
+      return node;
+    }
+    _art_attach(tree, split, &_art_leaf(tree, node)->key, common, node);
+    _art_attach(tree, split, op->key, common, leaf);
+    op->changed = true;
+    return split;
+  }
+
+  ARTHeader_t *header = _art_header(tree, node);
+  if (header->prefix_length > 0) {
+    size_t mismatch = _art_prefix_mismatch(tree, node, op->bytes, op->size, depth);
+    if (mismatch < header->prefix_length) {
+      // the key leaves the compressed path: a new node takes the matching part,
+      // node keeps what follows the byte it now hangs under
+      ARTRef leaf = _art_new_leaf(tree, op->key, op->value);
+      if (leaf == FASTER_ART_REF_NULL)
+        return node;
+      ARTRef split = _art_new_node4(tree, op->bytes + depth, mismatch);
+      if (split == FASTER_ART_REF_NULL) {
+        _art_release(tree, leaf);
+        return node;
+      }
+      header = _art_header(tree, node);
+      size_t rest = header->prefix_length - mismatch - 1;
+      uint8_t branch;
+      if (header->prefix_length <= FASTER_ART_MAX_PREFIX) {
+        branch = header->prefix[mismatch];
+        memmove(header->prefix, header->prefix + mismatch + 1, rest);
+      } else {
+        const uint8_t *leaf_bytes = key_bytes(&_art_leaf(tree, _art_minimum(tree, node))->key);
+        branch = leaf_bytes[depth + mismatch];
+        memcpy(header->prefix, leaf_bytes + depth + mismatch + 1, min_size(rest, FASTER_ART_MAX_PREFIX));
+      }
+      header->prefix_length = (uint32_t)rest;
+      _art_add_child(tree, split, branch, node);
+      _art_attach(tree, split, op->key, depth + mismatch, leaf);
+      op->changed = true;
+      return split;
+    }
+    depth += header->prefix_length;
+  }
+
+  if (depth == op->size) {
+    if (header->terminal != FASTER_ART_REF_NULL) {
+      _art_leaf(tree, header->terminal)->value = op->value;
+      return node;
+    }
+    ARTRef leaf = _art_new_leaf(tree, op->key, op->value);
+    if (leaf == FASTER_ART_REF_NULL)
+      return node;
+    _art_header(tree, node)->terminal = leaf;
+    op->changed = true;
+    return node;
+  }
+
+  uint8_t byte = op->bytes[depth];
+  ARTRef child = _art_find_child(tree, node, byte);
+  if (child != FASTER_ART_REF_NULL) {
+    ARTRef updated = _art_insert(tree, op, child, depth + 1);
+    if (updated != child)
+      _art_replace_child(tree, node, byte, updated);
+    return node;
+  }
+  ARTRef leaf = _art_new_leaf(tree, op->key, op->value);
+  if (leaf == FASTER_ART_REF_NULL)
+    return node;
+  ARTRef grown = _art_add_child(tree, node, byte, leaf);
+  if (grown == FASTER_ART_REF_NULL) {
+    _art_release(tree, leaf);
+    return node;
+  }
+  op->changed = true;
+  return grown;
+}
+
+// Insert a key into the tree, or update its value if present; true when the key was added
+bool ART_insert_or_update(const ARTreePtr tree, const faster_str_ptr_t key, const faster_value_ptr value) {
+  struct _art_operation_s op = {.key = key, .bytes = key_bytes(key), .size = key_size(key), .value = value, .changed = false};
+  tree->root = _art_insert(tree, &op, tree->root, 0);
+  if (op.changed)
+    tree->elements++;
+  return op.changed;
+}
+
+// compressed prefixes are checked optimistically on the way down, the leaf compare settles the match
+faster_value_ptr ART_get(const ARTreePtr tree, const faster_str_ptr_t key) {
+  const uint8_t *bytes = key_bytes(key);
+  size_t size = key_size(key);
+  size_t depth = 0;
+  ARTRef node = tree->root;
+  while (node != FASTER_ART_REF_NULL) {
+    if (FASTER_ART_KIND(node) == FASTER_ART_LEAF) {
+      ARTLeaf_t *leaf_ptr = _art_leaf(tree, node);
+      return _art_leaf_matches(leaf_ptr, bytes, size) ? leaf_ptr->value : NULL;
+    }
+    ARTHeader_t *header = _art_header(tree, node);
+    if (header->prefix_length > 0) {
+      if (depth + header->prefix_length > size ||
+          memcmp(header->prefix, bytes + depth, min_size(header->prefix_length, FASTER_ART_MAX_PREFIX)) != 0)
+        return NULL;
+      depth += header->prefix_length;
+    }
+    node = (depth == size) ? header->terminal : _art_find_child(tree, node, bytes[depth++]);
+  }
+  return NULL;
+}
+
+static ARTRef _art_remove(const ARTreePtr tree, struct _art_operation_s *op, const ARTRef node, size_t depth) {
+  if (node == FASTER_ART_REF_NULL)
+    return node;
+  if (FASTER_ART_KIND(node) == FASTER_ART_LEAF) {
+    if (!_art_leaf_matches(_art_leaf(tree, node), op->bytes, op->size))
+      return node;
+    _art_release(tree, node);
+    op->changed = true;
+    return FASTER_ART_REF_NULL;
+  }
+  ARTHeader_t *header = _art_header(tree, node);
+  if (header->prefix_length > 0) {
+    if (_art_prefix_mismatch(tree, node, op->bytes, op->size, depth) != header->prefix_length)
+      return node;
+    depth += header->prefix_length;
+  }
+  if (depth == op->size) {
+    if (header->terminal == FASTER_ART_REF_NULL)
+      return node;
+    _art_release(tree, header->terminal);
+    header->terminal = FASTER_ART_REF_NULL;
+    op->changed = true;
+    return _art_shrink(tree, node);
+  }
+  uint8_t byte = op->bytes[depth];
+  ARTRef child = _art_find_child(tree, node, byte);
+  if (child == FASTER_ART_REF_NULL)
+    return node;
+  ARTRef updated = _art_remove(tree, op, child, depth + 1);
+  if (updated == child)
+    return node;
+  if (updated == FASTER_ART_REF_NULL) {
+    _art_remove_child(tree, node, byte);
+  } else {
+    _art_replace_child(tree, node, byte, updated);
+  }
+  return _art_shrink(tree, node);
+}
+
+// Remove a key from the tree
+bool ART_remove(const ARTreePtr tree, const faster_str_ptr_t key) {
+  struct _art_operation_s op = {.key = key, .bytes = key_bytes(key), .size = key_size(key), .changed = false};
+  tree->root = _art_remove(tree, &op, tree->root, 0);
+  if (op.changed)
+    tree->elements--;
+  return op.changed;
+}
+
+static bool _art_push(faster_art_iterator_helper_t *it, const ARTRef node) {
+  if (it->top + 1 >= it->capacity) {
+    int capacity = it->capacity ? 2 * it->capacity : 32;
+    struct faster_art_iterator_frame_s *stack = realloc(it->stack, (size_t)capacity * sizeof(struct faster_art_iterator_frame_s));
+    if (stack == NULL)
+      return false;
+    it->stack = stack;
+    it->capacity = capacity;
+  }
+  it->top++;
+  it->stack[it->top].node = node;
+  it->stack[it->top].position = -1;
+  return true;
+}
+
+// next child of node in byte order, FASTER_ART_REF_NULL past the last one
+static ARTRef _art_next_child(const ARTreePtr tree, const ARTRef node, int *position) {
+  switch (FASTER_ART_KIND(node)) {
+  case FASTER_ART_NODE4: {
+    ARTNode4_t *node_ptr = _art_node4(tree, node);
+    return (*position < node_ptr->header.count) ? node_ptr->children[(*position)++] : FASTER_ART_REF_NULL;
+  }
+  case FASTER_ART_NODE16: {
+    ARTNode16_t *node_ptr = _art_node16(tree, node);
+    return (*position < node_ptr->header.count) ? node_ptr->children[(*position)++] : FASTER_ART_REF_NULL;
+  }
+  case FASTER_ART_NODE48: {
+    ARTNode48_t *node_ptr = _art_node48(tree, node);
+    while (*position < 256) {
+      int byte = (*position)++;
+      if (node_ptr->index[byte])
+        return node_ptr->children[node_ptr->index[byte] - 1];
+    }
+    return FASTER_ART_REF_NULL;
+  }
+  default: {
+    ARTNode256_t *node_ptr = _art_node256(tree, node);
+    while (*position < 256) {
+      int byte = (*position)++;
+      if (node_ptr->children[byte] != FASTER_ART_REF_NULL)
+        return node_ptr->children[byte];
+    }
+    return FASTER_ART_REF_NULL;
+  }
+  }
+}
+
+static bool _art_yield(const ARTreePtr tree, const ARTRef leaf, const faster_str_t **key, faster_value_ptr *value) {
+  ARTLeaf_t *leaf_ptr = _art_leaf(tree, leaf);
+  if (key != NULL)
+    *key = &leaf_ptr->key;
+  if (value != NULL)
+    *value = leaf_ptr->value;
+  return true;
+}
+
+// Iterator for the tree, walks every key in byte order unless positioned by ART_seek_prefix
+bool ART_iterator(ARTreePtr tree, faster_art_iterator_helper_t *it, const faster_str_t **key, faster_value_ptr *value) {
+  if (!it->initialized) {
+    it->initialized = 1;
+    it->top = -1;
+    if (tree->root != FASTER_ART_REF_NULL && !_art_push(it, tree->root))
+      return false;
+  }
+  while (it->top >= 0) {
+    struct faster_art_iterator_frame_s *frame = it->stack + it->top;
+    ARTRef node = frame->node;
+    if (FASTER_ART_KIND(node) == FASTER_ART_LEAF) {
+      it->top--;
+      return _art_yield(tree, node, key, value);
+    }
+    ARTRef next = FASTER_ART_REF_NULL;
+    if (frame->position < 0) {
+      frame->position = 0;
+      next = _art_header(tree, node)->terminal;
+    }
+    if (next == FASTER_ART_REF_NULL)
+      next = _art_next_child(tree, node, &frame->position);
+    if (next == FASTER_ART_REF_NULL) {
+      it->top--;
+    } else if (FASTER_ART_KIND(next) == FASTER_ART_LEAF) {
+      return _art_yield(tree, next, key, value);
+    } else if (!_art_push(it, next)) {
+      it->top = -1;
+      return false;
+    }
+  }
+  return false;
+}
+
+// the keys with a given prefix are exactly the subtree below the node where the prefix runs out;
+// returns false only when the iterator stack cannot be allocated
+bool ART_seek_prefix(ARTreePtr tree, const faster_str_ptr_t prefix, faster_art_iterator_helper_t *it) {
+  it->initialized = 1;
+  it->top = -1;
+  const uint8_t *bytes = key_bytes(prefix);
+  size_t size = key_size(prefix);
+  size_t depth = 0;
+  ARTRef node = tree->root;
+  while (node != FASTER_ART_REF_NULL) {
+    if (FASTER_ART_KIND(node) == FASTER_ART_LEAF) {
+      const faster_str_t *leaf_key = &_art_leaf(tree, node)->key;
+      if (key_size(leaf_key) >= size && memcmp(key_bytes(leaf_key), bytes, size) == 0)
+        return _art_push(it, node);
+      return true;
+    }
+    if (depth == size)
+      return _art_push(it, node);
+    ARTHeader_t *header = _art_header(tree, node);
+    if (header->prefix_length > 0) {
+      size_t matched = _art_prefix_mismatch(tree, node, bytes, size, depth);
+      if (depth + matched == size)
+        return _art_push(it, node);
+      if (matched < header->prefix_length)
+        return true;
+      depth += header->prefix_length;
+    }
+    node = _art_find_child(tree, node, bytes[depth++]);
+  }
+  return true;
+}
+
+void ART_iterator_free(faster_art_iterator_helper_t *it) {
+  free(it->stack);
+  it->stack = NULL;
+  it->capacity = 0;
+  it->top = -1;
+  it->initialized = 0;
+}
+
+size_t ART_memory_usage(const ARTreePtr tree) {
+  size_t bytes = 0;
+  if (tree->leaves.list != NULL)
+    bytes += (size_t)tree->leaves.list_header.array_capacity * sizeof(ARTLeaf_t);
+  if (tree->node4_list.list != NULL)
+    bytes += (size_t)tree->node4_list.list_header.array_capacity * sizeof(ARTNode4_t);
+  if (tree->node16_list.list != NULL)
+    bytes += (size_t)tree->node16_list.list_header.array_capacity * sizeof(ARTNode16_t);
+  if (tree->node48_list.list != NULL)
+    bytes += (size_t)tree->node48_list.list_header.array_capacity * sizeof(ARTNode48_t);
+  if (tree->node256_list.list != NULL)
+    bytes += (size_t)tree->node256_list.list_header.array_capacity * sizeof(ARTNode256_t);
+  return bytes;
+}
+
+void ART_reset_and_free(const ARTreePtr tree) {
+  ARTLeaf_t_arr_reset_and_free(&tree->leaves, 0);
+  ARTNode4_t_arr_reset_and_free(&tree->node4_list, 0);
+  ARTNode16_t_arr_reset_and_free(&tree->node16_list, 0);
+  ARTNode48_t_arr_reset_and_free(&tree->node48_list, 0);
+  ARTNode256_t_arr_reset_and_free(&tree->node256_list, 0);
+  tree->root = FASTER_ART_REF_NULL;
+  tree->elements = 0;
+}
@@ -1,7 +1,9 @@
 #include <stdbool.h>
 #include <string.h>
+#include <threads.h>
 
 #include "aster/faster_ast.h"
+#include "aster/faster_prim.h"
 
 static faster_error_code_t _faster_reset(faster_ast_ptr_t ast) {
   if (ast == NULL || ast->runtime_state.state != FAST_AST_STATE_EXECUTING) {
@@ -20,7 +22,7 @@ faster_error_code_t faster_ast_init(faster_ast_ptr_t ast) {
   if (ast == NULL || ast->runtime_state.state != FAST_AST_STATE_NOT_INITIALIZED) {
     return FAST_AST_ERROR_INVALID_STATE;
   }
-  faster_interned_strings_init(&ast->interned_strings);
+  faster_interned_strings_init_layered(&ast->interned_strings, faster_interned_strings_base());
   faster_ast_runtime_state_t runtime_state = {.call_stack_depth = 0,
                                               .return_depth = 0,
                                               .loop_depth = 0,
@@ -38,7 +40,7 @@ faster_error_code_t faster_ast_free(faster_ast_ptr_t ast) {
     return FAST_AST_ERROR_INVALID_STATE;
   }
   faster_interned_strings_free(&ast->interned_strings);
-  AVL_reset_and_free(&ast->context_tree);
+  faster_om_reset_and_free(&ast->context_tree);
   faster_token_t_arr_reset_and_free(&ast->token_list, 0);
   faster_ast_node_t_arr_reset_and_free(&ast->ast_list, 0);
   faster_value_float_holder_t_arr_reset_and_free(&ast->float_list, 0);
@@ -236,24 +238,20 @@ static const int _ocp_chars_len = 2;
 static const int _comment_chars_len = 1;
 static const int _comment_end_chars_len = 2;
 
-static inline bool _is_any_of(const fchar_t item, const fchar_t *list, const int clist_len) {
-  int list_len = clist_len;
-  while (list_len) {
-    if (item == list[list_len--]) {
-      return true;
-    }
-  }
-  return false;
+// character classes of the tokenizer, built once from the lists above
+static faster_prim_set_t _space_set;
+static faster_prim_set_t _string_set;
+static once_flag _char_sets_once = ONCE_FLAG_INIT;
+
+static void _char_sets_build(void) {
+  faster_prim_set_init(&_space_set, _space_chars, (size_t)_space_chars_len);
+  faster_prim_set_init(&_string_set, _string_chars, (size_t)_string_chars_len);
 }
 
-static inline bool _are_all_in(const fchar_t *tested, const int ctest_len, const fchar_t *list, const int clist_len) {
-  int test_len = ctest_len;
-  while (test_len) {
-    if (!_is_any_of(tested[test_len--], list, clist_len)) {
-      return false;
-    }
-  }
-  return true;
+static inline bool _is_any_of(const fchar_t item, const faster_prim_set_t *set) { return faster_prim_set_contains(set, item); }
+
+static inline bool _are_all_in(const fchar_t *tested, const size_t test_len, const faster_prim_set_t *set) {
+  return faster_prim_span(tested, test_len, set) == test_len;
 }
 
 static inline faster_indexing_t _store_next_token(faster_ast_ptr_t ast, faster_token_ptr_t token) {
@@ -271,33 +269,53 @@ static inline faster_indexing_t _create_store_token(faster_ast_ptr_t ast, faster
   return _store_next_token(ast, &new_token);
 }
 
-faster_error_code_t faster_tokenize(faster_ast_ptr_t ast, const faster_str_ptr_t str) {
-  if (ast == NULL || ast->runtime_state.state != FAST_AST_STATE_EMPTY) {
-    return FAST_AST_ERROR_INVALID_STATE;
+// the text of a string token: a view of the input when it is fchar_t, decoded and interned when it is UTF-8 bytes
+// that fchar_t is wider than
+static inline bool _store_string_token(faster_ast_ptr_t ast, const fchar_t *units, const char *bytes, const bool utf8,
+                                       const faster_system_indexing_t str_start, const faster_system_indexing_t str_len) {
+  if (!utf8) {
+    return _create_store_token(ast, FAST_TOKEN_TYPE_STRING, units, str_start, str_len) != FASTER_ARRAY_COUNT_INVALID;
   }
-  if (str == NULL || str->str_len == 0) {
-    return FAST_AST_ERROR_INVALID_STRING;
+  faster_symbol_t symbol =
+      faster_interned_strings_symbol_utf8(&ast->interned_strings, bytes + str_start, str_len, FAST_INTERNED_STRING_PURPOSE_TEXT);
+  if (symbol == FASTER_SYMBOL_INVALID) {
+    return false;
   }
+  faster_token_t new_token = {.token_type = FAST_TOKEN_TYPE_STRING,
+                              .token_str = *faster_interned_strings_str(&ast->interned_strings, symbol)};
+  return _store_next_token(ast, &new_token) != FASTER_ARRAY_COUNT_INVALID;
+}
+
+// one loop for both inputs, utf8 is a constant at each call so the unit reads specialize. Every structural character
+// is ASCII and a multibyte sequence has no byte below 0x80, so UTF-8 is classified a byte at a time
+static inline faster_error_code_t _tokenize(faster_ast_ptr_t ast, const fchar_t *units, const char *bytes, const bool utf8,
+                                            const faster_system_indexing_t str_len) {
   faster_tokenizer_state_t state = FAST_TOKENIZER_STATE_FLAT;
   faster_indexing_t token_id = 0;
   faster_system_indexing_t token_starting_pos = 0;
   faster_system_indexing_t token_current_pos = 0;
-  faster_system_indexing_t str_len = str->str_len;
-  faster_value_str_ptr_holder_t str_ptr = str->str_ptr;
+  // single-unit tokens of UTF-8 input view the character lists, the input is not fchar_t
+  const fchar_t *str_ptr = utf8 ? _orp_chars : units;
   while (token_current_pos <= str_len) {
-    fchar_t current_char = (token_current_pos == str_len) ? '\0' : str_ptr[token_current_pos];
+    fchar_t current_char = (token_current_pos == str_len) ? '\0'
+                           : utf8                         ? (fchar_t)(unsigned char)bytes[token_current_pos]
+                                                          : units[token_current_pos];
     switch (state) {
     case FAST_TOKENIZER_STATE_FLAT:
-      if (_is_any_of(current_char, _space_chars, _space_chars_len)) {
+      // end of input, the sentinel is not a token
+      if (token_current_pos == str_len) {
+        break;
+      }
+      if (_is_any_of(current_char, &_space_set)) {
         token_current_pos++;
         continue;
-      } else if (_is_any_of(current_char, _string_chars, _string_chars_len)) {
+      } else if (_is_any_of(current_char, &_string_set)) {
         state = FAST_TOKENIZER_STATE_STRING;
         token_starting_pos = token_current_pos + 1;
       } else if (current_char == '(') {
-        _create_store_token(ast, FAST_TOKEN_TYPE_ORP, str_ptr, token_current_pos, 1);
+        _create_store_token(ast, FAST_TOKEN_TYPE_ORP, str_ptr, utf8 ? 0 : token_current_pos, 1);
       } else if (current_char == ')') {
-        _create_store_token(ast, FAST_TOKEN_TYPE_OCP, str_ptr, token_current_pos, 1);
+        _create_store_token(ast, FAST_TOKEN_TYPE_OCP, str_ptr, utf8 ? 1 : token_current_pos, 1);
       } else if (current_char >= '0' && current_char <= '9') {
         state = FAST_TOKENIZER_STATE_NUMBER;
         token_starting_pos = token_current_pos;
@@ -309,10 +327,9 @@ faster_error_code_t faster_tokenize(faster_ast_ptr_t ast, const faster_str_ptr_t
 
     case FAST_TOKENIZER_STATE_STRING:
       if (current_char == '"') {
-        faster_token_t new_token = {
-            .token_type = FAST_TOKEN_TYPE_STRING,
-            .token_str = {.str_len = token_current_pos - token_starting_pos, .str_ptr = &str_ptr[token_current_pos]}};
-        _store_next_token(ast, &new_token);
+        if (!_store_string_token(ast, units, bytes, utf8, token_starting_pos, token_current_pos - token_starting_pos)) {
+          return FAST_ERROR_MEMORY_ALLOCATION_FAILED;
+        }
         state = FAST_TOKENIZER_STATE_FLAT;
       }
       break;
@@ -379,6 +396,33 @@ faster_error_code_t faster_tokenize(faster_ast_ptr_t ast, const faster_str_ptr_t
   return FAST_AST_ERROR_NONE;
 }
 
+faster_error_code_t faster_tokenize(faster_ast_ptr_t ast, const faster_str_ptr_t str) {
+  if (ast == NULL || ast->runtime_state.state != FAST_AST_STATE_EMPTY) {
+    return FAST_AST_ERROR_INVALID_STATE;
+  }
+  if (str == NULL || str->str_len == 0) {
+    return FAST_AST_ERROR_INVALID_STRING;
+  }
+  call_once(&_char_sets_once, _char_sets_build);
+  return _tokenize(ast, str->str_ptr, NULL, false, str->str_len);
+}
+
+faster_error_code_t faster_tokenize_utf8(faster_ast_ptr_t ast, const char *src, size_t len) {
+  if (ast == NULL || ast->runtime_state.state != FAST_AST_STATE_EMPTY) {
+    return FAST_AST_ERROR_INVALID_STATE;
+  }
+  if (src == NULL || len == 0 || faster_utf8_valid(src, len) != len) {
+    return FAST_AST_ERROR_INVALID_STRING;
+  }
+#if FASTER_UNICODE_NATIVE_BYTES
+  faster_str_t str = faster_str_from_utf8(src, len);
+  return faster_tokenize(ast, &str);
+#else
+  call_once(&_char_sets_once, _char_sets_build);
+  return _tokenize(ast, NULL, src, true, len);
+#endif
+}
+
 faster_error_code_t faster_parse(faster_ast_ptr_t ast) {
   if (ast == NULL || ast->runtime_state.state != FAST_AST_STATE_TOKENIZED) {
     return FAST_AST_ERROR_INVALID_STATE;
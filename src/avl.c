@@ -1,72 +1,273 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 
 #include "aster/faster_avl.h"
+#include "aster/faster_prim.h"
 
 // Utility functions
 static int max(const int a, const int b) { return (a > b) ? a : b; }
 static int height(const AVLNodesTreePtr tree, const AVLNodeIndex node) {
   return FASTER_AVL_NODE_VALID(node) ? tree->node_list.list[node].height : 0;
 }
-static AVLNodeIndex min_value_node(const AVLNodesTreePtr tree, const AVLNodeIndex node) {
-  AVLNodeIndex current = node;
-  while (FASTER_AVL_NODE_VALID(tree->node_list.list[current].left)) {
-    current = tree->node_list.list[current].left;
+#if FASTER_AVL_ORDER_STATISTICS
+static faster_indexing_t size(const AVLNodesTreePtr tree, const AVLNodeIndex node) {
+  return FASTER_AVL_NODE_VALID(node) ? tree->node_list.list[node].size : 0;
+}
+#define _AVL_UPDATE_SIZE(tree, node_ptr) ((node_ptr)->size = size(tree, (node_ptr)->left) + size(tree, (node_ptr)->right) + 1)
+// every node on the path gains or loses the inserted or removed node, whether or not rebalancing reaches it
+#define _AVL_ADJUST_PATH_SIZES(tree, path, depth, delta)                                                                           \
+  for (int _level = 0; _level < (depth); _level++)                                                                                \
+  (tree)->node_list.list[(path)[_level]].size += (delta)
+#else
+#define _AVL_UPDATE_SIZE(tree, node_ptr) ((void)0)
+#define _AVL_ADJUST_PATH_SIZES(tree, path, depth, delta) ((void)0)
+#endif
+
+// order of two node keys with their prefixes, as faster_str_cmp_binary
+static inline int _AVL_key_cmp(const AVLNodeKey_t *key1, const faster_str_prefix_t prefix1, const AVLNodeKey_t *key2,
+                               const faster_str_prefix_t prefix2) {
+#if FASTER_AVL_SSTR_KEYS
+  // an inline key is shorter than any reference, two of them compare as their words without reading elsewhere
+  if (faster_sstr_is_inline(key1) || faster_sstr_is_inline(key2)) {
+    return faster_sstr_cmp_binary(key1, key2);
+  }
+  faster_str_t view1 = faster_sstr_view(key1), view2 = faster_sstr_view(key2);
+  return faster_str_cmp_prefixed(&view1, prefix1, &view2, prefix2);
+#else
+  return faster_str_cmp_prefixed(key1, prefix1, key2, prefix2);
+#endif
+}
+
+// store key in the form the nodes keep, false when it is too long for it
+static inline bool _AVL_key_init(AVLNodeKey_t *node_key, const faster_str_t *key) {
+#if FASTER_AVL_SSTR_KEYS
+  return faster_sstr_init(node_key, key);
+#else
+  memcpy((void *)node_key, key, sizeof(faster_str_t));
+  return true;
+#endif
+}
+
+// the searched key, converted once per operation
+struct _AVL_probe_s {
+  const AVLNodeKey_t *key;
+  faster_str_prefix_t prefix;
+#if FASTER_AVL_SSTR_KEYS
+  faster_sstr_t storage;
+#endif
+};
+
+// false when no node can hold the key
+static inline bool _AVL_probe_init(struct _AVL_probe_s *probe, const faster_str_ptr_t key) {
+  probe->prefix = faster_str_prefix(key);
+#if FASTER_AVL_SSTR_KEYS
+  probe->key = &probe->storage;
+  return faster_sstr_init(&probe->storage, key);
+#else
+  probe->key = key;
+  return true;
+#endif
+}
+
+static inline int _AVL_probe_cmp(const struct _AVL_probe_s *probe, const AVLNode_t *node_ptr) {
+  return _AVL_key_cmp(probe->key, probe->prefix, &node_ptr->key, node_ptr->key_prefix);
+}
+
+static inline void _AVL_push(faster_avl_tree_iterator_helper_t *it, const AVLNodeIndex node) {
+  assert(it->top < FASTER_MAX_AVL_ITERATOR_STACK_SIZE - 1);
+  it->stack[++(it->top)] = node;
+}
+
+// push the path down to the smallest key of the subtree (the largest one for reverse walks)
+static void _AVL_push_edge(const AVLNodesTreePtr tree, faster_avl_tree_iterator_helper_t *it, AVLNodeIndex current) {
+  while (FASTER_AVL_NODE_VALID(current)) {
+    _AVL_push(it, current);
+    AVLNodePtr node_ptr = tree->node_list.list + current;
+    current = it->reverse ? node_ptr->right : node_ptr->left;
+  }
+}
+
+static void _AVL_iterator_reset(faster_avl_tree_iterator_helper_t *it, const int reverse) {
+  it->top = -1;
+  it->initialized = 1;
+  it->reverse = reverse;
+  it->bound = NULL;
+  it->prefix = NULL;
+  it->prefix_length = 0;
+}
+
+// stack the ancestors the walk still has to visit, so that the top is the first key above
+// (or with inclusive set, not below) the given one
+static void _AVL_seek_forward(const AVLNodesTreePtr tree, faster_avl_tree_iterator_helper_t *it, const faster_str_ptr_t key,
+                              const bool inclusive) {
+  struct _AVL_probe_s probe;
+  if (!_AVL_probe_init(&probe, key)) {
+    return; // above every key of the tree
+  }
+  AVLNodeIndex current = tree->root_node;
+  while (FASTER_AVL_NODE_VALID(current)) {
+    AVLNodePtr node_ptr = tree->node_list.list + current;
+    int cmp = -_AVL_probe_cmp(&probe, node_ptr);
+    if (cmp > 0 || (cmp == 0 && inclusive)) {
+      _AVL_push(it, current);
+      current = node_ptr->left;
+    } else {
+      current = node_ptr->right;
+    }
+  }
+}
+
+// mirror of _AVL_seek_forward, the top is the last key below (or not above) the given one
+static void _AVL_seek_backward(const AVLNodesTreePtr tree, faster_avl_tree_iterator_helper_t *it, const faster_str_ptr_t key,
+                               const bool inclusive) {
+  struct _AVL_probe_s probe;
+  if (!_AVL_probe_init(&probe, key)) {
+    _AVL_push_edge(tree, it, tree->root_node); // above every key of the tree
+    return;
+  }
+  AVLNodeIndex current = tree->root_node;
+  while (FASTER_AVL_NODE_VALID(current)) {
+    AVLNodePtr node_ptr = tree->node_list.list + current;
+    int cmp = -_AVL_probe_cmp(&probe, node_ptr);
+    if (cmp < 0 || (cmp == 0 && inclusive)) {
+      _AVL_push(it, current);
+      current = node_ptr->right;
+    } else {
+      current = node_ptr->left;
+    }
   }
-  return current;
 }
 
-// Iterator for AVL tree
+// keys sharing a prefix are contiguous only within one key length,
+// seek the first key of prefix_length length not below the prefix, or the first longer key
+static void _AVL_seek_prefix_length(const AVLNodesTreePtr tree, faster_avl_tree_iterator_helper_t *it) {
+  size_t bytes = FASTER_STRING_MEMORY_SIZE(it->prefix->str_len);
+  it->top = -1;
+  AVLNodeIndex current = tree->root_node;
+  while (FASTER_AVL_NODE_VALID(current)) {
+    AVLNodePtr node_ptr = tree->node_list.list + current;
+    faster_str_t node_key = AVL_node_key(node_ptr);
+    bool not_below = (node_key.str_len != it->prefix_length) ? (node_key.str_len > it->prefix_length)
+                                                           : (memcmp(node_key.str_ptr, it->prefix->str_ptr, bytes) >= 0);
+    if (not_below) {
+      _AVL_push(it, current);
+      current = node_ptr->left;
+    } else {
+      current = node_ptr->right;
+    }
+  }
+}
+
+// Iterator for AVL tree, walks the whole tree in order unless positioned by one of the seek functions
 AVLNodeIndex AVL_iterator(AVLNodesTreePtr tree, faster_avl_tree_iterator_helper_t *it) {
   // Initialize the iterator on the first call.
   if (!it->initialized) {
-    it->top = -1;
-    AVLNodeIndex current = tree->root_node;
-    while (FASTER_AVL_NODE_VALID(current)) {
-      if (it->top < FASTER_MAX_AVL_ITERATOR_STACK_SIZE - 1) {
-        it->stack[++(it->top)] = current;
+    _AVL_iterator_reset(it, 0);
+    _AVL_push_edge(tree, it, tree->root_node);
+  }
+
+  for (;;) {
+    // If the stack is empty, we have traversed all nodes.
+    if (it->top < 0) {
+      return FASTER_AVL_NODE_INDEX_INVALID;
+    }
+
+    // Pop the next node and stack the edge of its subtree on the far side
+    AVLNodeIndex node = it->stack[it->top--];
+    AVLNodePtr node_ptr = tree->node_list.list + node;
+    _AVL_push_edge(tree, it, it->reverse ? node_ptr->left : node_ptr->right);
+
+    faster_str_t node_key = AVL_node_key(node_ptr);
+    if (it->prefix != NULL) {
+      if (node_key.str_len == it->prefix_length &&
+          memcmp(node_key.str_ptr, it->prefix->str_ptr, FASTER_STRING_MEMORY_SIZE(it->prefix->str_len)) == 0) {
+        return node;
+      }
+      // past the matches of this length, jump to the next length present in the tree
+      it->prefix_length = (node_key.str_len == it->prefix_length) ? it->prefix_length + 1 : node_key.str_len;
+      _AVL_seek_prefix_length(tree, it);
+      continue;
+    }
+    if (it->bound != NULL) {
+      int cmp = faster_str_cmp_binary(&node_key, it->bound);
+      if (it->reverse ? (cmp < 0) : (cmp >= 0)) {
+        it->top = -1;
+        return FASTER_AVL_NODE_INDEX_INVALID;
       }
-      // Move to left child
-      AVLNodePtr node_ptr = tree->node_list.list + current;
-      current = node_ptr->left;
     }
-    it->initialized = 1;
+    return node;
   }
+}
 
-  // If the stack is empty, we have traversed all nodes.
-  if (it->top < 0) {
-    return FASTER_AVL_NODE_INDEX_INVALID;
+// first key not below the given one
+void AVL_seek_lower_bound(AVLNodesTreePtr tree, const faster_str_ptr_t key, faster_avl_tree_iterator_helper_t *it) {
+  _AVL_iterator_reset(it, 0);
+  _AVL_seek_forward(tree, it, key, true);
+}
+
+// first key above the given one
+void AVL_seek_upper_bound(AVLNodesTreePtr tree, const faster_str_ptr_t key, faster_avl_tree_iterator_helper_t *it) {
+  _AVL_iterator_reset(it, 0);
+  _AVL_seek_forward(tree, it, key, false);
+}
+
+// keys in [from, to), NULL leaves that side open
+void AVL_seek_range(AVLNodesTreePtr tree, const faster_str_ptr_t from, const faster_str_ptr_t to,
+                    faster_avl_tree_iterator_helper_t *it) {
+  _AVL_iterator_reset(it, 0);
+  if (from != NULL) {
+    _AVL_seek_forward(tree, it, from, true);
+  } else {
+    _AVL_push_edge(tree, it, tree->root_node);
   }
+  it->bound = to;
+}
 
-  // Pop the next node from the stack as the current in-order node.
-  AVLNodeIndex node = it->stack[it->top--];
+// keys starting with prefix, shortest keys first
+void AVL_seek_prefix(AVLNodesTreePtr tree, const faster_str_ptr_t prefix, faster_avl_tree_iterator_helper_t *it) {
+  _AVL_iterator_reset(it, 0);
+  it->prefix = prefix;
+  it->prefix_length = prefix->str_len;
+  _AVL_seek_prefix_length(tree, it);
+}
 
-  // If there is a right subtree, push its leftmost nodes onto the stack.
-  AVLNodePtr node_ptr = tree->node_list.list + node;
-  AVLNodeIndex current = node_ptr->right;
-  while (FASTER_AVL_NODE_VALID(current)) {
-    if (it->top < FASTER_MAX_AVL_ITERATOR_STACK_SIZE - 1) {
-      it->stack[++(it->top)] = current;
-    }
-    node_ptr = tree->node_list.list + current;
-    current = node_ptr->left;
+// descending walk from the last key not above the given one, NULL starts at the largest key
+void AVL_seek_reverse(AVLNodesTreePtr tree, const faster_str_ptr_t key, faster_avl_tree_iterator_helper_t *it) {
+  _AVL_iterator_reset(it, 1);
+  if (key != NULL) {
+    _AVL_seek_backward(tree, it, key, true);
+  } else {
+    _AVL_push_edge(tree, it, tree->root_node);
   }
+}
 
-  return node;
+// keys in [from, to) in descending order, NULL leaves that side open
+void AVL_seek_reverse_range(AVLNodesTreePtr tree, const faster_str_ptr_t from, const faster_str_ptr_t to,
+                            faster_avl_tree_iterator_helper_t *it) {
+  _AVL_iterator_reset(it, 1);
+  if (to != NULL) {
+    _AVL_seek_backward(tree, it, to, false);
+  } else {
+    _AVL_push_edge(tree, it, tree->root_node);
+  }
+  it->bound = from;
 }
 
 // Create a new node
-static AVLNodeIndex createNode(const AVLNodesTreePtr tree, const faster_str_ptr_t key, faster_value_ptr value) {
+static AVLNodeIndex createNode(const AVLNodesTreePtr tree, const struct _AVL_probe_s *probe, faster_value_ptr value) {
   AVLNodeIndex node = AVLNode_t_arr_get_next(&tree->node_list);
   if (FASTER_AVL_NODE_INVALID(node)) {
     return FASTER_AVL_NODE_INDEX_INVALID;
   }
   AVLNodePtr node_ptr = tree->node_list.list + node;
-  memcpy((void *)&node_ptr->key, key, sizeof(faster_str_t));
+  memcpy((void *)&node_ptr->key, probe->key, sizeof(AVLNodeKey_t));
+  node_ptr->key_prefix = probe->prefix;
   node_ptr->left = FASTER_AVL_NODE_INDEX_INVALID;
   node_ptr->right = FASTER_AVL_NODE_INDEX_INVALID;
   node_ptr->height = 1;
+  _AVL_UPDATE_SIZE(tree, node_ptr);
   node_ptr->value = value;
   return node;
 }
@@ -83,8 +284,10 @@ static AVLNodeIndex rightRotate(const AVLNodesTreePtr tree, AVLNodeIndex y) {
   y_ptr->left = T2;
 
   // Update heights
-  y_ptr->height = max(height(tree, y_ptr->left), height(tree, y_ptr->right)) + 1;
-  x_ptr->height = max(height(tree, x_ptr->left), height(tree, x_ptr->right)) + 1;
+  y_ptr->height = (int8_t)(max(height(tree, y_ptr->left), height(tree, y_ptr->right)) + 1);
+  x_ptr->height = (int8_t)(max(height(tree, x_ptr->left), height(tree, x_ptr->right)) + 1);
+  _AVL_UPDATE_SIZE(tree, y_ptr);
+  _AVL_UPDATE_SIZE(tree, x_ptr);
 
   return x;
 }
@@ -101,8 +304,10 @@ static AVLNodeIndex leftRotate(const AVLNodesTreePtr tree, AVLNodeIndex x) {
   x_ptr->right = T2;
 
   // Update heights
-  x_ptr->height = max(height(tree, x_ptr->left), height(tree, x_ptr->right)) + 1;
-  y_ptr->height = max(height(tree, y_ptr->left), height(tree, y_ptr->right)) + 1;
+  x_ptr->height = (int8_t)(max(height(tree, x_ptr->left), height(tree, x_ptr->right)) + 1);
+  y_ptr->height = (int8_t)(max(height(tree, y_ptr->left), height(tree, y_ptr->right)) + 1);
+  _AVL_UPDATE_SIZE(tree, x_ptr);
+  _AVL_UPDATE_SIZE(tree, y_ptr);
 
   return y;
 }
@@ -113,137 +318,295 @@ static int getBalance(const AVLNodesTreePtr tree, const AVLNodeIndex node) {
   return FASTER_AVL_NODE_VALID(node) ? (height(tree, node_ptr->left) - height(tree, node_ptr->right)) : 0;
 }
 
-// insert wrapper
-static AVLNodeIndex _AVL_insert(const AVLNodesTreePtr tree, const AVLNodeIndex node, const faster_str_ptr_t key,
-                                const faster_value_ptr value, bool *found);
-bool AVL_insert_or_update(AVLNodesTreePtr tree, const faster_str_ptr_t key, const faster_value_ptr value) {
-  bool found = false;
-  tree->root_node = _AVL_insert(tree, tree->root_node, key, value, &found);
-  return !found;
-}
-
-// Insert a key into the AVL tree
-static AVLNodeIndex _AVL_insert(const AVLNodesTreePtr tree, const AVLNodeIndex node, const faster_str_ptr_t key,
-                                const faster_value_ptr value, bool *found) {
-  if (FASTER_AVL_NODE_INVALID(node))
-    return createNode(tree, key, value);
-  AVLNodeIndex index = node;
-
-  int cmp = faster_str_cmp_binary(key, &tree->node_list.list[node].key);
-  if (cmp < 0) {
-    index = _AVL_insert(tree, tree->node_list.list[node].left, key, value, found);
-    tree->node_list.list[node].left = index;
-  } else if (cmp > 0) {
-    index = _AVL_insert(tree, tree->node_list.list[node].right, key, value, found);
-    tree->node_list.list[node].right = index;
+// relink the subtree that replaced path[level] under its parent (or as the root)
+static inline void _AVL_relink(const AVLNodesTreePtr tree, const AVLNodeIndex *path, const unsigned char *dir, const int level,
+                               const AVLNodeIndex subtree) {
+  if (level == 0) {
+    tree->root_node = subtree;
+  } else if (dir[level - 1]) {
+    tree->node_list.list[path[level - 1]].right = subtree;
   } else {
-    // Update value if key exists
-    *found = true;
-    tree->node_list.list[node].value = value;
-    return node;
+    tree->node_list.list[path[level - 1]].left = subtree;
   }
+}
 
-  // Update height of this ancestor node
-  tree->node_list.list[node].height =
-      max(height(tree, tree->node_list.list[node].left), height(tree, tree->node_list.list[node].right)) + 1;
-
-  // Get balance factor to check if this node became unbalanced
-  int balance = getBalance(tree, node);
-
-  if (balance > 1) {
-    if (faster_str_cmp_binary(key, &tree->node_list.list[tree->node_list.list[node].left].key) < 0) {
-      return rightRotate(tree, node);
-    } else {
-      tree->node_list.list[node].left = leftRotate(tree, tree->node_list.list[node].left);
-      return rightRotate(tree, node);
+// Insert a key into the AVL tree, or update its value if present
+// single comparison per level, the descent is kept for the bottom-up rebalancing
+bool AVL_insert_or_update(AVLNodesTreePtr tree, const faster_str_ptr_t key, const faster_value_ptr value) {
+  AVLNodeIndex path[FASTER_AVL_MAX_HEIGHT];
+  unsigned char dir[FASTER_AVL_MAX_HEIGHT];
+  int depth = 0;
+  struct _AVL_probe_s probe;
+  if (!_AVL_probe_init(&probe, key)) {
+    return false;
+  }
+  AVLNodeIndex node = tree->root_node;
+  while (FASTER_AVL_NODE_VALID(node)) {
+    AVLNodePtr node_ptr = tree->node_list.list + node;
+    int cmp = _AVL_probe_cmp(&probe, node_ptr);
+    if (cmp == 0) {
+      // Update value if key exists
+      node_ptr->value = value;
+      return false;
     }
+    assert(depth < FASTER_AVL_MAX_HEIGHT);
+    path[depth] = node;
+    dir[depth++] = cmp > 0;
+    node = node_ptr->child[cmp > 0];
+  }
+  AVLNodeIndex new_node = createNode(tree, &probe, value);
+  if (FASTER_AVL_NODE_INVALID(new_node)) {
+    return false;
   }
+  _AVL_relink(tree, path, dir, depth, new_node);
+  _AVL_ADJUST_PATH_SIZES(tree, path, depth, 1);
 
-  if (balance < -1) {
-    if (faster_str_cmp_binary(key, &tree->node_list.list[tree->node_list.list[node].right].key) > 0) {
-      return leftRotate(tree, node);
-    } else {
-      tree->node_list.list[node].right = rightRotate(tree, tree->node_list.list[node].right);
-      return leftRotate(tree, node);
+  // walk back up, a single rotation restores the previous height so we can stop there
+  for (int level = depth - 1; level >= 0; level--) {
+    node = path[level];
+    AVLNodePtr node_ptr = tree->node_list.list + node;
+    int left_height = height(tree, node_ptr->left);
+    int right_height = height(tree, node_ptr->right);
+    int new_height = max(left_height, right_height) + 1;
+    if (new_height == node_ptr->height) {
+      break;
+    }
+    node_ptr->height = (int8_t)new_height;
+    int balance = left_height - right_height;
+    if (balance > 1) {
+      // the inserted key went left, dir[level + 1] tells which side of the left child
+      if (dir[level + 1]) {
+        node_ptr->left = leftRotate(tree, node_ptr->left);
+      }
+      _AVL_relink(tree, path, dir, level, rightRotate(tree, node));
+      break;
+    }
+    if (balance < -1) {
+      if (!dir[level + 1]) {
+        node_ptr->right = rightRotate(tree, node_ptr->right);
+      }
+      _AVL_relink(tree, path, dir, level, leftRotate(tree, node));
+      break;
     }
   }
-
-  return node; // Return unchanged pointer
+  return true;
 }
 
 faster_value_ptr AVL_get(const AVLNodesTreePtr tree, const faster_str_ptr_t key) {
   // navigate tree using binary search
+  struct _AVL_probe_s probe;
+  if (!_AVL_probe_init(&probe, key)) {
+    return NULL;
+  }
   AVLNodeIndex node = tree->root_node;
   while (FASTER_AVL_NODE_VALID(node)) {
     AVLNodePtr node_ptr = tree->node_list.list + node;
-    int cmp = faster_str_cmp_binary(key, &node_ptr->key);
+    int cmp = _AVL_probe_cmp(&probe, node_ptr);
     if (cmp == 0)
       return node_ptr->value; // key found
-    node = (cmp < 0) ? node_ptr->left : node_ptr->right;
+    node = node_ptr->child[cmp > 0];
   }
   return NULL; // key not found
 }
 
-static AVLNodeIndex _AVL_remove(const AVLNodesTreePtr tree, const AVLNodeIndex node, const faster_str_ptr_t key, bool *found);
+// Remove a key from the AVL tree
+// single comparison per level, rebalancing stops once a subtree keeps its height
 bool AVL_remove(AVLNodesTreePtr tree, const faster_str_ptr_t key) {
-  bool found = false;
-  tree->root_node = _AVL_remove(tree, tree->root_node, key, &found);
-  return found; // key removed
-}
-
-static AVLNodeIndex _AVL_remove(const AVLNodesTreePtr tree, const AVLNodeIndex node, const faster_str_ptr_t key, bool *found) {
+  AVLNodeIndex path[FASTER_AVL_MAX_HEIGHT];
+  unsigned char dir[FASTER_AVL_MAX_HEIGHT];
+  int depth = 0;
+  struct _AVL_probe_s probe;
+  if (!_AVL_probe_init(&probe, key)) {
+    return false;
+  }
+  AVLNodeIndex node = tree->root_node;
+  while (FASTER_AVL_NODE_VALID(node)) {
+    AVLNodePtr node_ptr = tree->node_list.list + node;
+    int cmp = _AVL_probe_cmp(&probe, node_ptr);
+    if (cmp == 0)
+      break;
+    assert(depth < FASTER_AVL_MAX_HEIGHT);
+    path[depth] = node;
+    dir[depth++] = cmp > 0;
+    node = node_ptr->child[cmp > 0];
+  }
   if (FASTER_AVL_NODE_INVALID(node))
-    return node;
-  AVLNodeIndex index = node;
-  AVLNodePtr node_ptr = tree->node_list.list + index;
-  if (faster_str_cmp_binary(key, &node_ptr->key) < 0) {
-    node_ptr->left = _AVL_remove(tree, node_ptr->left, key, found);
-  } else if (faster_str_cmp_binary(key, &node_ptr->key) > 0) {
-    node_ptr->right = _AVL_remove(tree, node_ptr->right, key, found);
+    return false; // key not found
+
+  AVLNodePtr node_ptr = tree->node_list.list + node;
+  AVLNodeIndex removed = node;
+  AVLNodeIndex replacement;
+  if (FASTER_AVL_NODE_VALID(node_ptr->left) && FASTER_AVL_NODE_VALID(node_ptr->right)) {
+    // Node with two children: move the inorder successor here and unlink it instead
+    path[depth] = node;
+    dir[depth++] = 1;
+    removed = node_ptr->right;
+    while (FASTER_AVL_NODE_VALID(tree->node_list.list[removed].left)) {
+      assert(depth < FASTER_AVL_MAX_HEIGHT);
+      path[depth] = removed;
+      dir[depth++] = 0;
+      removed = tree->node_list.list[removed].left;
+    }
+    memcpy((void *)&node_ptr->key, &tree->node_list.list[removed].key, sizeof(AVLNodeKey_t));
+    node_ptr->key_prefix = tree->node_list.list[removed].key_prefix;
+    node_ptr->value = tree->node_list.list[removed].value;
+    replacement = tree->node_list.list[removed].right;
   } else {
-    *found = true; // key found
     // Node with only one child or no child
-    if (FASTER_AVL_NODE_INVALID(node_ptr->left)) {
-      AVLNodeIndex temp = node_ptr->right;
-      AVLNode_t_arr_release(&tree->node_list, index); // Release the node
-      return temp;
-    } else if (FASTER_AVL_NODE_INVALID(node_ptr->right)) {
-      AVLNodeIndex temp = node_ptr->left;
-      AVLNode_t_arr_release(&tree->node_list, index); // Release the node
-      return temp;
+    replacement = FASTER_AVL_NODE_VALID(node_ptr->left) ? node_ptr->left : node_ptr->right;
+  }
+  _AVL_relink(tree, path, dir, depth, replacement);
+  AVLNode_t_arr_release(&tree->node_list, removed); // Release the node
+  _AVL_ADJUST_PATH_SIZES(tree, path, depth, -1);
+
+  for (int level = depth - 1; level >= 0; level--) {
+    node = path[level];
+    node_ptr = tree->node_list.list + node;
+    int old_height = node_ptr->height;
+    int left_height = height(tree, node_ptr->left);
+    int right_height = height(tree, node_ptr->right);
+    node_ptr->height = (int8_t)(max(left_height, right_height) + 1);
+    int balance = left_height - right_height;
+    AVLNodeIndex subtree = node;
+    if (balance > 1) {
+      if (getBalance(tree, node_ptr->left) < 0) {
+        node_ptr->left = leftRotate(tree, node_ptr->left);
+      }
+      subtree = rightRotate(tree, node);
+      _AVL_relink(tree, path, dir, level, subtree);
+    } else if (balance < -1) {
+      if (getBalance(tree, node_ptr->right) > 0) {
+        node_ptr->right = rightRotate(tree, node_ptr->right);
+      }
+      subtree = leftRotate(tree, node);
+      _AVL_relink(tree, path, dir, level, subtree);
+    }
+    if (tree->node_list.list[subtree].height == old_height) {
+      break;
     }
-    // Node with two children: Get the inorder successor
-    AVLNodeIndex temp = min_value_node(tree, node_ptr->right);
-    memcpy((void *)&node_ptr->key, &tree->node_list.list[temp].key, sizeof(faster_str_t));
-    node_ptr->value = tree->node_list.list[temp].value;
-    node_ptr->right = _AVL_remove(tree, node_ptr->right, (const faster_str_ptr_t)&tree->node_list.list[temp].key, found);
   }
+  return true; // key removed
+}
 
-  if (FASTER_AVL_NODE_INVALID(index))
-    return index;
-
-  // Update height of this ancestor index
-  node_ptr->height = max(height(tree, node_ptr->left), height(tree, node_ptr->right)) + 1;
+// key and value for the sorting path of the bulk load, position breaks ties so the last value wins
+struct _AVL_bulk_entry_s {
+  AVLNodeKey_t key;
+  faster_str_prefix_t key_prefix;
+  faster_value_ptr value;
+  size_t position;
+};
+
+static int _AVL_bulk_entry_cmp(const void *entry1, const void *entry2) {
+  const struct _AVL_bulk_entry_s *e1 = (const struct _AVL_bulk_entry_s *)entry1;
+  const struct _AVL_bulk_entry_s *e2 = (const struct _AVL_bulk_entry_s *)entry2;
+  int cmp = _AVL_key_cmp(&e1->key, e1->key_prefix, &e2->key, e2->key_prefix);
+  return (cmp != 0) ? cmp : (e1->position > e2->position) - (e1->position < e2->position);
+}
 
-  // Get balance factor to check if this index became unbalanced
-  int balance = getBalance(tree, index);
-  if (balance > 1) {
-    if (getBalance(tree, node_ptr->left) >= 0) {
-      return rightRotate(tree, index);
+// lay count sorted keys out as a complete tree in breadth-first order: node i has its children at 2i + 1 and 2i + 2,
+// so the top levels of every descent share the first cache lines of node_list
+static bool _AVL_bulk_build(const AVLNodesTreePtr tree, const faster_str_t *keys, const faster_value_ptr *values,
+                            const struct _AVL_bulk_entry_s *entries, const faster_indexing_t count) {
+  if (!AVLNode_t_arr_fill(&tree->node_list, count)) {
+    return false;
+  }
+  // in-order walk of the implicit tree hands out the keys in ascending order
+  size_t stack[FASTER_AVL_MAX_HEIGHT];
+  int top = -1;
+  size_t next = 0;
+  size_t current = 0;
+  while (current < count || top >= 0) {
+    while (current < count) {
+      assert(top < FASTER_AVL_MAX_HEIGHT - 1);
+      stack[++top] = current;
+      current = 2 * current + 1;
+    }
+    current = stack[top--];
+    AVLNodePtr node_ptr = tree->node_list.list + current;
+    if (entries != NULL) {
+      memcpy((void *)&node_ptr->key, &entries[next].key, sizeof(AVLNodeKey_t));
+      node_ptr->key_prefix = entries[next].key_prefix;
+      node_ptr->value = entries[next].value;
     } else {
-      node_ptr->left = leftRotate(tree, node_ptr->left);
-      return rightRotate(tree, index);
+      _AVL_key_init(&node_ptr->key, &keys[next]);
+      node_ptr->key_prefix = faster_str_prefix(&keys[next]);
+      node_ptr->value = (values != NULL) ? values[next] : FASTER_NULL_VALUE;
     }
+    next++;
+    current = 2 * current + 2;
   }
-  if (balance < -1) {
-    if (getBalance(tree, node_ptr->right) <= 0) {
-      return leftRotate(tree, index);
-    } else {
-      node_ptr->right = rightRotate(tree, node_ptr->right);
-      return leftRotate(tree, index);
+  // children come after their parents, so heights are settled walking backwards
+  for (size_t i = count; i-- > 0;) {
+    AVLNodePtr node_ptr = tree->node_list.list + i;
+    node_ptr->left = (2 * i + 1 < count) ? (AVLNodeIndex)(2 * i + 1) : FASTER_AVL_NODE_INDEX_INVALID;
+    node_ptr->right = (2 * i + 2 < count) ? (AVLNodeIndex)(2 * i + 2) : FASTER_AVL_NODE_INDEX_INVALID;
+    node_ptr->height = (int8_t)(max(height(tree, node_ptr->left), height(tree, node_ptr->right)) + 1);
+    _AVL_UPDATE_SIZE(tree, node_ptr);
+  }
+  tree->root_node = (count > 0) ? 0 : FASTER_AVL_NODE_INDEX_INVALID;
+  return true;
+}
+
+// Build the tree from count keys (and values, NULL stores FASTER_NULL_VALUE) in O(n) when the keys are strictly
+// ascending, otherwise they are sorted first; duplicates keep the last value. Keys already in the tree are merged in,
+// with the loaded values winning. Returns false when memory runs out, the tree is unchanged then.
+bool AVL_bulk_load(AVLNodesTreePtr tree, const faster_str_t *keys, const faster_value_ptr *values, const faster_indexing_t count) {
+  faster_indexing_t existing = AVLNode_t_arr_count(&tree->node_list);
+#if FASTER_AVL_SSTR_KEYS
+  // refused up front, so the builds below cannot fail half way
+  for (faster_indexing_t i = 0; i < count; i++) {
+    if (keys[i].str_len > FAST_LIMIT_INDEXING_MAX) {
+      return false;
+    }
+  }
+#endif
+  bool sorted = (existing == 0);
+  for (faster_indexing_t i = 1; sorted && i < count; i++) {
+    sorted = faster_str_cmp_binary(&keys[i - 1], &keys[i]) < 0;
+  }
+  if (sorted) {
+    return _AVL_bulk_build(tree, keys, values, NULL, count);
+  }
+
+  size_t total = (size_t)existing + count;
+  struct _AVL_bulk_entry_s *entries = malloc(total * sizeof(struct _AVL_bulk_entry_s));
+  if (entries == NULL) {
+    return false;
+  }
+  size_t filled = 0;
+  faster_avl_tree_iterator_helper_t it = FASTER_AVL_TREE_EMPTY_ITERATOR;
+  AVLNodeIndex node;
+  while ((node = AVL_iterator(tree, &it)) != FASTER_AVL_NODE_INDEX_INVALID) {
+    AVLNodePtr node_ptr = tree->node_list.list + node;
+    memcpy((void *)&entries[filled].key, &node_ptr->key, sizeof(AVLNodeKey_t));
+    entries[filled].key_prefix = node_ptr->key_prefix;
+    entries[filled].value = node_ptr->value;
+    entries[filled].position = filled;
+    filled++;
+  }
+  for (faster_indexing_t i = 0; i < count; i++, filled++) {
+    _AVL_key_init(&entries[filled].key, &keys[i]);
+    entries[filled].key_prefix = faster_str_prefix(&keys[i]);
+    entries[filled].value = (values != NULL) ? values[i] : FASTER_NULL_VALUE;
+    entries[filled].position = filled;
+  }
+  qsort(entries, total, sizeof(struct _AVL_bulk_entry_s), _AVL_bulk_entry_cmp);
+
+  // keep the last entry of every run of equal keys
+  size_t unique = 0;
+  for (size_t i = 0; i < total; i++) {
+    if (i + 1 < total &&
+        _AVL_key_cmp(&entries[i].key, entries[i].key_prefix, &entries[i + 1].key, entries[i + 1].key_prefix) == 0) {
+      continue;
     }
+    if (unique != i) {
+      memcpy(&entries[unique], &entries[i], sizeof(struct _AVL_bulk_entry_s));
+    }
+    unique++;
   }
-  return index; // Return unchanged pointer
+  bool built = _AVL_bulk_build(tree, NULL, NULL, entries, (faster_indexing_t)unique);
+  free(entries);
+  return built;
 }
 
 void AVL_reset_and_free(const AVLNodesTreePtr tree) {
@@ -254,3 +617,364 @@ void AVL_reset_and_free(const AVLNodesTreePtr tree) {
   free(tree->node_list.list);
   tree->node_list.list = NULL;
 }
+
+// give node the children left and right, their heights differ by one at most
+static AVLNodeIndex _AVL_attach(const AVLNodesTreePtr tree, const AVLNodeIndex node, const AVLNodeIndex left,
+                                const AVLNodeIndex right) {
+  AVLNodePtr node_ptr = tree->node_list.list + node;
+  node_ptr->left = left;
+  node_ptr->right = right;
+  node_ptr->height = (int8_t)(max(height(tree, left), height(tree, right)) + 1);
+  _AVL_UPDATE_SIZE(tree, node_ptr);
+  return node;
+}
+
+// left is more than one level higher than right: walk down its right spine to a subtree
+// of right's height, hang middle there and rebalance on the way back
+static AVLNodeIndex _AVL_join_right(const AVLNodesTreePtr tree, const AVLNodeIndex left, const AVLNodeIndex middle,
+                                    const AVLNodeIndex right) {
+  AVLNodePtr left_ptr = tree->node_list.list + left;
+  AVLNodeIndex inner = left_ptr->right;
+  AVLNodeIndex joined = (height(tree, inner) <= height(tree, right) + 1) ? _AVL_attach(tree, middle, inner, right)
+                                                                        : _AVL_join_right(tree, inner, middle, right);
+  if (height(tree, joined) <= height(tree, left_ptr->left) + 1) {
+    return _AVL_attach(tree, left, left_ptr->left, joined);
+  }
+  if (getBalance(tree, joined) > 0) {
+    joined = rightRotate(tree, joined);
+  }
+  _AVL_attach(tree, left, left_ptr->left, joined);
+  return leftRotate(tree, left);
+}
+
+// mirror of _AVL_join_right
+static AVLNodeIndex _AVL_join_left(const AVLNodesTreePtr tree, const AVLNodeIndex left, const AVLNodeIndex middle,
+                                   const AVLNodeIndex right) {
+  AVLNodePtr right_ptr = tree->node_list.list + right;
+  AVLNodeIndex inner = right_ptr->left;
+  AVLNodeIndex joined = (height(tree, inner) <= height(tree, left) + 1) ? _AVL_attach(tree, middle, left, inner)
+                                                                       : _AVL_join_left(tree, left, middle, inner);
+  if (height(tree, joined) <= height(tree, right_ptr->right) + 1) {
+    return _AVL_attach(tree, right, joined, right_ptr->right);
+  }
+  if (getBalance(tree, joined) < 0) {
+    joined = leftRotate(tree, joined);
+  }
+  _AVL_attach(tree, right, joined, right_ptr->right);
+  return rightRotate(tree, right);
+}
+
+// subtree with the keys of left, middle and right, middle's children are overwritten
+AVLNodeIndex AVL_join(const AVLNodesTreePtr tree, AVLNodeIndex left, AVLNodeIndex middle, AVLNodeIndex right) {
+  int left_height = height(tree, left);
+  int right_height = height(tree, right);
+  if (left_height > right_height + 1) {
+    return _AVL_join_right(tree, left, middle, right);
+  }
+  if (right_height > left_height + 1) {
+    return _AVL_join_left(tree, left, middle, right);
+  }
+  return _AVL_attach(tree, middle, left, right);
+}
+
+// detach the node with the largest key, the rest of the subtree is returned
+static AVLNodeIndex _AVL_split_last(const AVLNodesTreePtr tree, const AVLNodeIndex node, AVLNodeIndex *last) {
+  AVLNodePtr node_ptr = tree->node_list.list + node;
+  if (FASTER_AVL_NODE_INVALID(node_ptr->right)) {
+    *last = node;
+    return node_ptr->left;
+  }
+  AVLNodeIndex left = node_ptr->left;
+  AVLNodeIndex rest = _AVL_split_last(tree, node_ptr->right, last);
+  return AVL_join(tree, left, node, rest);
+}
+
+// join without a middle key, every key of left must be below every key of right
+AVLNodeIndex AVL_join2(const AVLNodesTreePtr tree, AVLNodeIndex left, AVLNodeIndex right) {
+  if (FASTER_AVL_NODE_INVALID(left)) {
+    return right;
+  }
+  AVLNodeIndex last;
+  AVLNodeIndex rest = _AVL_split_last(tree, left, &last);
+  return AVL_join(tree, rest, last, right);
+}
+
+static AVLNodeIndex _AVL_split(const AVLNodesTreePtr tree, const AVLNodeIndex node, const struct _AVL_probe_s *probe,
+                               AVLNodeIndex *left, AVLNodeIndex *right) {
+  if (FASTER_AVL_NODE_INVALID(node)) {
+    *left = FASTER_AVL_NODE_INDEX_INVALID;
+    *right = FASTER_AVL_NODE_INDEX_INVALID;
+    return FASTER_AVL_NODE_INDEX_INVALID;
+  }
+  AVLNodePtr node_ptr = tree->node_list.list + node;
+  AVLNodeIndex node_left = node_ptr->left;
+  AVLNodeIndex node_right = node_ptr->right;
+  int cmp = _AVL_probe_cmp(probe, node_ptr);
+  if (cmp == 0) {
+    *left = node_left;
+    *right = node_right;
+    return _AVL_attach(tree, node, FASTER_AVL_NODE_INDEX_INVALID, FASTER_AVL_NODE_INDEX_INVALID);
+  }
+  AVLNodeIndex inner;
+  AVLNodeIndex found;
+  if (cmp < 0) {
+    found = _AVL_split(tree, node_left, probe, left, &inner);
+    *right = AVL_join(tree, inner, node, node_right);
+  } else {
+    found = _AVL_split(tree, node_right, probe, &inner, right);
+    *left = AVL_join(tree, node_left, node, inner);
+  }
+  return found;
+}
+
+// split the subtree into the keys below and above key, the node holding key comes back detached
+// (FASTER_AVL_NODE_INDEX_INVALID when the key is absent)
+AVLNodeIndex AVL_split(const AVLNodesTreePtr tree, AVLNodeIndex root, const faster_str_ptr_t key, AVLNodeIndex *left,
+                       AVLNodeIndex *right) {
+  struct _AVL_probe_s probe;
+  if (!_AVL_probe_init(&probe, key)) {
+    // above every key of the subtree
+    *left = root;
+    *right = FASTER_AVL_NODE_INDEX_INVALID;
+    return FASTER_AVL_NODE_INDEX_INVALID;
+  }
+  return _AVL_split(tree, root, &probe, left, right);
+}
+
+enum _AVL_set_operation_e { _AVL_UNION, _AVL_INTERSECTION, _AVL_DIFFERENCE };
+
+// one thread of a set operation; the node list never grows while threads run, so the nodes they free
+// are chained through left and handed back to the list once every thread is done
+struct _AVL_set_task_s {
+  AVLNodesTreePtr tree;
+  AVLNodesTreePtr keys; // tree holding the nodes of the second operand
+  enum _AVL_set_operation_e operation;
+  AVLNodeIndex first;
+  AVLNodeIndex second;
+  int depth;
+  AVLNodeIndex result;
+  AVLNodeIndex released;
+  AVLNodeIndex released_tail;
+};
+
+static void _AVL_defer_release(struct _AVL_set_task_s *task, const AVLNodeIndex node) {
+  task->tree->node_list.list[node].left = task->released;
+  task->released = node;
+  if (FASTER_AVL_NODE_INVALID(task->released_tail)) {
+    task->released_tail = node;
+  }
+}
+
+static void _AVL_defer_release_subtree(struct _AVL_set_task_s *task, const AVLNodeIndex node) {
+  if (FASTER_AVL_NODE_INVALID(node)) {
+    return;
+  }
+  AVLNodePtr node_ptr = task->tree->node_list.list + node;
+  _AVL_defer_release_subtree(task, node_ptr->left);
+  _AVL_defer_release_subtree(task, node_ptr->right);
+  _AVL_defer_release(task, node);
+}
+
+static int _AVL_set_thread(void *arg);
+
+// split first by the key at the root of second, recurse on both sides and join the halves back
+static AVLNodeIndex _AVL_set_op(struct _AVL_set_task_s *task, const AVLNodeIndex first, const AVLNodeIndex second,
+                                const int depth) {
+  AVLNodesTreePtr tree = task->tree;
+  if (FASTER_AVL_NODE_INVALID(second)) {
+    if (task->operation == _AVL_INTERSECTION) {
+      _AVL_defer_release_subtree(task, first);
+      return FASTER_AVL_NODE_INDEX_INVALID;
+    }
+    return first;
+  }
+  if (FASTER_AVL_NODE_INVALID(first)) {
+    return (task->operation == _AVL_UNION) ? second : FASTER_AVL_NODE_INDEX_INVALID;
+  }
+  AVLNodePtr second_ptr = task->keys->node_list.list + second;
+  AVLNodeIndex second_left = second_ptr->left;
+  AVLNodeIndex second_right = second_ptr->right;
+  AVLNodeIndex left, right;
+  // splitting only relinks nodes, the key of second stays in place for the whole descent
+  struct _AVL_probe_s probe = {.key = &second_ptr->key, .prefix = second_ptr->key_prefix};
+  AVLNodeIndex found = _AVL_split(tree, first, &probe, &left, &right);
+  // a union keeps the node of second, so the value of other wins
+  if (FASTER_AVL_NODE_VALID(found) && task->operation != _AVL_INTERSECTION) {
+    _AVL_defer_release(task, found);
+  }
+
+  if (depth < FASTER_AVL_PARALLEL_DEPTH && height(task->keys, second) >= FASTER_AVL_PARALLEL_MIN_HEIGHT) {
+    // both halves touch disjoint nodes, the left one goes to a new thread
+    struct _AVL_set_task_s fork = {.tree = tree,
+                                   .keys = task->keys,
+                                   .operation = task->operation,
+                                   .first = left,
+                                   .second = second_left,
+                                   .depth = depth + 1,
+                                   .released = FASTER_AVL_NODE_INDEX_INVALID,
+                                   .released_tail = FASTER_AVL_NODE_INDEX_INVALID};
+    thrd_t thread;
+    bool forked = thrd_create(&thread, _AVL_set_thread, &fork) == thrd_success;
+    if (!forked) {
+      _AVL_set_thread(&fork);
+    }
+    right = _AVL_set_op(task, right, second_right, depth + 1);
+    if (forked) {
+      thrd_join(thread, NULL);
+    }
+    left = fork.result;
+    if (FASTER_AVL_NODE_VALID(fork.released)) {
+      tree->node_list.list[fork.released_tail].left = task->released;
+      task->released = fork.released;
+      if (FASTER_AVL_NODE_INVALID(task->released_tail)) {
+        task->released_tail = fork.released_tail;
+      }
+    }
+  } else {
+    left = _AVL_set_op(task, left, second_left, depth + 1);
+    right = _AVL_set_op(task, right, second_right, depth + 1);
+  }
+
+  switch (task->operation) {
+  case _AVL_UNION:
+    return AVL_join(tree, left, second, right);
+  case _AVL_INTERSECTION:
+    return FASTER_AVL_NODE_VALID(found) ? AVL_join(tree, left, found, right) : AVL_join2(tree, left, right);
+  default:
+    return AVL_join2(tree, left, right);
+  }
+}
+
+static int _AVL_set_thread(void *arg) {
+  struct _AVL_set_task_s *task = (struct _AVL_set_task_s *)arg;
+  task->result = _AVL_set_op(task, task->first, task->second, task->depth);
+  return 0;
+}
+
+static void _AVL_set_run(AVLNodesTreePtr tree, AVLNodesTreePtr keys, const enum _AVL_set_operation_e operation,
+                         const AVLNodeIndex second) {
+  struct _AVL_set_task_s task = {.tree = tree,
+                                 .keys = keys,
+                                 .operation = operation,
+                                 .released = FASTER_AVL_NODE_INDEX_INVALID,
+                                 .released_tail = FASTER_AVL_NODE_INDEX_INVALID};
+  if (tree == keys && operation == _AVL_DIFFERENCE) {
+    _AVL_defer_release_subtree(&task, tree->root_node);
+    tree->root_node = FASTER_AVL_NODE_INDEX_INVALID;
+  } else if (tree != keys || operation == _AVL_UNION) {
+    tree->root_node = _AVL_set_op(&task, tree->root_node, second, 0);
+  }
+  AVLNodeIndex node = task.released;
+  while (FASTER_AVL_NODE_VALID(node)) {
+    AVLNodeIndex next = tree->node_list.list[node].left;
+    AVLNode_t_arr_release(&tree->node_list, node);
+    node = next;
+  }
+}
+
+static void _AVL_release_subtree(const AVLNodesTreePtr tree, const AVLNodeIndex node) {
+  if (FASTER_AVL_NODE_INVALID(node)) {
+    return;
+  }
+  _AVL_release_subtree(tree, tree->node_list.list[node].left);
+  _AVL_release_subtree(tree, tree->node_list.list[node].right);
+  AVLNode_t_arr_release(&tree->node_list, node);
+}
+
+// copy the subtree of other into the node list of tree, shape included
+static AVLNodeIndex _AVL_copy_subtree(const AVLNodesTreePtr tree, const AVLNodesTreePtr other, const AVLNodeIndex node) {
+  if (FASTER_AVL_NODE_INVALID(node)) {
+    return FASTER_AVL_NODE_INDEX_INVALID;
+  }
+  AVLNodePtr other_ptr = other->node_list.list + node;
+  AVLNodeIndex left = _AVL_copy_subtree(tree, other, other_ptr->left);
+  if (FASTER_AVL_NODE_VALID(other_ptr->left) && FASTER_AVL_NODE_INVALID(left)) {
+    return FASTER_AVL_NODE_INDEX_INVALID;
+  }
+  AVLNodeIndex right = _AVL_copy_subtree(tree, other, other_ptr->right);
+  AVLNodeIndex copy = FASTER_AVL_NODE_INDEX_INVALID;
+  if (FASTER_AVL_NODE_VALID(right) || FASTER_AVL_NODE_INVALID(other_ptr->right)) {
+    copy = AVLNode_t_arr_get_next(&tree->node_list);
+  }
+  if (FASTER_AVL_NODE_INVALID(copy)) {
+    _AVL_release_subtree(tree, left);
+    _AVL_release_subtree(tree, right);
+    return FASTER_AVL_NODE_INDEX_INVALID;
+  }
+  AVLNodePtr copy_ptr = tree->node_list.list + copy;
+  memcpy(copy_ptr, other_ptr, sizeof(AVLNode_t));
+  copy_ptr->left = left;
+  copy_ptr->right = right;
+  return copy;
+}
+
+// keys of either tree, other's value wins on common keys; returns false when memory runs out, the tree is unchanged then
+bool AVL_union(AVLNodesTreePtr tree, const AVLNodesTreePtr other) {
+  if (tree == other || FASTER_AVL_NODE_INVALID(other->root_node)) {
+    return true;
+  }
+  // the nodes of other are copied up front, the set operation itself never allocates
+  AVLNodeIndex copy = _AVL_copy_subtree(tree, other, other->root_node);
+  if (FASTER_AVL_NODE_INVALID(copy)) {
+    return false;
+  }
+  _AVL_set_run(tree, tree, _AVL_UNION, copy);
+  return true;
+}
+
+// keys present in both trees, with the values of tree
+void AVL_intersection(AVLNodesTreePtr tree, const AVLNodesTreePtr other) {
+  _AVL_set_run(tree, other, _AVL_INTERSECTION, other->root_node);
+}
+
+// keys of tree that other does not hold
+void AVL_difference(AVLNodesTreePtr tree, const AVLNodesTreePtr other) {
+  _AVL_set_run(tree, other, _AVL_DIFFERENCE, other->root_node);
+}
+
+#if FASTER_AVL_ORDER_STATISTICS
+// node holding the key of the given rank, FASTER_AVL_NODE_INDEX_INVALID past the last key
+AVLNodeIndex AVL_select(const AVLNodesTreePtr tree, faster_indexing_t rank) {
+  AVLNodeIndex node = tree->root_node;
+  while (FASTER_AVL_NODE_VALID(node)) {
+    AVLNodePtr node_ptr = tree->node_list.list + node;
+    faster_indexing_t left_size = size(tree, node_ptr->left);
+    if (rank == left_size)
+      return node;
+    if (rank < left_size) {
+      node = node_ptr->left;
+    } else {
+      rank -= left_size + 1;
+      node = node_ptr->right;
+    }
+  }
+  return FASTER_AVL_NODE_INDEX_INVALID;
+}
+
+// number of keys below the given one
+faster_indexing_t AVL_rank(const AVLNodesTreePtr tree, const faster_str_ptr_t key) {
+  struct _AVL_probe_s probe;
+  if (!_AVL_probe_init(&probe, key)) {
+    return size(tree, tree->root_node);
+  }
+  faster_indexing_t rank = 0;
+  AVLNodeIndex node = tree->root_node;
+  while (FASTER_AVL_NODE_VALID(node)) {
+    AVLNodePtr node_ptr = tree->node_list.list + node;
+    int cmp = _AVL_probe_cmp(&probe, node_ptr);
+    if (cmp > 0)
+      rank += size(tree, node_ptr->left) + 1;
+    if (cmp == 0)
+      return rank + size(tree, node_ptr->left);
+    node = node_ptr->child[cmp > 0];
+  }
+  return rank;
+}
+
+// number of keys in [from, to), NULL leaves that side open
+faster_indexing_t AVL_count_range(const AVLNodesTreePtr tree, const faster_str_ptr_t from, const faster_str_ptr_t to) {
+  faster_indexing_t upper = (to != NULL) ? AVL_rank(tree, to) : size(tree, tree->root_node);
+  faster_indexing_t lower = (from != NULL) ? AVL_rank(tree, from) : 0;
+  return (upper > lower) ? upper - lower : 0;
+}
+#endif
@@ -0,0 +1,425 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "aster/faster_bpt.h"
+#include "aster/faster_prim.h"
+
+// Utility functions
+static inline BPTNodePtr node_at(const BPTreePtr tree, const BPTNodeIndex node) { return tree->node_list.list + node; }
+
+static inline void set_key(const BPTNodePtr node_ptr, const faster_indexing_t pos, const faster_str_t *key,
+                           const faster_str_prefix_t prefix) {
+  memcpy((void *)&node_ptr->keys[pos], key, sizeof(faster_str_t));
+  node_ptr->prefixes[pos] = prefix;
+}
+
+// move keys (and prefixes) [from, count) of a node by delta positions
+static inline void shift_keys(const BPTNodePtr node_ptr, const faster_indexing_t from, const int delta) {
+  size_t moved = node_ptr->count - from;
+  memmove((void *)&node_ptr->keys[(int)from + delta], &node_ptr->keys[from], moved * sizeof(faster_str_t));
+  memmove(&node_ptr->prefixes[(int)from + delta], &node_ptr->prefixes[from], moved * sizeof(faster_str_prefix_t));
+}
+
+// position of the first key not less than the searched one, found reports an exact match
+static inline faster_indexing_t lower_bound(const BPTNodePtr node_ptr, const faster_str_ptr_t key, const faster_str_prefix_t prefix,
+                                            bool *found) {
+  faster_indexing_t low = 0;
+  faster_indexing_t high = node_ptr->count;
+  while (low < high) {
+    faster_indexing_t mid = (low + high) / 2;
+    int cmp = faster_str_cmp_prefixed(&node_ptr->keys[mid], node_ptr->prefixes[mid], key, prefix);
+    if (cmp == 0) {
+      *found = true;
+      return mid;
+    }
+    if (cmp < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  *found = false;
+  return low;
+}
+
+// Create a new, empty node
+static BPTNodeIndex createNode(const BPTreePtr tree, const bool is_leaf) {
+  BPTNodeIndex node = BPTNode_t_arr_get_next(&tree->node_list);
+  if (FASTER_BPT_NODE_INVALID(node)) {
+    return FASTER_BPT_NODE_INDEX_INVALID;
+  }
+  BPTNodePtr node_ptr = node_at(tree, node);
+  node_ptr->count = 0;
+  node_ptr->is_leaf = is_leaf;
+  node_ptr->prev = FASTER_BPT_NODE_INDEX_INVALID;
+  node_ptr->next = FASTER_BPT_NODE_INDEX_INVALID;
+  return node;
+}
+
+// leftmost leaf and first slot not less than key (key == NULL seeks the first key)
+static void seek_leaf(const BPTreePtr tree, const faster_str_ptr_t key, faster_bpt_tree_iterator_helper_t *it) {
+  BPTNodeIndex node = tree->root_node;
+  faster_indexing_t slot = 0;
+  if (FASTER_BPT_NODE_VALID(node)) {
+    faster_str_prefix_t prefix = key ? faster_str_prefix(key) : 0;
+    for (;;) {
+      BPTNodePtr node_ptr = node_at(tree, node);
+      bool found = false;
+      slot = key ? lower_bound(node_ptr, key, prefix, &found) : 0;
+      if (node_ptr->is_leaf)
+        break;
+      node = node_ptr->children[found ? slot + 1 : slot];
+    }
+  }
+  it->leaf = node;
+  it->slot = slot;
+  it->initialized = 1;
+}
+
+// Iterator for B+ tree, follows the leaf links
+bool BPT_iterator(BPTreePtr tree, faster_bpt_tree_iterator_helper_t *it, const faster_str_t **key, faster_value_ptr *value) {
+  if (!it->initialized) {
+    seek_leaf(tree, NULL, it);
+  }
+  while (FASTER_BPT_NODE_VALID(it->leaf)) {
+    BPTNodePtr leaf_ptr = node_at(tree, it->leaf);
+    if (it->slot < leaf_ptr->count) {
+      if (key)
+        *key = &leaf_ptr->keys[it->slot];
+      if (value)
+        *value = leaf_ptr->values[it->slot];
+      it->slot++;
+      return true;
+    }
+    it->leaf = leaf_ptr->next;
+    it->slot = 0;
+  }
+  return false;
+}
+
+// position the iterator at the first key not less than the given one
+void BPT_seek(BPTreePtr tree, const faster_str_ptr_t key, faster_bpt_tree_iterator_helper_t *it) { seek_leaf(tree, key, it); }
+
+faster_value_ptr BPT_get(const BPTreePtr tree, const faster_str_ptr_t key) {
+  BPTNodeIndex node = tree->root_node;
+  if (FASTER_BPT_NODE_INVALID(node))
+    return NULL;
+  faster_str_prefix_t prefix = faster_str_prefix(key);
+  for (;;) {
+    BPTNodePtr node_ptr = node_at(tree, node);
+    bool found;
+    faster_indexing_t slot = lower_bound(node_ptr, key, prefix, &found);
+    if (node_ptr->is_leaf)
+      return found ? node_ptr->values[slot] : NULL;
+    node = node_ptr->children[found ? slot + 1 : slot];
+  }
+}
+
+// Insert a key into the B+ tree, or update its value if present
+bool BPT_insert_or_update(BPTreePtr tree, const faster_str_ptr_t key, const faster_value_ptr value) {
+  faster_str_prefix_t prefix = faster_str_prefix(key);
+  if (FASTER_BPT_NODE_INVALID(tree->root_node)) {
+    BPTNodeIndex root = createNode(tree, true);
+    if (FASTER_BPT_NODE_INVALID(root))
+      return false;
+    BPTNodePtr root_ptr = node_at(tree, root);
+    set_key(root_ptr, 0, key, prefix);
+    root_ptr->values[0] = value;
+    root_ptr->count = 1;
+    tree->root_node = root;
+    tree->elements++;
+    return true;
+  }
+
+  BPTNodeIndex path[FASTER_BPT_MAX_HEIGHT];
+  faster_indexing_t pos[FASTER_BPT_MAX_HEIGHT];
+  int depth = 0;
+  BPTNodeIndex node = tree->root_node;
+  bool found;
+  faster_indexing_t slot;
+  for (;;) {
+    BPTNodePtr node_ptr = node_at(tree, node);
+    slot = lower_bound(node_ptr, key, prefix, &found);
+    if (node_ptr->is_leaf)
+      break;
+    assert(depth < FASTER_BPT_MAX_HEIGHT);
+    path[depth] = node;
+    pos[depth++] = found ? slot + 1 : slot;
+    node = node_ptr->children[found ? slot + 1 : slot];
+  }
+  if (found) {
+    // Update value if key exists
+    node_at(tree, node)->values[slot] = value;
+    return false;
+  }
+
+  BPTNodePtr leaf_ptr = node_at(tree, node);
+  if (leaf_ptr->count < FASTER_BPT_ORDER) {
+    shift_keys(leaf_ptr, slot, 1);
+    memmove(&leaf_ptr->values[slot + 1], &leaf_ptr->values[slot], (leaf_ptr->count - slot) * sizeof(faster_value_ptr));
+    set_key(leaf_ptr, slot, key, prefix);
+    leaf_ptr->values[slot] = value;
+    leaf_ptr->count++;
+    tree->elements++;
+    return true;
+  }
+
+  // full leaf: the split runs up through every full ancestor and may add a root. All the nodes it needs are
+  // taken before anything changes, so a failed allocation leaves the tree as it was
+  BPTNodeIndex reserved[FASTER_BPT_MAX_HEIGHT + 2];
+  int needed = 1, taken = 0;
+  int full = depth;
+  while (full > 0 && node_at(tree, path[full - 1])->count == FASTER_BPT_ORDER) {
+    full--;
+    needed++;
+  }
+  if (full == 0)
+    needed++;
+  for (; taken < needed; taken++) {
+    reserved[taken] = createNode(tree, taken == 0);
+    if (FASTER_BPT_NODE_INVALID(reserved[taken])) {
+      while (taken > 0)
+        BPTNode_t_arr_release(&tree->node_list, reserved[--taken]);
+      return false;
+    }
+  }
+  int next_reserved = 0;
+
+  BPTNodeIndex right = reserved[next_reserved++];
+  leaf_ptr = node_at(tree, node); // allocation could move the nodes
+  BPTNodePtr right_ptr = node_at(tree, right);
+  right_ptr->count = FASTER_BPT_ORDER - FASTER_BPT_MIN_KEYS;
+  memcpy((void *)right_ptr->keys, &leaf_ptr->keys[FASTER_BPT_MIN_KEYS], right_ptr->count * sizeof(faster_str_t));
+  memcpy(right_ptr->prefixes, &leaf_ptr->prefixes[FASTER_BPT_MIN_KEYS], right_ptr->count * sizeof(faster_str_prefix_t));
+  memcpy(right_ptr->values, &leaf_ptr->values[FASTER_BPT_MIN_KEYS], right_ptr->count * sizeof(faster_value_ptr));
+  leaf_ptr->count = FASTER_BPT_MIN_KEYS;
+  right_ptr->next = leaf_ptr->next;
+  right_ptr->prev = node;
+  if (FASTER_BPT_NODE_VALID(leaf_ptr->next))
+    node_at(tree, leaf_ptr->next)->prev = right;
+  leaf_ptr->next = right;
+
+  BPTNodePtr target_ptr = (slot <= FASTER_BPT_MIN_KEYS) ? leaf_ptr : right_ptr;
+  faster_indexing_t target_slot = (slot <= FASTER_BPT_MIN_KEYS) ? slot : slot - FASTER_BPT_MIN_KEYS;
+  shift_keys(target_ptr, target_slot, 1);
+  memmove(&target_ptr->values[target_slot + 1], &target_ptr->values[target_slot],
+          (target_ptr->count - target_slot) * sizeof(faster_value_ptr));
+  set_key(target_ptr, target_slot, key, prefix);
+  target_ptr->values[target_slot] = value;
+  target_ptr->count++;
+  tree->elements++;
+
+  // separator going up is the smallest key of the new right node
+  faster_str_t carry_key;
+  memcpy((void *)&carry_key, &right_ptr->keys[0], sizeof(faster_str_t));
+  faster_str_prefix_t carry_prefix = right_ptr->prefixes[0];
+  BPTNodeIndex carry_child = right;
+
+  while (depth > 0) {
+    BPTNodeIndex parent = path[--depth];
+    faster_indexing_t at = pos[depth];
+    BPTNodePtr parent_ptr = node_at(tree, parent);
+    if (parent_ptr->count < FASTER_BPT_ORDER) {
+      shift_keys(parent_ptr, at, 1);
+      memmove(&parent_ptr->children[at + 2], &parent_ptr->children[at + 1], (parent_ptr->count - at) * sizeof(BPTNodeIndex));
+      set_key(parent_ptr, at, &carry_key, carry_prefix);
+      parent_ptr->children[at + 1] = carry_child;
+      parent_ptr->count++;
+      return true;
+    }
+
+    // full internal node, split around the middle key which moves one level up
+    BPTNodeIndex sibling = reserved[next_reserved++];
+    BPTNodePtr sibling_ptr = node_at(tree, sibling);
+    faster_str_t keys[FASTER_BPT_ORDER + 1];
+    faster_str_prefix_t prefixes[FASTER_BPT_ORDER + 1];
+    BPTNodeIndex children[FASTER_BPT_ORDER + 2];
+    memcpy((void *)keys, parent_ptr->keys, at * sizeof(faster_str_t));
+    memcpy((void *)&keys[at + 1], &parent_ptr->keys[at], (FASTER_BPT_ORDER - at) * sizeof(faster_str_t));
+    memcpy((void *)&keys[at], &carry_key, sizeof(faster_str_t));
+    memcpy(prefixes, parent_ptr->prefixes, at * sizeof(faster_str_prefix_t));
+    memcpy(&prefixes[at + 1], &parent_ptr->prefixes[at], (FASTER_BPT_ORDER - at) * sizeof(faster_str_prefix_t));
+    prefixes[at] = carry_prefix;
+    memcpy(children, parent_ptr->children, (at + 1) * sizeof(BPTNodeIndex));
+    memcpy(&children[at + 2], &parent_ptr->children[at + 1], (FASTER_BPT_ORDER - at) * sizeof(BPTNodeIndex));
+    children[at + 1] = carry_child;
+
+    parent_ptr->count = FASTER_BPT_MIN_KEYS;
+    memcpy((void *)parent_ptr->keys, keys, FASTER_BPT_MIN_KEYS * sizeof(faster_str_t));
+    memcpy(parent_ptr->prefixes, prefixes, FASTER_BPT_MIN_KEYS * sizeof(faster_str_prefix_t));
+    memcpy(parent_ptr->children, children, (FASTER_BPT_MIN_KEYS + 1) * sizeof(BPTNodeIndex));
+    sibling_ptr->count = FASTER_BPT_ORDER - FASTER_BPT_MIN_KEYS;
+    memcpy((void *)sibling_ptr->keys, &keys[FASTER_BPT_MIN_KEYS + 1], sibling_ptr->count * sizeof(faster_str_t));
+    memcpy(sibling_ptr->prefixes, &prefixes[FASTER_BPT_MIN_KEYS + 1], sibling_ptr->count * sizeof(faster_str_prefix_t));
+    memcpy(sibling_ptr->children, &children[FASTER_BPT_MIN_KEYS + 1], (sibling_ptr->count + 1) * sizeof(BPTNodeIndex));
+
+    memcpy((void *)&carry_key, &keys[FASTER_BPT_MIN_KEYS], sizeof(faster_str_t));
+    carry_prefix = prefixes[FASTER_BPT_MIN_KEYS];
+    carry_child = sibling;
+  }
+
+  // root was split, grow the tree by one level
+  BPTNodeIndex root = reserved[next_reserved++];
+  BPTNodePtr root_ptr = node_at(tree, root);
+  set_key(root_ptr, 0, &carry_key, carry_prefix);
+  root_ptr->children[0] = tree->root_node;
+  root_ptr->children[1] = carry_child;
+  root_ptr->count = 1;
+  tree->root_node = root;
+  return true;
+}
+
+// drop key (at) and child (at + 1) from an internal node
+static inline void remove_separator(const BPTNodePtr node_ptr, const faster_indexing_t at) {
+  shift_keys(node_ptr, at + 1, -1);
+  memmove(&node_ptr->children[at + 1], &node_ptr->children[at + 2], (node_ptr->count - at - 1) * sizeof(BPTNodeIndex));
+  node_ptr->count--;
+}
+
+// move one entry from a richer sibling into an underflowing node, at is the separator between them
+static void borrow(const BPTreePtr tree, const BPTNodePtr parent_ptr, const faster_indexing_t at, const BPTNodePtr left_ptr,
+                   const BPTNodePtr right_ptr, const bool from_right) {
+  if (left_ptr->is_leaf) {
+    if (from_right) {
+      set_key(left_ptr, left_ptr->count, &right_ptr->keys[0], right_ptr->prefixes[0]);
+      left_ptr->values[left_ptr->count++] = right_ptr->values[0];
+      shift_keys(right_ptr, 1, -1);
+      memmove(right_ptr->values, &right_ptr->values[1], (right_ptr->count - 1) * sizeof(faster_value_ptr));
+      right_ptr->count--;
+    } else {
+      shift_keys(right_ptr, 0, 1);
+      memmove(&right_ptr->values[1], right_ptr->values, right_ptr->count * sizeof(faster_value_ptr));
+      left_ptr->count--;
+      set_key(right_ptr, 0, &left_ptr->keys[left_ptr->count], left_ptr->prefixes[left_ptr->count]);
+      right_ptr->values[0] = left_ptr->values[left_ptr->count];
+      right_ptr->count++;
+    }
+    set_key(parent_ptr, at, &right_ptr->keys[0], right_ptr->prefixes[0]);
+    return;
+  }
+  // internal nodes rotate through the parent separator
+  if (from_right) {
+    set_key(left_ptr, left_ptr->count, &parent_ptr->keys[at], parent_ptr->prefixes[at]);
+    left_ptr->children[++left_ptr->count] = right_ptr->children[0];
+    set_key(parent_ptr, at, &right_ptr->keys[0], right_ptr->prefixes[0]);
+    shift_keys(right_ptr, 1, -1);
+    memmove(right_ptr->children, &right_ptr->children[1], right_ptr->count * sizeof(BPTNodeIndex));
+    right_ptr->count--;
+  } else {
+    shift_keys(right_ptr, 0, 1);
+    memmove(&right_ptr->children[1], right_ptr->children, (right_ptr->count + 1) * sizeof(BPTNodeIndex));
+    set_key(right_ptr, 0, &parent_ptr->keys[at], parent_ptr->prefixes[at]);
+    right_ptr->children[0] = left_ptr->children[left_ptr->count];
+    right_ptr->count++;
+    left_ptr->count--;
+    set_key(parent_ptr, at, &left_ptr->keys[left_ptr->count], left_ptr->prefixes[left_ptr->count]);
+  }
+  (void)tree;
+}
+
+// append the right node to the left one, at is the separator between them
+static void merge(const BPTreePtr tree, const BPTNodePtr parent_ptr, const faster_indexing_t at, const BPTNodeIndex left,
+                  const BPTNodeIndex right) {
+  BPTNodePtr left_ptr = node_at(tree, left);
+  BPTNodePtr right_ptr = node_at(tree, right);
+  if (left_ptr->is_leaf) {
+    memcpy((void *)&left_ptr->keys[left_ptr->count], right_ptr->keys, right_ptr->count * sizeof(faster_str_t));
+    memcpy(&left_ptr->prefixes[left_ptr->count], right_ptr->prefixes, right_ptr->count * sizeof(faster_str_prefix_t));
+    memcpy(&left_ptr->values[left_ptr->count], right_ptr->values, right_ptr->count * sizeof(faster_value_ptr));
+    left_ptr->count += right_ptr->count;
+    left_ptr->next = right_ptr->next;
+    if (FASTER_BPT_NODE_VALID(right_ptr->next))
+      node_at(tree, right_ptr->next)->prev = left;
+  } else {
+    set_key(left_ptr, left_ptr->count++, &parent_ptr->keys[at], parent_ptr->prefixes[at]);
+    memcpy((void *)&left_ptr->keys[left_ptr->count], right_ptr->keys, right_ptr->count * sizeof(faster_str_t));
+    memcpy(&left_ptr->prefixes[left_ptr->count], right_ptr->prefixes, right_ptr->count * sizeof(faster_str_prefix_t));
+    memcpy(&left_ptr->children[left_ptr->count], right_ptr->children, (right_ptr->count + 1) * sizeof(BPTNodeIndex));
+    left_ptr->count += right_ptr->count;
+  }
+  remove_separator(parent_ptr, at);
+  BPTNode_t_arr_release(&tree->node_list, right);
+}
+
+// Remove a key from the B+ tree
+// separators always equal the smallest key of their right subtree, so they never outlive the keys
+bool BPT_remove(BPTreePtr tree, const faster_str_ptr_t key) {
+  if (FASTER_BPT_NODE_INVALID(tree->root_node))
+    return false;
+  faster_str_prefix_t prefix = faster_str_prefix(key);
+  BPTNodeIndex path[FASTER_BPT_MAX_HEIGHT];
+  faster_indexing_t pos[FASTER_BPT_MAX_HEIGHT];
+  int depth = 0;
+  BPTNodeIndex separator_node = FASTER_BPT_NODE_INDEX_INVALID;
+  faster_indexing_t separator_slot = 0;
+  BPTNodeIndex node = tree->root_node;
+  bool found;
+  faster_indexing_t slot;
+  for (;;) {
+    BPTNodePtr node_ptr = node_at(tree, node);
+    slot = lower_bound(node_ptr, key, prefix, &found);
+    if (node_ptr->is_leaf)
+      break;
+    if (found) {
+      separator_node = node;
+      separator_slot = slot;
+    }
+    assert(depth < FASTER_BPT_MAX_HEIGHT);
+    path[depth] = node;
+    pos[depth++] = found ? slot + 1 : slot;
+    node = node_ptr->children[found ? slot + 1 : slot];
+  }
+  if (!found)
+    return false; // key not found
+
+  BPTNodePtr leaf_ptr = node_at(tree, node);
+  shift_keys(leaf_ptr, slot + 1, -1);
+  memmove(&leaf_ptr->values[slot], &leaf_ptr->values[slot + 1], (leaf_ptr->count - slot - 1) * sizeof(faster_value_ptr));
+  leaf_ptr->count--;
+  tree->elements--;
+  if (FASTER_BPT_NODE_VALID(separator_node)) {
+    // the removed key was the smallest of its subtree, the leaf always keeps a successor here
+    set_key(node_at(tree, separator_node), separator_slot, &leaf_ptr->keys[0], leaf_ptr->prefixes[0]);
+  }
+
+  while (depth > 0 && node_at(tree, node)->count < FASTER_BPT_MIN_KEYS) {
+    BPTNodeIndex parent = path[--depth];
+    faster_indexing_t at = pos[depth];
+    BPTNodePtr parent_ptr = node_at(tree, parent);
+    BPTNodeIndex left = (at > 0) ? parent_ptr->children[at - 1] : FASTER_BPT_NODE_INDEX_INVALID;
+    BPTNodeIndex right = (at < parent_ptr->count) ? parent_ptr->children[at + 1] : FASTER_BPT_NODE_INDEX_INVALID;
+    if (FASTER_BPT_NODE_VALID(left) && node_at(tree, left)->count > FASTER_BPT_MIN_KEYS) {
+      borrow(tree, parent_ptr, at - 1, node_at(tree, left), node_at(tree, node), false);
+      break;
+    }
+    if (FASTER_BPT_NODE_VALID(right) && node_at(tree, right)->count > FASTER_BPT_MIN_KEYS) {
+      borrow(tree, parent_ptr, at, node_at(tree, node), node_at(tree, right), true);
+      break;
+    }
+    if (FASTER_BPT_NODE_VALID(left)) {
+      merge(tree, parent_ptr, at - 1, left, node);
+    } else {
+      merge(tree, parent_ptr, at, node, right);
+    }
+    node = parent;
+  }
+
+  BPTNodePtr root_ptr = node_at(tree, tree->root_node);
+  if (root_ptr->count == 0) {
+    // shrink the tree by one level, or drop the last empty leaf
+    BPTNodeIndex old_root = tree->root_node;
+    tree->root_node = root_ptr->is_leaf ? FASTER_BPT_NODE_INDEX_INVALID : root_ptr->children[0];
+    BPTNode_t_arr_release(&tree->node_list, old_root);
+  }
+  return true; // key removed
+}
+
+void BPT_reset_and_free(const BPTreePtr tree) {
+  tree->node_list.list_header.array_capacity = 0;
+  tree->node_list.list_header.array_internal = 0;
+  tree->node_list.list_header.next_free_index = FASTER_ARRAY_COUNT_INVALID;
+  tree->root_node = FASTER_BPT_NODE_INDEX_INVALID;
+  tree->elements = 0;
+  free(tree->node_list.list);
+  tree->node_list.list = NULL;
+}
@@ -63,7 +63,7 @@ void _arr_reset_and_free(_faster_default_array_ptr_t v, faster_indexing_t initia
   v->list_header = tmp;
 }
 
-faster_indexing_t _arr_count(_faster_default_array_ptr_t v) { return (v->list == NULL) ? 0 : v->list_header.array_internal; }
+faster_indexing_t _arr_count(const _faster_default_array_t *v) { return (v->list == NULL) ? 0 : v->list_header.array_internal; }
 
 faster_indexing_t _arr_get_next(_faster_default_array_ptr_t v, size_t element_size) {
   if (v->list_header.next_free_index == FASTER_ARRAY_COUNT_INVALID) {
@@ -102,4 +102,22 @@ void _arr_release(_faster_default_array_ptr_t v, const faster_indexing_t idx, si
   *(faster_indexing_t *)(FASTER_INCEMENT_POINTER_BY_SIZED_ELEMENT(v->list, idx, element_size)) = v->list_header.next_free_index;
   v->list_header.next_free_index = idx;
   v->list_header.array_internal--;
-}
\ No newline at end of file
+}
+bool _arr_fill(_faster_default_array_ptr_t v, const faster_indexing_t count, size_t element_size) {
+  size_t new_size = faster_get_optimal_block_size(element_size, count);
+  void *tmp = (void *)FASTER_REALLOCATOR(v->list, new_size, NULL);
+  if (tmp == NULL) {
+    return false;
+  }
+  faster_indexing_t new_capacity = _assume_within_range(new_size / element_size);
+  // whatever the block size leaves after count becomes the free list
+  for (faster_indexing_t i = count; i < new_capacity; i++) {
+    *(faster_indexing_t *)(FASTER_INCEMENT_POINTER_BY_SIZED_ELEMENT(tmp, i, element_size)) =
+        (i + 1 < new_capacity) ? i + 1 : FASTER_ARRAY_COUNT_INVALID;
+  }
+  v->list_header.next_free_index = (new_capacity > count) ? count : FASTER_ARRAY_COUNT_INVALID;
+  v->list_header.array_capacity = new_capacity;
+  v->list_header.array_internal = count;
+  v->list = (faster_value_ptr)tmp;
+  return true;
+}
@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "aster/faster_frozen.h"
+#include "aster/faster_prim.h"
+
+// walks the slots of an Eytzinger array in key order, an in-order walk of the implicit tree
+struct _frozen_walk_s {
+  size_t stack[FASTER_AVL_MAX_HEIGHT];
+  int top;
+  size_t current;
+  size_t count;
+};
+
+// next slot in key order, 0 once every slot has been visited
+static size_t _frozen_walk_next(struct _frozen_walk_s *walk) {
+  while (walk->current <= walk->count) {
+    walk->stack[++walk->top] = walk->current;
+    walk->current = 2 * walk->current;
+  }
+  if (walk->top < 0) {
+    return 0;
+  }
+  size_t slot = walk->stack[walk->top--];
+  walk->current = 2 * slot + 1;
+  return slot;
+}
+
+faster_error_code_t AVL_freeze(const AVLNodesTreePtr tree, faster_frozen_ptr_t frozen) {
+  faster_indexing_t count = AVLNode_t_arr_count(&tree->node_list);
+  size_t entries_size = ((size_t)count + 1) * sizeof(struct faster_frozen_entry_s);
+  entries_size = (entries_size + FASTER_FROZEN_ALIGNMENT - 1) / FASTER_FROZEN_ALIGNMENT * FASTER_FROZEN_ALIGNMENT;
+  frozen->count = count;
+  frozen->entries = aligned_alloc(FASTER_FROZEN_ALIGNMENT, entries_size);
+  frozen->keys = malloc(((size_t)count + 1) * sizeof(const fchar_t *));
+  frozen->values = malloc(((size_t)count + 1) * sizeof(faster_value_ptr));
+  if (frozen->entries == NULL || frozen->keys == NULL || frozen->values == NULL) {
+    faster_frozen_free(frozen);
+    return FAST_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+
+  // the AVL walk hands out the keys in ascending order, the Eytzinger walk places them
+  faster_avl_tree_iterator_helper_t it = FASTER_AVL_TREE_EMPTY_ITERATOR;
+  struct _frozen_walk_s walk = {.top = -1, .current = 1, .count = count};
+  size_t slot;
+  while ((slot = _frozen_walk_next(&walk)) != 0) {
+    AVLNodePtr node_ptr = tree->node_list.list + AVL_iterator(tree, &it);
+    faster_str_t node_key = AVL_node_key(node_ptr);
+    frozen->entries[slot].prefix = node_ptr->key_prefix;
+    frozen->entries[slot].length = node_key.str_len;
+    frozen->keys[slot] = node_key.str_ptr;
+    frozen->values[slot] = node_ptr->value;
+  }
+  return FAST_ERROR_NONE;
+}
+
+faster_error_code_t AVL_thaw(const faster_frozen_ptr_t frozen, AVLNodesTreePtr tree) {
+  faster_str_t *keys = malloc(((size_t)frozen->count + 1) * sizeof(faster_str_t));
+  faster_value_ptr *values = malloc(((size_t)frozen->count + 1) * sizeof(faster_value_ptr));
+  faster_error_code_t result = FAST_ERROR_MEMORY_ALLOCATION_FAILED;
+  if (keys != NULL && values != NULL) {
+    struct _frozen_walk_s walk = {.top = -1, .current = 1, .count = frozen->count};
+    size_t next = 0;
+    size_t slot;
+    while ((slot = _frozen_walk_next(&walk)) != 0) {
+      faster_str_t key = {frozen->keys[slot], frozen->entries[slot].length};
+      memcpy((void *)&keys[next], &key, sizeof(faster_str_t));
+      values[next++] = frozen->values[slot];
+    }
+    // the bulk load only fails allocating
+    if (AVL_bulk_load(tree, keys, values, frozen->count)) {
+      result = FAST_ERROR_NONE;
+    }
+  }
+  free(keys);
+  free(values);
+  return result;
+}
+
+// key units past the inline prefix
+static inline int _frozen_cmp_tail(const fchar_t *stored, const faster_str_ptr_t key) {
+  return faster_prim_compare(stored + FASTER_STR_PREFIX_UNITS, key->str_ptr + FASTER_STR_PREFIX_UNITS,
+                             key->str_len - FASTER_STR_PREFIX_UNITS);
+}
+
+// lower bound descent: every level moves to 2k or 2k + 1 on a computed flag, the key bytes are only
+// compared when length and prefix tie, and then only for keys longer than the prefix
+faster_value_ptr faster_frozen_get(const faster_frozen_ptr_t frozen, const faster_str_ptr_t key) {
+  const struct faster_frozen_entry_s *entries = frozen->entries;
+  const size_t count = frozen->count;
+  const faster_str_prefix_t key_prefix = faster_str_prefix(key);
+  const size_t length = key->str_len;
+  const bool long_key = length > FASTER_STR_PREFIX_UNITS;
+  size_t slot = 1;
+  while (slot <= count) {
+    __builtin_prefetch(entries + FASTER_FROZEN_PREFETCH_DISTANCE * slot);
+    const struct faster_frozen_entry_s *entry = entries + slot;
+    bool tie = (entry->length == length) & (entry->prefix == key_prefix);
+    bool less = (entry->length < length) | ((entry->length == length) & (entry->prefix < key_prefix));
+    if (__builtin_expect(tie & long_key, 0)) {
+      less = _frozen_cmp_tail(frozen->keys[slot], key) < 0;
+    }
+    slot = 2 * slot + less;
+  }
+  // drop the trailing right turns and the last left turn, which leaves the first slot not below key
+  slot >>= __builtin_ffsll((long long)~slot);
+  if (slot == 0 || entries[slot].length != length || entries[slot].prefix != key_prefix ||
+      (long_key && _frozen_cmp_tail(frozen->keys[slot], key) != 0)) {
+    return NULL;
+  }
+  return frozen->values[slot];
+}
+
+void faster_frozen_free(faster_frozen_ptr_t frozen) {
+  free(frozen->entries);
+  free((void *)frozen->keys);
+  free(frozen->values);
+  frozen->entries = NULL;
+  frozen->keys = NULL;
+  frozen->values = NULL;
+  frozen->count = 0;
+}
@@ -1,7 +1,13 @@
 #include "aster/faster_ht.h"
+#include "aster/faster_prim.h"
 #include <stddef.h>
 
-static inline bool _faster_ht_keys_equal(faster_ht_key_data_ptr_t key1, faster_ht_key_data_ptr_t key2) {
+#if FASTER_HT_SSTR_KEYS
+static inline bool _faster_ht_keys_equal(const faster_sstr_t *key1, const faster_sstr_t *key2) {
+  return faster_sstr_equal(key1, key2);
+}
+#else
+static inline bool _faster_ht_keys_equal(const faster_ht_key_data_t *key1, const faster_ht_key_data_t *key2) {
   if (key1->len != key2->len) {
     return false;
   }
@@ -10,250 +16,404 @@ static inline bool _faster_ht_keys_equal(faster_ht_key_data_ptr_t key1, faster_h
   }
   return memcmp(key1->ptr, key2->ptr, key1->len) == 0;
 }
+#endif
+
+// the searched key in the form the entries keep, converted once per operation
+static inline void _fht_probe_init(faster_ht_stored_key_t *probe, const faster_ht_key_data_t *key) {
+#if FASTER_HT_SSTR_KEYS
+  // key data lengths are faster_indexing_t bytes, always within what a reference keeps
+  faster_str_t units = {(const fchar_t *)key->ptr, key->len / sizeof(fchar_t)};
+  faster_sstr_init(probe, &units);
+#else
+  *probe = *key;
+#endif
+}
+
+#define FASTER_HT_INDEX_EMPTY ((faster_indexing_t)FASTER_ARRAY_INDEX_INVALID)
+#define FASTER_HT_INDEX_DELETED ((faster_indexing_t)(FASTER_ARRAY_INDEX_INVALID - 1))
+#define FASTER_HT_PERTURB_SHIFT 5
 
-faster_indexing_t _fht_create_list_element(faster_ht_ptr_t ht, faster_hash_value_t hv, faster_ht_key_data_ptr_t key,
-                                           faster_value_ptr value) {
-  faster_indexing_t new_item = faster_ht_entry_linked_t_arr_get_next(&ht->entries_linked);
-  if (new_item == FASTER_ARRAY_INDEX_INVALID) {
-    return FASTER_ARRAY_INDEX_INVALID;
+// index slots are stored in the narrowest width able to address all entries,
+// reserved values are mapped back to the 32-bit empty/deleted markers
+static inline faster_indexing_t _fht_index_get(const faster_ht_t *ht, const size_t slot) {
+  faster_indexing_t ix;
+  switch (ht->index_width) {
+  case 1:
+    ix = ((const uint8_t *)ht->index)[slot];
+    return (ix >= 0xFE) ? (ix | 0xFFFFFF00) : ix;
+  case 2:
+    ix = ((const uint16_t *)ht->index)[slot];
+    return (ix >= 0xFFFE) ? (ix | 0xFFFF0000) : ix;
+  default:
+    return ((const uint32_t *)ht->index)[slot];
   }
-  faster_ht_entry_linked_t *list_ref = ht->entries_linked.list + new_item;
-  list_ref->hash = hv;
-  list_ref->key = *key;
-  list_ref->value = value;
-  list_ref->next = FASTER_ARRAY_INDEX_INVALID;
-  return new_item;
-}
-
-static bool _faster_ht_resize_and_rehash(faster_ht_ptr_t ht, faster_indexing_t requested_capacity) {
-  faster_ht_entry_linked_t_arr_ptr_t linked_entries_table_ref = &ht->entries_linked;
-  faster_ht_entry_ptr_t new_entries = NULL;
-  size_t new_capacity = requested_capacity;
-  if (new_capacity < ht->requested_capacity) {
-    new_capacity = ht->requested_capacity;
+}
+
+static inline void _fht_index_set(const faster_ht_ptr_t ht, const size_t slot, const faster_indexing_t ix) {
+  switch (ht->index_width) {
+  case 1:
+    ((uint8_t *)ht->index)[slot] = (uint8_t)ix;
+    break;
+  case 2:
+    ((uint16_t *)ht->index)[slot] = (uint16_t)ix;
+    break;
+  default:
+    ((uint32_t *)ht->index)[slot] = (uint32_t)ix;
+    break;
   }
-  size_t new_size = faster_get_optimal_block_size(sizeof(faster_ht_entry_t), new_capacity);
-  new_entries = (faster_ht_entry_ptr_t)malloc(new_size);
-  if (new_entries == NULL) {
-    return false;
+}
+
+// the invalid hash marks removed entries, custom hash functions may still produce it
+static inline faster_hash_value_t _fht_valid_hash(const faster_hash_value_t hash) {
+  return (hash == FASTER_HASH_VALUE_INVALID) ? hash + 1 : hash;
+}
+
+// smallest power of two index able to hold the number of elements at 2/3 load
+static size_t _fht_capacity_for(const size_t elements) {
+  size_t capacity = FASTER_HT_INDEX_MIN_CAPACITY;
+  while ((capacity * 2) / 3 < elements) {
+    capacity <<= 1;
   }
-  new_capacity = new_size / sizeof(faster_ht_entry_t);
-  assert(FASTER_ARRAY_INDEX_INVALID == 0xffffffff);
-  memset(new_entries, 0xff, new_size);
-  // rehashing
-  for (size_t i = 0; i < ht->capacity; i++) {
-    if (ht->entries[i] != FASTER_ARRAY_INDEX_INVALID) {
-      faster_indexing_t list_index = ht->entries[i];
-      // for all elements in the list, place them in the new table
-      while (list_index != FASTER_ARRAY_INDEX_INVALID) {
-        // point old element data
-        faster_ht_entry_linked_t *hted = linked_entries_table_ref->list + list_index;
-        // emplace the new element in the new list
-        size_t new_index = hted->hash % new_capacity;
-        faster_indexing_t new_list_index = list_index;
-        list_index = hted->next;
-        hted->next = FASTER_ARRAY_INDEX_INVALID;
-        if (new_list_index == FASTER_ARRAY_INDEX_INVALID) {
-          free(new_entries);
-          return false;
-        }
-        if (new_entries[new_index] == FASTER_ARRAY_INDEX_INVALID) {
-          new_entries[new_index] = new_list_index;
-        } else {
-          // add to the list (at head)
-          faster_indexing_t list_head = new_entries[new_index];
-          new_entries[new_index] = new_list_index;
-          linked_entries_table_ref->list[new_list_index].next = list_head;
-        }
+  return capacity;
+}
+
+// locate the index slot holding the key, or FASTER_HT_INDEX_EMPTY if the key is absent,
+// free_slot (if requested) receives the first slot where the key could be inserted
+static size_t _fht_lookup(const faster_ht_t *ht, const faster_ht_stored_key_t *key, const faster_hash_value_t hash,
+                          faster_indexing_t *entry_index, size_t *free_slot) {
+  const size_t mask = (size_t)ht->capacity - 1;
+  size_t perturb = hash;
+  size_t slot = hash & mask;
+  size_t first_deleted = SIZE_MAX;
+  for (;;) {
+    faster_indexing_t ix = _fht_index_get(ht, slot);
+    if (ix == FASTER_HT_INDEX_EMPTY) {
+      if (free_slot) {
+        *free_slot = (first_deleted != SIZE_MAX) ? first_deleted : slot;
       }
+      *entry_index = FASTER_HT_INDEX_EMPTY;
+      return slot;
     }
+    if (ix == FASTER_HT_INDEX_DELETED) {
+      if (first_deleted == SIZE_MAX) {
+        first_deleted = slot;
+      }
+    } else if (ht->entries[ix].hash == hash && _faster_ht_keys_equal(&ht->entries[ix].key, key)) {
+      *entry_index = ix;
+      return slot;
+    }
+    perturb >>= FASTER_HT_PERTURB_SHIFT;
+    slot = (slot * 5 + perturb + 1) & mask;
   }
+}
+
+// dense entries of the table, kept inside the structure until the first migration
+static inline faster_ht_entry_ptr_t _fht_entries(const faster_ht_ptr_t ht) {
+  return (ht->capacity == 0) ? ht->inline_entries : ht->entries;
+}
+
+// linear scan of the inline entries, returns FASTER_HT_INDEX_EMPTY if the key is absent
+static inline faster_indexing_t _fht_inline_lookup(const faster_ht_t *ht, const faster_ht_stored_key_t *key,
+                                                   const faster_hash_value_t hash) {
+  for (faster_indexing_t i = 0; i < ht->entries_used; i++) {
+    if (ht->inline_entries[i].hash == hash && _faster_ht_keys_equal(&ht->inline_entries[i].key, key)) {
+      return i;
+    }
+  }
+  return FASTER_HT_INDEX_EMPTY;
+}
 
-  free(ht->entries);
+// first empty slot for a hash known not to be present (rehashing only)
+static size_t _fht_find_empty_slot(const faster_ht_ptr_t ht, const faster_hash_value_t hash) {
+  const size_t mask = (size_t)ht->capacity - 1;
+  size_t perturb = hash;
+  size_t slot = hash & mask;
+  while (_fht_index_get(ht, slot) != FASTER_HT_INDEX_EMPTY) {
+    perturb >>= FASTER_HT_PERTURB_SHIFT;
+    slot = (slot * 5 + perturb + 1) & mask;
+  }
+  return slot;
+}
+
+// (re)allocate index and entries as a single block, compacting holes left by removals
+static bool _faster_ht_resize_and_rehash(faster_ht_ptr_t ht, size_t min_elements) {
+  if (min_elements < ht->requested_capacity) {
+    min_elements = ht->requested_capacity;
+  }
+  size_t new_capacity = _fht_capacity_for(min_elements);
+  if (new_capacity > FAST_LIMIT_INDEXING_MAX / 2) {
+    return false;
+  }
+  size_t new_usable = (new_capacity * 2) / 3;
+  unsigned char new_width = FASTER_HT_INDEX_WIDTH_FOR_CAPACITY(new_capacity);
+  size_t index_size = new_capacity * new_width;
+  faster_value_ptr new_block = malloc(index_size + new_usable * sizeof(faster_ht_entry_t));
+  if (new_block == NULL) {
+    return false;
+  }
+  memset(new_block, 0xff, index_size);
+  faster_ht_entry_ptr_t new_entries = (faster_ht_entry_ptr_t)((char *)new_block + index_size);
+
+  faster_value_ptr old_block = ht->index;
+  faster_ht_entry_ptr_t old_entries = _fht_entries(ht);
+  faster_indexing_t old_used = ht->entries_used;
+
+  ht->index = new_block;
   ht->entries = new_entries;
-  ht->capacity = new_capacity;
-  ht->next_grow_at = (ht->capacity * 3) / 4;
-  ht->next_shrink_at = (ht->capacity / 4);
+  ht->index_width = new_width;
+  ht->capacity = _assume_within_range(new_capacity);
+
+  // entries keep their insertion order, only the holes are dropped
+  faster_indexing_t used = 0;
+  for (faster_indexing_t i = 0; i < old_used; i++) {
+    if (old_entries[i].hash == FASTER_HASH_VALUE_INVALID) {
+      continue;
+    }
+    new_entries[used] = old_entries[i];
+    _fht_index_set(ht, _fht_find_empty_slot(ht, old_entries[i].hash), used);
+    used++;
+  }
+  free(old_block);
 
+  ht->entries_used = used;
+  ht->next_grow_at = _assume_within_range(new_usable);
+  ht->next_shrink_at = (new_capacity > _fht_capacity_for(ht->requested_capacity)) ? ht->next_grow_at / 4 : 0;
   return true;
 }
 
 faster_error_code_t faster_ht_init(faster_ht_ptr_t ht, faster_indexing_t initial_capacity, faster_ht_hash_func_t hash_func) {
-  DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(_new_ht_list_table, faster_ht_entry_linked_t, initial_capacity);
   ht->requested_capacity = initial_capacity;
-  ht->entries_linked = _new_ht_list_table;
   ht->hash_func = hash_func;
   ht->next_shrink_at = 0;
   ht->next_grow_at = 0;
+  ht->index = NULL;
   ht->entries = NULL;
+  ht->index_width = 0;
+  ht->entries_used = 0;
   ht->elements = 0;
   ht->capacity = 0;
   return FAST_ERROR_NONE;
 }
 
 void faster_ht_free(faster_ht_ptr_t ht) {
-  faster_ht_entry_linked_t_arr_reset_and_free(&ht->entries_linked, ht->requested_capacity);
-  free(ht->entries);
+  free(ht->index);
+  ht->index = NULL;
   ht->entries = NULL;
+  ht->index_width = 0;
+  ht->entries_used = 0;
   ht->capacity = 0;
   ht->elements = 0;
   ht->next_grow_at = 0;
   ht->next_shrink_at = 0;
 }
 
-faster_error_code_t faster_ht_set(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, faster_value_ptr value) {
-  faster_ht_entry_linked_t_arr_ptr_t linked_entries_table_ref = &ht->entries_linked;
-  if (ht->elements >= ht->next_grow_at) {
-    if (!_faster_ht_resize_and_rehash(ht, ht->capacity + faster_get_optimal_growth_increment(ht->capacity))) {
-      return FAST_ERROR_MEMORY_ALLOCATION_FAILED;
-    }
+// entry index of the key or FASTER_HT_INDEX_EMPTY, slot receives its index slot in table mode
+static inline faster_indexing_t _fht_find(const faster_ht_t *ht, const faster_ht_stored_key_t *key,
+                                          const faster_hash_value_t hash, size_t *slot) {
+  if (ht->elements == 0) {
+    return FASTER_HT_INDEX_EMPTY;
   }
-  faster_hash_value_t hash = ht->hash_func(key);
-  faster_indexing_t hash_index = hash % ht->capacity;
-  // list could exist - seek for the key
-  faster_indexing_t list_index = ht->entries[hash_index];
-  while (list_index != FASTER_ARRAY_INDEX_INVALID) {
-    if (_faster_ht_keys_equal(&linked_entries_table_ref->list[list_index].key, key)) {
-      // element already exists, update the value
-      linked_entries_table_ref->list[list_index].value = value;
-      return FAST_ERROR_NONE;
-    }
-    list_index = linked_entries_table_ref->list[list_index].next;
+  if (ht->capacity == 0) {
+    return _fht_inline_lookup(ht, key, hash);
   }
-  // key not in the list, so create a new list element at front (faster)
-  faster_indexing_t new_list_index = _fht_create_list_element(ht, hash, key, value);
-  if (new_list_index == FASTER_ARRAY_INDEX_INVALID) {
-    return FAST_ERROR_MEMORY_ALLOCATION_FAILED;
+  faster_indexing_t entry_index;
+  *slot = _fht_lookup(ht, key, hash, &entry_index, NULL);
+  return entry_index;
+}
+
+// index slot pointing at a known entry, found by its cached hash without comparing keys
+static size_t _fht_slot_of_entry(const faster_ht_ptr_t ht, const faster_indexing_t entry_index) {
+  const size_t mask = (size_t)ht->capacity - 1;
+  size_t perturb = ht->entries[entry_index].hash;
+  size_t slot = perturb & mask;
+  while (_fht_index_get(ht, slot) != entry_index) {
+    perturb >>= FASTER_HT_PERTURB_SHIFT;
+    slot = (slot * 5 + perturb + 1) & mask;
   }
-  list_index = ht->entries[hash_index];
-  linked_entries_table_ref->list[new_list_index].next = list_index;
-  ht->entries[hash_index] = new_list_index;
-  ht->elements++;
-  return FAST_ERROR_NONE;
+  return slot;
 }
 
-faster_value_ptr faster_ht_get(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key) {
-  if (ht->capacity == 0 || ht->elements == 0) {
-    return FASTER_INVALID_VALUE_PTR;
+static faster_error_code_t _fht_remove_at(faster_ht_ptr_t ht, const faster_indexing_t entry_index, const size_t slot) {
+  if (ht->capacity == 0) {
+    // inline entries have no holes, close the gap to keep insertion order
+    memmove(ht->inline_entries + entry_index, ht->inline_entries + entry_index + 1,
+            (ht->entries_used - entry_index - 1) * sizeof(faster_ht_entry_t));
+    ht->entries_used--;
+    ht->elements--;
+    return FAST_ERROR_NONE;
   }
-  faster_hash_value_t hash = ht->hash_func(key);
-  faster_indexing_t hash_index = hash % ht->capacity;
-  // list "exists" - empty or otherwise
-  faster_indexing_t list_index = ht->entries[hash_index];
-  while (list_index != FASTER_ARRAY_INDEX_INVALID) {
-    if (_faster_ht_keys_equal(&ht->entries_linked.list[list_index].key, key)) {
-      return ht->entries_linked.list[list_index].value;
+  // leave a hole in the dense entries, the slot keeps probe chains intact. entries_used stays, even for
+  // the last entry: every slot that is not empty counts against it, so the next_grow_at limit keeps
+  // empty slots around to end the probes
+  _fht_index_set(ht, slot, FASTER_HT_INDEX_DELETED);
+  faster_ht_entry_ptr_t entry_ref = ht->entries + entry_index;
+  entry_ref->hash = FASTER_HASH_VALUE_INVALID;
+  entry_ref->value = FASTER_INVALID_VALUE_PTR;
+  ht->elements--;
+  if (ht->elements < ht->next_shrink_at) {
+    // shrink
+    if (!_faster_ht_resize_and_rehash(ht, (size_t)ht->elements * 2)) {
+      return FAST_ERROR_MEMORY_ALLOCATION_FAILED;
     }
-    list_index = ht->entries_linked.list[list_index].next;
   }
-  return FASTER_INVALID_VALUE_PTR;
+  return FAST_ERROR_NONE;
 }
 
-faster_error_code_t faster_ht_remove(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key) {
-  if (ht->capacity == 0 || ht->elements == 0) {
-    return FAST_ERROR_HT_KEY_NOT_FOUND;
-  }
-  faster_ht_entry_linked_t_arr_ptr_t linked_entries_table_ref = &ht->entries_linked;
-  faster_hash_value_t hash = ht->hash_func(key);
-  faster_indexing_t hash_index = hash % ht->capacity;
-  faster_indexing_t list_head = ht->entries[hash_index];
-  // no list
-  if (list_head == FASTER_ARRAY_INDEX_INVALID) {
-    return FAST_ERROR_HT_KEY_NOT_FOUND;
+faster_ht_handle_t faster_ht_upsert_prehashed(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, faster_hash_value_t hash,
+                                              bool *inserted) {
+  hash = _fht_valid_hash(hash);
+  faster_ht_stored_key_t probe;
+  _fht_probe_init(&probe, key);
+  faster_indexing_t entry_index = FASTER_HT_INDEX_EMPTY;
+  size_t free_slot = 0;
+  *inserted = false;
+  if (ht->capacity == 0) {
+    entry_index = _fht_inline_lookup(ht, &probe, hash);
+    if (entry_index != FASTER_HT_INDEX_EMPTY) {
+      return entry_index;
+    }
+    if (ht->entries_used < FASTER_HT_INLINE_CAPACITY) {
+      entry_index = ht->entries_used++;
+      faster_ht_entry_ptr_t entry_ref = ht->inline_entries + entry_index;
+      entry_ref->hash = hash;
+      entry_ref->key = probe;
+      entry_ref->value = FASTER_NULL_VALUE;
+      ht->elements++;
+      *inserted = true;
+      return entry_index;
+    }
+    // inline entries exhausted, migrate them into an indexed table
+  } else {
+    _fht_lookup(ht, &probe, hash, &entry_index, &free_slot);
+    if (entry_index != FASTER_HT_INDEX_EMPTY) {
+      return entry_index;
+    }
   }
-  // list exists
-  faster_indexing_t list_index = list_head;
-  faster_indexing_t prev_index = FASTER_ARRAY_INDEX_INVALID;
-  while (list_index != FASTER_ARRAY_INDEX_INVALID) {
-    if (_faster_ht_keys_equal(&ht->entries_linked.list[list_index].key, key)) {
-      // found the key, apply the removal
-      if (list_index == list_head) {
-        // first element in the list
-        ht->entries[hash_index] = linked_entries_table_ref->list[list_index].next;
-      } else {
-        // not first element in the list
-        linked_entries_table_ref->list[prev_index].next = linked_entries_table_ref->list[list_index].next;
-      }
-      faster_ht_entry_linked_t_arr_release(linked_entries_table_ref, list_index);
-      ht->elements--;
-      if (ht->elements < ht->next_shrink_at) {
-        // shrink
-        if (!_faster_ht_resize_and_rehash(ht, ht->capacity - faster_get_optimal_growth_increment(ht->capacity))) {
-          return FAST_ERROR_MEMORY_ALLOCATION_FAILED;
-        }
-      }
-      return FAST_ERROR_NONE;
+  if (ht->entries_used >= ht->next_grow_at) {
+    // grows when full of live entries, only compacts when full of holes
+    if (!_faster_ht_resize_and_rehash(ht, (size_t)ht->elements * 2 + 1)) {
+      return FASTER_HT_HANDLE_INVALID;
     }
-    prev_index = list_index;
-    list_index = ht->entries_linked.list[list_index].next;
+    free_slot = _fht_find_empty_slot(ht, hash);
   }
-  return FAST_ERROR_HT_KEY_NOT_FOUND;
+  // key not in the table, append a new entry to keep insertion order
+  entry_index = ht->entries_used++;
+  faster_ht_entry_ptr_t entry_ref = ht->entries + entry_index;
+  entry_ref->hash = hash;
+  entry_ref->key = probe;
+  entry_ref->value = FASTER_NULL_VALUE;
+  _fht_index_set(ht, free_slot, entry_index);
+  ht->elements++;
+  *inserted = true;
+  return entry_index;
 }
 
-void faster_ht_clear(faster_ht_ptr_t ht) {
-  for (size_t i = 0; i < ht->capacity; i++) {
-    ht->entries[i] = FASTER_ARRAY_INDEX_INVALID;
-  }
-  ht->elements = 0;
-  faster_ht_entry_linked_t_arr_reset_and_free(&ht->entries_linked, ht->requested_capacity);
-  _faster_ht_resize_and_rehash(ht, ht->requested_capacity);
+faster_ht_handle_t faster_ht_upsert(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, bool *inserted) {
+  return faster_ht_upsert_prehashed(ht, key, ht->hash_func(key), inserted);
 }
 
-// MurmurHash2, by Austin Appleby, taken from
-// https://github.com/aappleby/smhasher/blob/master/src/MurmurHash2.cpp
-
-// According to the file preamble:
-// MurmurHash2 was written by Austin Appleby, and is placed in the public
-// domain. The author hereby disclaims copyright to this source code.
-
-faster_hash_value_t faster_ht_hash(faster_ht_key_data_ptr_t key) {
-  uint32_t seed = 0x9747b28c;
+faster_ht_handle_t faster_ht_find_prehashed(const faster_ht_t *ht, faster_ht_key_data_ptr_t key, faster_hash_value_t hash) {
+  size_t slot;
+  hash = _fht_valid_hash(hash);
+  faster_ht_stored_key_t probe;
+  _fht_probe_init(&probe, key);
+  return _fht_find(ht, &probe, hash, &slot);
+}
 
-  const uint32_t m = 0x5bd1e995;
-  const int r = 24;
+faster_ht_handle_t faster_ht_find(const faster_ht_t *ht, faster_ht_key_data_ptr_t key) {
+  return faster_ht_find_prehashed(ht, key, ht->hash_func(key));
+}
 
-  size_t len = key->len;
-  const unsigned char *data = (const unsigned char *)key->ptr;
+// entries are 24 (32 with sstr keys) bytes wide and start 8-byte aligned, so the packed value stays aligned
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Waddress-of-packed-member"
+faster_value_ptr *faster_ht_handle_value(faster_ht_ptr_t ht, faster_ht_handle_t handle) {
+  return &_fht_entries(ht)[handle].value;
+}
+#pragma GCC diagnostic pop
 
-  // Initialize the hash to a 'random' value
+faster_value_ptr faster_ht_handle_get(const faster_ht_t *ht, faster_ht_handle_t handle) {
+  if (handle >= ht->entries_used) {
+    return FASTER_INVALID_VALUE_PTR;
+  }
+  return ((ht->capacity == 0) ? ht->inline_entries : ht->entries)[handle].value;
+}
 
-  uint32_t h = seed ^ len;
+faster_error_code_t faster_ht_handle_remove(faster_ht_ptr_t ht, faster_ht_handle_t handle) {
+  if (handle >= ht->entries_used || _fht_entries(ht)[handle].hash == FASTER_HASH_VALUE_INVALID) {
+    return FAST_ERROR_HT_KEY_NOT_FOUND;
+  }
+  return _fht_remove_at(ht, handle, (ht->capacity == 0) ? 0 : _fht_slot_of_entry(ht, handle));
+}
 
-  // Mix 4 bytes at a time into the hash
+faster_error_code_t faster_ht_set_prehashed(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, faster_hash_value_t hash,
+                                            faster_value_ptr value) {
+  bool inserted;
+  faster_ht_handle_t handle = faster_ht_upsert_prehashed(ht, key, hash, &inserted);
+  if (handle == FASTER_HT_HANDLE_INVALID) {
+    return FAST_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  _fht_entries(ht)[handle].value = value;
+  return FAST_ERROR_NONE;
+}
 
-  while (len >= 4) {
-    uint32_t k = *(uint32_t *)data;
+faster_error_code_t faster_ht_set(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, faster_value_ptr value) {
+  return faster_ht_set_prehashed(ht, key, ht->hash_func(key), value);
+}
 
-    k *= m;
-    k ^= k >> r;
-    k *= m;
+faster_value_ptr faster_ht_get_prehashed(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, faster_hash_value_t hash) {
+  faster_ht_handle_t handle = faster_ht_find_prehashed(ht, key, hash);
+  if (handle == FASTER_HT_HANDLE_INVALID) {
+    return FASTER_INVALID_VALUE_PTR;
+  }
+  return _fht_entries(ht)[handle].value;
+}
 
-    h *= m;
-    h ^= k;
+faster_value_ptr faster_ht_get(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key) {
+  return faster_ht_get_prehashed(ht, key, ht->hash_func(key));
+}
 
-    data += 4;
-    len -= 4;
+faster_error_code_t faster_ht_remove_prehashed(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key, faster_hash_value_t hash) {
+  size_t slot = 0;
+  hash = _fht_valid_hash(hash);
+  faster_ht_stored_key_t probe;
+  _fht_probe_init(&probe, key);
+  faster_indexing_t entry_index = _fht_find(ht, &probe, hash, &slot);
+  if (entry_index == FASTER_HT_INDEX_EMPTY) {
+    return FAST_ERROR_HT_KEY_NOT_FOUND;
   }
+  return _fht_remove_at(ht, entry_index, slot);
+}
 
-  // Handle the last few bytes of the input array
-
-  switch (len) {
-  case 3:
-    h ^= data[2] << 16;
-  case 2:
-    h ^= data[1] << 8;
-  case 1:
-    h ^= data[0];
-    h *= m;
-  };
+faster_error_code_t faster_ht_remove(faster_ht_ptr_t ht, faster_ht_key_data_ptr_t key) {
+  return faster_ht_remove_prehashed(ht, key, ht->hash_func(key));
+}
 
-  // Do a few final mixes of the hash to ensure the last few
-  // bytes are well-incorporated.
+void faster_ht_clear(faster_ht_ptr_t ht) {
+  // storage is recreated at the requested capacity by the next insertion
+  faster_ht_free(ht);
+}
 
-  h ^= h >> 13;
-  h *= m;
-  h ^= h >> 15;
+faster_ht_entry_ptr_t faster_ht_iterator(faster_ht_ptr_t ht, faster_ht_iterator_t *it) {
+  faster_ht_entry_ptr_t entries = _fht_entries(ht);
+  while (*it < ht->entries_used) {
+    faster_ht_entry_ptr_t entry_ref = entries + (*it)++;
+    if (entry_ref->hash != FASTER_HASH_VALUE_INVALID) {
+      return entry_ref;
+    }
+  }
+  return NULL;
+}
 
+// MurmurHash2 below FASTER_PRIM_HASH_STRIPED_MIN bytes, see faster_prim_hash
+faster_hash_value_t faster_ht_hash(faster_ht_key_data_ptr_t key) {
+#if FASTER_HT_SSTR_KEYS
+  faster_sstr_t stored;
+  _fht_probe_init(&stored, key);
+  faster_hash_value_t h = faster_sstr_hash(&stored);
+#else
+  faster_hash_value_t h = faster_prim_hash(key->ptr, key->len);
+#endif
   if (h == FASTER_HASH_VALUE_INVALID) {
     h++;
   }
@@ -1,23 +1,540 @@
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
 #include "aster/faster_is.h"
 
+// room for length characters and a terminator, NULL when out of memory
+static fchar_t *_is_arena_alloc(faster_is_arena_t *arena, const size_t length) {
+  struct faster_is_arena_chunk_s *chunk = arena->chunks;
+  if (chunk == NULL || chunk->size - chunk->used < length + 1) {
+    size_t size = (length + 1 > FASTER_IS_ARENA_CHUNK_SIZE / sizeof(fchar_t)) ? length + 1 : FASTER_IS_ARENA_CHUNK_SIZE / sizeof(fchar_t);
+    struct faster_is_arena_chunk_s *fresh = malloc(sizeof(struct faster_is_arena_chunk_s) + FASTER_STRING_MEMORY_SIZE(size));
+    if (fresh == NULL) {
+      return NULL;
+    }
+    fresh->used = 0;
+    fresh->size = size;
+    // an oversized string fills its chunk, the partly filled one stays in front
+    if (chunk != NULL && size > FASTER_IS_ARENA_CHUNK_SIZE / sizeof(fchar_t)) {
+      fresh->next = chunk->next;
+      chunk->next = fresh;
+    } else {
+      fresh->next = chunk;
+      arena->chunks = fresh;
+    }
+    chunk = fresh;
+  }
+  fchar_t *str_ptr = chunk->data + chunk->used;
+  chunk->used += length + 1;
+  arena->bytes += FASTER_STRING_MEMORY_SIZE(length) + sizeof(fchar_t);
+  return str_ptr;
+}
+
+static void _is_arena_free(faster_is_arena_t *arena) {
+  while (arena->chunks != NULL) {
+    struct faster_is_arena_chunk_s *next = arena->chunks->next;
+    free(arena->chunks);
+    arena->chunks = next;
+  }
+  arena->bytes = 0;
+  arena->garbage = 0;
+}
+
 void faster_interned_strings_init(faster_interned_strings_ptr_t interned_strings) {
-  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(avl_tree, 256);
-  interned_strings->avl_tree = avl_tree;
+  faster_interned_strings_init_layered(interned_strings, NULL);
+}
+
+void faster_interned_strings_init_layered(faster_interned_strings_ptr_t interned_strings, const faster_interned_strings_t *base) {
+  DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(symbols, faster_interned_symbol_t, 256);
+  interned_strings->symbols = symbols;
+  interned_strings->symbols_used = 0;
+  interned_strings->arena = (faster_is_arena_t){.chunks = NULL, .bytes = 0, .garbage = 0};
+  interned_strings->base = base;
+  interned_strings->base_count = (base != NULL) ? faster_interned_strings_count(base) : 0;
+  interned_strings->base_purposes = NULL;
+  faster_ht_init(&interned_strings->index, 256, faster_ht_hash);
 }
 
 void faster_interned_strings_free(faster_interned_strings_ptr_t interned_strings) {
-  AVL_reset_and_free(&interned_strings->avl_tree);
+  faster_interned_symbol_t_arr_reset_and_free(&interned_strings->symbols, 256);
+  faster_ht_free(&interned_strings->index);
+  _is_arena_free(&interned_strings->arena);
+  free(interned_strings->base_purposes);
+  interned_strings->base_purposes = NULL;
+}
+
+static inline faster_symbol_t _is_lookup(const faster_interned_strings_t *interned_strings, faster_ht_key_data_ptr_t key,
+                                         const faster_hash_value_t hash) {
+  faster_ht_handle_t handle = faster_ht_find_prehashed(&interned_strings->index, key, hash);
+  return (handle == FASTER_HT_HANDLE_INVALID)
+             ? FASTER_SYMBOL_INVALID
+             : (faster_symbol_t)FASTER_VALUE_GET_INT_DIRECT(faster_ht_handle_get(&interned_strings->index, handle));
+}
+
+// the base layers are searched first, they only ever read their index
+static faster_symbol_t _is_find(const faster_interned_strings_t *interned_strings, faster_ht_key_data_ptr_t key,
+                                const faster_hash_value_t hash) {
+  if (interned_strings->base != NULL) {
+    faster_symbol_t symbol = _is_find(interned_strings->base, key, hash);
+    if (symbol != FASTER_SYMBOL_INVALID) {
+      return symbol;
+    }
+  }
+  faster_symbol_t local = _is_lookup(interned_strings, key, hash);
+  return (local == FASTER_SYMBOL_INVALID) ? FASTER_SYMBOL_INVALID : interned_strings->base_count + local;
+}
+
+faster_symbol_t faster_interned_strings_find(const faster_interned_strings_t *interned_strings, const faster_str_ptr_t str) {
+  faster_ht_key_data_t key = {(faster_value_ptr)str->str_ptr, (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(str->str_len)};
+  return _is_find(interned_strings, &key, faster_ht_hash(&key));
+}
+
+// the base is frozen, purposes added to its symbols are kept in the overlay; symbols of the overlay gain a reference
+static bool _is_add_purpose(const faster_interned_strings_ptr_t interned_strings, const faster_symbol_t symbol,
+                            const faster_interned_string_purpose_t purpose) {
+  if (symbol >= interned_strings->base_count) {
+    interned_strings->symbols.list[symbol - interned_strings->base_count].purpose |= purpose;
+    interned_strings->symbols.list[symbol - interned_strings->base_count].references++;
+    return true;
+  }
+  if ((purpose & ~faster_interned_strings_purpose(interned_strings, symbol)) == 0) {
+    return true;
+  }
+  if (interned_strings->base_purposes == NULL) {
+    interned_strings->base_purposes = calloc(interned_strings->base_count, sizeof(faster_interned_string_purpose_t));
+    if (interned_strings->base_purposes == NULL) {
+      return false;
+    }
+  }
+  interned_strings->base_purposes[symbol] |= purpose;
+  return true;
+}
+
+// a miss copies the string into the arena, so the index and the symbol table never point into caller memory
+faster_symbol_t faster_interned_strings_symbol(const faster_interned_strings_ptr_t interned_strings, const faster_str_ptr_t str,
+                                               const faster_interned_string_purpose_t purpose) {
+  faster_ht_key_data_t key = {(faster_value_ptr)str->str_ptr, (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(str->str_len)};
+  faster_hash_value_t hash = faster_ht_hash(&key);
+  faster_symbol_t symbol = _is_find(interned_strings, &key, hash);
+  if (symbol != FASTER_SYMBOL_INVALID) {
+    return _is_add_purpose(interned_strings, symbol, purpose) ? symbol : FASTER_SYMBOL_INVALID;
+  }
+
+  symbol = faster_interned_symbol_t_arr_get_next(&interned_strings->symbols);
+  if (symbol == FASTER_SYMBOL_INVALID) {
+    return FASTER_SYMBOL_INVALID;
+  }
+  // the arena is append only: a failure past this point leaves an unused copy behind
+  fchar_t *copy = _is_arena_alloc(&interned_strings->arena, str->str_len);
+  if (copy == NULL) {
+    faster_interned_symbol_t_arr_release(&interned_strings->symbols, symbol);
+    return FASTER_SYMBOL_INVALID;
+  }
+  memcpy(copy, str->str_ptr, FASTER_STRING_MEMORY_SIZE(str->str_len));
+  copy[str->str_len] = 0;
+  key.ptr = copy;
+  if (faster_ht_set_prehashed(&interned_strings->index, &key, hash, FASTER_VALUE_MAKE_INT_DIRECT(symbol)) != FAST_ERROR_NONE) {
+    faster_interned_symbol_t_arr_release(&interned_strings->symbols, symbol);
+    return FASTER_SYMBOL_INVALID;
+  }
+  faster_interned_symbol_t entry = {.str = {copy, str->str_len}, .purpose = purpose, .hash = hash, .references = 1};
+  memcpy(&interned_strings->symbols.list[symbol], &entry, sizeof(faster_interned_symbol_t));
+  if (symbol >= interned_strings->symbols_used) {
+    interned_strings->symbols_used = symbol + 1;
+  }
+  return interned_strings->base_count + symbol;
+}
+
+#if !FASTER_UNICODE_NATIVE_BYTES
+// short strings are decoded on the stack
+#define FASTER_IS_UTF8_STACK_UNITS 64
+
+// src decoded into units, which is stack when it has room and a fresh allocation otherwise (NULL when out of memory)
+static fchar_t *_is_utf8_decode(const char *src, const size_t len, fchar_t *stack, faster_str_t *str) {
+  fchar_t *units = (len < FASTER_IS_UTF8_STACK_UNITS) ? stack : malloc(FASTER_STRING_MEMORY_SIZE(len + 1));
+  if (units == NULL) {
+    return NULL;
+  }
+  // never more units than bytes, so one call takes all of it
+  faster_mb_stream_t stream;
+  faster_mb_stream_init(&stream);
+  size_t consumed;
+  faster_str_t decoded = {units, faster_mb_stream_to_unicode(&stream, src, len, &consumed, units, len + 1, true)};
+  memcpy((void *)str, &decoded, sizeof(faster_str_t));
+  return units;
+}
+#endif
+
+faster_symbol_t faster_interned_strings_symbol_utf8(const faster_interned_strings_ptr_t interned_strings, const char *src, size_t len,
+                                                    const faster_interned_string_purpose_t purpose) {
+#if FASTER_UNICODE_NATIVE_BYTES
+  faster_str_t str = faster_str_from_utf8(src, len);
+  return faster_interned_strings_symbol(interned_strings, &str, purpose);
+#else
+  fchar_t stack[FASTER_IS_UTF8_STACK_UNITS];
+  faster_str_t str = {NULL, 0};
+  fchar_t *units = _is_utf8_decode(src, len, stack, &str);
+  if (units == NULL) {
+    return FASTER_SYMBOL_INVALID;
+  }
+  faster_symbol_t symbol = faster_interned_strings_symbol(interned_strings, &str, purpose);
+  if (units != stack) {
+    free(units);
+  }
+  return symbol;
+#endif
+}
+
+faster_symbol_t faster_interned_strings_find_utf8(const faster_interned_strings_t *interned_strings, const char *src, size_t len) {
+#if FASTER_UNICODE_NATIVE_BYTES
+  faster_str_t str = faster_str_from_utf8(src, len);
+  return faster_interned_strings_find(interned_strings, &str);
+#else
+  fchar_t stack[FASTER_IS_UTF8_STACK_UNITS];
+  faster_str_t str = {NULL, 0};
+  fchar_t *units = _is_utf8_decode(src, len, stack, &str);
+  if (units == NULL) {
+    return FASTER_SYMBOL_INVALID;
+  }
+  faster_symbol_t symbol = faster_interned_strings_find(interned_strings, &str);
+  if (units != stack) {
+    free(units);
+  }
+  return symbol;
+#endif
+}
+
+faster_indexing_t faster_interned_strings_count(const faster_interned_strings_t *interned_strings) {
+  return interned_strings->base_count + faster_interned_symbol_t_arr_count(&interned_strings->symbols);
+}
+
+void faster_interned_strings_acquire(const faster_interned_strings_ptr_t interned_strings, const faster_symbol_t symbol) {
+  if (symbol >= interned_strings->base_count) {
+    interned_strings->symbols.list[symbol - interned_strings->base_count].references++;
+  }
+}
+
+void faster_interned_strings_release(const faster_interned_strings_ptr_t interned_strings, const faster_symbol_t symbol) {
+  if (symbol >= interned_strings->base_count && interned_strings->symbols.list[symbol - interned_strings->base_count].references > 0) {
+    interned_strings->symbols.list[symbol - interned_strings->base_count].references--;
+  }
+}
+
+// copies the live strings into a fresh arena and indexes them again, the index loses its holes on the way;
+// nothing changes when memory runs out
+static void _is_compact(const faster_interned_strings_ptr_t interned_strings) {
+  faster_interned_symbol_t *list = interned_strings->symbols.list;
+  fchar_t **copies = malloc(((size_t)interned_strings->symbols_used + 1) * sizeof(fchar_t *));
+  faster_is_arena_t arena = {.chunks = NULL, .bytes = 0, .garbage = 0};
+  faster_ht_t index;
+  faster_ht_init(&index, faster_interned_symbol_t_arr_count(&interned_strings->symbols), faster_ht_hash);
+  bool complete = copies != NULL;
+  for (faster_indexing_t symbol = 0; complete && symbol < interned_strings->symbols_used; symbol++) {
+    if (list[symbol].references == FASTER_IS_SYMBOL_FREE) {
+      continue;
+    }
+    copies[symbol] = _is_arena_alloc(&arena, list[symbol].str.str_len);
+    if (copies[symbol] == NULL) {
+      complete = false;
+      break;
+    }
+    memcpy(copies[symbol], list[symbol].str.str_ptr, FASTER_STRING_MEMORY_SIZE(list[symbol].str.str_len) + sizeof(fchar_t));
+    faster_ht_key_data_t key = {copies[symbol], (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(list[symbol].str.str_len)};
+    complete = faster_ht_set_prehashed(&index, &key, list[symbol].hash, FASTER_VALUE_MAKE_INT_DIRECT(symbol)) == FAST_ERROR_NONE;
+  }
+  if (!complete) {
+    _is_arena_free(&arena);
+    faster_ht_free(&index);
+    free(copies);
+    return;
+  }
+  for (faster_indexing_t symbol = 0; symbol < interned_strings->symbols_used; symbol++) {
+    if (list[symbol].references != FASTER_IS_SYMBOL_FREE) {
+      faster_str_t str = {copies[symbol], list[symbol].str.str_len};
+      memcpy((void *)&list[symbol].str, &str, sizeof(faster_str_t));
+    }
+  }
+  _is_arena_free(&interned_strings->arena);
+  faster_ht_free(&interned_strings->index);
+  interned_strings->arena = arena;
+  interned_strings->index = index;
+  free(copies);
+}
+
+faster_indexing_t faster_interned_strings_sweep(const faster_interned_strings_ptr_t interned_strings) {
+  faster_interned_symbol_t *list = interned_strings->symbols.list;
+  faster_indexing_t reclaimed = 0;
+  for (faster_indexing_t symbol = 0; symbol < interned_strings->symbols_used; symbol++) {
+    if (list[symbol].references != 0) {
+      continue;
+    }
+    faster_ht_key_data_t key = {(faster_value_ptr)list[symbol].str.str_ptr,
+                                (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(list[symbol].str.str_len)};
+    faster_ht_remove_prehashed(&interned_strings->index, &key, list[symbol].hash);
+    interned_strings->arena.garbage += FASTER_STRING_MEMORY_SIZE(list[symbol].str.str_len) + sizeof(fchar_t);
+    // the free list link only overwrites the start of the entry, references keeps telling free slots apart
+    list[symbol].references = FASTER_IS_SYMBOL_FREE;
+    faster_interned_symbol_t_arr_release(&interned_strings->symbols, symbol);
+    reclaimed++;
+  }
+  if (reclaimed > 0 && interned_strings->arena.garbage * 100 >= interned_strings->arena.bytes * FASTER_IS_COMPACT_PERCENT) {
+    _is_compact(interned_strings);
+  }
+  return reclaimed;
+}
+
+// operators and reserved words every script shares, their symbols are the same in every layered table
+// arrays take the literals of every width, a const fchar_t * would need a cast where u8 literals are plain char
+struct _is_base_name_s {
+  fchar_t text[8];
+  faster_interned_string_purpose_t purpose;
+};
+
+static const struct _is_base_name_s _is_base_names[] = {
+    {ASTER_TEXT("+"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},   {ASTER_TEXT("-"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("*"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},   {ASTER_TEXT("/"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("%"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},   {ASTER_TEXT("**"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("//"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},  {ASTER_TEXT("&"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("|"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},   {ASTER_TEXT("^"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("~"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},   {ASTER_TEXT("&&"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("||"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},  {ASTER_TEXT("!"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("=="), FAST_INTERNED_STRING_PURPOSE_OPERATOR},  {ASTER_TEXT("!="), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("<"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},   {ASTER_TEXT(">"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("<="), FAST_INTERNED_STRING_PURPOSE_OPERATOR},  {ASTER_TEXT(">="), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("="), FAST_INTERNED_STRING_PURPOSE_OPERATOR},   {ASTER_TEXT("++"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("--"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},  {ASTER_TEXT("?"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT(":"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},   {ASTER_TEXT("AND"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("OR"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},  {ASTER_TEXT("XOR"), FAST_INTERNED_STRING_PURPOSE_OPERATOR},
+    {ASTER_TEXT("NOT"), FAST_INTERNED_STRING_PURPOSE_OPERATOR}, {ASTER_TEXT("null"), FAST_INTERNED_STRING_PURPOSE_SYMBOL},
+    {ASTER_TEXT("true"), FAST_INTERNED_STRING_PURPOSE_SYMBOL},  {ASTER_TEXT("false"), FAST_INTERNED_STRING_PURPOSE_SYMBOL},
+};
+
+static faster_interned_strings_t _is_base;
+static once_flag _is_base_once = ONCE_FLAG_INIT;
+
+static void _is_base_build(void) {
+  faster_interned_strings_init(&_is_base);
+  for (size_t i = 0; i < sizeof(_is_base_names) / sizeof(_is_base_names[0]); i++) {
+    faster_str_t str = {_is_base_names[i].text, faster_strlen(_is_base_names[i].text)};
+    faster_interned_strings_symbol(&_is_base, &str, _is_base_names[i].purpose);
+  }
+}
+
+const faster_interned_strings_t *faster_interned_strings_base(void) {
+  call_once(&_is_base_once, _is_base_build);
+  return &_is_base;
 }
 
-faster_interned_string_purpose_t faster_interned_strings_get(faster_interned_strings_ptr_t interned_strings,
+size_t faster_interned_strings_memory_usage(const faster_interned_strings_ptr_t interned_strings) {
+  size_t usage = (size_t)interned_strings->symbols.list_header.array_capacity * sizeof(faster_interned_symbol_t);
+  for (struct faster_is_arena_chunk_s *chunk = interned_strings->arena.chunks; chunk != NULL; chunk = chunk->next) {
+    usage += sizeof(struct faster_is_arena_chunk_s) + FASTER_STRING_MEMORY_SIZE(chunk->size);
+  }
+  return usage;
+}
+
+faster_interned_string_purpose_t faster_interned_strings_get(const faster_interned_strings_t *interned_strings,
                                                              const faster_str_ptr_t str) {
-  return (faster_interned_string_purpose_t)(FASTER_VALUE_GET_INT_DIRECT(AVL_get(&interned_strings->avl_tree, str)));
+  faster_symbol_t symbol = faster_interned_strings_find(interned_strings, str);
+  return (symbol == FASTER_SYMBOL_INVALID) ? FAST_INTERNED_STRING_PURPOSE_UNDEFINED
+                                           : faster_interned_strings_purpose(interned_strings, symbol);
 }
 
 void faster_interned_strings_intern(const faster_interned_strings_ptr_t interned_strings, const faster_str_ptr_t str,
                                     const faster_interned_string_purpose_t purpose) {
-  faster_value_int_holder_t value = FASTER_VALUE_GET_INT_DIRECT(AVL_get(&interned_strings->avl_tree, str));
-  if (!FASTER_INTERNED_STRING_PURPOSE_HAS_PURPOSE(value, purpose)) {
-    AVL_insert_or_update(&interned_strings->avl_tree, str, FASTER_VALUE_MAKE_INT_DIRECT(purpose | value));
+  faster_interned_strings_symbol(interned_strings, str, purpose);
+}
+
+static faster_symbol_t _cis_lookup(const faster_concurrent_interned_strings_ptr_t interned_strings,
+                                   const struct faster_concurrent_index_s *index, const faster_str_ptr_t str,
+                                   const faster_hash_value_t hash) {
+  for (size_t slot = hash & index->mask;; slot = (slot + 1) & index->mask) {
+    uint64_t value = atomic_load_explicit(&index->slots[slot], memory_order_acquire);
+    if (value == 0) {
+      return FASTER_SYMBOL_INVALID;
+    }
+    if ((faster_hash_value_t)(value >> 32) == hash) {
+      faster_indexing_t local = (faster_indexing_t)(value & 0xFFFFFFFF) - 1;
+      const faster_str_t *candidate = &_faster_concurrent_symbol(interned_strings, local)->str;
+      if (candidate->str_len == str->str_len &&
+          memcmp(candidate->str_ptr, str->str_ptr, FASTER_STRING_MEMORY_SIZE(str->str_len)) == 0) {
+        return interned_strings->base_count + local;
+      }
+    }
+  }
+}
+
+// the base first, then the current index of the table
+static faster_symbol_t _cis_find(const faster_concurrent_interned_strings_ptr_t interned_strings, const faster_str_ptr_t str,
+                                 const faster_hash_value_t hash) {
+  if (interned_strings->base != NULL) {
+    faster_ht_key_data_t key = {(faster_value_ptr)str->str_ptr, (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(str->str_len)};
+    faster_symbol_t symbol = _is_find(interned_strings->base, &key, hash);
+    if (symbol != FASTER_SYMBOL_INVALID) {
+      return symbol;
+    }
+  }
+  return _cis_lookup(interned_strings, atomic_load_explicit(&interned_strings->index, memory_order_acquire), str, hash);
+}
+
+static inline faster_hash_value_t _cis_hash(const faster_str_ptr_t str) {
+  faster_ht_key_data_t key = {(faster_value_ptr)str->str_ptr, (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(str->str_len)};
+  return faster_ht_hash(&key);
+}
+
+static struct faster_concurrent_index_s *_cis_index_create(const size_t capacity) {
+  struct faster_concurrent_index_s *index = malloc(sizeof(struct faster_concurrent_index_s) + capacity * sizeof(_Atomic uint64_t));
+  if (index != NULL) {
+    index->retired = NULL;
+    index->mask = capacity - 1;
+    for (size_t slot = 0; slot < capacity; slot++) {
+      atomic_init(&index->slots[slot], 0);
+    }
+  }
+  return index;
+}
+
+// under the lock, readers keep probing whichever index they loaded
+static void _cis_index_put(struct faster_concurrent_index_s *index, const faster_hash_value_t hash, const faster_indexing_t local) {
+  size_t slot = hash & index->mask;
+  while (atomic_load_explicit(&index->slots[slot], memory_order_relaxed) != 0) {
+    slot = (slot + 1) & index->mask;
+  }
+  atomic_store_explicit(&index->slots[slot], ((uint64_t)hash << 32) | ((uint64_t)local + 1), memory_order_release);
+}
+
+// under the lock: keeps the index at most half full, the replaced one stays readable
+static bool _cis_index_reserve(const faster_concurrent_interned_strings_ptr_t interned_strings, const faster_indexing_t count) {
+  struct faster_concurrent_index_s *index = atomic_load_explicit(&interned_strings->index, memory_order_relaxed);
+  if (((size_t)count + 1) * 2 <= index->mask + 1) {
+    return true;
+  }
+  struct faster_concurrent_index_s *grown = _cis_index_create((index->mask + 1) * 2);
+  if (grown == NULL) {
+    return false;
+  }
+  for (faster_indexing_t local = 0; local < count; local++) {
+    _cis_index_put(grown, _faster_concurrent_symbol(interned_strings, local)->hash, local);
+  }
+  grown->retired = index;
+  atomic_store_explicit(&interned_strings->index, grown, memory_order_release);
+  return true;
+}
+
+faster_error_code_t faster_concurrent_interned_strings_init(faster_concurrent_interned_strings_ptr_t interned_strings,
+                                                           const faster_interned_strings_t *base) {
+  interned_strings->base = base;
+  interned_strings->base_count = (base != NULL) ? faster_interned_strings_count(base) : 0;
+  interned_strings->arena = (faster_is_arena_t){.chunks = NULL, .bytes = 0, .garbage = 0};
+  atomic_init(&interned_strings->count, 0);
+  for (int segment = 0; segment < FASTER_CIS_SEGMENTS; segment++) {
+    atomic_init(&interned_strings->segments[segment], NULL);
+  }
+  struct faster_concurrent_index_s *index = _cis_index_create(FASTER_CIS_INDEX_MIN_CAPACITY);
+  interned_strings->base_purposes = calloc(interned_strings->base_count + 1, sizeof(_Atomic faster_interned_string_purpose_t));
+  if (index == NULL || interned_strings->base_purposes == NULL || mtx_init(&interned_strings->lock, mtx_plain) != thrd_success) {
+    free(index);
+    free((void *)interned_strings->base_purposes);
+    return FAST_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  atomic_init(&interned_strings->index, index);
+  return FAST_ERROR_NONE;
+}
+
+void faster_concurrent_interned_strings_free(faster_concurrent_interned_strings_ptr_t interned_strings) {
+  struct faster_concurrent_index_s *index = atomic_load(&interned_strings->index);
+  while (index != NULL) {
+    struct faster_concurrent_index_s *retired = index->retired;
+    free(index);
+    index = retired;
+  }
+  atomic_store(&interned_strings->index, NULL);
+  for (int segment = 0; segment < FASTER_CIS_SEGMENTS; segment++) {
+    free(atomic_load(&interned_strings->segments[segment]));
+    atomic_store(&interned_strings->segments[segment], NULL);
+  }
+  free((void *)interned_strings->base_purposes);
+  interned_strings->base_purposes = NULL;
+  _is_arena_free(&interned_strings->arena);
+  mtx_destroy(&interned_strings->lock);
+}
+
+static void _cis_add_purpose(const faster_concurrent_interned_strings_ptr_t interned_strings, const faster_symbol_t symbol,
+                             const faster_interned_string_purpose_t purpose) {
+  if ((purpose & ~faster_concurrent_interned_strings_purpose(interned_strings, symbol)) == 0) {
+    return;
   }
+  _Atomic faster_interned_string_purpose_t *target =
+      (symbol < interned_strings->base_count)
+          ? &interned_strings->base_purposes[symbol]
+          : &_faster_concurrent_symbol(interned_strings, symbol - interned_strings->base_count)->purpose;
+  atomic_fetch_or_explicit(target, purpose, memory_order_relaxed);
+}
+
+// a hit never locks; a miss looks again under the lock, as another thread may have added the string meanwhile
+faster_symbol_t faster_concurrent_interned_strings_symbol(const faster_concurrent_interned_strings_ptr_t interned_strings,
+                                                          const faster_str_ptr_t str, const faster_interned_string_purpose_t purpose) {
+  faster_hash_value_t hash = _cis_hash(str);
+  faster_symbol_t symbol = _cis_find(interned_strings, str, hash);
+  if (symbol != FASTER_SYMBOL_INVALID) {
+    _cis_add_purpose(interned_strings, symbol, purpose);
+    return symbol;
+  }
+
+  mtx_lock(&interned_strings->lock);
+  symbol = _cis_lookup(interned_strings, atomic_load_explicit(&interned_strings->index, memory_order_relaxed), str, hash);
+  if (symbol != FASTER_SYMBOL_INVALID) {
+    mtx_unlock(&interned_strings->lock);
+    _cis_add_purpose(interned_strings, symbol, purpose);
+    return symbol;
+  }
+  faster_indexing_t local = atomic_load_explicit(&interned_strings->count, memory_order_relaxed);
+  unsigned int segment = (unsigned int)(31 - __builtin_clz((local >> FASTER_CIS_FIRST_SEGMENT_BITS) + 1));
+  if (local >= FASTER_SYMBOL_INVALID - interned_strings->base_count - 1 || !_cis_index_reserve(interned_strings, local)) {
+    mtx_unlock(&interned_strings->lock);
+    return FASTER_SYMBOL_INVALID;
+  }
+  if (atomic_load_explicit(&interned_strings->segments[segment], memory_order_relaxed) == NULL) {
+    struct faster_concurrent_symbol_s *symbols =
+        malloc(((size_t)1 << (segment + FASTER_CIS_FIRST_SEGMENT_BITS)) * sizeof(struct faster_concurrent_symbol_s));
+    if (symbols == NULL) {
+      mtx_unlock(&interned_strings->lock);
+      return FASTER_SYMBOL_INVALID;
+    }
+    atomic_store_explicit(&interned_strings->segments[segment], symbols, memory_order_release);
+  }
+  fchar_t *copy = _is_arena_alloc(&interned_strings->arena, str->str_len);
+  if (copy == NULL) {
+    mtx_unlock(&interned_strings->lock);
+    return FASTER_SYMBOL_INVALID;
+  }
+  memcpy(copy, str->str_ptr, FASTER_STRING_MEMORY_SIZE(str->str_len));
+  copy[str->str_len] = 0;
+  // the symbol is complete before the slot publishing it becomes visible
+  struct faster_concurrent_symbol_s *entry = _faster_concurrent_symbol(interned_strings, local);
+  faster_str_t view = {copy, str->str_len};
+  memcpy((void *)&entry->str, &view, sizeof(faster_str_t));
+  entry->hash = hash;
+  atomic_init(&entry->purpose, purpose);
+  atomic_store_explicit(&interned_strings->count, local + 1, memory_order_release);
+  _cis_index_put(atomic_load_explicit(&interned_strings->index, memory_order_relaxed), hash, local);
+  mtx_unlock(&interned_strings->lock);
+  return interned_strings->base_count + local;
+}
+
+faster_symbol_t faster_concurrent_interned_strings_find(const faster_concurrent_interned_strings_ptr_t interned_strings,
+                                                        const faster_str_ptr_t str) {
+  return _cis_find(interned_strings, str, _cis_hash(str));
+}
+
+faster_interned_string_purpose_t faster_concurrent_interned_strings_get(const faster_concurrent_interned_strings_ptr_t interned_strings,
+                                                                       const faster_str_ptr_t str) {
+  faster_symbol_t symbol = faster_concurrent_interned_strings_find(interned_strings, str);
+  return (symbol == FASTER_SYMBOL_INVALID) ? FAST_INTERNED_STRING_PURPOSE_UNDEFINED
+                                           : faster_concurrent_interned_strings_purpose(interned_strings, symbol);
+}
+
+faster_indexing_t faster_concurrent_interned_strings_count(const faster_concurrent_interned_strings_ptr_t interned_strings) {
+  return interned_strings->base_count + atomic_load_explicit(&interned_strings->count, memory_order_acquire);
 }
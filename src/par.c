@@ -0,0 +1,304 @@
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aster/faster_par.h"
+
+// tasks are claimed through next by the caller and every worker that joined the batch
+struct _faster_pool_batch_s {
+  faster_pool_task_func_t func;
+  void *arg;
+  size_t count;
+  atomic_size_t next;
+};
+
+static void _pool_run_batch(struct _faster_pool_batch_s *batch) {
+  size_t task;
+  while ((task = atomic_fetch_add_explicit(&batch->next, 1, memory_order_relaxed)) < batch->count) {
+    batch->func(batch->arg, task);
+  }
+}
+
+// a worker only touches a batch while it is counted in active, the caller waits for active to drop
+// to 0 before it takes the batch back, so late workers find no batch rather than a stale one
+static int _pool_thread(void *arg) {
+  faster_pool_ptr_t pool = arg;
+  size_t seen = 0;
+  mtx_lock(&pool->lock);
+  for (;;) {
+    while (!pool->stopping && (pool->batch == NULL || pool->generation == seen)) {
+      cnd_wait(&pool->wake, &pool->lock);
+    }
+    if (pool->stopping) {
+      break;
+    }
+    seen = pool->generation;
+    struct _faster_pool_batch_s *batch = pool->batch;
+    pool->active++;
+    mtx_unlock(&pool->lock);
+    _pool_run_batch(batch);
+    mtx_lock(&pool->lock);
+    if (--pool->active == 0) {
+      cnd_signal(&pool->finished);
+    }
+  }
+  mtx_unlock(&pool->lock);
+  return 0;
+}
+
+faster_error_code_t faster_pool_init(faster_pool_ptr_t pool, const unsigned int threads) {
+  memset(pool, 0, sizeof(faster_pool_t));
+  if (mtx_init(&pool->lock, mtx_plain) != thrd_success || mtx_init(&pool->run_lock, mtx_plain) != thrd_success ||
+      cnd_init(&pool->wake) != thrd_success || cnd_init(&pool->finished) != thrd_success) {
+    return FAST_ERROR_GENERAL;
+  }
+  if (threads <= 1) {
+    return FAST_ERROR_NONE;
+  }
+  pool->threads = malloc((threads - 1) * sizeof(thrd_t));
+  if (pool->threads == NULL) {
+    faster_pool_free(pool);
+    return FAST_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  while (pool->thread_count < threads - 1 &&
+         thrd_create(&pool->threads[pool->thread_count], _pool_thread, pool) == thrd_success) {
+    pool->thread_count++;
+  }
+  return FAST_ERROR_NONE;
+}
+
+void faster_pool_free(faster_pool_ptr_t pool) {
+  mtx_lock(&pool->lock);
+  pool->stopping = true;
+  cnd_broadcast(&pool->wake);
+  mtx_unlock(&pool->lock);
+  for (unsigned int i = 0; i < pool->thread_count; i++) {
+    thrd_join(pool->threads[i], NULL);
+  }
+  free(pool->threads);
+  pool->threads = NULL;
+  pool->thread_count = 0;
+  cnd_destroy(&pool->wake);
+  cnd_destroy(&pool->finished);
+  mtx_destroy(&pool->lock);
+  mtx_destroy(&pool->run_lock);
+}
+
+void faster_pool_run(faster_pool_ptr_t pool, faster_pool_task_func_t func, void *arg, const size_t count) {
+  struct _faster_pool_batch_s batch = {.func = func, .arg = arg, .count = count};
+  atomic_init(&batch.next, 0);
+  if (pool == NULL || pool->thread_count == 0 || count <= 1) {
+    _pool_run_batch(&batch);
+    return;
+  }
+  mtx_lock(&pool->run_lock);
+  mtx_lock(&pool->lock);
+  pool->batch = &batch;
+  pool->generation++;
+  cnd_broadcast(&pool->wake);
+  mtx_unlock(&pool->lock);
+  _pool_run_batch(&batch);
+  mtx_lock(&pool->lock);
+  while (pool->active > 0) {
+    cnd_wait(&pool->finished, &pool->lock);
+  }
+  pool->batch = NULL;
+  mtx_unlock(&pool->lock);
+  mtx_unlock(&pool->run_lock);
+}
+
+static unsigned int _par_threads(const faster_pool_ptr_t pool) {
+  return (pool == NULL) ? 1 : pool->thread_count + 1;
+}
+
+// partial accumulators are laid out at the strictest fundamental alignment
+static size_t _par_stride(const faster_reduction_t *reduction) {
+  return (reduction->size + alignof(max_align_t) - 1) / alignof(max_align_t) * alignof(max_align_t);
+}
+
+// result starts from init and takes the partial results in order
+static void _par_combine(const faster_reduction_t *reduction, const unsigned char *partials, const size_t count,
+                         void *result) {
+  size_t stride = _par_stride(reduction);
+  reduction->init(result, reduction->context);
+  for (size_t i = 0; i < count; i++) {
+    reduction->combine(result, partials + i * stride, reduction->context);
+  }
+}
+
+static unsigned char *_par_partials(const faster_reduction_t *reduction, const size_t count) {
+  size_t stride = _par_stride(reduction);
+  unsigned char *partials = malloc((count > 0 ? count : 1) * stride);
+  if (partials != NULL) {
+    for (size_t i = 0; i < count; i++) {
+      reduction->init(partials + i * stride, reduction->context);
+    }
+  }
+  return partials;
+}
+
+// a piece of an AVL walk: a whole subtree, or a single node sitting above the subtrees
+struct _par_avl_piece_s {
+  AVLNodeIndex node;
+  bool subtree;
+};
+
+#define _PAR_AVL_MAX_PIECES ((2 << FASTER_PAR_AVL_MAX_SPLIT_DEPTH) - 1)
+
+struct _par_avl_walk_s {
+  AVLNodesTreePtr tree;
+  faster_avl_visit_func_t visit;
+  faster_avl_fold_func_t fold;
+  const faster_reduction_t *reduction;
+  unsigned char *partials;
+  void *context;
+  size_t count;
+  struct _par_avl_piece_s pieces[_PAR_AVL_MAX_PIECES];
+};
+
+// pieces in key order: the left side, the node, the right side
+static void _par_avl_split(struct _par_avl_walk_s *walk, const AVLNodeIndex node, const int depth) {
+  if (FASTER_AVL_NODE_INVALID(node)) {
+    return;
+  }
+  AVLNodePtr node_ptr = walk->tree->node_list.list + node;
+  if (depth == 0 || node_ptr->height <= 1) {
+    walk->pieces[walk->count++] = (struct _par_avl_piece_s){.node = node, .subtree = true};
+    return;
+  }
+  _par_avl_split(walk, node_ptr->left, depth - 1);
+  walk->pieces[walk->count++] = (struct _par_avl_piece_s){.node = node, .subtree = false};
+  _par_avl_split(walk, node_ptr->right, depth - 1);
+}
+
+static inline void _par_avl_apply(struct _par_avl_walk_s *walk, void *accumulator, const AVLNodePtr node) {
+  if (walk->fold != NULL) {
+    walk->fold(accumulator, node, walk->reduction->context);
+  } else {
+    walk->visit(node, walk->context);
+  }
+}
+
+// in-order walk of one piece
+static void _par_avl_task(void *arg, size_t task) {
+  struct _par_avl_walk_s *walk = arg;
+  AVLNodePtr list = walk->tree->node_list.list;
+  void *accumulator = (walk->partials != NULL) ? walk->partials + task * _par_stride(walk->reduction) : NULL;
+  if (!walk->pieces[task].subtree) {
+    _par_avl_apply(walk, accumulator, list + walk->pieces[task].node);
+    return;
+  }
+  AVLNodeIndex stack[FASTER_AVL_MAX_HEIGHT];
+  int top = -1;
+  AVLNodeIndex node = walk->pieces[task].node;
+  while (FASTER_AVL_NODE_VALID(node) || top >= 0) {
+    while (FASTER_AVL_NODE_VALID(node)) {
+      stack[++top] = node;
+      node = list[node].left;
+    }
+    node = stack[top--];
+    _par_avl_apply(walk, accumulator, list + node);
+    node = list[node].right;
+  }
+}
+
+// enough levels for FASTER_PAR_TASKS_PER_THREAD pieces per thread, none when the walk stays on the caller
+static void _par_avl_walk(const faster_pool_ptr_t pool, const AVLNodesTreePtr tree, struct _par_avl_walk_s *walk) {
+  walk->tree = tree;
+  walk->count = 0;
+  unsigned int threads = _par_threads(pool);
+  int depth = 0;
+  if (threads > 1) {
+    while (depth < FASTER_PAR_AVL_MAX_SPLIT_DEPTH && ((size_t)1 << depth) < (size_t)threads * FASTER_PAR_TASKS_PER_THREAD) {
+      depth++;
+    }
+  }
+  _par_avl_split(walk, tree->root_node, depth);
+}
+
+void AVL_for_each_parallel(faster_pool_ptr_t pool, const AVLNodesTreePtr tree, faster_avl_visit_func_t visit, void *context) {
+  struct _par_avl_walk_s walk = {.visit = visit, .context = context};
+  _par_avl_walk(pool, tree, &walk);
+  faster_pool_run(pool, _par_avl_task, &walk, walk.count);
+}
+
+faster_error_code_t AVL_reduce_parallel(faster_pool_ptr_t pool, const AVLNodesTreePtr tree, faster_avl_fold_func_t fold,
+                                        const faster_reduction_t *reduction, void *result) {
+  struct _par_avl_walk_s walk = {.fold = fold, .reduction = reduction};
+  _par_avl_walk(pool, tree, &walk);
+  walk.partials = _par_partials(reduction, walk.count);
+  if (walk.partials == NULL) {
+    return FAST_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  faster_pool_run(pool, _par_avl_task, &walk, walk.count);
+  _par_combine(reduction, walk.partials, walk.count, result);
+  free(walk.partials);
+  return FAST_ERROR_NONE;
+}
+
+// a hash table walk hands out ranges of range entries, holes are skipped
+struct _par_ht_walk_s {
+  faster_ht_entry_ptr_t entries;
+  size_t used;
+  size_t range;
+  faster_ht_visit_func_t visit;
+  faster_ht_fold_func_t fold;
+  const faster_reduction_t *reduction;
+  unsigned char *partials;
+  void *context;
+};
+
+static void _par_ht_task(void *arg, size_t task) {
+  struct _par_ht_walk_s *walk = arg;
+  size_t first = task * walk->range;
+  size_t last = (first + walk->range < walk->used) ? first + walk->range : walk->used;
+  if (walk->fold != NULL) {
+    void *accumulator = walk->partials + task * _par_stride(walk->reduction);
+    for (size_t i = first; i < last; i++) {
+      if (walk->entries[i].hash != FASTER_HASH_VALUE_INVALID) {
+        walk->fold(accumulator, walk->entries + i, walk->reduction->context);
+      }
+    }
+    return;
+  }
+  for (size_t i = first; i < last; i++) {
+    if (walk->entries[i].hash != FASTER_HASH_VALUE_INVALID) {
+      walk->visit(walk->entries + i, walk->context);
+    }
+  }
+}
+
+// small tables keep their entries inline until the index is allocated
+static size_t _par_ht_walk(const faster_pool_ptr_t pool, const faster_ht_ptr_t ht, struct _par_ht_walk_s *walk) {
+  walk->entries = (ht->capacity == 0) ? ht->inline_entries : ht->entries;
+  walk->used = ht->entries_used;
+  size_t tasks = (size_t)_par_threads(pool) * FASTER_PAR_TASKS_PER_THREAD;
+  walk->range = (walk->used + tasks - 1) / tasks;
+  if (walk->range < FASTER_PAR_HT_MIN_RANGE) {
+    walk->range = FASTER_PAR_HT_MIN_RANGE;
+  }
+  return (walk->used + walk->range - 1) / walk->range;
+}
+
+void faster_ht_for_each_parallel(faster_pool_ptr_t pool, const faster_ht_ptr_t ht, faster_ht_visit_func_t visit,
+                                 void *context) {
+  struct _par_ht_walk_s walk = {.visit = visit, .context = context};
+  size_t count = _par_ht_walk(pool, ht, &walk);
+  faster_pool_run(pool, _par_ht_task, &walk, count);
+}
+
+faster_error_code_t faster_ht_reduce_parallel(faster_pool_ptr_t pool, const faster_ht_ptr_t ht, faster_ht_fold_func_t fold,
+                                              const faster_reduction_t *reduction, void *result) {
+  struct _par_ht_walk_s walk = {.fold = fold, .reduction = reduction};
+  size_t count = _par_ht_walk(pool, ht, &walk);
+  walk.partials = _par_partials(reduction, count);
+  if (walk.partials == NULL) {
+    return FAST_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+  faster_pool_run(pool, _par_ht_task, &walk, count);
+  _par_combine(reduction, walk.partials, count, result);
+  free(walk.partials);
+  return FAST_ERROR_NONE;
+}
@@ -0,0 +1,357 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "aster/faster_pavl.h"
+#include "aster/faster_prim.h"
+
+// Utility functions
+static int max(const int a, const int b) { return (a > b) ? a : b; }
+static int height(const faster_pavl_ptr_t tree, const PAVLNodeIndex node) {
+  return FASTER_PAVL_NODE_VALID(node) ? faster_pavl_node(tree, node)->height : 0;
+}
+static void update_height(const faster_pavl_ptr_t tree, const PAVLNodePtr node_ptr) {
+  node_ptr->height = (int8_t)(max(height(tree, node_ptr->left), height(tree, node_ptr->right)) + 1);
+}
+
+// make sure a whole write fits in the node storage and the retired list, so no write fails half way
+static bool _pavl_reserve(const faster_pavl_ptr_t tree) {
+  while (tree->free_count + (tree->capacity - tree->allocated) < FASTER_PAVL_MAX_WRITE_NODES) {
+    unsigned int segment = 0;
+    while (segment < FASTER_PAVL_MAX_SEGMENTS && tree->segments[segment] != NULL)
+      segment++;
+    if (segment == FASTER_PAVL_MAX_SEGMENTS)
+      return false;
+    size_t nodes = (size_t)FASTER_PAVL_SEGMENT_BASE << segment;
+    PAVLNodePtr block = malloc(nodes * sizeof(PAVLNode_t));
+    if (block == NULL)
+      return false;
+    tree->segments[segment] = block;
+    tree->capacity += (faster_indexing_t)nodes;
+  }
+  if (tree->retired_capacity - tree->retired_count < FASTER_PAVL_MAX_WRITE_NODES) {
+    size_t new_capacity = tree->retired_capacity + faster_get_optimal_growth_increment(tree->retired_capacity) +
+                          FASTER_PAVL_MAX_WRITE_NODES;
+    struct faster_pavl_retired_s *tmp = realloc(tree->retired, new_capacity * sizeof(struct faster_pavl_retired_s));
+    if (tmp == NULL)
+      return false;
+    tree->retired = tmp;
+    tree->retired_capacity = new_capacity;
+  }
+  return true;
+}
+
+static PAVLNodeIndex _pavl_alloc(const faster_pavl_ptr_t tree) {
+  PAVLNodeIndex node;
+  if (FASTER_PAVL_NODE_VALID(tree->free_list)) {
+    node = tree->free_list;
+    tree->free_list = faster_pavl_node(tree, node)->left;
+    tree->free_count--;
+  } else {
+    node = tree->allocated++;
+  }
+  faster_pavl_node(tree, node)->fresh = 1;
+  tree->fresh[tree->fresh_count++] = node;
+  return node;
+}
+
+static void _pavl_release(const faster_pavl_ptr_t tree, const PAVLNodeIndex node) {
+  faster_pavl_node(tree, node)->left = tree->free_list;
+  tree->free_list = node;
+  tree->free_count++;
+}
+
+// a node leaves the current version, readers of older versions may still hold it
+static void _pavl_retire(const faster_pavl_ptr_t tree, const PAVLNodeIndex node) {
+  if (faster_pavl_node(tree, node)->fresh) {
+    _pavl_release(tree, node); // never published
+    return;
+  }
+  tree->retired[tree->retired_count].node = node;
+  tree->retired[tree->retired_count].epoch = atomic_load(&tree->epoch);
+  tree->retired_count++;
+}
+
+// node that may be changed by the current write, published nodes are copied first
+static PAVLNodeIndex _pavl_mutable(const faster_pavl_ptr_t tree, const PAVLNodeIndex node) {
+  PAVLNodePtr node_ptr = faster_pavl_node(tree, node);
+  if (node_ptr->fresh)
+    return node;
+  PAVLNodeIndex copy = _pavl_alloc(tree);
+  memcpy(faster_pavl_node(tree, copy), faster_pavl_node(tree, node), sizeof(PAVLNode_t));
+  _pavl_retire(tree, node);
+  return copy;
+}
+
+// rotations only run on nodes of the current write, the child moving up is copied on the way
+static PAVLNodeIndex rightRotate(const faster_pavl_ptr_t tree, const PAVLNodeIndex y) {
+  PAVLNodePtr y_ptr = faster_pavl_node(tree, y);
+  PAVLNodeIndex x = _pavl_mutable(tree, y_ptr->left);
+  PAVLNodePtr x_ptr = faster_pavl_node(tree, x);
+  y_ptr->left = x_ptr->right;
+  x_ptr->right = y;
+  update_height(tree, y_ptr);
+  update_height(tree, x_ptr);
+  return x;
+}
+
+static PAVLNodeIndex leftRotate(const faster_pavl_ptr_t tree, const PAVLNodeIndex x) {
+  PAVLNodePtr x_ptr = faster_pavl_node(tree, x);
+  PAVLNodeIndex y = _pavl_mutable(tree, x_ptr->right);
+  PAVLNodePtr y_ptr = faster_pavl_node(tree, y);
+  x_ptr->right = y_ptr->left;
+  y_ptr->left = x;
+  update_height(tree, x_ptr);
+  update_height(tree, y_ptr);
+  return y;
+}
+
+static int getBalance(const faster_pavl_ptr_t tree, const PAVLNodeIndex node) {
+  if (FASTER_PAVL_NODE_INVALID(node))
+    return 0;
+  PAVLNodePtr node_ptr = faster_pavl_node(tree, node);
+  return height(tree, node_ptr->left) - height(tree, node_ptr->right);
+}
+
+static PAVLNodeIndex _pavl_balance(const faster_pavl_ptr_t tree, const PAVLNodeIndex node) {
+  PAVLNodePtr node_ptr = faster_pavl_node(tree, node);
+  update_height(tree, node_ptr);
+  int balance = height(tree, node_ptr->left) - height(tree, node_ptr->right);
+  if (balance > 1) {
+    if (getBalance(tree, node_ptr->left) < 0) {
+      PAVLNodeIndex left = _pavl_mutable(tree, node_ptr->left);
+      faster_pavl_node(tree, node)->left = leftRotate(tree, left);
+    }
+    return rightRotate(tree, node);
+  }
+  if (balance < -1) {
+    if (getBalance(tree, node_ptr->right) > 0) {
+      PAVLNodeIndex right = _pavl_mutable(tree, node_ptr->right);
+      faster_pavl_node(tree, node)->right = rightRotate(tree, right);
+    }
+    return leftRotate(tree, node);
+  }
+  return node;
+}
+
+static PAVLNodeIndex _pavl_insert(const faster_pavl_ptr_t tree, const PAVLNodeIndex node, const faster_str_ptr_t key,
+                                  const faster_str_prefix_t key_prefix, const faster_value_ptr value, bool *inserted) {
+  if (FASTER_PAVL_NODE_INVALID(node)) {
+    PAVLNodeIndex created = _pavl_alloc(tree);
+    PAVLNodePtr created_ptr = faster_pavl_node(tree, created);
+    memcpy((void *)&created_ptr->key, key, sizeof(faster_str_t));
+    created_ptr->key_prefix = key_prefix;
+    created_ptr->value = value;
+    created_ptr->left = FASTER_PAVL_NODE_INDEX_INVALID;
+    created_ptr->right = FASTER_PAVL_NODE_INDEX_INVALID;
+    created_ptr->height = 1;
+    *inserted = true;
+    return created;
+  }
+  PAVLNodePtr node_ptr = faster_pavl_node(tree, node);
+  int cmp = faster_str_cmp_prefixed(key, key_prefix, &node_ptr->key, node_ptr->key_prefix);
+  if (cmp == 0) {
+    PAVLNodeIndex updated = _pavl_mutable(tree, node);
+    faster_pavl_node(tree, updated)->value = value;
+    return updated;
+  }
+  PAVLNodeIndex child = _pavl_insert(tree, node_ptr->child[cmp > 0], key, key_prefix, value, inserted);
+  PAVLNodeIndex copy = _pavl_mutable(tree, node);
+  faster_pavl_node(tree, copy)->child[cmp > 0] = child;
+  return _pavl_balance(tree, copy);
+}
+
+// unlink the smallest node of a subtree, the node itself is handed back untouched
+static PAVLNodeIndex _pavl_remove_min(const faster_pavl_ptr_t tree, const PAVLNodeIndex node, PAVLNodeIndex *min) {
+  PAVLNodePtr node_ptr = faster_pavl_node(tree, node);
+  if (FASTER_PAVL_NODE_INVALID(node_ptr->left)) {
+    *min = node;
+    return node_ptr->right;
+  }
+  PAVLNodeIndex left = _pavl_remove_min(tree, node_ptr->left, min);
+  PAVLNodeIndex copy = _pavl_mutable(tree, node);
+  faster_pavl_node(tree, copy)->left = left;
+  return _pavl_balance(tree, copy);
+}
+
+static PAVLNodeIndex _pavl_remove(const faster_pavl_ptr_t tree, const PAVLNodeIndex node, const faster_str_ptr_t key,
+                                  const faster_str_prefix_t key_prefix, bool *removed) {
+  if (FASTER_PAVL_NODE_INVALID(node))
+    return node;
+  PAVLNodePtr node_ptr = faster_pavl_node(tree, node);
+  int cmp = faster_str_cmp_prefixed(key, key_prefix, &node_ptr->key, node_ptr->key_prefix);
+  if (cmp != 0) {
+    PAVLNodeIndex child = _pavl_remove(tree, node_ptr->child[cmp > 0], key, key_prefix, removed);
+    if (!*removed)
+      return node; // nothing changed below, keep sharing this subtree
+    PAVLNodeIndex copy = _pavl_mutable(tree, node);
+    faster_pavl_node(tree, copy)->child[cmp > 0] = child;
+    return _pavl_balance(tree, copy);
+  }
+  *removed = true;
+  PAVLNodeIndex left = node_ptr->left;
+  PAVLNodeIndex right = node_ptr->right;
+  _pavl_retire(tree, node);
+  if (FASTER_PAVL_NODE_INVALID(left))
+    return right;
+  if (FASTER_PAVL_NODE_INVALID(right))
+    return left;
+  // the inorder successor takes the place of the removed node
+  PAVLNodeIndex successor;
+  right = _pavl_remove_min(tree, right, &successor);
+  successor = _pavl_mutable(tree, successor);
+  PAVLNodePtr successor_ptr = faster_pavl_node(tree, successor);
+  successor_ptr->left = left;
+  successor_ptr->right = right;
+  return _pavl_balance(tree, successor);
+}
+
+// free what no announced reader can reach anymore: nodes retired before the oldest announced epoch
+static void _pavl_reclaim(const faster_pavl_ptr_t tree) {
+  uint64_t oldest = FASTER_PAVL_READER_FREE;
+  for (int reader = 0; reader < FASTER_PAVL_MAX_READERS; reader++) {
+    uint64_t announced = atomic_load(&tree->readers[reader]);
+    if (announced != FASTER_PAVL_READER_IDLE && announced < oldest)
+      oldest = announced;
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < tree->retired_count; i++) {
+    if (tree->retired[i].epoch < oldest) {
+      _pavl_release(tree, tree->retired[i].node);
+    } else {
+      tree->retired[kept++] = tree->retired[i];
+    }
+  }
+  tree->retired_count = kept;
+}
+
+// seal the nodes of this write, make the new root visible, then move readers to the next epoch
+static void _pavl_publish(const faster_pavl_ptr_t tree, const PAVLNodeIndex root) {
+  for (faster_indexing_t i = 0; i < tree->fresh_count; i++)
+    faster_pavl_node(tree, tree->fresh[i])->fresh = 0;
+  tree->fresh_count = 0;
+  atomic_store(&tree->root, root);
+  atomic_fetch_add(&tree->epoch, 1);
+  _pavl_reclaim(tree);
+}
+
+faster_error_code_t faster_pavl_init(faster_pavl_ptr_t tree) {
+  atomic_init(&tree->root, FASTER_PAVL_NODE_INDEX_INVALID);
+  atomic_init(&tree->epoch, 1);
+  for (int reader = 0; reader < FASTER_PAVL_MAX_READERS; reader++)
+    atomic_init(&tree->readers[reader], FASTER_PAVL_READER_FREE);
+  memset(tree->segments, 0, sizeof(tree->segments));
+  tree->elements = 0;
+  tree->allocated = 0;
+  tree->capacity = 0;
+  tree->free_list = FASTER_PAVL_NODE_INDEX_INVALID;
+  tree->free_count = 0;
+  tree->retired = NULL;
+  tree->retired_count = 0;
+  tree->retired_capacity = 0;
+  tree->fresh_count = 0;
+  return _pavl_reserve(tree) ? FAST_ERROR_NONE : FAST_ERROR_MEMORY_ALLOCATION_FAILED;
+}
+
+// no reader may hold a snapshot anymore
+void faster_pavl_free(faster_pavl_ptr_t tree) {
+  for (int segment = 0; segment < FASTER_PAVL_MAX_SEGMENTS; segment++) {
+    free(tree->segments[segment]);
+    tree->segments[segment] = NULL;
+  }
+  free(tree->retired);
+  tree->retired = NULL;
+  tree->retired_count = 0;
+  tree->retired_capacity = 0;
+  tree->allocated = 0;
+  tree->capacity = 0;
+  tree->free_list = FASTER_PAVL_NODE_INDEX_INVALID;
+  tree->free_count = 0;
+  tree->elements = 0;
+  atomic_store(&tree->root, FASTER_PAVL_NODE_INDEX_INVALID);
+}
+
+// Insert a key, or update its value if present, and publish the new version
+bool faster_pavl_insert_or_update(faster_pavl_ptr_t tree, const faster_str_ptr_t key, const faster_value_ptr value) {
+  if (!_pavl_reserve(tree))
+    return false;
+  bool inserted = false;
+  PAVLNodeIndex root =
+      _pavl_insert(tree, atomic_load_explicit(&tree->root, memory_order_relaxed), key, faster_str_prefix(key), value, &inserted);
+  _pavl_publish(tree, root);
+  if (inserted)
+    tree->elements++;
+  return inserted;
+}
+
+// Remove a key and publish the new version
+bool faster_pavl_remove(faster_pavl_ptr_t tree, const faster_str_ptr_t key) {
+  if (!_pavl_reserve(tree))
+    return false;
+  bool removed = false;
+  PAVLNodeIndex root =
+      _pavl_remove(tree, atomic_load_explicit(&tree->root, memory_order_relaxed), key, faster_str_prefix(key), &removed);
+  if (!removed)
+    return false; // key not found
+  _pavl_publish(tree, root);
+  tree->elements--;
+  return true;
+}
+
+// claim a reader slot, -1 when all FASTER_PAVL_MAX_READERS are taken
+int faster_pavl_reader_register(faster_pavl_ptr_t tree) {
+  for (int reader = 0; reader < FASTER_PAVL_MAX_READERS; reader++) {
+    uint64_t expected = FASTER_PAVL_READER_FREE;
+    if (atomic_compare_exchange_strong(&tree->readers[reader], &expected, FASTER_PAVL_READER_IDLE))
+      return reader;
+  }
+  return -1;
+}
+
+void faster_pavl_reader_unregister(faster_pavl_ptr_t tree, int reader) {
+  atomic_store(&tree->readers[reader], FASTER_PAVL_READER_FREE);
+}
+
+// the epoch is announced before the root is read, so the writer keeps every node of that root alive
+faster_pavl_snapshot_t faster_pavl_snapshot(faster_pavl_ptr_t tree, int reader) {
+  atomic_store(&tree->readers[reader], atomic_load(&tree->epoch));
+  faster_pavl_snapshot_t snapshot = {.root = atomic_load(&tree->root), .reader = reader};
+  return snapshot;
+}
+
+void faster_pavl_snapshot_release(faster_pavl_ptr_t tree, faster_pavl_snapshot_t *snapshot) {
+  atomic_store(&tree->readers[snapshot->reader], FASTER_PAVL_READER_IDLE);
+  snapshot->root = FASTER_PAVL_NODE_INDEX_INVALID;
+}
+
+faster_value_ptr faster_pavl_get(const faster_pavl_ptr_t tree, const faster_pavl_snapshot_t *snapshot, const faster_str_ptr_t key) {
+  faster_str_prefix_t key_prefix = faster_str_prefix(key);
+  PAVLNodeIndex node = snapshot->root;
+  while (FASTER_PAVL_NODE_VALID(node)) {
+    PAVLNodePtr node_ptr = faster_pavl_node(tree, node);
+    int cmp = faster_str_cmp_prefixed(key, key_prefix, &node_ptr->key, node_ptr->key_prefix);
+    if (cmp == 0)
+      return node_ptr->value; // key found
+    node = node_ptr->child[cmp > 0];
+  }
+  return NULL; // key not found
+}
+
+// in-order walk of a snapshot
+PAVLNodeIndex faster_pavl_iterator(const faster_pavl_ptr_t tree, const faster_pavl_snapshot_t *snapshot,
+                                   faster_pavl_iterator_helper_t *it) {
+  PAVLNodeIndex current = FASTER_PAVL_NODE_INDEX_INVALID;
+  if (!it->initialized) {
+    it->top = -1;
+    it->initialized = 1;
+    current = snapshot->root;
+  } else if (it->top >= 0) {
+    current = faster_pavl_node(tree, it->stack[it->top])->right;
+    it->top--;
+  }
+  // the popped node was returned last time, descend to the leftmost node of its right subtree
+  while (FASTER_PAVL_NODE_VALID(current)) {
+    it->stack[++(it->top)] = current;
+    current = faster_pavl_node(tree, current)->left;
+  }
+  return (it->top >= 0) ? it->stack[it->top] : FASTER_PAVL_NODE_INDEX_INVALID;
+}
@@ -0,0 +1,477 @@
+#include <stdatomic.h>
+
+#include "aster/faster_prim.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define _PRIM_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#define _PRIM_UNIT_BYTES sizeof(faster_prim_unit_t)
+
+// MurmurHash2, by Austin Appleby, taken from
+// https://github.com/aappleby/smhasher/blob/master/src/MurmurHash2.cpp
+
+// According to the file preamble:
+// MurmurHash2 was written by Austin Appleby, and is placed in the public
+// domain. The author hereby disclaims copyright to this source code.
+#define _PRIM_MURMUR_SEED 0x9747b28c
+#define _PRIM_MURMUR_M 0x5bd1e995
+#define _PRIM_MURMUR_R 24
+
+static inline uint32_t _prim_murmur_mix(uint32_t h, uint32_t k) {
+  k *= _PRIM_MURMUR_M;
+  k ^= k >> _PRIM_MURMUR_R;
+  k *= _PRIM_MURMUR_M;
+  h *= _PRIM_MURMUR_M;
+  return h ^ k;
+}
+
+// the body and tail of MurmurHash2 from h on, without the final mixes
+static uint32_t _prim_murmur(uint32_t h, const unsigned char *data, size_t len) {
+  // Mix 4 bytes at a time into the hash
+  while (len >= 4) {
+    uint32_t k;
+    memcpy(&k, data, sizeof(k));
+    h = _prim_murmur_mix(h, k);
+    data += 4;
+    len -= 4;
+  }
+
+  // Handle the last few bytes of the input array
+  switch (len) {
+  case 3:
+    h ^= (uint32_t)data[2] << 16;
+    [[fallthrough]];
+  case 2:
+    h ^= (uint32_t)data[1] << 8;
+    [[fallthrough]];
+  case 1:
+    h ^= data[0];
+    h *= _PRIM_MURMUR_M;
+  };
+  return h;
+}
+
+// striped lanes, one xxHash32 style round per 32-bit word: lane = rotl(lane + word * P2, 13) * P1
+#define _PRIM_LANES (FASTER_PRIM_HASH_STRIPE / sizeof(uint32_t))
+#define _PRIM_LANE_P1 0x9E3779B1u
+#define _PRIM_LANE_P2 0x85EBCA77u
+
+static inline uint32_t _prim_lane_round(uint32_t lane, uint32_t word) {
+  lane += word * _PRIM_LANE_P2;
+  lane = (lane << 13) | (lane >> 19);
+  return lane * _PRIM_LANE_P1;
+}
+
+// scalar references, the kernels must give the same answers
+
+static size_t _prim_strlen_scalar(const fchar_t *str) {
+  const faster_prim_unit_t *units = (const faster_prim_unit_t *)str;
+  const faster_prim_unit_t *unit = units;
+  while (*unit)
+    ++unit;
+  return (size_t)(unit - units);
+}
+
+static size_t _prim_mismatch_scalar(const unsigned char *bytes1, const unsigned char *bytes2, const size_t bytes) {
+  size_t at = 0;
+  for (; at + sizeof(uint64_t) <= bytes; at += sizeof(uint64_t)) {
+    uint64_t word1, word2;
+    memcpy(&word1, bytes1 + at, sizeof(uint64_t));
+    memcpy(&word2, bytes2 + at, sizeof(uint64_t));
+    if (word1 != word2)
+      break;
+  }
+  while (at < bytes && bytes1[at] == bytes2[at])
+    at++;
+  return at;
+}
+
+static size_t _prim_scan_scalar(const faster_prim_unit_t *units, const size_t len, const faster_prim_set_t *set,
+                                const bool member) {
+  size_t at = 0;
+  while (at < len && faster_prim_set_contains(set, (fchar_t)units[at]) != member)
+    at++;
+  return at;
+}
+
+static void _prim_hash_stripes_scalar(uint32_t *lanes, const unsigned char *data, const size_t stripes) {
+  for (size_t stripe = 0; stripe < stripes; stripe++, data += FASTER_PRIM_HASH_STRIPE) {
+    for (size_t lane = 0; lane < _PRIM_LANES; lane++) {
+      uint32_t word;
+      memcpy(&word, data + lane * sizeof(uint32_t), sizeof(word));
+      lanes[lane] = _prim_lane_round(lanes[lane], word);
+    }
+  }
+}
+
+#ifdef _PRIM_X86_KERNELS
+#define _PRIM_KERNEL(isa) __attribute__((target(isa)))
+// strlen loads aligned blocks, they stay within the page of the terminator but may read past it
+#define _PRIM_STRLEN_KERNEL(isa) __attribute__((target(isa), no_sanitize_address))
+
+// per width operations; on SSE2 and AVX2 the range tests bias both sides by the sign bit,
+// since there are only signed comparisons
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_FOUR_BYTE
+#define _PRIM_SSE2(op) _mm_##op##_epi32
+#define _PRIM_AVX2(op) _mm256_##op##_epi32
+#define _PRIM_AVX512(op) _mm512_##op##_epi32
+#define _PRIM_AVX512_MASK(op) _mm512_##op##_epu32_mask
+#define _PRIM_AVX512_TESTN _mm512_testn_epi32_mask
+#define _PRIM_SIGN ((int)0x80000000)
+#elif FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+#define _PRIM_SSE2(op) _mm_##op##_epi16
+#define _PRIM_AVX2(op) _mm256_##op##_epi16
+#define _PRIM_AVX512(op) _mm512_##op##_epi16
+#define _PRIM_AVX512_MASK(op) _mm512_##op##_epu16_mask
+#define _PRIM_AVX512_TESTN _mm512_testn_epi16_mask
+#define _PRIM_SIGN ((short)0x8000)
+#else
+#define _PRIM_SSE2(op) _mm_##op##_epi8
+#define _PRIM_AVX2(op) _mm256_##op##_epi8
+#define _PRIM_AVX512(op) _mm512_##op##_epi8
+#define _PRIM_AVX512_MASK(op) _mm512_##op##_epu8_mask
+#define _PRIM_AVX512_TESTN _mm512_testn_epi8_mask
+#define _PRIM_SIGN ((char)0x80)
+#endif
+
+_PRIM_STRLEN_KERNEL("sse2") static size_t _prim_strlen_sse2(const fchar_t *str) {
+  const faster_prim_unit_t *units = (const faster_prim_unit_t *)str;
+  const faster_prim_unit_t *unit = units;
+  // a string not aligned to its units never reaches a block boundary and ends here
+  for (; ((uintptr_t)unit & 15) != 0; unit++) {
+    if (*unit == 0)
+      return (size_t)(unit - units);
+  }
+  const __m128i zero = _mm_setzero_si128();
+  for (;; unit += 16 / _PRIM_UNIT_BYTES) {
+    unsigned int nul = (unsigned int)_mm_movemask_epi8(_PRIM_SSE2(cmpeq)(_mm_load_si128((const __m128i *)(const void *)unit), zero));
+    if (nul != 0)
+      return (size_t)(unit - units) + (unsigned int)__builtin_ctz(nul) / _PRIM_UNIT_BYTES;
+  }
+}
+
+_PRIM_KERNEL("sse2") static size_t _prim_mismatch_sse2(const unsigned char *bytes1, const unsigned char *bytes2, const size_t bytes) {
+  size_t at = 0;
+  for (; at + 16 <= bytes; at += 16) {
+    __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(const void *)(bytes1 + at)),
+                                   _mm_loadu_si128((const __m128i *)(const void *)(bytes2 + at)));
+    unsigned int mismatch = (unsigned int)_mm_movemask_epi8(equal) ^ 0xFFFFu;
+    if (mismatch != 0)
+      return at + (unsigned int)__builtin_ctz(mismatch);
+  }
+  return at + _prim_mismatch_scalar(bytes1 + at, bytes2 + at, bytes - at);
+}
+
+_PRIM_KERNEL("sse2")
+static size_t _prim_scan_sse2(const faster_prim_unit_t *units, const size_t len, const faster_prim_set_t *set, const bool member) {
+  const size_t step = 16 / _PRIM_UNIT_BYTES;
+  const __m128i sign = _PRIM_SSE2(set1)(_PRIM_SIGN);
+  __m128i low[FASTER_PRIM_SET_RANGES], span[FASTER_PRIM_SET_RANGES];
+  for (unsigned int range = 0; range < set->ranges; range++) {
+    low[range] = _PRIM_SSE2(set1)(set->low[range]);
+    span[range] = _mm_xor_si128(_PRIM_SSE2(set1)((faster_prim_unit_t)(set->high[range] - set->low[range])), sign);
+  }
+  size_t at = 0;
+  for (; at + step <= len; at += step) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(const void *)(units + at));
+    __m128i outside = _mm_cmpeq_epi8(block, block);
+    for (unsigned int range = 0; range < set->ranges; range++) {
+      __m128i offset = _mm_xor_si128(_PRIM_SSE2(sub)(block, low[range]), sign);
+      outside = _mm_and_si128(outside, _PRIM_SSE2(cmpgt)(offset, span[range]));
+    }
+    unsigned int found = (unsigned int)_mm_movemask_epi8(outside);
+    if (member)
+      found ^= 0xFFFFu;
+    if (found != 0)
+      return at + (unsigned int)__builtin_ctz(found) / _PRIM_UNIT_BYTES;
+  }
+  return at + _prim_scan_scalar(units + at, len - at, set, member);
+}
+
+// _mm_mullo_epi32 is SSE4.1, two widening multiplies of the even and odd lanes do it on SSE2
+_PRIM_KERNEL("sse2") static inline __m128i _prim_mullo_sse2(const __m128i a, const __m128i b) {
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+_PRIM_KERNEL("sse2") static void _prim_hash_stripes_sse2(uint32_t *lanes, const unsigned char *data, const size_t stripes) {
+  const __m128i p1 = _mm_set1_epi32((int)_PRIM_LANE_P1), p2 = _mm_set1_epi32((int)_PRIM_LANE_P2);
+  __m128i acc[4];
+  for (int part = 0; part < 4; part++)
+    acc[part] = _mm_loadu_si128((const __m128i *)(const void *)(lanes + part * 4));
+  for (size_t stripe = 0; stripe < stripes; stripe++, data += FASTER_PRIM_HASH_STRIPE) {
+    for (int part = 0; part < 4; part++) {
+      __m128i words = _mm_loadu_si128((const __m128i *)(const void *)(data + part * 16));
+      __m128i lane = _mm_add_epi32(acc[part], _prim_mullo_sse2(words, p2));
+      lane = _mm_or_si128(_mm_slli_epi32(lane, 13), _mm_srli_epi32(lane, 19));
+      acc[part] = _prim_mullo_sse2(lane, p1);
+    }
+  }
+  for (int part = 0; part < 4; part++)
+    _mm_storeu_si128((__m128i *)(void *)(lanes + part * 4), acc[part]);
+}
+
+_PRIM_STRLEN_KERNEL("avx2") static size_t _prim_strlen_avx2(const fchar_t *str) {
+  const faster_prim_unit_t *units = (const faster_prim_unit_t *)str;
+  const faster_prim_unit_t *unit = units;
+  for (; ((uintptr_t)unit & 31) != 0; unit++) {
+    if (*unit == 0)
+      return (size_t)(unit - units);
+  }
+  const __m256i zero = _mm256_setzero_si256();
+  for (;; unit += 32 / _PRIM_UNIT_BYTES) {
+    unsigned int nul =
+        (unsigned int)_mm256_movemask_epi8(_PRIM_AVX2(cmpeq)(_mm256_load_si256((const __m256i *)(const void *)unit), zero));
+    if (nul != 0)
+      return (size_t)(unit - units) + (unsigned int)__builtin_ctz(nul) / _PRIM_UNIT_BYTES;
+  }
+}
+
+_PRIM_KERNEL("avx2") static size_t _prim_mismatch_avx2(const unsigned char *bytes1, const unsigned char *bytes2, const size_t bytes) {
+  size_t at = 0;
+  for (; at + 32 <= bytes; at += 32) {
+    __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(const void *)(bytes1 + at)),
+                                      _mm256_loadu_si256((const __m256i *)(const void *)(bytes2 + at)));
+    unsigned int mismatch = ~(unsigned int)_mm256_movemask_epi8(equal);
+    if (mismatch != 0)
+      return at + (unsigned int)__builtin_ctz(mismatch);
+  }
+  return at + _prim_mismatch_scalar(bytes1 + at, bytes2 + at, bytes - at);
+}
+
+_PRIM_KERNEL("avx2")
+static size_t _prim_scan_avx2(const faster_prim_unit_t *units, const size_t len, const faster_prim_set_t *set, const bool member) {
+  const size_t step = 32 / _PRIM_UNIT_BYTES;
+  const __m256i sign = _PRIM_AVX2(set1)(_PRIM_SIGN);
+  __m256i low[FASTER_PRIM_SET_RANGES], span[FASTER_PRIM_SET_RANGES];
+  for (unsigned int range = 0; range < set->ranges; range++) {
+    low[range] = _PRIM_AVX2(set1)(set->low[range]);
+    span[range] = _mm256_xor_si256(_PRIM_AVX2(set1)((faster_prim_unit_t)(set->high[range] - set->low[range])), sign);
+  }
+  size_t at = 0;
+  for (; at + step <= len; at += step) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(const void *)(units + at));
+    __m256i outside = _mm256_cmpeq_epi8(block, block);
+    for (unsigned int range = 0; range < set->ranges; range++) {
+      __m256i offset = _mm256_xor_si256(_PRIM_AVX2(sub)(block, low[range]), sign);
+      outside = _mm256_and_si256(outside, _PRIM_AVX2(cmpgt)(offset, span[range]));
+    }
+    unsigned int found = (unsigned int)_mm256_movemask_epi8(outside);
+    if (member)
+      found = ~found;
+    if (found != 0)
+      return at + (unsigned int)__builtin_ctz(found) / _PRIM_UNIT_BYTES;
+  }
+  return at + _prim_scan_scalar(units + at, len - at, set, member);
+}
+
+_PRIM_KERNEL("avx2") static void _prim_hash_stripes_avx2(uint32_t *lanes, const unsigned char *data, const size_t stripes) {
+  const __m256i p1 = _mm256_set1_epi32((int)_PRIM_LANE_P1), p2 = _mm256_set1_epi32((int)_PRIM_LANE_P2);
+  __m256i acc1 = _mm256_loadu_si256((const __m256i *)(const void *)lanes);
+  __m256i acc2 = _mm256_loadu_si256((const __m256i *)(const void *)(lanes + 8));
+  for (size_t stripe = 0; stripe < stripes; stripe++, data += FASTER_PRIM_HASH_STRIPE) {
+    __m256i lane1 = _mm256_add_epi32(acc1, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)(const void *)data), p2));
+    __m256i lane2 = _mm256_add_epi32(acc2, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)(const void *)(data + 32)), p2));
+    lane1 = _mm256_or_si256(_mm256_slli_epi32(lane1, 13), _mm256_srli_epi32(lane1, 19));
+    lane2 = _mm256_or_si256(_mm256_slli_epi32(lane2, 13), _mm256_srli_epi32(lane2, 19));
+    acc1 = _mm256_mullo_epi32(lane1, p1);
+    acc2 = _mm256_mullo_epi32(lane2, p1);
+  }
+  _mm256_storeu_si256((__m256i *)(void *)lanes, acc1);
+  _mm256_storeu_si256((__m256i *)(void *)(lanes + 8), acc2);
+}
+
+#define _PRIM_AVX512_ISA "avx512f,avx512bw"
+
+_PRIM_STRLEN_KERNEL(_PRIM_AVX512_ISA) static size_t _prim_strlen_avx512(const fchar_t *str) {
+  const faster_prim_unit_t *units = (const faster_prim_unit_t *)str;
+  const faster_prim_unit_t *unit = units;
+  for (; ((uintptr_t)unit & 63) != 0; unit++) {
+    if (*unit == 0)
+      return (size_t)(unit - units);
+  }
+  for (;; unit += 64 / _PRIM_UNIT_BYTES) {
+    __m512i block = _mm512_load_si512((const void *)unit);
+    uint64_t nul = (uint64_t)_PRIM_AVX512_TESTN(block, block);
+    if (nul != 0)
+      return (size_t)(unit - units) + (size_t)__builtin_ctzll(nul);
+  }
+}
+
+_PRIM_KERNEL(_PRIM_AVX512_ISA)
+static size_t _prim_mismatch_avx512(const unsigned char *bytes1, const unsigned char *bytes2, const size_t bytes) {
+  size_t at = 0;
+  for (; at + 64 <= bytes; at += 64) {
+    uint64_t mismatch = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *)(bytes1 + at)),
+                                                _mm512_loadu_si512((const void *)(bytes2 + at)));
+    if (mismatch != 0)
+      return at + (size_t)__builtin_ctzll(mismatch);
+  }
+  return at + _prim_mismatch_scalar(bytes1 + at, bytes2 + at, bytes - at);
+}
+
+_PRIM_KERNEL(_PRIM_AVX512_ISA)
+static size_t _prim_scan_avx512(const faster_prim_unit_t *units, const size_t len, const faster_prim_set_t *set,
+                                const bool member) {
+  const size_t step = 64 / _PRIM_UNIT_BYTES;
+  const uint64_t all = (step == 64) ? ~(uint64_t)0 : (((uint64_t)1 << step) - 1);
+  __m512i low[FASTER_PRIM_SET_RANGES], span[FASTER_PRIM_SET_RANGES];
+  for (unsigned int range = 0; range < set->ranges; range++) {
+    low[range] = _PRIM_AVX512(set1)(set->low[range]);
+    span[range] = _PRIM_AVX512(set1)((faster_prim_unit_t)(set->high[range] - set->low[range]));
+  }
+  size_t at = 0;
+  for (; at + step <= len; at += step) {
+    __m512i block = _mm512_loadu_si512((const void *)(units + at));
+    uint64_t inside = 0;
+    for (unsigned int range = 0; range < set->ranges; range++)
+      inside |= (uint64_t)_PRIM_AVX512_MASK(cmple)(_PRIM_AVX512(sub)(block, low[range]), span[range]);
+    uint64_t found = member ? inside : (inside ^ all);
+    if (found != 0)
+      return at + (size_t)__builtin_ctzll(found);
+  }
+  return at + _prim_scan_scalar(units + at, len - at, set, member);
+}
+
+_PRIM_KERNEL(_PRIM_AVX512_ISA) static void _prim_hash_stripes_avx512(uint32_t *lanes, const unsigned char *data, const size_t stripes) {
+  const __m512i p1 = _mm512_set1_epi32((int)_PRIM_LANE_P1), p2 = _mm512_set1_epi32((int)_PRIM_LANE_P2);
+  __m512i acc = _mm512_loadu_si512((const void *)lanes);
+  for (size_t stripe = 0; stripe < stripes; stripe++, data += FASTER_PRIM_HASH_STRIPE) {
+    __m512i lane = _mm512_add_epi32(acc, _mm512_mullo_epi32(_mm512_loadu_si512((const void *)data), p2));
+    acc = _mm512_mullo_epi32(_mm512_rol_epi32(lane, 13), p1);
+  }
+  _mm512_storeu_si512((void *)lanes, acc);
+}
+#endif // _PRIM_X86_KERNELS
+
+struct _prim_kernels_s {
+  size_t (*strlen)(const fchar_t *str);
+  size_t (*mismatch)(const unsigned char *bytes1, const unsigned char *bytes2, const size_t bytes);
+  size_t (*scan)(const faster_prim_unit_t *units, const size_t len, const faster_prim_set_t *set, const bool member);
+  void (*hash_stripes)(uint32_t *lanes, const unsigned char *data, const size_t stripes);
+};
+
+static const struct _prim_kernels_s _prim_kernels[] = {
+    [FASTER_SIMD_SCALAR] = {_prim_strlen_scalar, _prim_mismatch_scalar, _prim_scan_scalar, _prim_hash_stripes_scalar},
+#ifdef _PRIM_X86_KERNELS
+    [FASTER_SIMD_SSE2] = {_prim_strlen_sse2, _prim_mismatch_sse2, _prim_scan_sse2, _prim_hash_stripes_sse2},
+    [FASTER_SIMD_AVX2] = {_prim_strlen_avx2, _prim_mismatch_avx2, _prim_scan_avx2, _prim_hash_stripes_avx2},
+    [FASTER_SIMD_AVX512] = {_prim_strlen_avx512, _prim_mismatch_avx512, _prim_scan_avx512, _prim_hash_stripes_avx512},
+#endif
+};
+
+// scalar until the startup detection ran, so code running ahead of it still works
+static _Atomic faster_simd_level_t _prim_level = FASTER_SIMD_SCALAR;
+
+static faster_simd_level_t _prim_supported(void) {
+#ifdef _PRIM_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    return FASTER_SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return FASTER_SIMD_AVX2;
+  if (__builtin_cpu_supports("sse2"))
+    return FASTER_SIMD_SSE2;
+#endif
+  return FASTER_SIMD_SCALAR;
+}
+
+__attribute__((constructor)) static void _prim_detect(void) { atomic_store(&_prim_level, _prim_supported()); }
+
+faster_simd_level_t faster_simd_level(void) { return atomic_load_explicit(&_prim_level, memory_order_relaxed); }
+
+faster_simd_level_t faster_simd_select(const faster_simd_level_t level) {
+  faster_simd_level_t supported = _prim_supported();
+  faster_simd_level_t selected = (level < supported) ? level : supported;
+  atomic_store(&_prim_level, selected);
+  return selected;
+}
+
+static inline const struct _prim_kernels_s *_prim_kernels_current(void) { return &_prim_kernels[faster_simd_level()]; }
+
+faster_error_code_t faster_prim_set_init(faster_prim_set_t *set, const fchar_t *chars, const size_t count) {
+  set->ascii[0] = set->ascii[1] = 0;
+  set->ranges = 0;
+  // insertion into the sorted ranges, merging neighbours
+  for (size_t i = 0; i < count; i++) {
+    faster_prim_unit_t unit = (faster_prim_unit_t)chars[i];
+    if (unit < 0x80)
+      set->ascii[unit >> 6] |= (uint64_t)1 << (unit & 63);
+    unsigned int at = 0;
+    while (at < set->ranges && set->high[at] < unit && set->high[at] + 1 != unit)
+      at++;
+    if (at < set->ranges && unit >= set->low[at] && unit <= set->high[at])
+      continue;
+    if (at < set->ranges && set->high[at] + 1 == unit) {
+      set->high[at] = unit;
+      if (at + 1 < set->ranges && set->low[at + 1] == unit + 1) {
+        set->high[at] = set->high[at + 1];
+        memmove(set->low + at + 1, set->low + at + 2, (set->ranges - at - 2) * sizeof(faster_prim_unit_t));
+        memmove(set->high + at + 1, set->high + at + 2, (set->ranges - at - 2) * sizeof(faster_prim_unit_t));
+        set->ranges--;
+      }
+    } else if (at < set->ranges && set->low[at] == unit + 1) {
+      set->low[at] = unit;
+    } else {
+      if (set->ranges == FASTER_PRIM_SET_RANGES)
+        return FAST_ERROR_GENERAL;
+      memmove(set->low + at + 1, set->low + at, (set->ranges - at) * sizeof(faster_prim_unit_t));
+      memmove(set->high + at + 1, set->high + at, (set->ranges - at) * sizeof(faster_prim_unit_t));
+      set->low[at] = set->high[at] = unit;
+      set->ranges++;
+    }
+  }
+  return FAST_ERROR_NONE;
+}
+
+size_t faster_prim_strlen(const fchar_t *str) { return _prim_kernels_current()->strlen(str); }
+
+size_t faster_prim_mismatch(const fchar_t *str1, const fchar_t *str2, const size_t len) {
+  return _prim_kernels_current()->mismatch((const unsigned char *)str1, (const unsigned char *)str2, len * _PRIM_UNIT_BYTES) /
+         _PRIM_UNIT_BYTES;
+}
+
+int faster_prim_compare(const fchar_t *str1, const fchar_t *str2, const size_t len) {
+  size_t bytes = len * _PRIM_UNIT_BYTES;
+  size_t at = _prim_kernels_current()->mismatch((const unsigned char *)str1, (const unsigned char *)str2, bytes);
+  if (at == bytes)
+    return 0;
+  return (int)((const unsigned char *)str1)[at] - (int)((const unsigned char *)str2)[at];
+}
+
+size_t faster_prim_find_first_of(const fchar_t *str, const size_t len, const faster_prim_set_t *set) {
+  return _prim_kernels_current()->scan((const faster_prim_unit_t *)str, len, set, true);
+}
+
+size_t faster_prim_span(const fchar_t *str, const size_t len, const faster_prim_set_t *set) {
+  return _prim_kernels_current()->scan((const faster_prim_unit_t *)str, len, set, false);
+}
+
+uint32_t faster_prim_hash(const void *data, const size_t bytes) {
+  const unsigned char *bytes_ptr = (const unsigned char *)data;
+  // Initialize the hash to a 'random' value
+  uint32_t h = _PRIM_MURMUR_SEED ^ (uint32_t)bytes;
+  size_t tail = bytes;
+  if (bytes >= FASTER_PRIM_HASH_STRIPED_MIN) {
+    uint32_t lanes[_PRIM_LANES];
+    for (size_t lane = 0; lane < _PRIM_LANES; lane++)
+      lanes[lane] = _PRIM_MURMUR_SEED + (uint32_t)lane * _PRIM_LANE_P1;
+    size_t stripes = bytes / FASTER_PRIM_HASH_STRIPE;
+    _prim_kernels_current()->hash_stripes(lanes, bytes_ptr, stripes);
+    for (size_t lane = 0; lane < _PRIM_LANES; lane++)
+      h = _prim_murmur_mix(h, lanes[lane]);
+    bytes_ptr += stripes * FASTER_PRIM_HASH_STRIPE;
+    tail -= stripes * FASTER_PRIM_HASH_STRIPE;
+  }
+  h = _prim_murmur(h, bytes_ptr, tail);
+
+  // Do a few final mixes of the hash to ensure the last few
+  // bytes are well-incorporated.
+  h ^= h >> 13;
+  h *= _PRIM_MURMUR_M;
+  h ^= h >> 15;
+  return h;
+}
@@ -0,0 +1,289 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "aster/faster_sort.h"
+
+// keys are compared as the significant bytes of their length, big-endian, followed by their bytes
+struct _sort_context_s {
+  faster_str_t *strs;
+  // 8 bytes of the virtual key of every key, indexed like strs: the passes read their digits from here
+  // and only go back to the key bytes once every 8 passes
+  uint64_t *cache;
+  size_t length_digits;
+};
+#define _SORT_NO_BLOCK SIZE_MAX
+
+// digit of the virtual key at depth, -1 past its end
+static inline int _sort_digit(const struct _sort_context_s *ctx, const faster_str_t *str, const size_t depth) {
+  if (depth < ctx->length_digits)
+    return (int)((str->str_len >> (8 * (ctx->length_digits - 1 - depth))) & 0xff);
+  size_t position = depth - ctx->length_digits;
+  return (position < FASTER_STRING_MEMORY_SIZE(str->str_len)) ? ((const uint8_t *)str->str_ptr)[position] : -1;
+}
+
+// bytes [8 * block, 8 * block + 8) of the virtual key as a big-endian word, zero past its end
+static inline uint64_t _sort_load(const struct _sort_context_s *ctx, const faster_str_t *str, const size_t block) {
+  size_t first = 8 * block;
+  uint64_t word = 0;
+  if (first >= ctx->length_digits && first - ctx->length_digits + 8 <= FASTER_STRING_MEMORY_SIZE(str->str_len)) {
+    memcpy(&word, (const uint8_t *)str->str_ptr + (first - ctx->length_digits), 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+  }
+  for (size_t depth = first; depth < first + 8; depth++) {
+    int digit = _sort_digit(ctx, str, depth);
+    word = (word << 8) | (uint64_t)(digit < 0 ? 0 : digit);
+  }
+  return word;
+}
+
+static inline void _sort_swap(faster_str_t *str1, faster_str_t *str2) {
+  unsigned char tmp[sizeof(faster_str_t)];
+  memcpy(tmp, str1, sizeof(faster_str_t));
+  memcpy((void *)str1, str2, sizeof(faster_str_t));
+  memcpy((void *)str2, tmp, sizeof(faster_str_t));
+}
+
+static void _sort_swap_range(faster_str_t *strs1, faster_str_t *strs2, size_t count) {
+  while (count-- > 0)
+    _sort_swap(strs1++, strs2++);
+}
+
+static void _sort_insertion(faster_str_t *strs, const size_t count) {
+  unsigned char tmp[sizeof(faster_str_t)];
+  for (size_t i = 1; i < count; i++) {
+    size_t j = i;
+    memcpy(tmp, &strs[i], sizeof(faster_str_t));
+    while (j > 0 && faster_str_cmp_binary(&strs[j - 1], (const faster_str_t *)tmp) > 0) {
+      memcpy((void *)&strs[j], &strs[j - 1], sizeof(faster_str_t));
+      j--;
+    }
+    memcpy((void *)&strs[j], tmp, sizeof(faster_str_t));
+  }
+}
+
+// Bentley-Sedgewick three way partition on the digit at depth, keys share the virtual key before depth
+static void _sort_multikey(const struct _sort_context_s *ctx, faster_str_t *strs, size_t count, size_t depth) {
+  while (count > FASTER_SORT_INSERTION_MAX) {
+    // median of three as the pivot, moved to the front
+    size_t middle = count / 2;
+    int first = _sort_digit(ctx, &strs[0], depth);
+    int center = _sort_digit(ctx, &strs[middle], depth);
+    int last = _sort_digit(ctx, &strs[count - 1], depth);
+    size_t pivot_at = ((first < center) == (center < last)) ? middle : (((center < first) == (first < last)) ? 0 : count - 1);
+    _sort_swap(&strs[0], &strs[pivot_at]);
+    int pivot = _sort_digit(ctx, &strs[0], depth);
+
+    // equal keys gather at both ends, then move to the middle
+    size_t a = 1, b = 1, c = count - 1, d = count - 1;
+    for (;;) {
+      int digit;
+      while (b <= c && (digit = _sort_digit(ctx, &strs[b], depth)) <= pivot) {
+        if (digit == pivot)
+          _sort_swap(&strs[a++], &strs[b]);
+        b++;
+      }
+      while (b <= c && (digit = _sort_digit(ctx, &strs[c], depth)) >= pivot) {
+        if (digit == pivot)
+          _sort_swap(&strs[c], &strs[d--]);
+        c--;
+      }
+      if (b > c)
+        break;
+      _sort_swap(&strs[b++], &strs[c--]);
+    }
+    size_t moved = (a < b - a) ? a : b - a;
+    _sort_swap_range(strs, strs + b - moved, moved);
+    moved = (d - c < count - d - 1) ? d - c : count - d - 1;
+    _sort_swap_range(strs + b, strs + count - moved, moved);
+
+    size_t below = b - a;
+    size_t above = d - c;
+    _sort_multikey(ctx, strs, below, depth);
+    if (pivot >= 0)
+      _sort_multikey(ctx, strs + below, count - below - above, depth + 1);
+    strs += count - above;
+    count = above;
+  }
+  _sort_insertion(strs, count);
+}
+
+// one radix pass over [begin, end): skips the digits all keys share, then permutes the keys in place
+// into their buckets, bounded by starts; returns false when the keys are all equal
+static bool _sort_partition(const struct _sort_context_s *ctx, const size_t begin, const size_t end, size_t *depth,
+                            size_t *cached_block, size_t starts[257]) {
+  faster_str_t *strs = ctx->strs;
+  uint64_t *cache = ctx->cache;
+  for (;;) {
+    // past the length digits the keys of a bucket have the same length
+    if (*depth >= ctx->length_digits && *depth - ctx->length_digits >= FASTER_STRING_MEMORY_SIZE(strs[begin].str_len))
+      return false;
+    if (*cached_block != *depth / 8) {
+      *cached_block = *depth / 8;
+      for (size_t i = begin; i < end; i++)
+        cache[i] = _sort_load(ctx, &strs[i], *cached_block);
+    }
+    unsigned int shift = 8 * (7 - (unsigned int)(*depth % 8));
+    size_t counts[256] = {0};
+    for (size_t i = begin; i < end; i++)
+      counts[(cache[i] >> shift) & 0xff]++;
+    if (counts[(cache[begin] >> shift) & 0xff] == end - begin) {
+      (*depth)++;
+      continue;
+    }
+    size_t next[256];
+    starts[0] = begin;
+    for (int bucket = 0; bucket < 256; bucket++) {
+      next[bucket] = starts[bucket];
+      starts[bucket + 1] = starts[bucket] + counts[bucket];
+    }
+    // cycle every misplaced key to the next free slot of its bucket
+    for (unsigned int bucket = 0; bucket < 256; bucket++) {
+      while (next[bucket] < starts[bucket + 1]) {
+        size_t i = next[bucket];
+        unsigned int digit = (unsigned int)(cache[i] >> shift) & 0xff;
+        while (digit != bucket) {
+          size_t j = next[digit]++;
+          _sort_swap(&strs[i], &strs[j]);
+          uint64_t word = cache[i];
+          cache[i] = cache[j];
+          cache[j] = word;
+          digit = (unsigned int)(cache[i] >> shift) & 0xff;
+        }
+        next[bucket]++;
+      }
+    }
+    return true;
+  }
+}
+
+static void _sort_radix(const struct _sort_context_s *ctx, const size_t begin, const size_t end, size_t depth,
+                        size_t cached_block) {
+  if (end - begin < FASTER_SORT_RADIX_MIN) {
+    _sort_multikey(ctx, ctx->strs + begin, end - begin, depth);
+    return;
+  }
+  size_t starts[257];
+  if (!_sort_partition(ctx, begin, end, &depth, &cached_block, starts))
+    return;
+  for (int bucket = 0; bucket < 256; bucket++) {
+    if (starts[bucket + 1] - starts[bucket] > 1)
+      _sort_radix(ctx, starts[bucket], starts[bucket + 1], depth + 1, cached_block);
+  }
+}
+
+// the context for count keys, false when there is no memory for the key cache
+static bool _sort_context(struct _sort_context_s *ctx, faster_str_t *strs, const size_t count) {
+  size_t longest = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (strs[i].str_len > longest)
+      longest = strs[i].str_len;
+  }
+  ctx->strs = strs;
+  ctx->length_digits = 0;
+  while (longest > 0) {
+    ctx->length_digits++;
+    longest >>= 8;
+  }
+  ctx->cache = (count >= FASTER_SORT_RADIX_MIN) ? malloc(count * sizeof(uint64_t)) : NULL;
+  return ctx->cache != NULL;
+}
+
+void faster_str_sort(faster_str_t *strs, const size_t count) {
+  struct _sort_context_s ctx;
+  if (_sort_context(&ctx, strs, count)) {
+    _sort_radix(&ctx, 0, count, 0, _SORT_NO_BLOCK);
+  } else {
+    _sort_multikey(&ctx, strs, count, 0);
+  }
+  free(ctx.cache);
+}
+
+struct _sort_task_s {
+  size_t begin;
+  size_t end;
+  size_t depth;
+  size_t cached_block;
+};
+
+struct _sort_pool_s {
+  const struct _sort_context_s *ctx;
+  struct _sort_task_s *tasks;
+  size_t task_count;
+  atomic_size_t next_task;
+};
+
+static int _sort_worker(void *arg) {
+  struct _sort_pool_s *pool = (struct _sort_pool_s *)arg;
+  size_t task;
+  while ((task = atomic_fetch_add(&pool->next_task, 1)) < pool->task_count)
+    _sort_radix(pool->ctx, pool->tasks[task].begin, pool->tasks[task].end, pool->tasks[task].depth, pool->tasks[task].cached_block);
+  return 0;
+}
+
+static int _sort_task_cmp(const void *task1, const void *task2) {
+  size_t size1 = ((const struct _sort_task_s *)task1)->end - ((const struct _sort_task_s *)task1)->begin;
+  size_t size2 = ((const struct _sort_task_s *)task2)->end - ((const struct _sort_task_s *)task2)->begin;
+  return (size1 < size2) - (size1 > size2);
+}
+
+// the first passes run on the calling thread and split the keys into independent buckets until
+// none holds more than a fraction of the work, the workers then take the buckets largest first
+void faster_str_sort_parallel(faster_str_t *strs, const size_t count, const unsigned int threads) {
+  if (threads <= 1 || count < FASTER_SORT_PARALLEL_MIN) {
+    faster_str_sort(strs, count);
+    return;
+  }
+  struct _sort_context_s ctx;
+  size_t capacity = (size_t)threads * 64 + 257;
+  struct _sort_task_s *tasks = malloc(capacity * sizeof(struct _sort_task_s));
+  thrd_t *workers = malloc(threads * sizeof(thrd_t));
+  if (!_sort_context(&ctx, strs, count) || tasks == NULL || workers == NULL) {
+    free(ctx.cache);
+    free(tasks);
+    free(workers);
+    faster_str_sort(strs, count);
+    return;
+  }
+
+  size_t task_count = 1;
+  tasks[0] = (struct _sort_task_s){.begin = 0, .end = count, .depth = 0, .cached_block = _SORT_NO_BLOCK};
+  size_t small_enough = count / ((size_t)threads * 8);
+  while (task_count + 256 <= capacity) {
+    size_t largest = 0;
+    for (size_t i = 1; i < task_count; i++) {
+      if (tasks[i].end - tasks[i].begin > tasks[largest].end - tasks[largest].begin)
+        largest = i;
+    }
+    struct _sort_task_s split = tasks[largest];
+    if (split.end - split.begin <= small_enough || split.end - split.begin < FASTER_SORT_RADIX_MIN)
+      break;
+    tasks[largest] = tasks[--task_count];
+    size_t starts[257];
+    if (!_sort_partition(&ctx, split.begin, split.end, &split.depth, &split.cached_block, starts))
+      continue;
+    for (int bucket = 0; bucket < 256; bucket++) {
+      if (starts[bucket + 1] - starts[bucket] > 1)
+        tasks[task_count++] = (struct _sort_task_s){
+            .begin = starts[bucket], .end = starts[bucket + 1], .depth = split.depth + 1, .cached_block = split.cached_block};
+    }
+  }
+  qsort(tasks, task_count, sizeof(struct _sort_task_s), _sort_task_cmp);
+
+  struct _sort_pool_s pool = {.ctx = &ctx, .tasks = tasks, .task_count = task_count};
+  atomic_init(&pool.next_task, 0);
+  unsigned int started = 0;
+  while (started + 1 < threads && thrd_create(&workers[started], _sort_worker, &pool) == thrd_success)
+    started++;
+  _sort_worker(&pool);
+  for (unsigned int i = 0; i < started; i++)
+    thrd_join(workers[i], NULL);
+
+  free(ctx.cache);
+  free(tasks);
+  free(workers);
+}
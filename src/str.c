@@ -1,76 +1,857 @@
 #include "aster/faster_core.h"
+#include "aster/faster_prim.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define _STR_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// ASCII runs go through vector kernels: widen turns bytes into fchar_t, narrow the other way round.
+// Both take whole blocks for as long as every unit is in [1, 0x7F] and return the units done; src is aligned
+// to a block, so a load never crosses into a page past the terminator
+typedef size_t (*_str_widen_func_t)(const unsigned char *src, fchar_t *dest, const size_t units);
+typedef size_t (*_str_narrow_func_t)(const fchar_t *src, unsigned char *dest, const size_t units);
+// Mixed text goes through two more, from AVX2 on (they need a byte shuffle, SSE2 has none): valid checks
+// UTF-8 a block at a time with lookup tables, transcode turns blocks of 1- to 3-byte sequences into fchar_t
+// and leaves 4-byte sequences to the scalar decoder. Both stop at the first block with an error and return
+// at a sequence boundary, so the scalar code carries on where they stop
+typedef size_t (*_str_valid_func_t)(const unsigned char *src, const size_t len);
+typedef size_t (*_str_transcode_func_t)(const unsigned char *src, const size_t avail, size_t *consumed, fchar_t *dest,
+                                        const size_t room);
+
+struct _str_kernels_s {
+  size_t block; // units per step, the alignment of src is block * its unit size
+  _str_widen_func_t widen;
+  _str_narrow_func_t narrow;
+  _str_valid_func_t valid;
+  _str_transcode_func_t transcode; // src aligned to 32 bytes
+};
+
+#ifdef _STR_X86_KERNELS
+// the loads are aligned and stay within the page of the terminator, but may read past it
+#define _STR_KERNEL(isa) __attribute__((target(isa), no_sanitize_address))
+
+_STR_KERNEL("sse2") static size_t _str_widen_sse2(const unsigned char *src, fchar_t *dest, const size_t units) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t done = 0;
+  for (; done + 16 <= units; done += 16) {
+    __m128i bytes = _mm_load_si128((const __m128i *)(const void *)(src + done));
+    if ((_mm_movemask_epi8(bytes) | _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero))) != 0)
+      break;
+    __m128i *out = (__m128i *)(void *)(dest + done);
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+    _mm_storeu_si128(out, _mm_unpacklo_epi8(bytes, zero));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(bytes, zero));
+#elif FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_FOUR_BYTE
+    __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+    _mm_storeu_si128(out, _mm_unpacklo_epi16(low, zero));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, zero));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, zero));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, zero));
+#else
+    _mm_storeu_si128(out, bytes);
+#endif
+  }
+  return done;
+}
+
+_STR_KERNEL("sse2") static size_t _str_narrow_sse2(const fchar_t *src, unsigned char *dest, const size_t units) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t done = 0;
+  for (; done + 16 <= units; done += 16) {
+    const __m128i *in = (const __m128i *)(const void *)(src + done);
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+    __m128i units1 = _mm_load_si128(in), units2 = _mm_load_si128(in + 1);
+    __m128i outside = _mm_or_si128(_mm_and_si128(_mm_or_si128(units1, units2), _mm_set1_epi16((short)0xFF80)),
+                                   _mm_or_si128(_mm_cmpeq_epi16(units1, zero), _mm_cmpeq_epi16(units2, zero)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(outside, zero)) != 0xFFFF)
+      break;
+    __m128i bytes = _mm_packus_epi16(units1, units2);
+#elif FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_FOUR_BYTE
+    __m128i units1 = _mm_load_si128(in), units2 = _mm_load_si128(in + 1);
+    __m128i units3 = _mm_load_si128(in + 2), units4 = _mm_load_si128(in + 3);
+    __m128i any = _mm_or_si128(_mm_or_si128(units1, units2), _mm_or_si128(units3, units4));
+    __m128i nul = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(units1, zero), _mm_cmpeq_epi32(units2, zero)),
+                               _mm_or_si128(_mm_cmpeq_epi32(units3, zero), _mm_cmpeq_epi32(units4, zero)));
+    __m128i outside = _mm_or_si128(_mm_and_si128(any, _mm_set1_epi32((int)0xFFFFFF80)), nul);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(outside, zero)) != 0xFFFF)
+      break;
+    __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(units1, units2), _mm_packs_epi32(units3, units4));
+#else
+    __m128i bytes = _mm_load_si128(in);
+    if ((_mm_movemask_epi8(bytes) | _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero))) != 0)
+      break;
+#endif
+    _mm_storeu_si128((__m128i *)(void *)(dest + done), bytes);
+  }
+  return done;
+}
+
+_STR_KERNEL("avx2") static size_t _str_widen_avx2(const unsigned char *src, fchar_t *dest, const size_t units) {
+  const __m256i zero = _mm256_setzero_si256();
+  size_t done = 0;
+  for (; done + 32 <= units; done += 32) {
+    __m256i bytes = _mm256_load_si256((const __m256i *)(const void *)(src + done));
+    if ((_mm256_movemask_epi8(bytes) | _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, zero))) != 0)
+      break;
+    __m256i *out = (__m256i *)(void *)(dest + done);
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+    _mm256_storeu_si256(out, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+    _mm256_storeu_si256(out + 1, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+#elif FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_FOUR_BYTE
+    __m128i low = _mm256_castsi256_si128(bytes), high = _mm256_extracti128_si256(bytes, 1);
+    _mm256_storeu_si256(out, _mm256_cvtepu8_epi32(low));
+    _mm256_storeu_si256(out + 1, _mm256_cvtepu8_epi32(_mm_srli_si128(low, 8)));
+    _mm256_storeu_si256(out + 2, _mm256_cvtepu8_epi32(high));
+    _mm256_storeu_si256(out + 3, _mm256_cvtepu8_epi32(_mm_srli_si128(high, 8)));
+#else
+    _mm256_storeu_si256(out, bytes);
+#endif
+  }
+  return done;
+}
+
+_STR_KERNEL("avx2") static size_t _str_narrow_avx2(const fchar_t *src, unsigned char *dest, const size_t units) {
+  const __m256i zero = _mm256_setzero_si256();
+  size_t done = 0;
+  for (; done + 32 <= units; done += 32) {
+    const __m256i *in = (const __m256i *)(const void *)(src + done);
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+    __m256i units1 = _mm256_load_si256(in), units2 = _mm256_load_si256(in + 1);
+    __m256i outside = _mm256_or_si256(_mm256_and_si256(_mm256_or_si256(units1, units2), _mm256_set1_epi16((short)0xFF80)),
+                                      _mm256_or_si256(_mm256_cmpeq_epi16(units1, zero), _mm256_cmpeq_epi16(units2, zero)));
+    if (!_mm256_testz_si256(outside, outside))
+      break;
+    // the packs work within 128-bit lanes, the permutes put the lanes back in order
+    __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(units1, units2), 0xD8);
+#elif FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_FOUR_BYTE
+    __m256i units1 = _mm256_load_si256(in), units2 = _mm256_load_si256(in + 1);
+    __m256i units3 = _mm256_load_si256(in + 2), units4 = _mm256_load_si256(in + 3);
+    __m256i any = _mm256_or_si256(_mm256_or_si256(units1, units2), _mm256_or_si256(units3, units4));
+    __m256i nul = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi32(units1, zero), _mm256_cmpeq_epi32(units2, zero)),
+                                  _mm256_or_si256(_mm256_cmpeq_epi32(units3, zero), _mm256_cmpeq_epi32(units4, zero)));
+    __m256i outside = _mm256_or_si256(_mm256_and_si256(any, _mm256_set1_epi32((int)0xFFFFFF80)), nul);
+    if (!_mm256_testz_si256(outside, outside))
+      break;
+    __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(units1, units2), _mm256_packs_epi32(units3, units4));
+    bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+#else
+    __m256i bytes = _mm256_load_si256(in);
+    if ((_mm256_movemask_epi8(bytes) | _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, zero))) != 0)
+      break;
+#endif
+    _mm256_storeu_si256((__m256i *)(void *)(dest + done), bytes);
+  }
+  return done;
+}
+
+_STR_KERNEL("avx512f,avx512bw") static size_t _str_widen_avx512(const unsigned char *src, fchar_t *dest, const size_t units) {
+  size_t done = 0;
+  for (; done + 64 <= units; done += 64) {
+    __m512i bytes = _mm512_load_si512((const void *)(src + done));
+    if ((_mm512_movepi8_mask(bytes) | _mm512_testn_epi8_mask(bytes, bytes)) != 0)
+      break;
+    __m512i *out = (__m512i *)(void *)(dest + done);
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+    _mm512_storeu_si512(out, _mm512_cvtepu8_epi16(_mm512_castsi512_si256(bytes)));
+    _mm512_storeu_si512(out + 1, _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(bytes, 1)));
+#elif FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_FOUR_BYTE
+    _mm512_storeu_si512(out, _mm512_cvtepu8_epi32(_mm512_castsi512_si128(bytes)));
+    _mm512_storeu_si512(out + 1, _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(bytes, 1)));
+    _mm512_storeu_si512(out + 2, _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(bytes, 2)));
+    _mm512_storeu_si512(out + 3, _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(bytes, 3)));
+#else
+    _mm512_storeu_si512(out, bytes);
+#endif
+  }
+  return done;
+}
+
+_STR_KERNEL("avx512f,avx512bw") static size_t _str_narrow_avx512(const fchar_t *src, unsigned char *dest, const size_t units) {
+  size_t done = 0;
+  for (; done + 64 <= units; done += 64) {
+    const __m512i *in = (const __m512i *)(const void *)(src + done);
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+    __m512i units1 = _mm512_load_si512(in), units2 = _mm512_load_si512(in + 1);
+    const __m512i high = _mm512_set1_epi16((short)0xFF80);
+    if ((_mm512_test_epi16_mask(_mm512_or_si512(units1, units2), high) | _mm512_testn_epi16_mask(units1, units1) |
+         _mm512_testn_epi16_mask(units2, units2)) != 0)
+      break;
+    __m256i *out = (__m256i *)(void *)(dest + done);
+    _mm256_storeu_si256(out, _mm512_cvtepi16_epi8(units1));
+    _mm256_storeu_si256(out + 1, _mm512_cvtepi16_epi8(units2));
+#elif FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_FOUR_BYTE
+    __m512i units1 = _mm512_load_si512(in), units2 = _mm512_load_si512(in + 1);
+    __m512i units3 = _mm512_load_si512(in + 2), units4 = _mm512_load_si512(in + 3);
+    __m512i any = _mm512_or_si512(_mm512_or_si512(units1, units2), _mm512_or_si512(units3, units4));
+    if ((_mm512_test_epi32_mask(any, _mm512_set1_epi32((int)0xFFFFFF80)) | _mm512_testn_epi32_mask(units1, units1) |
+         _mm512_testn_epi32_mask(units2, units2) | _mm512_testn_epi32_mask(units3, units3) |
+         _mm512_testn_epi32_mask(units4, units4)) != 0)
+      break;
+    __m128i *out = (__m128i *)(void *)(dest + done);
+    _mm_storeu_si128(out, _mm512_cvtepi32_epi8(units1));
+    _mm_storeu_si128(out + 1, _mm512_cvtepi32_epi8(units2));
+    _mm_storeu_si128(out + 2, _mm512_cvtepi32_epi8(units3));
+    _mm_storeu_si128(out + 3, _mm512_cvtepi32_epi8(units4));
+#else
+    __m512i bytes = _mm512_load_si512(in);
+    if ((_mm512_movepi8_mask(bytes) | _mm512_testn_epi8_mask(bytes, bytes)) != 0)
+      break;
+    _mm512_storeu_si512((void *)(dest + done), bytes);
+#endif
+  }
+  return done;
+}
+
+// bytes at the end of the well-formed src[0, done) that start a sequence finished past done
+static inline size_t _str_utf8_tail(const unsigned char *src, const size_t done) {
+  if (done >= 1 && src[done - 1] >= 0xC0)
+    return 1;
+  if (done >= 2 && src[done - 2] >= 0xE0)
+    return 2;
+  if (done >= 3 && src[done - 3] >= 0xF0)
+    return 3;
+  return 0;
+}
+
+// Keiser and Lemire's lookup validation: the high and low nibble of a byte and the high nibble of the next one
+// index three tables whose common bits are the errors the pair shows; the second and third continuation a 3-
+// or 4-byte lead asks for are checked apart. An error is flagged at the byte where its sequence ends
+#define _STR_TOO_SHORT (1 << 0)
+#define _STR_TOO_LONG (1 << 1)
+#define _STR_OVERLONG_3 (1 << 2)
+#define _STR_TOO_LARGE (1 << 3)
+#define _STR_SURROGATE (1 << 4)
+#define _STR_OVERLONG_2 (1 << 5)
+#define _STR_TOO_LARGE_1000 (1 << 6)
+#define _STR_OVERLONG_4 (1 << 6)
+#define _STR_TWO_CONTS (1 << 7)
+#define _STR_CARRY (_STR_TOO_SHORT | _STR_TOO_LONG | _STR_TWO_CONTS)
+#define _STR_TABLE16_AVX2(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+// input moved up by n bytes, the last n of prev coming in
+#define _STR_PREV_AVX2(input, prev, n) _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - (n))
+
+_STR_KERNEL("avx2") static inline __m256i _str_utf8_errors_avx2(const __m256i input, const __m256i prev_input) {
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  __m256i prev1 = _STR_PREV_AVX2(input, prev_input, 1);
+  __m256i byte_1_high = _mm256_shuffle_epi8(
+      _STR_TABLE16_AVX2(_STR_TOO_LONG, _STR_TOO_LONG, _STR_TOO_LONG, _STR_TOO_LONG, _STR_TOO_LONG, _STR_TOO_LONG,
+                        _STR_TOO_LONG, _STR_TOO_LONG, (char)_STR_TWO_CONTS, (char)_STR_TWO_CONTS, (char)_STR_TWO_CONTS,
+                        (char)_STR_TWO_CONTS, _STR_TOO_SHORT | _STR_OVERLONG_2, _STR_TOO_SHORT,
+                        _STR_TOO_SHORT | _STR_OVERLONG_3 | _STR_SURROGATE,
+                        _STR_TOO_SHORT | _STR_TOO_LARGE | _STR_TOO_LARGE_1000 | _STR_OVERLONG_4),
+      _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+  __m256i byte_1_low = _mm256_shuffle_epi8(
+      _STR_TABLE16_AVX2((char)(_STR_CARRY | _STR_OVERLONG_3 | _STR_OVERLONG_2 | _STR_OVERLONG_4),
+                        (char)(_STR_CARRY | _STR_OVERLONG_2), (char)_STR_CARRY, (char)_STR_CARRY,
+                        (char)(_STR_CARRY | _STR_TOO_LARGE), (char)(_STR_CARRY | _STR_TOO_LARGE | _STR_TOO_LARGE_1000),
+                        (char)(_STR_CARRY | _STR_TOO_LARGE | _STR_TOO_LARGE_1000),
+                        (char)(_STR_CARRY | _STR_TOO_LARGE | _STR_TOO_LARGE_1000),
+                        (char)(_STR_CARRY | _STR_TOO_LARGE | _STR_TOO_LARGE_1000),
+                        (char)(_STR_CARRY | _STR_TOO_LARGE | _STR_TOO_LARGE_1000),
+                        (char)(_STR_CARRY | _STR_TOO_LARGE | _STR_TOO_LARGE_1000),
+                        (char)(_STR_CARRY | _STR_TOO_LARGE | _STR_TOO_LARGE_1000),
+                        (char)(_STR_CARRY | _STR_TOO_LARGE | _STR_TOO_LARGE_1000),
+                        (char)(_STR_CARRY | _STR_TOO_LARGE | _STR_TOO_LARGE_1000 | _STR_SURROGATE),
+                        (char)(_STR_CARRY | _STR_TOO_LARGE | _STR_TOO_LARGE_1000),
+                        (char)(_STR_CARRY | _STR_TOO_LARGE | _STR_TOO_LARGE_1000)),
+      _mm256_and_si256(prev1, nibble));
+  __m256i byte_2_high = _mm256_shuffle_epi8(
+      _STR_TABLE16_AVX2(_STR_TOO_SHORT, _STR_TOO_SHORT, _STR_TOO_SHORT, _STR_TOO_SHORT, _STR_TOO_SHORT, _STR_TOO_SHORT,
+                        _STR_TOO_SHORT, _STR_TOO_SHORT,
+                        (char)(_STR_TOO_LONG | _STR_OVERLONG_2 | _STR_TWO_CONTS | _STR_OVERLONG_3 | _STR_TOO_LARGE_1000 |
+                               _STR_OVERLONG_4),
+                        (char)(_STR_TOO_LONG | _STR_OVERLONG_2 | _STR_TWO_CONTS | _STR_OVERLONG_3 | _STR_TOO_LARGE),
+                        (char)(_STR_TOO_LONG | _STR_OVERLONG_2 | _STR_TWO_CONTS | _STR_SURROGATE | _STR_TOO_LARGE),
+                        (char)(_STR_TOO_LONG | _STR_OVERLONG_2 | _STR_TWO_CONTS | _STR_SURROGATE | _STR_TOO_LARGE),
+                        _STR_TOO_SHORT, _STR_TOO_SHORT, _STR_TOO_SHORT, _STR_TOO_SHORT),
+      _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+  __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+  // a byte two places behind a 3-byte lead or three behind a 4-byte lead must be a continuation, which the
+  // tables flagged as TWO_CONTS: the two cancel out
+  __m256i third = _mm256_subs_epu8(_STR_PREV_AVX2(input, prev_input, 2), _mm256_set1_epi8((char)(0xE0 - 0x80)));
+  __m256i fourth = _mm256_subs_epu8(_STR_PREV_AVX2(input, prev_input, 3), _mm256_set1_epi8((char)(0xF0 - 0x80)));
+  __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+  return _mm256_xor_si256(must23, special);
+}
+
+_STR_KERNEL("avx2") static size_t _str_valid_avx2(const unsigned char *src, const size_t len) {
+  __m256i prev_input = _mm256_setzero_si256();
+  size_t done = 0;
+  for (; done + 32 <= len; done += 32) {
+    __m256i input = _mm256_loadu_si256((const __m256i *)(const void *)(src + done));
+    __m256i errors = _str_utf8_errors_avx2(input, prev_input);
+    if (!_mm256_testz_si256(errors, errors))
+      break;
+    prev_input = input;
+  }
+  return done - _str_utf8_tail(src, done);
+}
+
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE || FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_FOUR_BYTE
+// the code point of a well-formed block without 4-byte sequences is put together at the last byte of each
+// sequence, in 16-bit lanes (low: bytes 0-15, high: bytes 16-31): the byte itself, the one before it and,
+// behind a 3-byte lead, the one before that; returns a bit for every byte that ends a sequence
+_STR_KERNEL("avx2") static inline uint32_t _str_code_points_avx2(const __m256i input, const __m256i prev_input, __m256i *low,
+                                                                 __m256i *high) {
+  __m256i prev1 = _STR_PREV_AVX2(input, prev_input, 1), prev2 = _STR_PREV_AVX2(input, prev_input, 2);
+  __m256i lead2 = _mm256_cmpeq_epi8(_mm256_and_si256(prev1, _mm256_set1_epi8((char)0xE0)), _mm256_set1_epi8((char)0xC0));
+  __m256i lead3 = _mm256_cmpeq_epi8(_mm256_and_si256(prev2, _mm256_set1_epi8((char)0xF0)), _mm256_set1_epi8((char)0xE0));
+  // ASCII ends its sequence, a continuation does behind a 2-byte lead or two places behind a 3-byte lead
+  uint32_t ends = ~(uint32_t)_mm256_movemask_epi8(input) | (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(lead2, lead3));
+  const __m256i payload = _mm256_set1_epi8(0x3F);
+  __m256i ascii = _mm256_cmpgt_epi8(input, _mm256_set1_epi8(-1));
+  __m256i byte0 = _mm256_blendv_epi8(_mm256_and_si256(input, payload), input, ascii);
+  __m256i byte1 = _mm256_andnot_si256(ascii, _mm256_and_si256(prev1, payload));
+  __m256i byte2 = _mm256_and_si256(lead3, _mm256_and_si256(prev2, _mm256_set1_epi8(0x0F)));
+  *low = _mm256_or_si256(_mm256_or_si256(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(byte0)),
+                                         _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(byte1)), 6)),
+                         _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(byte2)), 12));
+  *high = _mm256_or_si256(_mm256_or_si256(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(byte0, 1)),
+                                          _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(byte1, 1)), 6)),
+                          _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(byte2, 1)), 12));
+  return ends;
+}
+#endif
+
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE || FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_FOUR_BYTE
+// byte shuffles moving the 16-bit lanes a 4-bit mask selects to the front
+static const uint64_t _str_compact4[16] = {
+    0x8080808080808080ULL, 0x8080808080800100ULL, 0x8080808080800302ULL, 0x8080808003020100ULL,
+    0x8080808080800504ULL, 0x8080808005040100ULL, 0x8080808005040302ULL, 0x8080050403020100ULL,
+    0x8080808080800706ULL, 0x8080808007060100ULL, 0x8080808007060302ULL, 0x8080070603020100ULL,
+    0x8080808007060504ULL, 0x8080070605040100ULL, 0x8080070605040302ULL, 0x0706050403020100ULL};
+#endif
+
+// NUL ends a run, and so does a 4-byte lead where a sequence does not stay one unit
+_STR_KERNEL("avx2") static inline bool _str_transcode_stop_avx2(const __m256i input) {
+  __m256i stop = _mm256_cmpeq_epi8(input, _mm256_setzero_si256());
+#if FASTER_UNICODE_SUPPORT != FASTER_UNICODE_SUPPORT_ONE_BYTE
+  stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(_mm256_max_epu8(input, _mm256_set1_epi8((char)0xF0)), input));
+#endif
+  return !_mm256_testz_si256(stop, stop);
+}
 
 #if FASTER_UNICODE_SUPPORT != FASTER_UNICODE_SUPPORT_NONE
-// Convert multibyte string to Unicode (fchar_t)
-// return number of bytes written to dest
+_STR_KERNEL("avx2") static size_t _str_transcode_avx2(const unsigned char *src, const size_t avail, size_t *consumed,
+                                                      fchar_t *dest, const size_t room) {
+  __m256i prev_input = _mm256_setzero_si256();
+  size_t done = 0, written = 0;
+  for (; done + 32 <= avail && written + 32 <= room; done += 32) {
+    __m256i input = _mm256_load_si256((const __m256i *)(const void *)(src + done));
+    __m256i errors = _str_utf8_errors_avx2(input, prev_input);
+    if (_str_transcode_stop_avx2(input) || !_mm256_testz_si256(errors, errors))
+      break;
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_ONE_BYTE
+    // well-formed UTF-8 is its own one-byte form
+    _mm256_storeu_si256((__m256i *)(void *)(dest + written), input);
+    written += 32;
+#else
+    __m256i low, high;
+    uint32_t ends = _str_code_points_avx2(input, prev_input, &low, &high);
+    // the ends move to the front four lanes at a time, the lanes stored past them are overwritten next
+    __m128i quarters[4] = {_mm256_castsi256_si128(low), _mm256_extracti128_si256(low, 1), _mm256_castsi256_si128(high),
+                           _mm256_extracti128_si256(high, 1)};
+    for (int group = 0; group < 8; group++) {
+      __m128i lanes = (group & 1) ? _mm_srli_si128(quarters[group >> 1], 8) : quarters[group >> 1];
+      unsigned mask = (ends >> (4 * group)) & 0xF;
+      __m128i packed = _mm_shuffle_epi8(lanes, _mm_loadl_epi64((const __m128i *)(const void *)(_str_compact4 + mask)));
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+      _mm_storel_epi64((__m128i *)(void *)(dest + written), packed);
+#else
+      _mm_storeu_si128((__m128i *)(void *)(dest + written), _mm_cvtepu16_epi32(packed));
+#endif
+      written += (size_t)__builtin_popcount(mask);
+    }
+#endif
+    prev_input = input;
+  }
+  size_t tail = _str_utf8_tail(src, done);
+  *consumed = done - tail;
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_ONE_BYTE
+  written -= tail;
+#endif
+  return written;
+}
+#endif
+
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE || FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_FOUR_BYTE
+// as _str_transcode_avx2, the ends are packed together with a compress
+_STR_KERNEL("avx512f,avx512bw") static size_t _str_transcode_avx512(const unsigned char *src, const size_t avail,
+                                                                    size_t *consumed, fchar_t *dest, const size_t room) {
+  __m256i prev_input = _mm256_setzero_si256();
+  size_t done = 0, written = 0;
+  for (; done + 32 <= avail && written + 32 <= room; done += 32) {
+    __m256i input = _mm256_load_si256((const __m256i *)(const void *)(src + done));
+    __m256i errors = _str_utf8_errors_avx2(input, prev_input);
+    if (_str_transcode_stop_avx2(input) || !_mm256_testz_si256(errors, errors))
+      break;
+    __m256i halves[2];
+    uint32_t ends = _str_code_points_avx2(input, prev_input, halves, halves + 1);
+    for (int half = 0; half < 2; half++) {
+      __mmask16 mask = (__mmask16)(ends >> (16 * half));
+      __m512i units = _mm512_maskz_compress_epi32(mask, _mm512_cvtepu16_epi32(halves[half]));
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+      _mm256_storeu_si256((__m256i *)(void *)(dest + written), _mm512_cvtepi32_epi16(units));
+#else
+      _mm512_storeu_si512((void *)(dest + written), units);
+#endif
+      written += (size_t)__builtin_popcount(mask);
+    }
+    prev_input = input;
+  }
+  *consumed = done - _str_utf8_tail(src, done);
+  return written;
+}
+#define _STR_TRANSCODE_AVX512 _str_transcode_avx512
+#elif FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_ONE_BYTE
+#define _STR_TRANSCODE_AVX512 _str_transcode_avx2
+#endif
+#endif // _STR_X86_KERNELS
+
+static const struct _str_kernels_s _str_kernels[] = {
+    [FASTER_SIMD_SCALAR] = {0, NULL, NULL, NULL, NULL},
+#ifdef _STR_X86_KERNELS
+#if FASTER_UNICODE_SUPPORT != FASTER_UNICODE_SUPPORT_NONE
+    [FASTER_SIMD_SSE2] = {16, _str_widen_sse2, _str_narrow_sse2, NULL, NULL},
+    [FASTER_SIMD_AVX2] = {32, _str_widen_avx2, _str_narrow_avx2, _str_valid_avx2, _str_transcode_avx2},
+    [FASTER_SIMD_AVX512] = {64, _str_widen_avx512, _str_narrow_avx512, _str_valid_avx2, _STR_TRANSCODE_AVX512},
+#else
+    // bytes pass through unchanged, there is nothing to transcode
+    [FASTER_SIMD_SSE2] = {16, _str_widen_sse2, _str_narrow_sse2, NULL, NULL},
+    [FASTER_SIMD_AVX2] = {32, _str_widen_avx2, _str_narrow_avx2, _str_valid_avx2, NULL},
+    [FASTER_SIMD_AVX512] = {64, _str_widen_avx512, _str_narrow_avx512, _str_valid_avx2, NULL},
+#endif
+#endif
+};
+
+static inline const struct _str_kernels_s *_str_kernels_current(void) { return &_str_kernels[faster_simd_level()]; }
+
+static inline bool _str_kernel_aligned(const void *src, const size_t block_bytes) {
+  return ((uintptr_t)src & (block_bytes - 1)) == 0;
+}
+
+#define _STR_INCOMPLETE ((size_t)-1)
+
+// length of the well-formed UTF-8 sequence at src (RFC 3629: no overlongs, surrogates or code points above U+10FFFF),
+// 0 when there is none, _STR_INCOMPLETE when the avail bytes are the start of one; the bytes after a mismatch
+// are not read, so a terminator ends the sequence safely
+static inline size_t _str_utf8_decode(const unsigned char *src, const size_t avail, uint_least32_t *code) {
+  unsigned char lead = src[0];
+  if (lead < 0x80) {
+    *code = lead;
+    return 1;
+  }
+  size_t len;
+  uint_least32_t value;
+  unsigned char low = 0x80, high = 0xBF; // range of the second byte
+  if (lead < 0xC2) {
+    return 0;
+  } else if (lead < 0xE0) {
+    len = 2;
+    value = lead & 0x1F;
+  } else if (lead < 0xF0) {
+    len = 3;
+    value = lead & 0x0F;
+    low = (lead == 0xE0) ? 0xA0 : 0x80;
+    high = (lead == 0xED) ? 0x9F : 0xBF;
+  } else if (lead < 0xF5) {
+    len = 4;
+    value = lead & 0x07;
+    low = (lead == 0xF0) ? 0x90 : 0x80;
+    high = (lead == 0xF4) ? 0x8F : 0xBF;
+  } else {
+    return 0;
+  }
+  for (size_t at = 1; at < len; at++, low = 0x80, high = 0xBF) {
+    if (at == avail)
+      return _STR_INCOMPLETE;
+    if (src[at] < low || src[at] > high)
+      return 0;
+    value = (value << 6) | (src[at] & 0x3F);
+  }
+  *code = value;
+  return len;
+}
+
+// the valid kernel takes the blocks it can, then ASCII goes eight bytes at a time and the decoder sees the rest
+size_t faster_utf8_valid(const char *src, size_t len) {
+  const struct _str_kernels_s *kernels = _str_kernels_current();
+  const unsigned char *ptr = (const unsigned char *)src;
+  const unsigned char *end = ptr + len;
+  if (kernels->valid != NULL)
+    ptr += kernels->valid(ptr, len);
+  while (ptr < end) {
+    uint64_t word;
+    if (end - ptr >= 8 && (memcpy(&word, ptr, sizeof(word)), (word & 0x8080808080808080u) == 0)) {
+      ptr += 8;
+      continue;
+    }
+    uint_least32_t code;
+    size_t units = _str_utf8_decode(ptr, (size_t)(end - ptr), &code);
+    if (units == 0 || units == _STR_INCOMPLETE)
+      break;
+    ptr += units;
+  }
+  return (size_t)(ptr - (const unsigned char *)src);
+}
+
+#if FASTER_UNICODE_SUPPORT != FASTER_UNICODE_SUPPORT_NONE
+static inline size_t _str_utf8_encode(const uint_least32_t code, unsigned char *dest) {
+  if (code < 0x80) {
+    dest[0] = (unsigned char)code;
+    return 1;
+  }
+  if (code < 0x800) {
+    dest[0] = (unsigned char)(0xC0 | (code >> 6));
+    dest[1] = (unsigned char)(0x80 | (code & 0x3F));
+    return 2;
+  }
+  if (code < 0x10000) {
+    dest[0] = (unsigned char)(0xE0 | (code >> 12));
+    dest[1] = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+    dest[2] = (unsigned char)(0x80 | (code & 0x3F));
+    return 3;
+  }
+  dest[0] = (unsigned char)(0xF0 | (code >> 18));
+  dest[1] = (unsigned char)(0x80 | ((code >> 12) & 0x3F));
+  dest[2] = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+  dest[3] = (unsigned char)(0x80 | (code & 0x3F));
+  return 4;
+}
+
+// code point at src from avail units: the units it takes, 0 for a unit that is dropped (unpaired surrogates,
+// values above U+10FFFF, broken UTF-8), _STR_INCOMPLETE when the avail units are the start of one
+static inline size_t _str_unicode_decode(const fchar_t *src, const size_t avail, uint_least32_t *code) {
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_ONE_BYTE
+  return _str_utf8_decode((const unsigned char *)src, avail, code);
+#elif FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+  *code = src[0];
+  if (*code < 0xD800 || *code >= 0xE000)
+    return 1;
+  if (*code >= 0xDC00)
+    return 0;
+  if (avail < 2)
+    return _STR_INCOMPLETE;
+  if (src[1] < 0xDC00 || src[1] >= 0xE000)
+    return 0;
+  *code = 0x10000 + ((*code - 0xD800) << 10) + ((uint_least32_t)src[1] - 0xDC00);
+  return 2;
+#else
+  (void)avail;
+  *code = src[0];
+  return ((*code >= 0xD800 && *code < 0xE000) || *code > 0x10FFFF) ? 0 : 1;
+#endif
+}
+
+// the units of code, or nothing when they do not fit into room
+static inline size_t _str_unicode_encode(const uint_least32_t code, fchar_t *dest, const size_t room) {
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_ONE_BYTE
+  unsigned char bytes[4];
+  size_t len = _str_utf8_encode(code, bytes);
+  if (room < len)
+    return 0;
+  memcpy(dest, bytes, len);
+  return len;
+#elif FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_TWO_BYTE
+  if (code >= 0x10000) {
+    // surrogate pair
+    if (room < 2)
+      return 0;
+    dest[0] = (fchar_t)(0xD800 + ((code - 0x10000) >> 10));
+    dest[1] = (fchar_t)(0xDC00 + ((code - 0x10000) & 0x3FF));
+    return 2;
+  }
+  if (room < 1)
+    return 0;
+  dest[0] = (fchar_t)code;
+  return 1;
+#else
+  if (room < 1)
+    return 0;
+  dest[0] = (fchar_t)code;
+  return 1;
+#endif
+}
+
+// Convert UTF-8 string to Unicode (fchar_t), every byte that does not start a well-formed sequence
+// becomes a replacement character; sequences are never split at the end of dest
+// return number of units written to dest
 size_t faster_mb_to_unicode(const char *src, fchar_t *_dest, size_t dest_size) {
   if (!src || !_dest || dest_size == 0)
     return 0;
 
-  mbstate_t state = {0};
-  const char *ptr = src;
-  const char *end = src + strlen(src);
-  size_t rc;
+  const struct _str_kernels_s *kernels = _str_kernels_current();
+  const unsigned char *ptr = (const unsigned char *)src;
   fchar_t *dest = _dest;
-  dest_size--; // leave space for null terminator
-  while ((rc = FASTER_UNICODE_MB_TO_UC_FUNC(dest, ptr, ((size_t)(end - ptr)) + 1, &state))) {
-    if (rc == (size_t)-3) {
-      // earlier surrogate pair
-      dest++;
-    } else if (rc == (size_t)-2) {
+  fchar_t *limit = _dest + dest_size - 1; // leave space for null terminator
+  while (dest < limit) {
+    if (kernels->widen != NULL && _str_kernel_aligned(ptr, kernels->block)) {
+      size_t done = kernels->widen(ptr, dest, (size_t)(limit - dest));
+      ptr += done;
+      dest += done;
+      if (dest >= limit)
+        break;
+      // stopped at a block with more than ASCII
+      if (kernels->transcode != NULL) {
+        dest += kernels->transcode(ptr, SIZE_MAX, &done, dest, (size_t)(limit - dest));
+        ptr += done;
+        if (dest >= limit)
+          break;
+      }
+    }
+    if (*ptr < 0x80) {
+      if (*ptr == 0)
+        break;
+      *dest++ = (fchar_t)*ptr++;
       continue;
-    } else if (rc == (size_t)-1) {
-// error, store replacement character if possible and reset state
+    }
+    uint_least32_t code;
+    size_t len = _str_utf8_decode(ptr, 4, &code);
+    if (len == 0) {
+// store replacement character if possible
 #if FASTER_UNICODE_SUPPORT_ONE_BYTE == FASTER_UNICODE_SUPPORT
       static const size_t _faster_invalid_character_len_runtime = sizeof(FASTER_UNICODE_SUPPORT_INVALID_CHARACTER_STRING_UTF8) - 1;
-      if (dest + _faster_invalid_character_len_runtime < _dest + dest_size) {
-        strncpy((char *)dest, FASTER_UNICODE_SUPPORT_INVALID_CHARACTER_STRING_UTF8, _faster_invalid_character_len_runtime);
+      if (dest + _faster_invalid_character_len_runtime < limit) {
+        memcpy(dest, FASTER_UNICODE_SUPPORT_INVALID_CHARACTER_STRING_UTF8, _faster_invalid_character_len_runtime);
         dest += _faster_invalid_character_len_runtime;
       }
 #else
-      *dest = FASTER_UNICODE_SUPPORT_INVALID_CHARACTER_VALUE;
-      dest++;
+      *dest++ = FASTER_UNICODE_SUPPORT_INVALID_CHARACTER_VALUE;
 #endif
       ptr++;
-      memset(&state, 0, sizeof(state));
-    } else {
-      // valid conversion
-      dest++;
-      ptr += rc;
+      continue;
     }
-    if (((size_t)(dest - _dest)) >= dest_size) {
-      // buffer overflow, null terminate and exit
+    size_t units = _str_unicode_encode(code, dest, (size_t)(limit - dest));
+    if (units == 0)
       break;
-    }
+    dest += units;
+    ptr += len;
   }
   *dest = '\0';
   return (size_t)(dest - _dest);
 }
 
-// Convert Unicode (fchar_t) to multibyte string
+// Convert Unicode (fchar_t) to UTF-8 string, units that are not well-formed (unpaired surrogates, values
+// above U+10FFFF, broken UTF-8) are dropped; sequences are never split at the end of dest
 // return number of bytes written to dest
-size_t faster_unicode_to_mb(const fchar_t *src, char *dest, size_t dest_size) {
-  if (!src || !dest || dest_size == 0)
+size_t faster_unicode_to_mb(const fchar_t *src, char *_dest, size_t dest_size) {
+  if (!src || !_dest || dest_size == 0)
     return 0;
 
-  mbstate_t ps = {0};
+  const struct _str_kernels_s *kernels = _str_kernels_current();
   const fchar_t *ptr = src;
-  const fchar_t *end = src + faster_strlen(src);
-  size_t rc;
-  char *dest_start = dest;
-  dest_size--; // leave space for null terminator
-  while (ptr < end) {
-    rc = FASTER_UNICODE_UC_TO_MB_FUNC(dest, *(ptr++), &ps);
-    if (rc != (size_t)-1) {
-      dest += rc;
+  unsigned char *dest = (unsigned char *)_dest;
+  unsigned char *limit = dest + dest_size - 1; // leave space for null terminator
+  while (dest < limit) {
+    if (kernels->narrow != NULL && _str_kernel_aligned(ptr, kernels->block * sizeof(fchar_t))) {
+      size_t done = kernels->narrow(ptr, dest, (size_t)(limit - dest));
+      ptr += done;
+      dest += done;
+      if (dest >= limit)
+        break;
     }
-    if (((size_t)(dest - dest_start)) >= dest_size) {
-      // buffer overflow, null terminate and exit
-      break;
+    uint_least32_t code = (uint_least32_t)*ptr;
+    if (code < 0x80) {
+      if (code == 0)
+        break;
+      *dest++ = (unsigned char)code;
+      ptr++;
+      continue;
+    }
+    size_t units = _str_unicode_decode(ptr, 4, &code);
+    if (units == 0) {
+      ptr++;
+      continue;
     }
+    unsigned char bytes[4];
+    size_t len = _str_utf8_encode(code, bytes);
+    if ((size_t)(limit - dest) < len)
+      break;
+    memcpy(dest, bytes, len);
+    dest += len;
+    ptr += units;
   }
   *dest = '\0';
-  return (size_t)(dest - dest_start);
+  return (size_t)(dest - (unsigned char *)_dest);
+}
+
+// the replacement character, or nothing when it does not fit into room
+static inline size_t _str_unicode_invalid(fchar_t *dest, const size_t room) {
+  return _str_unicode_encode(FASTER_UNICODE_SUPPORT_INVALID_CHARACTER_VALUE, dest, room);
+}
+
+void faster_mb_stream_init(faster_mb_stream_t *stream) { stream->pending_len = 0; }
+
+size_t faster_mb_stream_to_unicode(faster_mb_stream_t *stream, const char *src, size_t src_len, size_t *consumed, fchar_t *_dest,
+                                   size_t dest_size, bool last) {
+  const unsigned char *ptr = (const unsigned char *)src;
+  const unsigned char *end = ptr + src_len;
+  fchar_t *dest = _dest;
+  fchar_t *limit = _dest + dest_size;
+  // the sequence cut by the previous chunk goes first, completed from the head of this one
+  while (stream->pending_len > 0) {
+    unsigned char window[4];
+    size_t have = stream->pending_len;
+    size_t take = ((size_t)(end - ptr) < 4 - have) ? (size_t)(end - ptr) : 4 - have;
+    memcpy(window, stream->pending, have);
+    memcpy(window + have, ptr, take);
+    uint_least32_t code = 0;
+    size_t len = _str_utf8_decode(window, have + take, &code);
+    if (len == _STR_INCOMPLETE && !last) {
+      // still cut, the whole chunk belongs to it
+      memcpy(stream->pending + have, ptr, take);
+      stream->pending_len = (unsigned char)(have + take);
+      ptr += take;
+      break;
+    }
+    if (len == 0 || len == _STR_INCOMPLETE) {
+      // the lead byte is replaced, the bytes after it start over
+      size_t units = _str_unicode_invalid(dest, (size_t)(limit - dest));
+      if (units == 0)
+        break;
+      dest += units;
+      memmove(stream->pending, stream->pending + 1, have - 1);
+      stream->pending_len--;
+      continue;
+    }
+    size_t units = _str_unicode_encode(code, dest, (size_t)(limit - dest));
+    if (units == 0)
+      break;
+    dest += units;
+    ptr += len - have;
+    stream->pending_len = 0;
+  }
+
+  const struct _str_kernels_s *kernels = _str_kernels_current();
+  while (stream->pending_len == 0 && ptr < end && dest < limit) {
+    if (kernels->widen != NULL && _str_kernel_aligned(ptr, kernels->block)) {
+      size_t room = (size_t)(limit - dest), left = (size_t)(end - ptr);
+      size_t done = kernels->widen(ptr, dest, (room < left) ? room : left);
+      ptr += done;
+      dest += done;
+      if (ptr == end || dest == limit)
+        break;
+      if (kernels->transcode != NULL) {
+        dest += kernels->transcode(ptr, (size_t)(end - ptr), &done, dest, (size_t)(limit - dest));
+        ptr += done;
+        if (ptr == end || dest == limit)
+          break;
+      }
+    }
+    if (*ptr < 0x80) {
+      *dest++ = (fchar_t)*ptr++;
+      continue;
+    }
+    uint_least32_t code = 0;
+    size_t len = _str_utf8_decode(ptr, (size_t)(end - ptr), &code);
+    if (len == _STR_INCOMPLETE && !last) {
+      stream->pending_len = (unsigned char)(end - ptr);
+      memcpy(stream->pending, ptr, stream->pending_len);
+      ptr = end;
+      break;
+    }
+    size_t units;
+    if (len == 0 || len == _STR_INCOMPLETE) {
+      units = _str_unicode_invalid(dest, (size_t)(limit - dest));
+      len = 1;
+    } else {
+      units = _str_unicode_encode(code, dest, (size_t)(limit - dest));
+    }
+    if (units == 0)
+      break;
+    dest += units;
+    ptr += len;
+  }
+  *consumed = (size_t)(ptr - (const unsigned char *)src);
+  return (size_t)(dest - _dest);
+}
+
+void faster_unicode_stream_init(faster_unicode_stream_t *stream) { stream->pending_len = 0; }
+
+size_t faster_unicode_stream_to_mb(faster_unicode_stream_t *stream, const fchar_t *src, size_t src_len, size_t *consumed,
+                                   char *_dest, size_t dest_size, bool last) {
+  const fchar_t *ptr = src;
+  const fchar_t *end = src + src_len;
+  unsigned char *dest = (unsigned char *)_dest;
+  unsigned char *limit = dest + dest_size;
+  unsigned char bytes[4];
+  while (stream->pending_len > 0) {
+    fchar_t window[4];
+    size_t have = stream->pending_len;
+    size_t take = ((size_t)(end - ptr) < 4 - have) ? (size_t)(end - ptr) : 4 - have;
+    memcpy(window, stream->pending, have * sizeof(fchar_t));
+    memcpy(window + have, ptr, take * sizeof(fchar_t));
+    uint_least32_t code = 0;
+    size_t units = _str_unicode_decode(window, have + take, &code);
+    if (units == _STR_INCOMPLETE && !last) {
+      memcpy(stream->pending + have, ptr, take * sizeof(fchar_t));
+      stream->pending_len = (unsigned char)(have + take);
+      ptr += take;
+      break;
+    }
+    if (units == 0 || units == _STR_INCOMPLETE) {
+      // the first unit is dropped, the ones after it start over
+      memmove(stream->pending, stream->pending + 1, (have - 1) * sizeof(fchar_t));
+      stream->pending_len--;
+      continue;
+    }
+    size_t len = _str_utf8_encode(code, bytes);
+    if ((size_t)(limit - dest) < len)
+      break;
+    memcpy(dest, bytes, len);
+    dest += len;
+    ptr += units - have;
+    stream->pending_len = 0;
+  }
+
+  const struct _str_kernels_s *kernels = _str_kernels_current();
+  while (stream->pending_len == 0 && ptr < end && dest < limit) {
+    if (kernels->narrow != NULL && _str_kernel_aligned(ptr, kernels->block * sizeof(fchar_t))) {
+      size_t room = (size_t)(limit - dest), left = (size_t)(end - ptr);
+      size_t done = kernels->narrow(ptr, dest, (room < left) ? room : left);
+      ptr += done;
+      dest += done;
+      if (ptr == end || dest == limit)
+        break;
+    }
+    uint_least32_t code = (uint_least32_t)*ptr;
+    if (code < 0x80) {
+      *dest++ = (unsigned char)code;
+      ptr++;
+      continue;
+    }
+    size_t units = _str_unicode_decode(ptr, (size_t)(end - ptr), &code);
+    if (units == _STR_INCOMPLETE && !last) {
+      stream->pending_len = (unsigned char)(end - ptr);
+      memcpy(stream->pending, ptr, stream->pending_len * sizeof(fchar_t));
+      ptr = end;
+      break;
+    }
+    if (units == 0 || units == _STR_INCOMPLETE) {
+      ptr++;
+      continue;
+    }
+    size_t len = _str_utf8_encode(code, bytes);
+    if ((size_t)(limit - dest) < len)
+      break;
+    memcpy(dest, bytes, len);
+    dest += len;
+    ptr += units;
+  }
+  *consumed = (size_t)(ptr - src);
+  return (size_t)(dest - (unsigned char *)_dest);
+}
+
+uint_least32_t faster_str_decode(const fchar_t *str, size_t len, size_t *pos) {
+  uint_least32_t code;
+  size_t units = _str_unicode_decode(str + *pos, len - *pos, &code);
+  if (units == 0 || units == _STR_INCOMPLETE) {
+    *pos += 1;
+    return FASTER_UNICODE_SUPPORT_INVALID_CHARACTER_VALUE;
+  }
+  *pos += units;
+  return code;
 }
 
 #else
@@ -79,7 +860,13 @@ size_t faster_mb_to_unicode(const char *src, fchar_t *dest, size_t dest_size) {
   if (!dest || !src || dest_size == 0)
     return 0;
 
+  const struct _str_kernels_s *kernels = _str_kernels_current();
   for (; i < dest_size - 1 && src[i]; i++) {
+    if (kernels->widen != NULL && _str_kernel_aligned(src + i, kernels->block)) {
+      i += kernels->widen((const unsigned char *)src + i, dest + i, dest_size - 1 - i);
+      if (i == dest_size - 1 || src[i] == 0)
+        break;
+    }
     dest[i] = (unsigned char)src[i]; // Explicit cast for non-ASCII
   }
   dest[i] = '\0';
@@ -91,12 +878,47 @@ size_t faster_unicode_to_mb(const fchar_t *src, char *dest, size_t dest_size) {
   if (!dest || !src || dest_size == 0)
     return 0;
 
+  const struct _str_kernels_s *kernels = _str_kernels_current();
   for (; i < dest_size - 1 && src[i]; i++) {
+    if (kernels->narrow != NULL && _str_kernel_aligned(src + i, kernels->block)) {
+      i += kernels->narrow(src + i, (unsigned char *)dest + i, dest_size - 1 - i);
+      if (i == dest_size - 1 || src[i] == 0)
+        break;
+    }
     dest[i] = (char)(src[i] & 0xFF); // Truncate to byte
   }
   dest[i] = '\0';
   return i;
 }
+// without Unicode support every byte is a character and nothing is ever pending
+void faster_mb_stream_init(faster_mb_stream_t *stream) { stream->pending_len = 0; }
+
+size_t faster_mb_stream_to_unicode(faster_mb_stream_t *stream, const char *src, size_t src_len, size_t *consumed, fchar_t *dest,
+                                   size_t dest_size, bool last) {
+  (void)stream;
+  (void)last;
+  size_t count = (src_len < dest_size) ? src_len : dest_size;
+  memcpy(dest, src, count);
+  *consumed = count;
+  return count;
+}
+
+void faster_unicode_stream_init(faster_unicode_stream_t *stream) { stream->pending_len = 0; }
+
+size_t faster_unicode_stream_to_mb(faster_unicode_stream_t *stream, const fchar_t *src, size_t src_len, size_t *consumed,
+                                   char *dest, size_t dest_size, bool last) {
+  (void)stream;
+  (void)last;
+  size_t count = (src_len < dest_size) ? src_len : dest_size;
+  memcpy(dest, src, count);
+  *consumed = count;
+  return count;
+}
+
+uint_least32_t faster_str_decode(const fchar_t *str, size_t len, size_t *pos) {
+  (void)len;
+  return (unsigned char)str[(*pos)++];
+}
 #endif
 
 int faster_str_cmp_binary(const faster_str_t *str1, const faster_str_t *str2) {
@@ -105,18 +927,32 @@ int faster_str_cmp_binary(const faster_str_t *str1, const faster_str_t *str2) {
   } else if (str1->str_len < str2->str_len) {
     return -1;
   }
-  return memcmp(str1->str_ptr, str2->str_ptr, FASTER_STRING_MEMORY_SIZE(str1->str_len));
+  return faster_prim_compare(str1->str_ptr, str2->str_ptr, str1->str_len);
+}
+
+bool faster_sstr_init(faster_sstr_t *sstr, const faster_str_t *str) {
+  // the unused units and the fill stay zero, so equal strings have equal words
+  memset(sstr, 0, sizeof(*sstr));
+  if (str->str_len <= FASTER_SSTR_INLINE_UNITS) {
+    if (str->str_len > 0)
+      memcpy(sstr->units, str->str_ptr, FASTER_STRING_MEMORY_SIZE(str->str_len));
+    sstr->ref.tag = (unsigned char)(FASTER_SSTR_INLINE_TAG | str->str_len);
+  } else if (str->str_len <= FAST_LIMIT_INDEXING_MAX) {
+    sstr->ref.ptr = str->str_ptr;
+    sstr->ref.len = (faster_str_len_t)str->str_len;
+  } else {
+    // the length would be cut, the empty inline string is left instead
+    sstr->ref.tag = FASTER_SSTR_INLINE_TAG;
+    return false;
+  }
+  return true;
 }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wsign-conversion"
-size_t faster_strlen(const fchar_t *s) {
-  const fchar_t *p = s;
-  while (*p)
-    ++p;
-  return p - s; // no worries about overflow, as p is always greater than s
+uint32_t faster_sstr_hash(const faster_sstr_t *sstr) {
+  return faster_prim_hash(faster_sstr_ptr(sstr), FASTER_STRING_MEMORY_SIZE(faster_sstr_len(sstr)));
 }
-#pragma GCC diagnostic pop
+
+size_t faster_strlen(const fchar_t *s) { return faster_prim_strlen(s); }
 
 size_t faster_str_bytelen(const fchar_t *s) { return faster_strlen(s) * sizeof(fchar_t); }
 
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "aster/faster_art.h"
+#include "aster/faster_avl.h"
+#include <time.h>
+
+#define KEY_SIZE 64
+
+// dotted metric names sharing long prefixes, plus short keys that are prefixes of others
+static faster_str_t make_key(intptr_t number, fchar_t *aster_text) {
+  static const char *metrics[] = {"cpu.user", "cpu.system", "memory.rss", "disk.io.read", "disk.io.write", "net.rx"};
+  char str_ptr[KEY_SIZE];
+  switch (number % 4) {
+  case 0:
+    sprintf(str_ptr, "k%ld", number / 4);
+    break;
+  case 1:
+    sprintf(str_ptr, "org.cluster%ld.node%ld", number % 7, number / 4);
+    break;
+  default:
+    sprintf(str_ptr, "org.cluster%ld.node%ld.%s", number % 7, number / 24, metrics[(number / 4) % 6]);
+  }
+  faster_mb_to_unicode(str_ptr, aster_text, KEY_SIZE);
+  faster_str_t keyp = {aster_text, faster_strlen(aster_text)};
+  return keyp;
+}
+
+// byte order, a prefix of a key comes first
+static int byte_cmp(const faster_str_t *str1, const faster_str_t *str2) {
+  size_t bytes1 = FASTER_STRING_MEMORY_SIZE(str1->str_len);
+  size_t bytes2 = FASTER_STRING_MEMORY_SIZE(str2->str_len);
+  int cmp = memcmp(str1->str_ptr, str2->str_ptr, bytes1 < bytes2 ? bytes1 : bytes2);
+  return cmp ? cmp : (bytes1 > bytes2) - (bytes1 < bytes2);
+}
+
+static bool has_prefix(const faster_str_t *key, const faster_str_t *prefix) {
+  return key->str_len >= prefix->str_len &&
+         memcmp(key->str_ptr, prefix->str_ptr, FASTER_STRING_MEMORY_SIZE(prefix->str_len)) == 0;
+}
+
+// same keys and values as the reference tree, walked in byte order
+static bool check_tree(ARTreePtr art, AVLNodesTreePtr reference) {
+  faster_indexing_t count = 0;
+  faster_avl_tree_iterator_helper_t avl_it = FASTER_AVL_TREE_EMPTY_ITERATOR;
+  AVLNodeIndex node;
+  while ((node = AVL_iterator(reference, &avl_it)) != FASTER_AVL_NODE_INDEX_INVALID) {
+    if (ART_get(art, &reference->node_list.list[node].key) != reference->node_list.list[node].value)
+      return false;
+    count++;
+  }
+  if (count != art->elements)
+    return false;
+  faster_art_iterator_helper_t it = FASTER_ART_EMPTY_ITERATOR;
+  const faster_str_t *key = NULL;
+  const faster_str_t *previous = NULL;
+  faster_value_ptr value;
+  faster_indexing_t seen = 0;
+  while (ART_iterator(art, &it, &key, &value)) {
+    if ((previous && byte_cmp(previous, key) >= 0) || AVL_get(reference, (faster_str_ptr_t)key) != value)
+      return false;
+    previous = key;
+    seen++;
+  }
+  ART_iterator_free(&it);
+  return seen == count;
+}
+
+int main() {
+  DECLARE_ART_WITH_DYNAMIC_ALLOCATION(art, 256);
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(reference, 256);
+
+  srand(0);
+  int generation = RAND_MAX / 4000;
+  fchar_t(*texts)[KEY_SIZE] = calloc((size_t)generation + 1, sizeof(*texts));
+  faster_str_t *queries = calloc((size_t)generation, sizeof(faster_str_t));
+  for (int i = 0; i < (generation / 4); i++) {
+    intptr_t random_number = rand() % generation + 1;
+    faster_str_t keyp = make_key(random_number, texts[random_number]);
+    if (ART_insert_or_update(&art, &keyp, (faster_value_ptr)random_number) !=
+        AVL_insert_or_update(&reference, &keyp, (faster_value_ptr)random_number)) {
+      printf("ART insertion disagrees with the AVL tree\n");
+      return -1;
+    }
+  }
+  if (!check_tree(&art, &reference)) {
+    printf("ART broken after insertion\n");
+    return -1;
+  }
+
+  // lookups over present and absent keys
+  fchar_t(*query_texts)[KEY_SIZE] = calloc((size_t)generation, sizeof(*query_texts));
+  for (int i = 0; i < generation; i++) {
+    faster_str_t keyp = make_key(rand() % (generation + 100) + 1, query_texts[i]);
+    memcpy((void *)&queries[i], &keyp, sizeof(faster_str_t));
+  }
+  faster_indexing_t hits = 0;
+  clock_t start_time = clock();
+  for (int i = 0; i < generation; i++)
+    hits += AVL_get(&reference, &queries[i]) != NULL;
+  clock_t avl_time = clock() - start_time;
+  start_time = clock();
+  for (int i = 0; i < generation; i++)
+    hits -= ART_get(&art, &queries[i]) != NULL;
+  clock_t art_time = clock() - start_time;
+  if (hits != 0) {
+    printf("ART and AVL tree found different keys\n");
+    return -1;
+  }
+  printf("Average lookup time: %f useconds in the AVL tree, %f useconds in the ART\n",
+         ((double)avl_time / CLOCKS_PER_SEC) / generation * 1000000, ((double)art_time / CLOCKS_PER_SEC) / generation * 1000000);
+  printf("Memory: %zu bytes in the AVL tree, %zu bytes in the ART for %u keys\n",
+         (size_t)reference.node_list.list_header.array_capacity * sizeof(AVLNode_t), ART_memory_usage(&art), art.elements);
+
+  // prefix walks return exactly the matching keys, in order
+  const char *prefixes[] = {"org.cluster3.", "org.cluster3.node1", "org.cluster5.node42.cpu", "k1", "k", "org", "nothing", ""};
+  for (size_t p = 0; p < sizeof(prefixes) / sizeof(prefixes[0]); p++) {
+    fchar_t prefix_text[KEY_SIZE];
+    faster_mb_to_unicode(prefixes[p], prefix_text, KEY_SIZE);
+    faster_str_t prefix = {prefix_text, faster_strlen(prefix_text)};
+    faster_indexing_t expected = 0;
+    faster_avl_tree_iterator_helper_t avl_it = FASTER_AVL_TREE_EMPTY_ITERATOR;
+    AVLNodeIndex node;
+    while ((node = AVL_iterator(&reference, &avl_it)) != FASTER_AVL_NODE_INDEX_INVALID)
+      expected += has_prefix(&reference.node_list.list[node].key, &prefix);
+    faster_art_iterator_helper_t it = FASTER_ART_EMPTY_ITERATOR;
+    const faster_str_t *key = NULL;
+    const faster_str_t *previous = NULL;
+    faster_indexing_t walked = 0;
+    ART_seek_prefix(&art, &prefix, &it);
+    while (ART_iterator(&art, &it, &key, NULL)) {
+      if (!has_prefix(key, &prefix) || (previous && byte_cmp(previous, key) >= 0)) {
+        printf("ART prefix walk returned a wrong key for %s\n", prefixes[p]);
+        return -1;
+      }
+      previous = key;
+      walked++;
+    }
+    ART_iterator_free(&it);
+    if (walked != expected) {
+      printf("ART prefix walk for '%s' returned %u of %u keys\n", prefixes[p], walked, expected);
+      return -1;
+    }
+    printf("Prefix '%s': %u keys\n", prefixes[p], walked);
+  }
+
+  // removals shrink the nodes back
+  for (int i = 0; i < generation / 2; i++) {
+    intptr_t random_number = rand() % generation + 1;
+    fchar_t aster_text[KEY_SIZE];
+    faster_str_t keyp = make_key(random_number, aster_text);
+    if (ART_remove(&art, &keyp) != AVL_remove(&reference, &keyp)) {
+      printf("ART removal disagrees with the AVL tree\n");
+      return -1;
+    }
+  }
+  if (!check_tree(&art, &reference)) {
+    printf("ART broken after removal\n");
+    return -1;
+  }
+  for (intptr_t i = 1; i <= generation; i++) {
+    if (texts[i][0] == 0)
+      continue;
+    faster_str_t keyp = {texts[i], faster_strlen(texts[i])};
+    ART_remove(&art, &keyp);
+  }
+  if (art.elements != 0 || art.root != FASTER_ART_REF_NULL || ARTLeaf_t_arr_count(&art.leaves) != 0 ||
+      ARTNode4_t_arr_count(&art.node4_list) != 0 || ARTNode16_t_arr_count(&art.node16_list) != 0 ||
+      ARTNode48_t_arr_count(&art.node48_list) != 0 || ARTNode256_t_arr_count(&art.node256_list) != 0) {
+    printf("ART not empty after draining (%u elements)\n", art.elements);
+    return -1;
+  }
+  printf("Structure OK for ART\n");
+
+  ART_reset_and_free(&art);
+  AVL_reset_and_free(&reference);
+  free(texts);
+  free(queries);
+  free(query_texts);
+  return 0;
+}
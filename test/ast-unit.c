@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "aster/faster_ast.h"
+
+#define MAX_UNITS 32
+
+static faster_error_code_t tokenize(const char *text, faster_indexing_t *token_count) {
+  DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(token_array, faster_token_t, 16);
+  faster_ast_t ast = {.token_list = token_array, .runtime_state = {0}};
+  fchar_t units[MAX_UNITS];
+  size_t len = strlen(text);
+  for (size_t i = 0; i < len; i++)
+    units[i] = (fchar_t)text[i];
+  faster_str_t str = {units, len};
+  if (faster_ast_init(&ast) != FAST_AST_ERROR_NONE) {
+    return FAST_AST_ERROR_INVALID_STATE;
+  }
+  faster_error_code_t result = faster_tokenize(&ast, &str);
+  *token_count = faster_token_t_arr_count(&ast.token_list);
+  faster_interned_strings_free(&ast.interned_strings);
+  faster_token_t_arr_reset_and_free(&ast.token_list, 0);
+  return result;
+}
+
+// the same through the UTF-8 entry point, text of the last string token compared with its decoded content
+static faster_error_code_t tokenize_utf8(const char *text, faster_indexing_t *token_count, const char *expected) {
+  DECLARE_FAST_ARRAY_WITH_DYNAMIC_ALLOCATION(token_array, faster_token_t, 16);
+  faster_ast_t ast = {.token_list = token_array, .runtime_state = {0}};
+  if (faster_ast_init(&ast) != FAST_AST_ERROR_NONE) {
+    return FAST_AST_ERROR_INVALID_STATE;
+  }
+  faster_error_code_t result = faster_tokenize_utf8(&ast, text, strlen(text));
+  *token_count = faster_token_t_arr_count(&ast.token_list);
+  for (faster_indexing_t i = 0; expected != NULL && i < *token_count; i++) {
+    faster_token_t *token = &ast.token_list.list[i];
+    if (token->token_type == FAST_TOKEN_TYPE_STRING) {
+      fchar_t units[MAX_UNITS];
+      size_t len = faster_mb_to_unicode(expected, units, MAX_UNITS);
+      if (token->token_str.str_len != len || memcmp(token->token_str.str_ptr, units, FASTER_STRING_MEMORY_SIZE(len)) != 0) {
+        result = FAST_AST_ERROR_INVALID_STRING;
+      }
+    } else if (token->token_str.str_len != 1 ||
+               token->token_str.str_ptr[0] != (token->token_type == FAST_TOKEN_TYPE_ORP ? (fchar_t)'(' : (fchar_t)')')) {
+      result = FAST_AST_ERROR_INVALID_TOKEN;
+    }
+  }
+  faster_interned_strings_free(&ast.interned_strings);
+  faster_token_t_arr_reset_and_free(&ast.token_list, 0);
+  return result;
+}
+
+int main() {
+  // input ending between tokens reaches the list checks, the end of input is not a symbol
+  struct {
+    const char *text;
+    faster_indexing_t tokens;
+  } flat_cases[] = {{"()", 2}, {"( ) ", 2}, {" \n\t", 0}, {"(\"s\")", 3}};
+  for (size_t i = 0; i < sizeof(flat_cases) / sizeof(flat_cases[0]); i++) {
+    faster_indexing_t token_count = 0;
+    faster_error_code_t result = tokenize(flat_cases[i].text, &token_count);
+    if (result == FAST_AST_ERROR_INVALID_TOKEN || token_count != flat_cases[i].tokens) {
+      printf("Input \"%s\" gave error %d with %u tokens\n", flat_cases[i].text, result, (unsigned)token_count);
+      return -1;
+    }
+  }
+  // an unterminated string is still an invalid token
+  faster_indexing_t token_count = 0;
+  if (tokenize("(\"s", &token_count) != FAST_AST_ERROR_INVALID_TOKEN) {
+    printf("Unterminated string accepted\n");
+    return -1;
+  }
+
+  // the flat cases again as UTF-8, then string text beyond ASCII
+  for (size_t i = 0; i < sizeof(flat_cases) / sizeof(flat_cases[0]); i++) {
+    faster_error_code_t result = tokenize_utf8(flat_cases[i].text, &token_count, "s");
+    if (result == FAST_AST_ERROR_INVALID_TOKEN || result == FAST_AST_ERROR_INVALID_STRING ||
+        token_count != flat_cases[i].tokens) {
+      printf("UTF-8 input \"%s\" gave error %d with %u tokens\n", flat_cases[i].text, result, (unsigned)token_count);
+      return -1;
+    }
+  }
+  const char *multibyte = "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 (x)";
+  char text[MAX_UNITS * 2];
+  snprintf(text, sizeof(text), "( \"%s\" )", multibyte);
+  faster_error_code_t result = tokenize_utf8(text, &token_count, multibyte);
+  if (result == FAST_AST_ERROR_INVALID_TOKEN || result == FAST_AST_ERROR_INVALID_STRING || token_count != 3) {
+    printf("Multibyte string gave error %d with %u tokens\n", result, (unsigned)token_count);
+    return -1;
+  }
+  // broken UTF-8 is refused before any token is made
+  if (tokenize_utf8("(\"\xc3\")", &token_count, NULL) != FAST_AST_ERROR_INVALID_STRING || token_count != 0) {
+    printf("Invalid UTF-8 accepted\n");
+    return -1;
+  }
+
+  printf("Tokenizer OK\n");
+  return 0;
+}
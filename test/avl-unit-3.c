@@ -4,6 +4,22 @@
 #include "aster/faster_avl.h"
 #include <time.h>
 
+// recomputes heights bottom-up and checks the AVL balance, returns -1 on a broken subtree
+static int check_subtree(AVLNodesTreePtr tree, AVLNodeIndex node, faster_indexing_t *count) {
+  if (FASTER_AVL_NODE_INVALID(node))
+    return 0;
+  AVLNodePtr node_ptr = tree->node_list.list + node;
+  int left_height = check_subtree(tree, node_ptr->left, count);
+  int right_height = check_subtree(tree, node_ptr->right, count);
+  if (left_height < 0 || right_height < 0 || left_height - right_height > 1 || right_height - left_height > 1)
+    return -1;
+  int node_height = (left_height > right_height ? left_height : right_height) + 1;
+  if (node_height != node_ptr->height)
+    return -1;
+  (*count)++;
+  return node_height;
+}
+
 int main(int argc, char *argv[]) {
   DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(avl_tree, 256);
 
@@ -67,12 +83,20 @@ int main(int argc, char *argv[]) {
          "useconds\n",
          removal, generation / 2, avg_rem_time * 1000000);
 
+  faster_indexing_t checked_nodes = 0;
+  if (check_subtree(&avl_tree, avl_tree.root_node, &checked_nodes) < 0 ||
+      checked_nodes != avl_tree.node_list.list_header.array_internal) {
+    printf("AVL Tree unbalanced or with stale heights after removal\n");
+    return -1;
+  }
+
   faster_indexing_t found_counter = 0;
   faster_avl_tree_iterator_helper_t it = FASTER_AVL_TREE_EMPTY_ITERATOR;
   clock_t seek_start_time = clock();
   AVLNodeIndex node;
   while ((node = AVL_iterator(&avl_tree, &it)) != FASTER_AVL_NODE_INDEX_INVALID) {
-    faster_value_ptr tmp = AVL_get(&avl_tree, (const faster_str_ptr_t)&avl_tree.node_list.list[node].key);
+    faster_str_t key = AVL_node_key(avl_tree.node_list.list + node);
+    faster_value_ptr tmp = AVL_get(&avl_tree, &key);
     if (tmp != NULL) {
       found_counter++;
     }
@@ -100,6 +124,12 @@ int main(int argc, char *argv[]) {
     faster_str_t keyp = {aster_text, faster_strlen(aster_text)};
     AVL_insert_or_update(&avl_tree, &keyp, (faster_value_ptr)random_number + 1);
   }
+  checked_nodes = 0;
+  if (check_subtree(&avl_tree, avl_tree.root_node, &checked_nodes) < 0 ||
+      checked_nodes != avl_tree.node_list.list_header.array_internal) {
+    printf("AVL Tree unbalanced or with stale heights after reinsertion\n");
+    return -1;
+  }
   if (avl_tree.node_list.list_header.array_capacity > capacity_before_adding) {
     printf("AVL Tree resized unnecesarly\n");
     return -1;
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "aster/faster_avl.h"
+#include "aster/faster_prim.h"
+
+static faster_str_t make_key(intptr_t number, fchar_t *aster_text) {
+  char str_ptr[64];
+  sprintf(str_ptr, "key%ld", number);
+  faster_mb_to_unicode(str_ptr, aster_text, 64);
+  faster_str_t keyp = {aster_text, faster_strlen(aster_text)};
+  return keyp;
+}
+
+static bool has_prefix(const faster_str_t *key, const faster_str_t *prefix) {
+  return key->str_len >= prefix->str_len &&
+         memcmp(key->str_ptr, prefix->str_ptr, FASTER_STRING_MEMORY_SIZE(prefix->str_len)) == 0;
+}
+
+// node keys go through AVL_node_key, whichever form the nodes keep
+static int cmp_node_key(AVLNodesTreePtr tree, AVLNodeIndex node, const faster_str_t *key) {
+  faster_str_t node_key = AVL_node_key(tree->node_list.list + node);
+  return faster_str_cmp_binary(&node_key, key);
+}
+
+// the prefixed compare behind the node key comparisons has to agree with memcmp at every kernel level
+static bool check_cmp_prefixed(void) {
+  fchar_t units1[80], units2[80];
+  for (int level = FASTER_SIMD_SCALAR; level <= FASTER_SIMD_AVX512; level++) {
+    faster_simd_select((faster_simd_level_t)level);
+    for (int round = 0; round < 20000; round++) {
+      size_t len = (size_t)(rand() % 80);
+      for (size_t i = 0; i < len; i++)
+        units1[i] = units2[i] = (fchar_t)rand();
+      if (len > 0 && (round % 4) != 0)
+        units2[rand() % len] = (fchar_t)rand();
+      faster_str_t str1 = {units1, len}, str2 = {units2, len};
+      int expected = memcmp(units1, units2, FASTER_STRING_MEMORY_SIZE(len));
+      int got = faster_str_cmp_prefixed(&str1, faster_str_prefix(&str1), &str2, faster_str_prefix(&str2));
+      if ((expected > 0) != (got > 0) || (expected < 0) != (got < 0))
+        return false;
+    }
+  }
+  faster_simd_select(FASTER_SIMD_AVX512);
+  return true;
+}
+
+int main() {
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(avl_tree, 256);
+
+  srand(0);
+  if (!check_cmp_prefixed()) {
+    printf("faster_str_cmp_prefixed disagrees with memcmp\n");
+    return -1;
+  }
+  int generation = RAND_MAX / 4000;
+  fchar_t(*texts)[64] = calloc((size_t)generation + 1, sizeof(*texts));
+  for (int i = 0; i < (generation / 4); i++) {
+    intptr_t random_number = rand() % generation + 1;
+    faster_str_t keyp = make_key(random_number, texts[random_number]);
+    AVL_insert_or_update(&avl_tree, &keyp, (faster_value_ptr)random_number);
+  }
+
+  // the full walk gives the reference order
+  faster_indexing_t count = avl_tree.node_list.list_header.array_internal;
+  AVLNodeIndex *sorted = calloc(count, sizeof(AVLNodeIndex));
+  faster_avl_tree_iterator_helper_t it = FASTER_AVL_TREE_EMPTY_ITERATOR;
+  faster_indexing_t seen = 0;
+  AVLNodeIndex node;
+  while ((node = AVL_iterator(&avl_tree, &it)) != FASTER_AVL_NODE_INDEX_INVALID) {
+    faster_str_t node_key = AVL_node_key(avl_tree.node_list.list + node);
+    if (seen > 0 && cmp_node_key(&avl_tree, sorted[seen - 1], &node_key) >= 0) {
+      printf("AVL Tree walk out of order\n");
+      return -1;
+    }
+    sorted[seen++] = node;
+  }
+  if (seen != count) {
+    printf("AVL Tree walk visited %u of %u nodes\n", seen, count);
+    return -1;
+  }
+
+  for (int probe = 0; probe < 200; probe++) {
+    fchar_t from_text[64], to_text[64];
+    faster_str_t from = make_key(rand() % (generation + 10), from_text);
+    faster_str_t to = make_key(rand() % (generation + 10), to_text);
+    faster_indexing_t lower = 0;
+    while (lower < count && cmp_node_key(&avl_tree, sorted[lower], &from) < 0)
+      lower++;
+    faster_indexing_t upper = lower;
+    if (upper < count && cmp_node_key(&avl_tree, sorted[upper], &from) == 0)
+      upper++;
+    faster_indexing_t end = 0;
+    while (end < count && cmp_node_key(&avl_tree, sorted[end], &to) < 0)
+      end++;
+
+    AVL_seek_lower_bound(&avl_tree, &from, &it);
+    node = AVL_iterator(&avl_tree, &it);
+    if (node != (lower < count ? sorted[lower] : FASTER_AVL_NODE_INDEX_INVALID)) {
+      printf("AVL Tree lower bound mismatch\n");
+      return -1;
+    }
+    AVL_seek_upper_bound(&avl_tree, &from, &it);
+    node = AVL_iterator(&avl_tree, &it);
+    if (node != (upper < count ? sorted[upper] : FASTER_AVL_NODE_INDEX_INVALID)) {
+      printf("AVL Tree upper bound mismatch\n");
+      return -1;
+    }
+
+    // [from, to) forward and backward
+    faster_indexing_t expected = (end > lower) ? end - lower : 0;
+    faster_indexing_t walked = 0;
+    AVL_seek_range(&avl_tree, &from, &to, &it);
+    while ((node = AVL_iterator(&avl_tree, &it)) != FASTER_AVL_NODE_INDEX_INVALID) {
+      if (node != sorted[lower + walked++]) {
+        printf("AVL Tree range walk mismatch\n");
+        return -1;
+      }
+    }
+    if (walked != expected) {
+      printf("AVL Tree range walk returned %u of %u keys\n", walked, expected);
+      return -1;
+    }
+    walked = 0;
+    AVL_seek_reverse_range(&avl_tree, &from, &to, &it);
+    while ((node = AVL_iterator(&avl_tree, &it)) != FASTER_AVL_NODE_INDEX_INVALID) {
+      walked++;
+      if (node != sorted[end - walked]) {
+        printf("AVL Tree reverse range walk mismatch\n");
+        return -1;
+      }
+    }
+    if (walked != expected) {
+      printf("AVL Tree reverse range walk returned %u of %u keys\n", walked, expected);
+      return -1;
+    }
+  }
+
+  // full reverse walk
+  AVL_seek_reverse(&avl_tree, NULL, &it);
+  seen = 0;
+  while ((node = AVL_iterator(&avl_tree, &it)) != FASTER_AVL_NODE_INDEX_INVALID) {
+    if (node != sorted[count - 1 - seen++]) {
+      printf("AVL Tree reverse walk mismatch\n");
+      return -1;
+    }
+  }
+  if (seen != count) {
+    printf("AVL Tree reverse walk visited %u of %u nodes\n", seen, count);
+    return -1;
+  }
+
+  // prefixes spread over several key lengths
+  const char *prefixes[] = {"key1", "key42", "key7", "key", "ke", "nokey", "key12345678"};
+  for (size_t p = 0; p < sizeof(prefixes) / sizeof(prefixes[0]); p++) {
+    fchar_t prefix_text[64];
+    faster_mb_to_unicode(prefixes[p], prefix_text, 64);
+    faster_str_t prefix = {prefix_text, faster_strlen(prefix_text)};
+    faster_indexing_t expected = 0;
+    for (faster_indexing_t i = 0; i < count; i++) {
+      faster_str_t key = AVL_node_key(avl_tree.node_list.list + sorted[i]);
+      if (has_prefix(&key, &prefix))
+        expected++;
+    }
+    faster_indexing_t walked = 0;
+    AVLNodeIndex previous = FASTER_AVL_NODE_INDEX_INVALID;
+    AVL_seek_prefix(&avl_tree, &prefix, &it);
+    while ((node = AVL_iterator(&avl_tree, &it)) != FASTER_AVL_NODE_INDEX_INVALID) {
+      faster_str_t key = AVL_node_key(avl_tree.node_list.list + node);
+      if (!has_prefix(&key, &prefix) || (FASTER_AVL_NODE_VALID(previous) && cmp_node_key(&avl_tree, previous, &key) >= 0)) {
+        printf("AVL Tree prefix walk returned a wrong key for %s\n", prefixes[p]);
+        return -1;
+      }
+      previous = node;
+      walked++;
+    }
+    if (walked != expected) {
+      printf("AVL Tree prefix walk for %s returned %u of %u keys\n", prefixes[p], walked, expected);
+      return -1;
+    }
+    printf("Prefix %s: %u keys\n", prefixes[p], walked);
+  }
+
+  printf("AVL Tree iterators OK\n");
+  free(sorted);
+  AVL_reset_and_free(&avl_tree);
+  free(texts);
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "aster/faster_avl.h"
+
+// recomputes heights bottom-up and checks the AVL balance, returns -1 on a broken subtree
+static int check_subtree(AVLNodesTreePtr tree, AVLNodeIndex node, faster_indexing_t *count) {
+  if (FASTER_AVL_NODE_INVALID(node))
+    return 0;
+  AVLNodePtr node_ptr = tree->node_list.list + node;
+  int left_height = check_subtree(tree, node_ptr->left, count);
+  int right_height = check_subtree(tree, node_ptr->right, count);
+  if (left_height < 0 || right_height < 0 || left_height - right_height > 1 || right_height - left_height > 1)
+    return -1;
+  int node_height = (left_height > right_height ? left_height : right_height) + 1;
+  faster_str_t key = AVL_node_key(node_ptr);
+  if (node_height != node_ptr->height || node_ptr->key_prefix != faster_str_prefix(&key))
+    return -1;
+  (*count)++;
+  return node_height;
+}
+
+static bool check_tree(AVLNodesTreePtr tree, const char *stage) {
+  faster_indexing_t checked_nodes = 0;
+  if (check_subtree(tree, tree->root_node, &checked_nodes) < 0 || checked_nodes != tree->node_list.list_header.array_internal) {
+    printf("AVL Tree broken after %s\n", stage);
+    return false;
+  }
+  faster_avl_tree_iterator_helper_t it = FASTER_AVL_TREE_EMPTY_ITERATOR;
+  AVLNodeIndex previous = FASTER_AVL_NODE_INDEX_INVALID;
+  AVLNodeIndex node;
+  while ((node = AVL_iterator(tree, &it)) != FASTER_AVL_NODE_INDEX_INVALID) {
+    faster_str_t key = AVL_node_key(tree->node_list.list + node);
+    if (FASTER_AVL_NODE_VALID(previous)) {
+      faster_str_t previous_key = AVL_node_key(tree->node_list.list + previous);
+      if (faster_str_cmp_binary(&previous_key, &key) >= 0) {
+        printf("AVL Tree out of order after %s\n", stage);
+        return false;
+      }
+    }
+    previous = node;
+  }
+  return true;
+}
+
+int main() {
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(avl_tree, 256);
+
+  srand(0);
+  faster_indexing_t generation = 100000;
+  fchar_t(*texts)[24] = calloc(generation, sizeof(*texts));
+  faster_str_t *keys = calloc(generation, sizeof(faster_str_t));
+  faster_value_ptr *values = calloc(generation, sizeof(faster_value_ptr));
+
+  // ascending keys of one length build directly
+  for (faster_indexing_t i = 0; i < generation; i++) {
+    char str_ptr[24];
+    sprintf(str_ptr, "key%08u", i);
+    faster_mb_to_unicode(str_ptr, texts[i], 24);
+    faster_str_t keyp = {texts[i], faster_strlen(texts[i])};
+    memcpy((void *)&keys[i], &keyp, sizeof(faster_str_t));
+    values[i] = (faster_value_ptr)(intptr_t)(i + 1);
+  }
+  if (!AVL_bulk_load(&avl_tree, keys, values, generation) || !check_tree(&avl_tree, "sorted bulk load"))
+    return -1;
+  if (avl_tree.root_node != 0 || avl_tree.node_list.list_header.array_internal != generation) {
+    printf("AVL Tree bulk load did not use the breadth-first layout\n");
+    return -1;
+  }
+  for (faster_indexing_t i = 0; i < generation; i++) {
+    if (AVL_get(&avl_tree, &keys[i]) != values[i]) {
+      printf("AVL Tree bulk loaded key %u not found\n", i);
+      return -1;
+    }
+  }
+  printf("Sorted bulk load OK, height %d\n", avl_tree.node_list.list[avl_tree.root_node].height);
+
+  // the tree keeps working with the regular operations
+  for (faster_indexing_t i = 0; i < generation; i += 3)
+    AVL_remove(&avl_tree, &keys[i]);
+  if (!check_tree(&avl_tree, "removal from a bulk loaded tree"))
+    return -1;
+
+  // shuffled keys with duplicates are merged into the remaining tree, the last value wins
+  for (faster_indexing_t i = generation - 1; i > 0; i--) {
+    faster_indexing_t j = (faster_indexing_t)rand() % (i + 1);
+    faster_str_t tmp_key;
+    memcpy((void *)&tmp_key, &keys[i], sizeof(faster_str_t));
+    memcpy((void *)&keys[i], &keys[j], sizeof(faster_str_t));
+    memcpy((void *)&keys[j], &tmp_key, sizeof(faster_str_t));
+  }
+  faster_indexing_t half = generation / 2;
+  for (faster_indexing_t i = 0; i < half; i++)
+    values[i] = (faster_value_ptr)(intptr_t)(i + 1);
+  memcpy((void *)&keys[half], &keys[0], sizeof(faster_str_t));
+  values[half] = (faster_value_ptr)(intptr_t)-1;
+  faster_indexing_t expected = avl_tree.node_list.list_header.array_internal;
+  for (faster_indexing_t i = 0; i < half; i++) {
+    if (AVL_get(&avl_tree, &keys[i]) == NULL)
+      expected++;
+  }
+  if (!AVL_bulk_load(&avl_tree, keys, values, half + 1) || !check_tree(&avl_tree, "unsorted bulk load"))
+    return -1;
+  if (AVL_get(&avl_tree, &keys[0]) != (faster_value_ptr)(intptr_t)-1) {
+    printf("AVL Tree bulk load kept the first of duplicate keys\n");
+    return -1;
+  }
+  for (faster_indexing_t i = 1; i < half; i++) {
+    if (AVL_get(&avl_tree, &keys[i]) != values[i]) {
+      printf("AVL Tree bulk merged key not found\n");
+      return -1;
+    }
+  }
+  if (avl_tree.node_list.list_header.array_internal != expected) {
+    printf("AVL Tree bulk merge holds %u nodes instead of %u\n", avl_tree.node_list.list_header.array_internal, expected);
+    return -1;
+  }
+  printf("Unsorted bulk merge OK, %u nodes\n", expected);
+
+  AVL_reset_and_free(&avl_tree);
+  free(values);
+  free(keys);
+  free(texts);
+  return 0;
+}
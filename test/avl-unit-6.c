@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "aster/faster_avl.h"
+
+#if !FASTER_AVL_ORDER_STATISTICS
+#error "avl-unit-6 needs FASTER_AVL_ORDER_STATISTICS"
+#endif
+
+// checks the subtree sizes bottom-up, returns the size or -1 on a stale count
+static long check_sizes(AVLNodesTreePtr tree, AVLNodeIndex node) {
+  if (FASTER_AVL_NODE_INVALID(node))
+    return 0;
+  AVLNodePtr node_ptr = tree->node_list.list + node;
+  long left_size = check_sizes(tree, node_ptr->left);
+  long right_size = check_sizes(tree, node_ptr->right);
+  if (left_size < 0 || right_size < 0 || (long)node_ptr->size != left_size + right_size + 1)
+    return -1;
+  return node_ptr->size;
+}
+
+static faster_str_t make_key(intptr_t number, fchar_t *aster_text) {
+  char str_ptr[24];
+  sprintf(str_ptr, "key%ld", number);
+  faster_mb_to_unicode(str_ptr, aster_text, 24);
+  faster_str_t keyp = {aster_text, faster_strlen(aster_text)};
+  return keyp;
+}
+
+// every rank selects the node the in-order walk gives, and ranks its key back
+static bool check_order_statistics(AVLNodesTreePtr tree, const char *stage) {
+  long count = check_sizes(tree, tree->root_node);
+  if (count != (long)AVLNode_t_arr_count(&tree->node_list)) {
+    printf("AVL Tree subtree sizes stale after %s\n", stage);
+    return false;
+  }
+  faster_avl_tree_iterator_helper_t it = FASTER_AVL_TREE_EMPTY_ITERATOR;
+  faster_indexing_t rank = 0;
+  AVLNodeIndex node;
+  while ((node = AVL_iterator(tree, &it)) != FASTER_AVL_NODE_INDEX_INVALID) {
+    if (AVL_select(tree, rank) != node || AVL_rank(tree, &tree->node_list.list[node].key) != rank) {
+      printf("AVL Tree rank %u mismatch after %s\n", rank, stage);
+      return false;
+    }
+    rank++;
+  }
+  if (AVL_select(tree, rank) != FASTER_AVL_NODE_INDEX_INVALID || AVL_count_range(tree, NULL, NULL) != rank) {
+    printf("AVL Tree select past the end after %s\n", stage);
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(avl_tree, 256);
+
+  srand(0);
+  int generation = 40000;
+  fchar_t(*texts)[24] = calloc((size_t)generation + 1, sizeof(*texts));
+  for (int i = 0; i < generation / 2; i++) {
+    intptr_t random_number = rand() % generation + 1;
+    faster_str_t keyp = make_key(random_number, texts[random_number]);
+    AVL_insert_or_update(&avl_tree, &keyp, (faster_value_ptr)random_number);
+  }
+  if (!check_order_statistics(&avl_tree, "insertion"))
+    return -1;
+
+  for (int i = 0; i < generation / 2; i++) {
+    fchar_t aster_text[24];
+    faster_str_t keyp = make_key(rand() % generation + 1, aster_text);
+    AVL_remove(&avl_tree, &keyp);
+  }
+  if (!check_order_statistics(&avl_tree, "removal"))
+    return -1;
+
+  // range counts agree with a bounded walk, including bounds that are not keys
+  faster_avl_tree_iterator_helper_t it = FASTER_AVL_TREE_EMPTY_ITERATOR;
+  for (int probe = 0; probe < 500; probe++) {
+    fchar_t from_text[24], to_text[24];
+    faster_str_t from = make_key(rand() % (generation + 10), from_text);
+    faster_str_t to = make_key(rand() % (generation + 10), to_text);
+    faster_indexing_t walked = 0;
+    AVL_seek_range(&avl_tree, &from, &to, &it);
+    while (AVL_iterator(&avl_tree, &it) != FASTER_AVL_NODE_INDEX_INVALID)
+      walked++;
+    if (AVL_count_range(&avl_tree, &from, &to) != walked) {
+      printf("AVL Tree range count mismatch\n");
+      return -1;
+    }
+  }
+
+  // sizes are laid down by the bulk load as well
+  faster_indexing_t count = AVLNode_t_arr_count(&avl_tree.node_list);
+  faster_str_t *keys = calloc(count, sizeof(faster_str_t));
+  faster_indexing_t filled = 0;
+  AVLNodeIndex node;
+  it = (faster_avl_tree_iterator_helper_t)FASTER_AVL_TREE_EMPTY_ITERATOR;
+  while ((node = AVL_iterator(&avl_tree, &it)) != FASTER_AVL_NODE_INDEX_INVALID)
+    memcpy((void *)&keys[filled++], &avl_tree.node_list.list[node].key, sizeof(faster_str_t));
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(bulk_tree, 0);
+  if (!AVL_bulk_load(&bulk_tree, keys, NULL, filled) || !check_order_statistics(&bulk_tree, "bulk load"))
+    return -1;
+
+  printf("AVL Tree order statistics OK over %u keys\n", count);
+  free(keys);
+  AVL_reset_and_free(&bulk_tree);
+  AVL_reset_and_free(&avl_tree);
+  free(texts);
+  return 0;
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "aster/faster_avl.h"
+
+#define KEY_SIZE 24
+
+static fchar_t (*texts)[KEY_SIZE];
+static faster_str_t *keys;
+
+// checks ordering, heights (and sizes) below node, returns the number of keys or -1
+static long check_subtree(AVLNodesTreePtr tree, AVLNodeIndex node, const faster_str_t **previous) {
+  if (FASTER_AVL_NODE_INVALID(node))
+    return 0;
+  AVLNodePtr node_ptr = tree->node_list.list + node;
+  long left = check_subtree(tree, node_ptr->left, previous);
+  if (left < 0 || (*previous && faster_str_cmp_binary(*previous, &node_ptr->key) >= 0) ||
+      node_ptr->key_prefix != faster_str_prefix(&node_ptr->key))
+    return -1;
+  *previous = &node_ptr->key;
+  long right = check_subtree(tree, node_ptr->right, previous);
+  if (right < 0)
+    return -1;
+  int left_height = FASTER_AVL_NODE_VALID(node_ptr->left) ? tree->node_list.list[node_ptr->left].height : 0;
+  int right_height = FASTER_AVL_NODE_VALID(node_ptr->right) ? tree->node_list.list[node_ptr->right].height : 0;
+  if (left_height - right_height > 1 || right_height - left_height > 1 ||
+      node_ptr->height != (left_height > right_height ? left_height : right_height) + 1)
+    return -1;
+#if FASTER_AVL_ORDER_STATISTICS
+  if (node_ptr->size != left + right + 1)
+    return -1;
+#endif
+  return left + right + 1;
+}
+
+// the tree holds exactly the keys marked in expected, values encode the tree they came from
+static bool check_tree(AVLNodesTreePtr tree, const unsigned char *expected, int generation, const char *what) {
+  const faster_str_t *previous = NULL;
+  long count = check_subtree(tree, tree->root_node, &previous);
+  long wanted = 0;
+  for (int i = 0; i < generation; i++) {
+    if (expected[i] == 0) {
+      if (AVL_get(tree, &keys[i]) != NULL) {
+        printf("%s: unexpected key %d\n", what, i);
+        return false;
+      }
+      continue;
+    }
+    wanted++;
+    if (AVL_get(tree, &keys[i]) != (faster_value_ptr)(intptr_t)expected[i]) {
+      printf("%s: key %d missing or with the wrong value\n", what, i);
+      return false;
+    }
+  }
+  if (count != wanted || AVLNode_t_arr_count(&tree->node_list) != (faster_indexing_t)count) {
+    printf("%s: broken tree, %ld keys, %ld expected, %u nodes in use\n", what, count, wanted,
+           AVLNode_t_arr_count(&tree->node_list));
+    return false;
+  }
+  printf("%s OK, %ld keys, height %d\n", what, count,
+         FASTER_AVL_NODE_VALID(tree->root_node) ? tree->node_list.list[tree->root_node].height : 0);
+  return true;
+}
+
+static void fill(AVLNodesTreePtr tree, unsigned char *present, int generation, int count, intptr_t value) {
+  for (int i = 0; i < count; i++) {
+    int number = rand() % generation;
+    AVL_insert_or_update(tree, &keys[number], (faster_value_ptr)value);
+    present[number] = (unsigned char)value;
+  }
+}
+
+int main() {
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(first, 256);
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(second, 256);
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(small, 256);
+
+  srand(0);
+  int generation = RAND_MAX / 8000;
+  texts = calloc((size_t)generation, sizeof(*texts));
+  keys = calloc((size_t)generation, sizeof(faster_str_t));
+  unsigned char *in_first = calloc((size_t)generation, 1);
+  unsigned char *in_second = calloc((size_t)generation, 1);
+  unsigned char *in_small = calloc((size_t)generation, 1);
+  unsigned char *expected = calloc((size_t)generation, 1);
+  for (int i = 0; i < generation; i++) {
+    char str_ptr[KEY_SIZE];
+    sprintf(str_ptr, "key%d", i);
+    faster_mb_to_unicode(str_ptr, texts[i], KEY_SIZE);
+    faster_str_t keyp = {texts[i], faster_strlen(texts[i])};
+    memcpy((void *)&keys[i], &keyp, sizeof(faster_str_t));
+  }
+
+  // split at every kind of key, then join the halves back around the split node
+  fill(&first, in_first, generation, generation / 16, 1);
+  for (int probe = 0; probe < 200; probe++) {
+    int number = rand() % generation;
+    AVLNodeIndex left, right;
+    AVLNodeIndex found = AVL_split(&first, first.root_node, &keys[number], &left, &right);
+    if (FASTER_AVL_NODE_VALID(found) != (in_first[number] != 0)) {
+      printf("AVL split found the wrong node for key %d\n", number);
+      return -1;
+    }
+    const faster_str_t *previous = NULL;
+    long left_count = check_subtree(&first, left, &previous);
+    if (left_count < 0 || (previous && faster_str_cmp_binary(previous, &keys[number]) >= 0)) {
+      printf("AVL split left half broken\n");
+      return -1;
+    }
+    previous = &keys[number];
+    long right_count = check_subtree(&first, right, &previous);
+    if (right_count < 0) {
+      printf("AVL split right half broken\n");
+      return -1;
+    }
+    first.root_node = FASTER_AVL_NODE_VALID(found) ? AVL_join(&first, left, found, right) : AVL_join2(&first, left, right);
+  }
+  if (!check_tree(&first, in_first, generation, "Split and join"))
+    return -1;
+
+  // a large tree against a large and a small one
+  fill(&second, in_second, generation, generation / 16, 2);
+  fill(&small, in_small, generation, 100, 3);
+
+  for (int i = 0; i < generation; i++)
+    expected[i] = in_second[i] ? in_second[i] : in_first[i];
+  if (!AVL_union(&first, &second) || !check_tree(&first, expected, generation, "Union") ||
+      !check_tree(&second, in_second, generation, "Union operand"))
+    return -1;
+  memcpy(in_first, expected, (size_t)generation);
+
+  for (int i = 0; i < generation; i++)
+    expected[i] = in_small[i] ? in_small[i] : in_first[i];
+  if (!AVL_union(&first, &small) || !check_tree(&first, expected, generation, "Small union"))
+    return -1;
+  memcpy(in_first, expected, (size_t)generation);
+
+  for (int i = 0; i < generation; i++)
+    expected[i] = in_first[i] && !in_small[i] ? in_first[i] : 0;
+  AVL_difference(&first, &small);
+  if (!check_tree(&first, expected, generation, "Small difference"))
+    return -1;
+  memcpy(in_first, expected, (size_t)generation);
+
+  // every key of second is in first after the union, add some that are not
+  fill(&second, in_second, generation, generation / 32, 4);
+  for (int i = 0; i < generation; i++)
+    expected[i] = in_first[i] && in_second[i] ? in_first[i] : 0;
+  AVL_intersection(&first, &second);
+  if (!check_tree(&first, expected, generation, "Intersection"))
+    return -1;
+  memcpy(in_first, expected, (size_t)generation);
+
+  fill(&first, in_first, generation, generation / 16, 5);
+  for (int i = 0; i < generation; i++)
+    expected[i] = in_first[i] && !in_second[i] ? in_first[i] : 0;
+  AVL_difference(&first, &second);
+  if (!check_tree(&first, expected, generation, "Difference"))
+    return -1;
+  memcpy(in_first, expected, (size_t)generation);
+
+  // degenerate operands
+  AVL_intersection(&small, &small);
+  if (!check_tree(&small, in_small, generation, "Self intersection"))
+    return -1;
+  memset(expected, 0, (size_t)generation);
+  AVL_difference(&small, &small);
+  if (!check_tree(&small, expected, generation, "Self difference"))
+    return -1;
+  if (!AVL_union(&small, &first) || !check_tree(&small, in_first, generation, "Union into empty"))
+    return -1;
+
+  AVL_reset_and_free(&first);
+  AVL_reset_and_free(&second);
+  AVL_reset_and_free(&small);
+  free(texts);
+  free(keys);
+  free(in_first);
+  free(in_second);
+  free(in_small);
+  free(expected);
+  return 0;
+}
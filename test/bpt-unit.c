@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "aster/faster_bpt.h"
+#include <time.h>
+
+#define FASTER_BPT_TEST_KEY_SIZE 24
+
+static faster_indexing_t leaf_depth;
+
+// checks fill, ordering and separator bounds below node, returns the number of keys or -1 on a broken subtree
+static long check_subtree(BPTreePtr tree, BPTNodeIndex node, faster_indexing_t depth, const faster_str_t *low,
+                          const faster_str_t *high, const faster_str_t **smallest) {
+  BPTNodePtr node_ptr = tree->node_list.list + node;
+  if (node != tree->root_node && node_ptr->count < FASTER_BPT_MIN_KEYS)
+    return -1;
+  for (faster_indexing_t i = 0; i < node_ptr->count; i++) {
+    if (node_ptr->prefixes[i] != faster_str_prefix(&node_ptr->keys[i]))
+      return -1;
+    if (i > 0 && faster_str_cmp_binary(&node_ptr->keys[i - 1], &node_ptr->keys[i]) >= 0)
+      return -1;
+    if (low && faster_str_cmp_binary(&node_ptr->keys[i], low) < 0)
+      return -1;
+    if (high && faster_str_cmp_binary(&node_ptr->keys[i], high) >= 0)
+      return -1;
+  }
+  if (node_ptr->is_leaf) {
+    if (leaf_depth == 0)
+      leaf_depth = depth;
+    if (depth != leaf_depth)
+      return -1;
+    *smallest = node_ptr->count > 0 ? &node_ptr->keys[0] : NULL;
+    return node_ptr->count;
+  }
+  long total = 0;
+  for (faster_indexing_t i = 0; i <= node_ptr->count; i++) {
+    const faster_str_t *child_smallest = NULL;
+    long sub = check_subtree(tree, node_ptr->children[i], depth + 1, i > 0 ? &node_ptr->keys[i - 1] : low,
+                             i < node_ptr->count ? &node_ptr->keys[i] : high, &child_smallest);
+    if (sub < 0 || child_smallest == NULL)
+      return -1;
+    // separators are the smallest key of their right subtree
+    if (i > 0 && faster_str_cmp_binary(child_smallest, &node_ptr->keys[i - 1]) != 0)
+      return -1;
+    if (i == 0)
+      *smallest = child_smallest;
+    total += sub;
+  }
+  return total;
+}
+
+static bool check_tree(BPTreePtr tree) {
+  if (tree->root_node == FASTER_BPT_NODE_INDEX_INVALID)
+    return tree->elements == 0;
+  leaf_depth = 0;
+  const faster_str_t *smallest = NULL;
+  long keys = check_subtree(tree, tree->root_node, 1, NULL, NULL, &smallest);
+  if (keys != (long)tree->elements)
+    return false;
+  // the leaf chain sees every key once, in order
+  faster_bpt_tree_iterator_helper_t it = FASTER_BPT_EMPTY_ITERATOR;
+  const faster_str_t *key = NULL;
+  const faster_str_t *prev_key = NULL;
+  long seen = 0;
+  while (BPT_iterator(tree, &it, &key, NULL)) {
+    if (prev_key && faster_str_cmp_binary(prev_key, key) >= 0)
+      return false;
+    prev_key = key;
+    seen++;
+  }
+  return seen == keys;
+}
+
+static faster_str_t make_key(intptr_t number, fchar_t *aster_text) {
+  char str_ptr[64];
+  sprintf(str_ptr, "key%ld", number);
+  faster_mb_to_unicode(str_ptr, aster_text, FASTER_BPT_TEST_KEY_SIZE);
+  faster_str_t keyp = {aster_text, faster_strlen(aster_text)};
+  return keyp;
+}
+
+int main(int argc, char *argv[]) {
+  DECLARE_BPT_TREE_WITH_DYNAMIC_ALLOCATION(bpt_tree, 256);
+
+  srand(0);
+  int generation = RAND_MAX / 4000;
+
+  if (argc > 1) {
+    generation = atoi(argv[1]);
+    if (generation <= 0) {
+      printf("Invalid argument, using default generation of %d\n", generation);
+      generation = RAND_MAX / 4000;
+    }
+  }
+
+  // keys are owned by the test, the tree only references them
+  fchar_t(*texts)[FASTER_BPT_TEST_KEY_SIZE] = calloc((size_t)generation + 1, sizeof(*texts));
+  if (texts == NULL) {
+    printf("Allocation failed\n");
+    return -1;
+  }
+
+  faster_indexing_t insertions = 0;
+  clock_t start_time = clock();
+  for (int i = 0; i < (generation / 10); i++) {
+    intptr_t random_number = rand() % generation + 1;
+    faster_str_t keyp = make_key(random_number, texts[random_number]);
+    if (BPT_insert_or_update(&bpt_tree, &keyp, (faster_value_ptr)random_number))
+      insertions++;
+  }
+  clock_t end_time = clock();
+  double avg_insertion_time = ((double)(end_time - start_time) / CLOCKS_PER_SEC) / (generation / 10);
+  printf("Average insertion time: %f useconds\n", avg_insertion_time * 1000000);
+  printf("B+ Tree node count: %u\n", bpt_tree.node_list.list_header.array_internal);
+  printf("B+ Tree node capacity: %u\n", bpt_tree.node_list.list_header.array_capacity);
+
+  if (insertions != bpt_tree.elements || !check_tree(&bpt_tree)) {
+    printf("B+ Tree broken after insertion\n");
+    return -1;
+  }
+
+  // every inserted key is found with its value
+  for (intptr_t i = 1; i <= generation; i++) {
+    if (texts[i][0] == 0)
+      continue;
+    faster_str_t keyp = {texts[i], faster_strlen(texts[i])};
+    if (BPT_get(&bpt_tree, &keyp) != (faster_value_ptr)i) {
+      printf("Key %ld not found in B+ Tree\n", i);
+      return -1;
+    }
+  }
+
+  fchar_t aster_textx[] = ASTER_TEXT("key-notfound");
+  faster_str_t keyx = {aster_textx, faster_strlen(aster_textx)};
+  if (BPT_remove(&bpt_tree, &keyx) == true || BPT_get(&bpt_tree, &keyx) != NULL) {
+    printf("ERROR: Key notfound removed from B+ Tree\n");
+    return -1;
+  } else {
+    printf("OK: Key notfound not found in B+ Tree\n");
+  }
+
+  // seek lands on the key itself or on its successor
+  faster_bpt_tree_iterator_helper_t seek_it = FASTER_BPT_EMPTY_ITERATOR;
+  fchar_t seek_text[FASTER_BPT_TEST_KEY_SIZE];
+  faster_str_t seek_key = make_key(generation / 2, seek_text);
+  BPT_seek(&bpt_tree, &seek_key, &seek_it);
+  const faster_str_t *found_key = NULL;
+  if (BPT_iterator(&bpt_tree, &seek_it, &found_key, NULL) && faster_str_cmp_binary(found_key, &seek_key) < 0) {
+    printf("B+ Tree seek went before the searched key\n");
+    return -1;
+  }
+
+  clock_t rem_start_time = clock();
+  faster_indexing_t removal = 0;
+  for (int i = 0; i < generation / 2; i++) {
+    intptr_t random_number = rand() % generation + 1;
+    fchar_t aster_text[FASTER_BPT_TEST_KEY_SIZE];
+    faster_str_t keyp = make_key(random_number, aster_text);
+    if (BPT_remove(&bpt_tree, &keyp) == true) {
+      removal++;
+    }
+  }
+  clock_t rem_end_time = clock();
+  double avg_rem_time = ((double)(rem_end_time - rem_start_time) / CLOCKS_PER_SEC) / (generation / 2);
+  printf("Average removal time of %u items over %u deletion attempts: %f useconds\n", removal, generation / 2,
+         avg_rem_time * 1000000);
+
+  if (insertions - removal != bpt_tree.elements || !check_tree(&bpt_tree)) {
+    printf("B+ Tree broken after removal (%u inserted, %u removed, %u elements)\n", insertions, removal, bpt_tree.elements);
+    return -1;
+  }
+
+  faster_indexing_t capacity_before_adding = bpt_tree.node_list.list_header.array_capacity;
+  for (int i = 0; i < removal; i++) {
+    intptr_t random_number = rand() % generation + 1;
+    faster_str_t keyp = make_key(random_number, texts[random_number]);
+    BPT_insert_or_update(&bpt_tree, &keyp, (faster_value_ptr)random_number);
+  }
+  if (!check_tree(&bpt_tree)) {
+    printf("B+ Tree broken after reinsertion\n");
+    return -1;
+  }
+  printf("B+ Tree capacity %u before and %u after reinsertion\n", capacity_before_adding,
+         bpt_tree.node_list.list_header.array_capacity);
+
+  // drain completely, the tree must collapse back to empty
+  for (intptr_t i = 1; i <= generation; i++) {
+    if (texts[i][0] == 0)
+      continue;
+    faster_str_t keyp = {texts[i], faster_strlen(texts[i])};
+    BPT_remove(&bpt_tree, &keyp);
+    if ((i % 4093) == 0 && !check_tree(&bpt_tree)) {
+      printf("B+ Tree broken while draining\n");
+      return -1;
+    }
+  }
+  if (bpt_tree.elements != 0 || bpt_tree.root_node != FASTER_BPT_NODE_INDEX_INVALID ||
+      bpt_tree.node_list.list_header.array_internal != 0) {
+    printf("B+ Tree not empty after draining (%u elements, %u nodes)\n", bpt_tree.elements,
+           bpt_tree.node_list.list_header.array_internal);
+    return -1;
+  }
+  printf("Structure OK for B+ Tree\n");
+
+  BPT_reset_and_free(&bpt_tree);
+  free(texts);
+
+  return 0;
+}
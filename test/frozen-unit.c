@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "aster/faster_frozen.h"
+#include <time.h>
+
+#define KEY_SIZE 48
+
+// short keys and dotted names sharing long prefixes, so both the prefix and the tail comparisons are exercised
+static faster_str_t make_key(intptr_t number, fchar_t *aster_text) {
+  char str_ptr[KEY_SIZE];
+  if (number % 2) {
+    sprintf(str_ptr, "key%ld", number);
+  } else {
+    sprintf(str_ptr, "metrics.service.latency.%ld", number);
+  }
+  faster_mb_to_unicode(str_ptr, aster_text, KEY_SIZE);
+  faster_str_t keyp = {aster_text, faster_strlen(aster_text)};
+  return keyp;
+}
+
+int main() {
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(avl_tree, 256);
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(thawed, 256);
+  faster_frozen_t frozen = FASTER_FROZEN_EMPTY;
+
+  // an empty tree freezes and thaws too
+  fchar_t probe_text[KEY_SIZE];
+  faster_str_t probe = make_key(1, probe_text);
+  if (AVL_freeze(&avl_tree, &frozen) != FAST_ERROR_NONE || faster_frozen_get(&frozen, &probe) != NULL ||
+      AVL_thaw(&frozen, &thawed) != FAST_ERROR_NONE || FASTER_AVL_NODE_VALID(thawed.root_node)) {
+    printf("Empty frozen map broken\n");
+    return -1;
+  }
+  faster_frozen_free(&frozen);
+
+  srand(0);
+  int generation = RAND_MAX / 4000;
+  fchar_t(*texts)[KEY_SIZE] = calloc((size_t)generation + 1, sizeof(*texts));
+  for (int i = 0; i < (generation / 4); i++) {
+    intptr_t random_number = rand() % generation + 1;
+    faster_str_t keyp = make_key(random_number, texts[random_number]);
+    AVL_insert_or_update(&avl_tree, &keyp, (faster_value_ptr)random_number);
+  }
+  if (AVL_freeze(&avl_tree, &frozen) != FAST_ERROR_NONE) {
+    printf("Freeze failed\n");
+    return -1;
+  }
+
+  // the frozen map answers like the tree, for present and absent keys
+  faster_str_t *queries = calloc((size_t)generation, sizeof(faster_str_t));
+  fchar_t(*query_texts)[KEY_SIZE] = calloc((size_t)generation, sizeof(*query_texts));
+  for (int i = 0; i < generation; i++) {
+    faster_str_t keyp = make_key(rand() % (generation + 100), query_texts[i]);
+    memcpy((void *)&queries[i], &keyp, sizeof(faster_str_t));
+    if (faster_frozen_get(&frozen, &queries[i]) != AVL_get(&avl_tree, &queries[i])) {
+      printf("Frozen map and AVL tree disagree on a key\n");
+      return -1;
+    }
+  }
+
+  faster_indexing_t hits = 0;
+  clock_t start_time = clock();
+  for (int i = 0; i < generation; i++)
+    hits += AVL_get(&avl_tree, &queries[i]) != NULL;
+  clock_t avl_time = clock() - start_time;
+  start_time = clock();
+  for (int i = 0; i < generation; i++)
+    hits -= faster_frozen_get(&frozen, &queries[i]) != NULL;
+  clock_t frozen_time = clock() - start_time;
+  if (hits != 0) {
+    printf("Frozen map and AVL tree found different keys\n");
+    return -1;
+  }
+  printf("Average lookup time: %f useconds in the AVL tree, %f useconds frozen\n",
+         ((double)avl_time / CLOCKS_PER_SEC) / generation * 1000000, ((double)frozen_time / CLOCKS_PER_SEC) / generation * 1000000);
+  printf("Memory: %zu bytes in the AVL tree, %zu bytes frozen for %u keys\n",
+         (size_t)avl_tree.node_list.list_header.array_capacity * sizeof(AVLNode_t),
+         ((size_t)frozen.count + 1) * (sizeof(struct faster_frozen_entry_s) + sizeof(fchar_t *) + sizeof(faster_value_ptr)),
+         frozen.count);
+
+  // thawing gives back the same keys in order
+  if (AVL_thaw(&frozen, &thawed) != FAST_ERROR_NONE) {
+    printf("Thaw failed\n");
+    return -1;
+  }
+  faster_avl_tree_iterator_helper_t it = FASTER_AVL_TREE_EMPTY_ITERATOR;
+  faster_avl_tree_iterator_helper_t thawed_it = FASTER_AVL_TREE_EMPTY_ITERATOR;
+  AVLNodeIndex node, thawed_node;
+  do {
+    node = AVL_iterator(&avl_tree, &it);
+    thawed_node = AVL_iterator(&thawed, &thawed_it);
+    if (FASTER_AVL_NODE_VALID(node) != FASTER_AVL_NODE_VALID(thawed_node) ||
+        (FASTER_AVL_NODE_VALID(node) &&
+         (faster_str_cmp_binary(&avl_tree.node_list.list[node].key, &thawed.node_list.list[thawed_node].key) != 0 ||
+          avl_tree.node_list.list[node].value != thawed.node_list.list[thawed_node].value))) {
+      printf("Thawed tree differs from the frozen one\n");
+      return -1;
+    }
+  } while (FASTER_AVL_NODE_VALID(node));
+  printf("Frozen map OK, %u keys\n", frozen.count);
+
+  faster_frozen_free(&frozen);
+  AVL_reset_and_free(&avl_tree);
+  AVL_reset_and_free(&thawed);
+  free(queries);
+  free(query_texts);
+  free(texts);
+  return 0;
+}
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "aster/faster_ht.h"
 
@@ -133,6 +134,145 @@ int main(int argc, char *argv[]) {
     faster_ht_free(&ht);
     return -1;
   }
+  // small tables stay inline until they outgrow FASTER_HT_INLINE_CAPACITY
+  faster_ht_free(&ht);
+  if (faster_ht_init(&ht, 0, faster_ht_hash) != FAST_ERROR_NONE) {
+    printf("Failed to initialize small hash table\n");
+    return -1;
+  }
+  fchar_t small_keys[FASTER_HT_INLINE_CAPACITY * 2][16];
+  for (intptr_t i = 0; i < FASTER_HT_INLINE_CAPACITY * 2; i++) {
+    sprintf(str_ptr, "small%ld", (long)i);
+    faster_mb_to_unicode(str_ptr, small_keys[i], 16);
+    faster_ht_key_data_t key = {small_keys[i], faster_str_bytelen(small_keys[i])};
+    if (faster_ht_set(&ht, &key, (faster_value_ptr)(i + 1)) != FAST_ERROR_NONE) {
+      printf("Failed to set small table value\n");
+      return -1;
+    }
+    if ((i < FASTER_HT_INLINE_CAPACITY) != (ht.capacity == 0)) {
+      printf("Small table migrated at the wrong size: %ld elements, capacity %u\n", (long)i + 1, ht.capacity);
+      return -1;
+    }
+    for (intptr_t j = 0; j <= i; j++) {
+      faster_ht_key_data_t check_key = {small_keys[j], faster_str_bytelen(small_keys[j])};
+      if (faster_ht_get(&ht, &check_key) != (faster_value_ptr)(j + 1)) {
+        printf("Small table lost key %ld after %ld insertions\n", (long)j, (long)i + 1);
+        return -1;
+      }
+    }
+  }
+  faster_ht_free(&ht);
+  for (intptr_t i = 0; i < FASTER_HT_INLINE_CAPACITY; i++) {
+    faster_ht_key_data_t key = {small_keys[i], faster_str_bytelen(small_keys[i])};
+    faster_ht_set(&ht, &key, (faster_value_ptr)(i + 1));
+  }
+  faster_ht_key_data_t first_small_key = {small_keys[0], faster_str_bytelen(small_keys[0])};
+  if (faster_ht_remove(&ht, &first_small_key) != FAST_ERROR_NONE || faster_ht_get(&ht, &first_small_key) != NULL) {
+    printf("Failed to remove inline key\n");
+    return -1;
+  }
+  faster_ht_iterator_t small_it = FASTER_HT_EMPTY_ITERATOR;
+  faster_ht_entry_ptr_t small_entry;
+  intptr_t small_expected = 1;
+  while ((small_entry = faster_ht_iterator(&ht, &small_it)) != NULL) {
+    if (small_entry->value != (faster_value_ptr)++small_expected) {
+      printf("Inline iteration out of insertion order\n");
+      return -1;
+    }
+  }
+  if (small_expected != FASTER_HT_INLINE_CAPACITY || ht.capacity != 0) {
+    printf("Inline table in unexpected state after removal\n");
+    return -1;
+  }
+
+  // read-modify-write through handles, counting repeated keys in a single probe each
+  faster_ht_free(&ht);
+  for (intptr_t i = 0; i < FASTER_HT_INLINE_CAPACITY * 2 * 10; i++) {
+    intptr_t k = i % (FASTER_HT_INLINE_CAPACITY * 2);
+    faster_ht_key_data_t key = {small_keys[k], faster_str_bytelen(small_keys[k])};
+    bool inserted;
+    faster_ht_handle_t handle = faster_ht_upsert(&ht, &key, &inserted);
+    if (handle == FASTER_HT_HANDLE_INVALID || inserted != (i < FASTER_HT_INLINE_CAPACITY * 2)) {
+      printf("Failed to upsert counter key %ld\n", (long)k);
+      return -1;
+    }
+    faster_value_ptr *counter = faster_ht_handle_value(&ht, handle);
+    *counter = FASTER_VALUE_MAKE_INT_DIRECT(FASTER_VALUE_GET_INT_DIRECT(*counter) + 1);
+  }
+  for (intptr_t k = 0; k < FASTER_HT_INLINE_CAPACITY * 2; k++) {
+    faster_ht_key_data_t key = {small_keys[k], faster_str_bytelen(small_keys[k])};
+    faster_hash_value_t hash = faster_ht_hash(&key);
+    if (faster_ht_get_prehashed(&ht, &key, hash) != FASTER_VALUE_MAKE_INT_DIRECT(10)) {
+      printf("Wrong counter for key %ld\n", (long)k);
+      return -1;
+    }
+    faster_ht_handle_t handle = faster_ht_find_prehashed(&ht, &key, hash);
+    if (faster_ht_handle_get(&ht, handle) != FASTER_VALUE_MAKE_INT_DIRECT(10) ||
+        faster_ht_handle_remove(&ht, handle) != FAST_ERROR_NONE || faster_ht_find(&ht, &key) != FASTER_HT_HANDLE_INVALID) {
+      printf("Failed handle access for key %ld\n", (long)k);
+      return -1;
+    }
+  }
+  if (ht.elements != 0) {
+    printf("Counter table not empty after handle removal\n");
+    return -1;
+  }
+
+  // a handle does not survive an insertion that compacts: after a removal, the growth renumbers the
+  // entries behind the hole, the key has to be found again
+  faster_ht_free(&ht);
+  for (intptr_t k = 0; k < FASTER_HT_INLINE_CAPACITY * 2; k++) {
+    faster_ht_key_data_t key = {small_keys[k], faster_str_bytelen(small_keys[k])};
+    faster_ht_set(&ht, &key, FASTER_VALUE_MAKE_INT_DIRECT(k));
+  }
+  faster_ht_key_data_t held_key = {small_keys[FASTER_HT_INLINE_CAPACITY * 2 - 1],
+                                   faster_str_bytelen(small_keys[FASTER_HT_INLINE_CAPACITY * 2 - 1])};
+  faster_ht_handle_t held = faster_ht_find(&ht, &held_key);
+  faster_ht_key_data_t first_key = {small_keys[0], faster_str_bytelen(small_keys[0])};
+  faster_ht_remove(&ht, &first_key);
+  faster_indexing_t capacity_before = ht.capacity;
+  for (int i = 0; ht.capacity == capacity_before; i++) {
+    bool inserted;
+    if (faster_ht_upsert(&ht, &held_key, &inserted) != held || inserted) {
+      printf("Upsert of a present key moved its handle\n");
+      return -1;
+    }
+    sprintf(str_ptr, "grow%d", i);
+    faster_mb_to_unicode(str_ptr, aster_text, 64);
+    faster_ht_key_data_t key = {managed_strdup(aster_text), faster_str_bytelen(aster_text)};
+    faster_ht_set(&ht, &key, FASTER_VALUE_MAKE_INT_DIRECT(i));
+  }
+  faster_ht_handle_t refound = faster_ht_find(&ht, &held_key);
+  if (refound != held - 1 ||
+      faster_ht_handle_get(&ht, refound) != FASTER_VALUE_MAKE_INT_DIRECT(FASTER_HT_INLINE_CAPACITY * 2 - 1)) {
+    printf("Compacting insert did not renumber the held entry (%u, then %u)\n", held, refound);
+    return -1;
+  }
+
+  // inserting and removing the newest key over and over must not fill the index with deleted slots,
+  // a probe that never meets an empty slot does not end (the alarm ends the test instead)
+  faster_ht_free(&ht);
+  alarm(10);
+  for (intptr_t k = 0; k < FASTER_HT_INLINE_CAPACITY * 2; k++) {
+    faster_ht_key_data_t key = {small_keys[k], faster_str_bytelen(small_keys[k])};
+    faster_ht_set(&ht, &key, FASTER_VALUE_MAKE_INT_DIRECT(k));
+  }
+  for (int i = 0; i < 100000; i++) {
+    sprintf(str_ptr, "churn%d", i);
+    faster_mb_to_unicode(str_ptr, aster_text, 64);
+    faster_ht_key_data_t key = {aster_text, faster_str_bytelen(aster_text)};
+    if (faster_ht_set(&ht, &key, FASTER_VALUE_MAKE_INT_DIRECT(i)) != FAST_ERROR_NONE ||
+        faster_ht_remove(&ht, &key) != FAST_ERROR_NONE || faster_ht_get(&ht, &key) != FASTER_INVALID_VALUE_PTR) {
+      printf("Churn failed at key %d\n", i);
+      return -1;
+    }
+  }
+  alarm(0);
+  if (ht.elements != FASTER_HT_INLINE_CAPACITY * 2) {
+    printf("Churn lost keys, %u left\n", ht.elements);
+    return -1;
+  }
+
   // try freeing and recreating
   faster_ht_free(&ht);
   if (faster_ht_init(&ht, 1000, faster_ht_hash) != FAST_ERROR_NONE) {
@@ -177,6 +317,24 @@ int main(int argc, char *argv[]) {
     double avg_insertion_time = ((double)(end_time - start_time) / CLOCKS_PER_SEC) / (generation / 10);
     printf("Average insertion time: %f useconds for %u insertions \n", avg_insertion_time * 1000000, insertions);
     printf("Max insertion time: %f useconds\n", ((double)max_sit / CLOCKS_PER_SEC) * 1000000);
+    // iteration follows insertion order
+    faster_ht_iterator_t it = FASTER_HT_EMPTY_ITERATOR;
+    faster_ht_entry_ptr_t entry;
+    intptr_t expected_value = 0;
+    start_time = clock();
+    while ((entry = faster_ht_iterator(&ht, &it)) != NULL) {
+      if (entry->value != (faster_value_ptr)++expected_value) {
+        printf("Iteration out of insertion order: %ld vs %ld\n", (long)entry->value, (long)expected_value);
+        return -1;
+      }
+    }
+    end_time = clock();
+    if (expected_value != insertions) {
+      printf("Iteration visited %ld of %u entries\n", (long)expected_value, insertions);
+      return -1;
+    }
+    printf("Average iteration time: %f useconds\n",
+           (((double)(end_time - start_time) / CLOCKS_PER_SEC) / (generation / 10)) * 1000000);
     // lookup
     faster_indexing_t lookup = 0;
     clock_t seek_start_time = clock();
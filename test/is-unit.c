@@ -1,6 +1,42 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "aster/faster_is.h"
+#include <threads.h>
+
+static int base_thread(void *arg) {
+  *(const faster_interned_strings_t **)arg = faster_interned_strings_base();
+  return 0;
+}
+
+#define CONCURRENT_THREADS 4
+#define CONCURRENT_NAMES 20000
+
+struct concurrent_worker_s {
+  faster_concurrent_interned_strings_ptr_t table;
+  fchar_t (*names)[32];
+  faster_symbol_t *symbols;
+  int stride; // every worker walks the names in its own order
+  bool ok;
+};
+
+static int concurrent_thread(void *arg) {
+  struct concurrent_worker_s *worker = arg;
+  worker->ok = true;
+  for (int n = 0; n < CONCURRENT_NAMES; n++) {
+    int i = (int)(((long)n * worker->stride) % CONCURRENT_NAMES);
+    faster_str_t keyp = {worker->names[i], faster_strlen(worker->names[i])};
+    worker->symbols[i] = faster_concurrent_interned_strings_symbol(worker->table, &keyp, FAST_INTERNED_STRING_PURPOSE_VNAME);
+    // a symbol is visible to lookups as soon as it is returned
+    if (worker->symbols[i] == FASTER_SYMBOL_INVALID ||
+        faster_concurrent_interned_strings_find(worker->table, &keyp) != worker->symbols[i] ||
+        !FASTER_INTERNED_STRING_PURPOSE_HAS_PURPOSE(faster_concurrent_interned_strings_get(worker->table, &keyp),
+                                                    FAST_INTERNED_STRING_PURPOSE_VNAME))
+      worker->ok = false;
+  }
+  return 0;
+}
 
 int main() {
   FASTER_DECLARE_FASTER_STR(key1, "key1");
@@ -60,6 +96,275 @@ int main() {
     return -1;
   }
   printf("All keys have correct purposes\n");
+
+  // symbols: dense ids, string to id and id to string
+  faster_symbol_t symbol2 = faster_interned_strings_find(&interned_strings, (const faster_str_ptr_t)&key2);
+  if (symbol2 == FASTER_SYMBOL_INVALID ||
+      faster_interned_strings_symbol(&interned_strings, (const faster_str_ptr_t)&key2, FAST_INTERNED_STRING_PURPOSE_TEXT) !=
+          symbol2 ||
+      faster_str_cmp_binary(faster_interned_strings_str(&interned_strings, symbol2), (const faster_str_ptr_t)&key2) != 0 ||
+      faster_interned_strings_find(&interned_strings, (const faster_str_ptr_t)&key5) != FASTER_SYMBOL_INVALID) {
+    printf("Symbol lookup mismatch\n");
+    return -1;
+  }
+  faster_indexing_t base_count = faster_interned_strings_count(&interned_strings);
+  int generation = RAND_MAX / 40000;
+  for (int i = 0; i < generation; i++) {
+    char str_ptr[32];
+    fchar_t aster_text[32];
+    sprintf(str_ptr, "name_%d", i / 2);
+    faster_mb_to_unicode(str_ptr, aster_text, 32);
+    faster_str_t keyp = {aster_text, faster_strlen(aster_text)};
+    faster_symbol_t symbol = faster_interned_strings_symbol(&interned_strings, &keyp, FAST_INTERNED_STRING_PURPOSE_VNAME);
+    // every name is interned twice, the second time returns the first id
+    if (symbol != base_count + (faster_symbol_t)(i / 2) ||
+        faster_str_cmp_binary(faster_interned_strings_str(&interned_strings, symbol), &keyp) != 0 ||
+        faster_interned_strings_str(&interned_strings, symbol)->str_ptr == keyp.str_ptr) {
+      printf("Symbol %u for %s is not dense or not copied\n", symbol, str_ptr);
+      return -1;
+    }
+  }
+  if (faster_interned_strings_count(&interned_strings) != base_count + (faster_indexing_t)(generation + 1) / 2) {
+    printf("Symbol count mismatch\n");
+    return -1;
+  }
+  printf("Symbols OK, %u interned\n", faster_interned_strings_count(&interned_strings));
+
+  // strings are copied into the arena: the source buffer can go away, consecutive strings sit next to each other
+  fchar_t *buffer = calloc(FASTER_IS_ARENA_CHUNK_SIZE, 1);
+  faster_symbol_t previous = FASTER_SYMBOL_INVALID;
+  for (int i = 0; i < 1000; i++) {
+    char str_ptr[32];
+    sprintf(str_ptr, "arena_%d", i);
+    faster_mb_to_unicode(str_ptr, buffer, 32);
+    faster_str_t keyp = {buffer, faster_strlen(buffer)};
+    faster_symbol_t symbol = faster_interned_strings_symbol(&interned_strings, &keyp, FAST_INTERNED_STRING_PURPOSE_TEXT);
+    memset(buffer, 0xff, FASTER_STRING_MEMORY_SIZE(32));
+    const faster_str_t *view = faster_interned_strings_str(&interned_strings, symbol);
+    fchar_t expected[32];
+    faster_mb_to_unicode(str_ptr, expected, 32);
+    if (view->str_len != faster_strlen(expected) || memcmp(view->str_ptr, expected, FASTER_STRING_MEMORY_SIZE(view->str_len)) != 0 ||
+        view->str_ptr[view->str_len] != 0) {
+      printf("Interned copy of %s is broken\n", str_ptr);
+      return -1;
+    }
+    const faster_str_t *previous_view =
+        (previous == FASTER_SYMBOL_INVALID) ? NULL : faster_interned_strings_str(&interned_strings, previous);
+    if (previous_view != NULL && previous_view->str_ptr + previous_view->str_len + 1 != view->str_ptr &&
+        view->str_ptr != interned_strings.arena.chunks->data) {
+      printf("Interned strings are not contiguous\n");
+      return -1;
+    }
+    previous = symbol;
+  }
+  // longer than a chunk
+  fchar_t *long_text = calloc(FASTER_IS_ARENA_CHUNK_SIZE, 1);
+  for (size_t i = 0; i + 1 < FASTER_IS_ARENA_CHUNK_SIZE / sizeof(fchar_t); i++)
+    long_text[i] = (fchar_t)('a' + i % 26);
+  faster_str_t long_key = {long_text, faster_strlen(long_text)};
+  faster_symbol_t long_symbol = faster_interned_strings_symbol(&interned_strings, &long_key, FAST_INTERNED_STRING_PURPOSE_TEXT);
+  faster_symbol_t after_long = faster_interned_strings_symbol(&interned_strings, (const faster_str_ptr_t)&key5, FAST_INTERNED_STRING_PURPOSE_TEXT);
+  if (long_symbol == FASTER_SYMBOL_INVALID || faster_str_cmp_binary(faster_interned_strings_str(&interned_strings, long_symbol), &long_key) != 0 ||
+      faster_str_cmp_binary(faster_interned_strings_str(&interned_strings, after_long), (const faster_str_ptr_t)&key5) != 0 ||
+      faster_interned_strings_symbol(&interned_strings, &long_key, FAST_INTERNED_STRING_PURPOSE_TEXT) != long_symbol) {
+    printf("Long interned string is broken\n");
+    return -1;
+  }
+  printf("Arena OK, %zu string bytes in %zu bytes\n", interned_strings.arena.bytes,
+         faster_interned_strings_memory_usage(&interned_strings));
+  free(buffer);
+  free(long_text);
+
+  // layered tables: every thread sees the same base, overlays share its symbols and number their own after it
+  const faster_interned_strings_t *seen[4];
+  thrd_t threads[4];
+  for (int i = 0; i < 4; i++)
+    thrd_create(&threads[i], base_thread, &seen[i]);
+  for (int i = 0; i < 4; i++)
+    thrd_join(threads[i], NULL);
+  const faster_interned_strings_t *base = faster_interned_strings_base();
+  for (int i = 0; i < 4; i++) {
+    if (seen[i] != base) {
+      printf("Threads see different base tables\n");
+      return -1;
+    }
+  }
+  FASTER_DECLARE_RAW_STR(plus_text, "+");
+  FASTER_DECLARE_RAW_STR(local_text, "local_name");
+  faster_str_t plus = {plus_text, 1};
+  faster_str_t local = {local_text, faster_strlen(local_text)};
+  faster_interned_strings_t overlay1, overlay2;
+  faster_interned_strings_init_layered(&overlay1, base);
+  faster_interned_strings_init_layered(&overlay2, base);
+  faster_indexing_t base_size = faster_interned_strings_count(base);
+  faster_symbol_t plus_symbol = faster_interned_strings_find(base, &plus);
+  if (base_size == 0 || plus_symbol == FASTER_SYMBOL_INVALID || faster_interned_strings_memory_usage(&overlay1) != 0 ||
+      faster_interned_strings_symbol(&overlay1, &plus, FAST_INTERNED_STRING_PURPOSE_OPERATOR) != plus_symbol ||
+      faster_interned_strings_find(&overlay2, &plus) != plus_symbol || faster_interned_strings_count(&overlay1) != base_size) {
+    printf("Overlays do not share the base symbols\n");
+    return -1;
+  }
+  faster_symbol_t local1 = faster_interned_strings_symbol(&overlay1, &local, FAST_INTERNED_STRING_PURPOSE_VNAME);
+  if (local1 != base_size || faster_interned_strings_find(&overlay2, &local) != FASTER_SYMBOL_INVALID ||
+      faster_interned_strings_find(base, &local) != FASTER_SYMBOL_INVALID ||
+      faster_str_cmp_binary(faster_interned_strings_str(&overlay1, local1), &local) != 0 ||
+      faster_str_cmp_binary(faster_interned_strings_str(&overlay1, plus_symbol), &plus) != 0) {
+    printf("Overlay symbols leak between tables\n");
+    return -1;
+  }
+  // purposes added to a base symbol stay in the overlay
+  faster_interned_strings_intern(&overlay2, &plus, FAST_INTERNED_STRING_PURPOSE_FNAME);
+  if (!FASTER_INTERNED_STRING_PURPOSE_HAS_PURPOSE(faster_interned_strings_get(&overlay2, &plus), FAST_INTERNED_STRING_PURPOSE_FNAME) ||
+      FASTER_INTERNED_STRING_PURPOSE_HAS_PURPOSE(faster_interned_strings_get(&overlay1, &plus), FAST_INTERNED_STRING_PURPOSE_FNAME) ||
+      FASTER_INTERNED_STRING_PURPOSE_HAS_PURPOSE(faster_interned_strings_get(base, &plus), FAST_INTERNED_STRING_PURPOSE_FNAME) ||
+      !FASTER_INTERNED_STRING_PURPOSE_HAS_PURPOSE(faster_interned_strings_get(&overlay2, &plus), FAST_INTERNED_STRING_PURPOSE_OPERATOR)) {
+    printf("Overlay purposes leak into the base\n");
+    return -1;
+  }
+  faster_interned_strings_free(&overlay1);
+  faster_interned_strings_free(&overlay2);
+  printf("Layered tables OK, %u base symbols\n", base_size);
+
+  // reclamation: released symbols go away on the next sweep, their ids come back
+  faster_interned_strings_t churn;
+  faster_interned_strings_init_layered(&churn, base);
+  int churn_count = 20000;
+  faster_symbol_t *churn_symbols = calloc((size_t)churn_count, sizeof(faster_symbol_t));
+  for (int i = 0; i < churn_count; i++) {
+    char str_ptr[32];
+    fchar_t aster_text[32];
+    sprintf(str_ptr, "user_variable_%d", i);
+    faster_mb_to_unicode(str_ptr, aster_text, 32);
+    faster_str_t keyp = {aster_text, faster_strlen(aster_text)};
+    churn_symbols[i] = faster_interned_strings_symbol(&churn, &keyp, FAST_INTERNED_STRING_PURPOSE_VNAME);
+    if (i % 4 == 0)
+      faster_interned_strings_symbol(&churn, &keyp, FAST_INTERNED_STRING_PURPOSE_VNAME);
+  }
+  size_t churn_memory = faster_interned_strings_memory_usage(&churn);
+  // every other symbol is released, the ones interned twice need two releases
+  for (int i = 0; i < churn_count; i += 2)
+    faster_interned_strings_release(&churn, churn_symbols[i]);
+  faster_interned_strings_release(&churn, plus_symbol);
+  faster_indexing_t reclaimed = faster_interned_strings_sweep(&churn);
+  if (reclaimed != (faster_indexing_t)(churn_count / 2 - churn_count / 4)) {
+    printf("Sweep reclaimed %u symbols\n", reclaimed);
+    return -1;
+  }
+  for (int i = 0; i < churn_count; i += 4)
+    faster_interned_strings_release(&churn, churn_symbols[i]);
+  reclaimed += faster_interned_strings_sweep(&churn);
+  if (reclaimed != (faster_indexing_t)(churn_count / 2) || faster_interned_strings_count(&churn) != base_size + (faster_indexing_t)churn_count / 2 ||
+      faster_interned_strings_find(&churn, &plus) != plus_symbol || faster_interned_strings_memory_usage(&churn) >= churn_memory) {
+    printf("Sweep left %u symbols in %zu bytes\n", faster_interned_strings_count(&churn), faster_interned_strings_memory_usage(&churn));
+    return -1;
+  }
+  for (int i = 0; i < churn_count; i++) {
+    char str_ptr[32];
+    fchar_t aster_text[32];
+    sprintf(str_ptr, "user_variable_%d", i);
+    faster_mb_to_unicode(str_ptr, aster_text, 32);
+    faster_str_t keyp = {aster_text, faster_strlen(aster_text)};
+    faster_symbol_t symbol = faster_interned_strings_find(&churn, &keyp);
+    if ((i % 2 == 0) != (symbol == FASTER_SYMBOL_INVALID) ||
+        (symbol != FASTER_SYMBOL_INVALID &&
+         (symbol != churn_symbols[i] || faster_str_cmp_binary(faster_interned_strings_str(&churn, symbol), &keyp) != 0))) {
+      printf("Symbol of %s wrong after the sweep\n", str_ptr);
+      return -1;
+    }
+  }
+  // new names take the freed ids
+  for (int i = 0; i < churn_count / 2; i++) {
+    char str_ptr[32];
+    fchar_t aster_text[32];
+    sprintf(str_ptr, "next_variable_%d", i);
+    faster_mb_to_unicode(str_ptr, aster_text, 32);
+    faster_str_t keyp = {aster_text, faster_strlen(aster_text)};
+    faster_symbol_t symbol = faster_interned_strings_symbol(&churn, &keyp, FAST_INTERNED_STRING_PURPOSE_VNAME);
+    if (symbol >= base_size + (faster_symbol_t)churn_count ||
+        faster_str_cmp_binary(faster_interned_strings_str(&churn, symbol), &keyp) != 0) {
+      printf("Freed ids are not reused\n");
+      return -1;
+    }
+  }
+  printf("Sweep OK, %u symbols in %zu bytes\n", faster_interned_strings_count(&churn), faster_interned_strings_memory_usage(&churn));
+  // concurrent table: threads interning the same names in different orders agree on one dense id space
+  faster_concurrent_interned_strings_t concurrent;
+  if (faster_concurrent_interned_strings_init(&concurrent, faster_interned_strings_base()) != FAST_ERROR_NONE) {
+    printf("Concurrent table init failed\n");
+    return -1;
+  }
+  fchar_t(*names)[32] = calloc(CONCURRENT_NAMES, sizeof(*names));
+  faster_symbol_t *concurrent_symbols = calloc((size_t)CONCURRENT_THREADS * CONCURRENT_NAMES, sizeof(faster_symbol_t));
+  for (int i = 0; i < CONCURRENT_NAMES; i++) {
+    char str_ptr[32];
+    sprintf(str_ptr, "shared_name_%d", i);
+    faster_mb_to_unicode(str_ptr, names[i], 32);
+  }
+  // strides coprime with the name count
+  int strides[CONCURRENT_THREADS] = {1, 7, 13, 19997};
+  struct concurrent_worker_s workers[CONCURRENT_THREADS];
+  thrd_t workers_threads[CONCURRENT_THREADS];
+  for (int t = 0; t < CONCURRENT_THREADS; t++) {
+    workers[t] = (struct concurrent_worker_s){&concurrent, names, concurrent_symbols + (size_t)t * CONCURRENT_NAMES, strides[t], false};
+    thrd_create(&workers_threads[t], concurrent_thread, &workers[t]);
+  }
+  for (int t = 0; t < CONCURRENT_THREADS; t++)
+    thrd_join(workers_threads[t], NULL);
+  bool *taken = calloc(CONCURRENT_NAMES, sizeof(bool));
+  for (int i = 0; i < CONCURRENT_NAMES; i++) {
+    faster_symbol_t symbol = concurrent_symbols[i];
+    faster_str_t keyp = {names[i], faster_strlen(names[i])};
+    bool agreed = symbol >= base_size && symbol < base_size + CONCURRENT_NAMES && !taken[symbol - base_size] &&
+                  faster_str_cmp_binary(faster_concurrent_interned_strings_str(&concurrent, symbol), &keyp) == 0;
+    for (int t = 1; t < CONCURRENT_THREADS; t++)
+      agreed = agreed && concurrent_symbols[(size_t)t * CONCURRENT_NAMES + i] == symbol;
+    if (!agreed) {
+      printf("Concurrent symbol of name %d wrong\n", i);
+      return -1;
+    }
+    taken[symbol - base_size] = true;
+  }
+  for (int t = 0; t < CONCURRENT_THREADS; t++) {
+    if (!workers[t].ok) {
+      printf("Concurrent lookups of thread %d failed\n", t);
+      return -1;
+    }
+  }
+  // base symbols are shared, purposes added to them stay in the table
+  if (faster_concurrent_interned_strings_count(&concurrent) != base_size + CONCURRENT_NAMES ||
+      faster_concurrent_interned_strings_symbol(&concurrent, &plus, FAST_INTERNED_STRING_PURPOSE_TEXT) != plus_symbol ||
+      !FASTER_INTERNED_STRING_PURPOSE_HAS_PURPOSE(faster_concurrent_interned_strings_get(&concurrent, &plus),
+                                                  FAST_INTERNED_STRING_PURPOSE_TEXT | FAST_INTERNED_STRING_PURPOSE_OPERATOR) ||
+      FASTER_INTERNED_STRING_PURPOSE_HAS_PURPOSE(faster_interned_strings_purpose(faster_interned_strings_base(), plus_symbol),
+                                                 FAST_INTERNED_STRING_PURPOSE_TEXT) ||
+      faster_concurrent_interned_strings_find(&concurrent, (const faster_str_ptr_t)&key5) != FASTER_SYMBOL_INVALID) {
+    printf("Concurrent table holds %u symbols\n", faster_concurrent_interned_strings_count(&concurrent));
+    return -1;
+  }
+  printf("Concurrent table OK, %u symbols\n", faster_concurrent_interned_strings_count(&concurrent));
+  faster_concurrent_interned_strings_free(&concurrent);
+  free(taken);
+  free(concurrent_symbols);
+  free(names);
+
+  // UTF-8 text meets the fchar_t form of the same string in one symbol, short and longer than the stack buffer
+  const char *utf8_texts[] = {"na\xc3\xafve \xe2\x82\xac\xf0\x9f\x98\x80",
+                              "a key longer than sixty-four bytes, so it is decoded outside the stack \xc3\xa9\xc3\xa9"};
+  for (size_t i = 0; i < sizeof(utf8_texts) / sizeof(utf8_texts[0]); i++) {
+    fchar_t units[128];
+    faster_str_t str = {units, faster_mb_to_unicode(utf8_texts[i], units, 128)};
+    faster_symbol_t from_units = faster_interned_strings_symbol(&interned_strings, &str, FAST_INTERNED_STRING_PURPOSE_TEXT);
+    size_t len = strlen(utf8_texts[i]);
+    if (faster_interned_strings_find_utf8(&interned_strings, utf8_texts[i], len) != from_units ||
+        faster_interned_strings_symbol_utf8(&interned_strings, utf8_texts[i], len, FAST_INTERNED_STRING_PURPOSE_TEXT) != from_units ||
+        faster_interned_strings_find_utf8(&interned_strings, utf8_texts[i], len - 1) == from_units) {
+      printf("UTF-8 text %zu interned apart from its units\n", i);
+      return -1;
+    }
+  }
+
+  faster_interned_strings_free(&churn);
+  free(churn_symbols);
   faster_interned_strings_free(&interned_strings);
   return 0;
 }
@@ -1,6 +1,8 @@
 #include "aster/faster.h"
+#include "aster/faster_prim.h"
 #include <locale.h>
 #include <stdio.h>
+#include <time.h>
 
 void test_stub_conversion() {
 // only in non-unicode mode
@@ -107,6 +109,437 @@ void test_invalid_sequences() {
 #endif
 }
 
+#if FASTER_UNICODE_SUPPORT != FASTER_UNICODE_SUPPORT_NONE
+// the locale based conversion the kernels replaced, for UTF-8 input without code points above U+10FFFF
+static size_t reference_mb_to_unicode(const char *src, fchar_t *_dest, size_t dest_size) {
+  mbstate_t state = {0};
+  const char *ptr = src;
+  const char *end = src + strlen(src);
+  size_t rc;
+  fchar_t *dest = _dest;
+  dest_size--;
+  while ((rc = FASTER_UNICODE_MB_TO_UC_FUNC(dest, ptr, ((size_t)(end - ptr)) + 1, &state))) {
+    if (rc == (size_t)-3) {
+      dest++;
+    } else if (rc == (size_t)-2) {
+      continue;
+    } else if (rc == (size_t)-1) {
+#if FASTER_UNICODE_SUPPORT_ONE_BYTE == FASTER_UNICODE_SUPPORT
+      size_t tmp = strlen(FASTER_UNICODE_SUPPORT_INVALID_CHARACTER_STRING_UTF8);
+      if (dest + tmp < _dest + dest_size) {
+        memcpy(dest, FASTER_UNICODE_SUPPORT_INVALID_CHARACTER_STRING_UTF8, tmp);
+        dest += tmp;
+      }
+#else
+      *dest = FASTER_UNICODE_SUPPORT_INVALID_CHARACTER_VALUE;
+      dest++;
+#endif
+      ptr++;
+      memset(&state, 0, sizeof(state));
+    } else {
+      dest++;
+      ptr += rc;
+    }
+    if (((size_t)(dest - _dest)) >= dest_size)
+      break;
+  }
+  *dest = '\0';
+  return (size_t)(dest - _dest);
+}
+
+static size_t reference_unicode_to_mb(const fchar_t *src, char *dest, size_t dest_size) {
+  mbstate_t ps = {0};
+  char *dest_start = dest;
+  for (; *src && (size_t)(dest - dest_start) < dest_size - 4; src++) {
+    size_t rc = FASTER_UNICODE_UC_TO_MB_FUNC(dest, *src, &ps);
+    if (rc != (size_t)-1)
+      dest += rc;
+  }
+  *dest = '\0';
+  return (size_t)(dest - dest_start);
+}
+#endif
+
+#define KERNEL_TEXT_SIZE 4096
+
+// ASCII runs of every length and offset, so the kernels start and stop everywhere, mixed with multibyte
+// and broken sequences (no lead byte above F3, the C library accepts code points beyond U+10FFFF)
+static void random_text(char *text, size_t size) {
+  static const unsigned char odd[] = {0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xC1, 0xC2, 0xDF,
+                                      0xE0, 0xE4, 0xED, 0xEF, 0xF0, 0xF1, 0xF3, 0xFE, 0xFF};
+  static const char *valid[] = {"\xC2\x80", "\xC3\xA9", "\xDF\xBF", "\xE0\xA0\x80", "\xE4\xBD\xA0", "\xED\x9F\xBF",
+                                 "\xEF\xBF\xBD", "\xF0\x90\x80\x80", "\xF0\x9F\x9A\x80", "\xF4\x8F\xBF\xBF"};
+  size_t i = 0;
+  while (i < size - 1) {
+    size_t run = (rand() % 2) ? 0 : (size_t)(rand() % 200);
+    for (; run > 0 && i < size - 1; run--)
+      text[i++] = (char)(' ' + rand() % 95);
+    if (rand() % 2) {
+      const char *sequence = valid[rand() % (int)(sizeof(valid) / sizeof(valid[0]))];
+      for (; *sequence && i < size - 1; sequence++)
+        text[i++] = *sequence;
+    } else if (i < size - 1) {
+      text[i++] = (char)odd[rand() % (int)sizeof(odd)];
+    }
+  }
+  text[size - 1] = '\0';
+}
+
+void test_kernels_against_reference() {
+  char *text = malloc(KERNEL_TEXT_SIZE + 64);
+  fchar_t *unicode = malloc((KERNEL_TEXT_SIZE + 64) * sizeof(fchar_t) * 2);
+  fchar_t *expected = malloc((KERNEL_TEXT_SIZE + 64) * sizeof(fchar_t) * 2);
+  char *mb = malloc(KERNEL_TEXT_SIZE * 4);
+  char *expected_mb = malloc(KERNEL_TEXT_SIZE * 4);
+  faster_simd_level_t supported = faster_simd_level();
+  srand(1);
+  for (int round = 0; round < 200; round++) {
+    size_t offset = (size_t)(round % 64);
+    random_text(text + offset, KERNEL_TEXT_SIZE - (size_t)(rand() % 1000));
+    size_t dest_size = (round % 5 == 0) ? (size_t)(rand() % 300 + 1) : KERNEL_TEXT_SIZE * 2;
+#if FASTER_UNICODE_SUPPORT != FASTER_UNICODE_SUPPORT_NONE
+    size_t expected_len = reference_mb_to_unicode(text + offset, expected, KERNEL_TEXT_SIZE * 2);
+#else
+    size_t expected_len = strlen(text + offset);
+    memcpy(expected, text + offset, expected_len + 1);
+#endif
+    for (faster_simd_level_t level = FASTER_SIMD_SCALAR; level <= supported; level++) {
+      assert(faster_simd_select(level) == level);
+      size_t len = faster_mb_to_unicode(text + offset, unicode, dest_size);
+      if (dest_size == KERNEL_TEXT_SIZE * 2) {
+        assert(len == expected_len);
+        assert(memcmp(unicode, expected, (len + 1) * sizeof(fchar_t)) == 0);
+      } else {
+        // a short buffer ends like the reference, except that sequences the reference split are left out
+        fchar_t short_expected[301];
+#if FASTER_UNICODE_SUPPORT != FASTER_UNICODE_SUPPORT_NONE
+        size_t short_len = reference_mb_to_unicode(text + offset, short_expected, dest_size);
+#else
+        size_t short_len = (expected_len < dest_size - 1) ? expected_len : dest_size - 1;
+        memcpy(short_expected, expected, short_len * sizeof(fchar_t));
+#endif
+        assert(len < dest_size && unicode[len] == 0);
+        assert(len <= short_len && short_len - len < 4);
+        assert(memcmp(unicode, short_expected, len * sizeof(fchar_t)) == 0);
+      }
+    }
+    // back to UTF-8, the replacement characters included
+    size_t expected_mb_len = 0;
+    for (faster_simd_level_t level = FASTER_SIMD_SCALAR; level <= supported; level++) {
+      faster_simd_select(level);
+      size_t mb_len = faster_unicode_to_mb(expected, mb, KERNEL_TEXT_SIZE * 4);
+      if (level == FASTER_SIMD_SCALAR) {
+#if FASTER_UNICODE_SUPPORT != FASTER_UNICODE_SUPPORT_NONE
+        expected_mb_len = reference_unicode_to_mb(expected, expected_mb, KERNEL_TEXT_SIZE * 4);
+#else
+        expected_mb_len = strlen(text + offset);
+        memcpy(expected_mb, text + offset, expected_mb_len + 1);
+#endif
+      }
+      assert(mb_len == expected_mb_len);
+      assert(memcmp(mb, expected_mb, mb_len + 1) == 0);
+    }
+  }
+  faster_simd_select(supported);
+  free(text);
+  free(unicode);
+  free(expected);
+  free(mb);
+  free(expected_mb);
+}
+
+// random_text fed in chunks of random size into random room: the pieces join to the one-shot conversion,
+// however the chunks cut the sequences
+void test_stream_chunks() {
+  char *text = malloc(KERNEL_TEXT_SIZE);
+  fchar_t *expected = malloc(KERNEL_TEXT_SIZE * sizeof(fchar_t) * 2);
+  fchar_t *unicode = malloc(KERNEL_TEXT_SIZE * sizeof(fchar_t) * 2);
+  char *expected_mb = malloc(KERNEL_TEXT_SIZE * 4);
+  char *mb = malloc(KERNEL_TEXT_SIZE * 4);
+  srand(2);
+  for (int round = 0; round < 100; round++) {
+    random_text(text, KERNEL_TEXT_SIZE - (size_t)(rand() % 1000));
+    size_t text_len = strlen(text);
+    size_t expected_len = faster_mb_to_unicode(text, expected, KERNEL_TEXT_SIZE * 2);
+    faster_mb_stream_t stream;
+    faster_mb_stream_init(&stream);
+    size_t at = 0, len = 0;
+    while (at < text_len || stream.pending_len > 0) {
+      size_t chunk = (size_t)(rand() % 40);
+      if (chunk > text_len - at)
+        chunk = text_len - at;
+      bool last = at + chunk == text_len;
+      // a chunk may take several calls when the room runs out
+      do {
+        size_t room = FASTER_STREAM_MIN_ROOM + (size_t)(rand() % 50), consumed;
+        if (room > KERNEL_TEXT_SIZE * 2 - len)
+          room = KERNEL_TEXT_SIZE * 2 - len;
+        size_t written = faster_mb_stream_to_unicode(&stream, text + at, chunk, &consumed, unicode + len, room, last);
+        assert(consumed <= chunk && written <= room);
+        assert(consumed > 0 || written > 0 || (chunk == 0 && (!last || stream.pending_len == 0)));
+        at += consumed;
+        chunk -= consumed;
+        len += written;
+      } while (chunk > 0 || (last && stream.pending_len > 0));
+    }
+    assert(len == expected_len);
+    assert(memcmp(unicode, expected, len * sizeof(fchar_t)) == 0);
+
+    // and back, cutting surrogate pairs and UTF-8 units the same way
+    size_t expected_mb_len = faster_unicode_to_mb(expected, expected_mb, KERNEL_TEXT_SIZE * 4);
+    faster_unicode_stream_t back;
+    faster_unicode_stream_init(&back);
+    size_t mb_len = 0;
+    at = 0;
+    while (at < expected_len || back.pending_len > 0) {
+      size_t chunk = (size_t)(rand() % 40);
+      if (chunk > expected_len - at)
+        chunk = expected_len - at;
+      bool last = at + chunk == expected_len;
+      do {
+        size_t room = FASTER_STREAM_MIN_ROOM + (size_t)(rand() % 50), consumed;
+        size_t written = faster_unicode_stream_to_mb(&back, expected + at, chunk, &consumed, mb + mb_len, room, last);
+        assert(consumed <= chunk && written <= room);
+        at += consumed;
+        chunk -= consumed;
+        mb_len += written;
+      } while (chunk > 0 || (last && back.pending_len > 0));
+    }
+    assert(mb_len == expected_mb_len);
+    assert(memcmp(mb, expected_mb, mb_len) == 0);
+  }
+
+  // NUL is an ordinary character
+  faster_mb_stream_t stream;
+  faster_mb_stream_init(&stream);
+  fchar_t buf[8];
+  size_t consumed;
+  assert(faster_mb_stream_to_unicode(&stream, "a\0b", 3, &consumed, buf, 8, true) == 3);
+  assert(consumed == 3 && buf[0] == 'a' && buf[1] == 0 && buf[2] == 'b');
+#if FASTER_UNICODE_SUPPORT != FASTER_UNICODE_SUPPORT_NONE
+  // a sequence cut at the end waits, and is replaced byte by byte when the input ends there
+  assert(faster_mb_stream_to_unicode(&stream, "x\xE4\xBD", 3, &consumed, buf, 8, false) == 1);
+  assert(consumed == 3 && stream.pending_len == 2);
+  fchar_t replaced[8];
+  size_t replaced_len = faster_mb_to_unicode("\xE4\xBD", replaced, 8);
+  assert(faster_mb_stream_to_unicode(&stream, "", 0, &consumed, buf, 8, true) == replaced_len);
+  assert(stream.pending_len == 0 && memcmp(buf, replaced, replaced_len * sizeof(fchar_t)) == 0);
+  // or completes from the next chunk
+  assert(faster_mb_stream_to_unicode(&stream, "\xE4", 1, &consumed, buf, 8, false) == 0);
+  size_t written = faster_mb_stream_to_unicode(&stream, "\xBD\xA0!", 3, &consumed, buf, 8, true);
+  assert(consumed == 3 && faster_unicode_stream_to_mb(&(faster_unicode_stream_t){0}, buf, written, &consumed,
+                                                      (char *)replaced, 8, true) == 4);
+  assert(memcmp(replaced, "\xE4\xBD\xA0!", 4) == 0);
+#endif
+  free(text);
+  free(expected);
+  free(unicode);
+  free(expected_mb);
+  free(mb);
+}
+
+static size_t encode_utf8(uint_least32_t code, char *dest) {
+  if (code < 0x80) {
+    dest[0] = (char)code;
+    return 1;
+  }
+  if (code < 0x800) {
+    dest[0] = (char)(0xC0 | (code >> 6));
+    dest[1] = (char)(0x80 | (code & 0x3F));
+    return 2;
+  }
+  if (code < 0x10000) {
+    dest[0] = (char)(0xE0 | (code >> 12));
+    dest[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+    dest[2] = (char)(0x80 | (code & 0x3F));
+    return 3;
+  }
+  dest[0] = (char)(0xF0 | (code >> 18));
+  dest[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+  dest[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+  dest[3] = (char)(0x80 | (code & 0x3F));
+  return 4;
+}
+
+// the valid prefix ends where the conversion puts its first replacement, the decoded code points encode back
+// to the UTF-8 the conversion produces, and in the byte builds valid input is used without a conversion
+void test_utf8_native() {
+  char *text = malloc(KERNEL_TEXT_SIZE);
+  fchar_t *unicode = malloc(KERNEL_TEXT_SIZE * sizeof(fchar_t) * 2);
+  char *mb = malloc(KERNEL_TEXT_SIZE * 4);
+  char *encoded = malloc(KERNEL_TEXT_SIZE * 4);
+  srand(3);
+  for (int round = 0; round < 100; round++) {
+    random_text(text, KERNEL_TEXT_SIZE - (size_t)(rand() % 1000));
+    size_t text_len = strlen(text);
+    if (round % 4 == 0) {
+      // valid throughout
+      size_t keep = faster_utf8_valid(text, text_len);
+      text[keep] = '\0';
+      text_len = keep;
+    }
+    size_t valid = faster_utf8_valid(text, text_len);
+    assert(valid <= text_len);
+    size_t len = faster_mb_to_unicode(text, unicode, KERNEL_TEXT_SIZE * 2);
+#if FASTER_UNICODE_SUPPORT != FASTER_UNICODE_SUPPORT_NONE
+    size_t encoded_len = 0, pos = 0, at = 0;
+    while (pos < len) {
+      uint_least32_t code = faster_str_decode(unicode, len, &pos);
+      encoded_len += encode_utf8(code, encoded + encoded_len);
+      if (encoded_len <= valid)
+        at = encoded_len;
+    }
+    assert(at == valid && (valid == text_len || memcmp(encoded + valid, "\xEF\xBF\xBD", 3) == 0));
+    assert(memcmp(encoded, text, valid) == 0);
+    assert(faster_unicode_to_mb(unicode, mb, KERNEL_TEXT_SIZE * 4) == encoded_len);
+    assert(memcmp(mb, encoded, encoded_len) == 0);
+#endif
+#if FASTER_UNICODE_NATIVE_BYTES
+    if (valid == text_len) {
+      faster_str_t view = faster_str_from_utf8(text, text_len);
+      assert(view.str_len == len && memcmp(view.str_ptr, unicode, len) == 0);
+    }
+#endif
+  }
+  // broken and cut sequences decode one unit at a time
+#if FASTER_UNICODE_SUPPORT == FASTER_UNICODE_SUPPORT_ONE_BYTE
+  const fchar_t broken[] = {'a', 0xE4, 0xBD, 0xC0, 0xE4, 0xBD, 0xA0};
+  const uint_least32_t codes[] = {'a', 0xFFFD, 0xFFFD, 0xFFFD, 0x4F60};
+  size_t pos = 0;
+  for (size_t i = 0; i < sizeof(codes) / sizeof(codes[0]); i++)
+    assert(faster_str_decode(broken, sizeof(broken), &pos) == codes[i]);
+  assert(pos == sizeof(broken));
+#endif
+  assert(faster_utf8_valid("abcdefgh\xE4\xBD\xA0ijklmnop\xE4\xBD", 21) == 19);
+  free(text);
+  free(unicode);
+  free(mb);
+  free(encoded);
+}
+
+// mostly well-formed text in long runs of 2- and 3-byte sequences, so the transcode and valid kernels take whole
+// blocks, with now and then a 4-byte sequence or a broken byte where they have to stop
+static void multibyte_text(char *text, size_t size) {
+  static const char *sequences[] = {"a", " ", "\xC3\xA9", "\xD0\x96", "\xDF\xBF", "\xE0\xA0\x80", "\xE4\xBD\xA0",
+                                    "\xED\x9F\xBF", "\xEE\x80\x80", "\xEF\xBF\xBD"};
+  size_t i = 0;
+  while (i < size - 1) {
+    const char *sequence;
+    int pick = rand() % 1000;
+    if (pick == 0)
+      sequence = "\xF0\x9F\x9A\x80";
+    else if (pick == 1)
+      sequence = (rand() % 2) ? "\xED\xA0\x80" : "\xC0\x80"; // a surrogate and an overlong
+    else if (pick == 2)
+      sequence = "\xE4\xBD"; // cut short
+    else
+      sequence = sequences[rand() % (int)(sizeof(sequences) / sizeof(sequences[0]))];
+    size_t len = strlen(sequence);
+    if (i + len > size - 1)
+      break;
+    memcpy(text + i, sequence, len);
+    i += len;
+  }
+  text[i] = '\0';
+}
+
+// every kernel level converts and validates mixed text as the scalar code does, at every offset and room
+void test_multibyte_kernels() {
+  char *text = malloc(KERNEL_TEXT_SIZE + 64);
+  fchar_t *unicode = malloc(KERNEL_TEXT_SIZE * sizeof(fchar_t) * 2);
+  fchar_t *expected = malloc(KERNEL_TEXT_SIZE * sizeof(fchar_t) * 2);
+  faster_simd_level_t supported = faster_simd_level();
+  srand(4);
+  for (int round = 0; round < 400; round++) {
+    size_t offset = (size_t)(round % 64);
+    multibyte_text(text + offset, KERNEL_TEXT_SIZE - (size_t)(rand() % 1000));
+    size_t text_len = strlen(text + offset);
+    size_t dest_size = (round % 3 == 0) ? (size_t)(rand() % 600 + 1) : KERNEL_TEXT_SIZE * 2;
+    faster_simd_select(FASTER_SIMD_SCALAR);
+    size_t expected_len = faster_mb_to_unicode(text + offset, expected, dest_size);
+    size_t expected_valid = faster_utf8_valid(text + offset, text_len);
+    for (faster_simd_level_t level = FASTER_SIMD_SSE2; level <= supported; level++) {
+      faster_simd_select(level);
+      size_t len = faster_mb_to_unicode(text + offset, unicode, dest_size);
+      assert(len == expected_len);
+      assert(memcmp(unicode, expected, (len + 1) * sizeof(fchar_t)) == 0);
+      assert(faster_utf8_valid(text + offset, text_len) == expected_valid);
+      // and the stream form, one chunk
+      faster_mb_stream_t stream;
+      faster_mb_stream_init(&stream);
+      size_t consumed;
+      size_t stream_len = faster_mb_stream_to_unicode(&stream, text + offset, text_len, &consumed, unicode,
+                                                      KERNEL_TEXT_SIZE * 2, true);
+      if (dest_size == KERNEL_TEXT_SIZE * 2) {
+        assert(consumed == text_len && stream_len == expected_len);
+        assert(memcmp(unicode, expected, len * sizeof(fchar_t)) == 0);
+      }
+    }
+  }
+  faster_simd_select(supported);
+  free(text);
+  free(unicode);
+  free(expected);
+}
+
+#define THROUGHPUT_SIZE (8 * 1024 * 1024)
+
+void test_kernel_throughput() {
+  char *text = malloc(THROUGHPUT_SIZE);
+  fchar_t *unicode = malloc(THROUGHPUT_SIZE * sizeof(fchar_t));
+  char *back = malloc(THROUGHPUT_SIZE);
+  for (size_t i = 0; i < THROUGHPUT_SIZE - 1; i++)
+    text[i] = (char)('a' + i % 26);
+  text[THROUGHPUT_SIZE - 1] = '\0';
+  faster_simd_level_t supported = faster_simd_level();
+  for (faster_simd_level_t level = FASTER_SIMD_SCALAR; level <= supported; level++) {
+    faster_simd_select(level);
+    struct timespec start, middle, end;
+    timespec_get(&start, TIME_UTC);
+    size_t len = faster_mb_to_unicode(text, unicode, THROUGHPUT_SIZE);
+    timespec_get(&middle, TIME_UTC);
+    size_t back_len = faster_unicode_to_mb(unicode, back, THROUGHPUT_SIZE);
+    timespec_get(&end, TIME_UTC);
+    assert(len == THROUGHPUT_SIZE - 1 && back_len == THROUGHPUT_SIZE - 1);
+    double to_unicode = (double)(middle.tv_sec - start.tv_sec) + (double)(middle.tv_nsec - start.tv_nsec) / 1e9;
+    double to_mb = (double)(end.tv_sec - middle.tv_sec) + (double)(end.tv_nsec - middle.tv_nsec) / 1e9;
+    printf("ASCII at level %d: %.0f MB/s to unicode, %.0f MB/s back\n", (int)level, THROUGHPUT_SIZE / 1e6 / to_unicode,
+           THROUGHPUT_SIZE / 1e6 / to_mb);
+  }
+  faster_simd_select(supported);
+  // what the byte builds do instead of converting
+  struct timespec start, end;
+  timespec_get(&start, TIME_UTC);
+  size_t valid = faster_utf8_valid(text, THROUGHPUT_SIZE - 1);
+  timespec_get(&end, TIME_UTC);
+  assert(valid == THROUGHPUT_SIZE - 1);
+  printf("ASCII validated in place: %.0f MB/s\n",
+         THROUGHPUT_SIZE / 1e6 / ((double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9));
+  // Cyrillic and CJK, two and three bytes a character
+  for (size_t i = 0; i + 5 < THROUGHPUT_SIZE; i += 5)
+    memcpy(text + i, "\xD0\x96\xE4\xBD\xA0", 5);
+  text[THROUGHPUT_SIZE - 1 - (THROUGHPUT_SIZE - 1) % 5] = '\0';
+  size_t text_len = strlen(text);
+  for (faster_simd_level_t level = FASTER_SIMD_SCALAR; level <= supported; level++) {
+    faster_simd_select(level);
+    timespec_get(&start, TIME_UTC);
+    size_t len = faster_mb_to_unicode(text, unicode, THROUGHPUT_SIZE);
+    struct timespec middle;
+    timespec_get(&middle, TIME_UTC);
+    valid = faster_utf8_valid(text, text_len);
+    timespec_get(&end, TIME_UTC);
+    assert(valid == text_len && len > 0);
+    double to_unicode = (double)(middle.tv_sec - start.tv_sec) + (double)(middle.tv_nsec - start.tv_nsec) / 1e9;
+    double validate = (double)(end.tv_sec - middle.tv_sec) + (double)(end.tv_nsec - middle.tv_nsec) / 1e9;
+    printf("Multibyte at level %d: %.0f MB/s to unicode, %.0f MB/s validated\n", (int)level, text_len / 1e6 / to_unicode,
+           text_len / 1e6 / validate);
+  }
+  faster_simd_select(supported);
+  free(text);
+  free(unicode);
+  free(back);
+}
+
 #if FASTER_UNICODE_SUPPORT != FASTER_UNICODE_SUPPORT_NONE
 #define _TEST_LOCALE "C.UTF-8"
 #else
@@ -123,5 +556,10 @@ int main(void) {
   test_invalid_sequences();
   test_surrogate_handling();
   test_conversion_roundtrip();
+  test_kernels_against_reference();
+  test_stream_chunks();
+  test_utf8_native();
+  test_multibyte_kernels();
+  test_kernel_throughput();
   return 0;
 }
@@ -0,0 +1,204 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "aster/faster_par.h"
+#include <time.h>
+
+#define KEY_SIZE 32
+
+// sum and count of the values, plus the first and last element seen: combining two pieces out of order
+// shows up as a break between the last element of one and the first of the next
+struct walk_sum_s {
+  uint64_t sum;
+  uint64_t count;
+  const void *first;
+  const void *last;
+  bool ordered;
+};
+
+// how elements follow each other in a walk, the context of the reductions
+struct walk_order_s {
+  int (*before)(const void *, const void *);
+};
+
+static void sum_init(void *accumulator, void *context) {
+  (void)context;
+  *(struct walk_sum_s *)accumulator = (struct walk_sum_s){.ordered = true};
+}
+
+static void sum_combine(void *accumulator, const void *other, void *context) {
+  struct walk_sum_s *into = accumulator;
+  const struct walk_sum_s *from = other;
+  int (*before)(const void *, const void *) = ((const struct walk_order_s *)context)->before;
+  if (from->count == 0)
+    return;
+  if (into->count == 0) {
+    *into = *from;
+    return;
+  }
+  into->ordered = into->ordered && from->ordered && before(into->last, from->first);
+  into->sum += from->sum;
+  into->count += from->count;
+  into->last = from->last;
+}
+
+static void sum_add(struct walk_sum_s *accumulator, const void *element, uint64_t value,
+                    int (*before)(const void *, const void *)) {
+  if (accumulator->count == 0)
+    accumulator->first = element;
+  else
+    accumulator->ordered = accumulator->ordered && before(accumulator->last, element);
+  accumulator->last = element;
+  accumulator->sum += value;
+  accumulator->count++;
+}
+
+static int avl_before(const void *node1, const void *node2) {
+  return faster_str_cmp_binary(&((const AVLNode_t *)node1)->key, &((const AVLNode_t *)node2)->key) < 0;
+}
+
+static int ht_before(const void *entry1, const void *entry2) {
+  return (const faster_ht_entry_t *)entry1 < (const faster_ht_entry_t *)entry2;
+}
+
+static struct walk_order_s avl_order = {avl_before};
+static struct walk_order_s ht_order = {ht_before};
+
+static void avl_fold(void *accumulator, AVLNodePtr node, void *context) {
+  sum_add(accumulator, node, (uint64_t)(uintptr_t)node->value, ((const struct walk_order_s *)context)->before);
+}
+
+static void ht_fold(void *accumulator, faster_ht_entry_ptr_t entry, void *context) {
+  sum_add(accumulator, entry, (uint64_t)(uintptr_t)entry->value, ((const struct walk_order_s *)context)->before);
+}
+
+static void avl_double(AVLNodePtr node, void *context) {
+  atomic_fetch_add((atomic_uint_fast64_t *)context, 1);
+  node->value = (faster_value_ptr)((uintptr_t)node->value * 2);
+}
+
+static void ht_double(faster_ht_entry_ptr_t entry, void *context) {
+  atomic_fetch_add((atomic_uint_fast64_t *)context, 1);
+  entry->value = (faster_value_ptr)((uintptr_t)entry->value * 2);
+}
+
+static bool check_sum(const char *what, const struct walk_sum_s *result, uint64_t sum, uint64_t count) {
+  if (result->sum != sum || result->count != count || !result->ordered) {
+    printf("%s: sum %lu of %lu elements, expected %lu of %lu%s\n", what, (unsigned long)result->sum,
+           (unsigned long)result->count, (unsigned long)sum, (unsigned long)count, result->ordered ? "" : ", out of order");
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(tree, 256);
+  faster_ht_t ht;
+  faster_ht_init(&ht, 16, faster_ht_hash);
+
+  int generation = RAND_MAX / 4000;
+  if (argc > 1 && atoi(argv[1]) > 0)
+    generation = atoi(argv[1]);
+  fchar_t(*texts)[KEY_SIZE] = calloc((size_t)generation, sizeof(*texts));
+  srand(0);
+  uint64_t sum = 0, count = 0;
+  for (int i = 0; i < generation; i++) {
+    char str_ptr[KEY_SIZE];
+    sprintf(str_ptr, "metric.%d", rand() % (generation * 2));
+    faster_mb_to_unicode(str_ptr, texts[i], KEY_SIZE);
+    faster_str_t keyp = {texts[i], faster_strlen(texts[i])};
+    if (AVL_get(&tree, &keyp) == NULL) {
+      AVL_insert_or_update(&tree, &keyp, (faster_value_ptr)(uintptr_t)(i + 1));
+      faster_ht_key_data_t key = {texts[i], faster_str_bytelen(texts[i])};
+      faster_ht_set(&ht, &key, (faster_value_ptr)(uintptr_t)(i + 1));
+      sum += (uint64_t)(i + 1);
+      count++;
+    }
+  }
+  // holes in the dense entries are skipped
+  for (int i = 0; i < generation; i += 7) {
+    faster_str_t keyp = {texts[i], faster_strlen(texts[i])};
+    faster_value_ptr value = AVL_get(&tree, &keyp);
+    if (value != NULL && AVL_remove(&tree, &keyp)) {
+      faster_ht_key_data_t key = {texts[i], faster_str_bytelen(texts[i])};
+      faster_ht_remove(&ht, &key);
+      sum -= (uint64_t)(uintptr_t)value;
+      count--;
+    }
+  }
+
+  unsigned int thread_counts[] = {0, 1, 2, 3, 8};
+  for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+    faster_pool_t pool;
+    if (faster_pool_init(&pool, thread_counts[t]) != FAST_ERROR_NONE) {
+      printf("Pool of %u threads failed\n", thread_counts[t]);
+      return -1;
+    }
+    faster_pool_ptr_t pools[] = {&pool, NULL};
+    for (size_t p = 0; p < 2; p++) {
+      struct walk_sum_s result;
+      faster_reduction_t avl_reduction = {sizeof(struct walk_sum_s), sum_init, sum_combine, &avl_order};
+      faster_reduction_t ht_reduction = {sizeof(struct walk_sum_s), sum_init, sum_combine, &ht_order};
+      if (AVL_reduce_parallel(pools[p], &tree, avl_fold, &avl_reduction, &result) != FAST_ERROR_NONE ||
+          !check_sum("AVL reduce", &result, sum, count))
+        return -1;
+      if (faster_ht_reduce_parallel(pools[p], &ht, ht_fold, &ht_reduction, &result) != FAST_ERROR_NONE ||
+          !check_sum("Hash table reduce", &result, sum, count))
+        return -1;
+
+      // every element visited exactly once, values updated in place
+      atomic_uint_fast64_t visited = 0;
+      AVL_for_each_parallel(pools[p], &tree, avl_double, &visited);
+      faster_ht_for_each_parallel(pools[p], &ht, ht_double, &visited);
+      if (visited != 2 * count) {
+        printf("Parallel walks visited %lu of %lu elements\n", (unsigned long)visited, (unsigned long)(2 * count));
+        return -1;
+      }
+      sum *= 2;
+      if (AVL_reduce_parallel(pools[p], &tree, avl_fold, &avl_reduction, &result) != FAST_ERROR_NONE ||
+          !check_sum("AVL reduce after update", &result, sum, count))
+        return -1;
+      if (faster_ht_reduce_parallel(pools[p], &ht, ht_fold, &ht_reduction, &result) != FAST_ERROR_NONE ||
+          !check_sum("Hash table reduce after update", &result, sum, count))
+        return -1;
+    }
+    faster_pool_free(&pool);
+  }
+
+  // empty structures reduce to init
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(empty_tree, 16);
+  faster_ht_t empty_ht;
+  faster_ht_init(&empty_ht, 16, faster_ht_hash);
+  faster_pool_t pool;
+  faster_pool_init(&pool, 4);
+  struct walk_sum_s result;
+  faster_reduction_t reduction = {sizeof(struct walk_sum_s), sum_init, sum_combine, &avl_order};
+  if (AVL_reduce_parallel(&pool, &empty_tree, avl_fold, &reduction, &result) != FAST_ERROR_NONE ||
+      !check_sum("Empty AVL reduce", &result, 0, 0))
+    return -1;
+  reduction.context = &ht_order;
+  if (faster_ht_reduce_parallel(&pool, &empty_ht, ht_fold, &reduction, &result) != FAST_ERROR_NONE ||
+      !check_sum("Empty hash table reduce", &result, 0, 0))
+    return -1;
+
+  struct timespec start, middle, end;
+  reduction.context = &avl_order;
+  timespec_get(&start, TIME_UTC);
+  AVL_reduce_parallel(NULL, &tree, avl_fold, &reduction, &result);
+  timespec_get(&middle, TIME_UTC);
+  AVL_reduce_parallel(&pool, &tree, avl_fold, &reduction, &result);
+  timespec_get(&end, TIME_UTC);
+  printf("AVL reduce over %lu nodes: %f seconds on one thread, %f seconds on 4 threads\n", (unsigned long)count,
+         (double)(middle.tv_sec - start.tv_sec) + (double)(middle.tv_nsec - start.tv_nsec) / 1e9,
+         (double)(end.tv_sec - middle.tv_sec) + (double)(end.tv_nsec - middle.tv_nsec) / 1e9);
+  faster_pool_free(&pool);
+
+  printf("Parallel walks OK\n");
+  AVL_reset_and_free(&tree);
+  AVL_reset_and_free(&empty_tree);
+  faster_ht_free(&ht);
+  faster_ht_free(&empty_ht);
+  free(texts);
+  return 0;
+}
@@ -0,0 +1,149 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "aster/faster_pavl.h"
+
+#define KEY_SPACE 4096
+#define READERS 3
+#define WRITES 200000
+
+static faster_pavl_t tree;
+static fchar_t texts[KEY_SPACE][24];
+static faster_str_t keys[KEY_SPACE];
+static atomic_int writer_done;
+static atomic_int reader_failures;
+
+// checks ordering and balance of one version, returns the number of keys or -1
+static long check_subtree(PAVLNodeIndex node, int *node_height) {
+  if (FASTER_PAVL_NODE_INVALID(node)) {
+    *node_height = 0;
+    return 0;
+  }
+  PAVLNodePtr node_ptr = faster_pavl_node(&tree, node);
+  int left_height, right_height;
+  long left = check_subtree(node_ptr->left, &left_height);
+  long right = check_subtree(node_ptr->right, &right_height);
+  if (left < 0 || right < 0 || left_height - right_height > 1 || right_height - left_height > 1)
+    return -1;
+  *node_height = (left_height > right_height ? left_height : right_height) + 1;
+  if (*node_height != node_ptr->height)
+    return -1;
+  return left + right + 1;
+}
+
+// values always encode their key, so any consistent version passes
+static bool check_snapshot(const faster_pavl_snapshot_t *snapshot) {
+  int root_height;
+  long count = check_subtree(snapshot->root, &root_height);
+  if (count < 0)
+    return false;
+  faster_pavl_iterator_helper_t it = FASTER_PAVL_EMPTY_ITERATOR;
+  const faster_str_t *previous = NULL;
+  long seen = 0;
+  PAVLNodeIndex node;
+  while ((node = faster_pavl_iterator(&tree, snapshot, &it)) != FASTER_PAVL_NODE_INDEX_INVALID) {
+    PAVLNodePtr node_ptr = faster_pavl_node(&tree, node);
+    intptr_t number = (intptr_t)node_ptr->value;
+    if (number < 1 || number > KEY_SPACE || faster_str_cmp_binary(&node_ptr->key, &keys[number - 1]) != 0)
+      return false;
+    if (previous && faster_str_cmp_binary(previous, &node_ptr->key) >= 0)
+      return false;
+    previous = &node_ptr->key;
+    seen++;
+  }
+  return seen == count;
+}
+
+static void *reader(void *arg) {
+  (void)arg;
+  int slot = faster_pavl_reader_register(&tree);
+  if (slot < 0) {
+    atomic_fetch_add(&reader_failures, 1);
+    return NULL;
+  }
+  while (!atomic_load(&writer_done)) {
+    faster_pavl_snapshot_t snapshot = faster_pavl_snapshot(&tree, slot);
+    if (!check_snapshot(&snapshot))
+      atomic_fetch_add(&reader_failures, 1);
+    faster_pavl_snapshot_release(&tree, &snapshot);
+  }
+  faster_pavl_reader_unregister(&tree, slot);
+  return NULL;
+}
+
+int main() {
+  for (int i = 0; i < KEY_SPACE; i++) {
+    char str_ptr[24];
+    sprintf(str_ptr, "key%d", i + 1);
+    faster_mb_to_unicode(str_ptr, texts[i], 24);
+    faster_str_t keyp = {texts[i], faster_strlen(texts[i])};
+    memcpy((void *)&keys[i], &keyp, sizeof(faster_str_t));
+  }
+  if (faster_pavl_init(&tree) != FAST_ERROR_NONE) {
+    printf("Persistent AVL init failed\n");
+    return -1;
+  }
+
+  // an old snapshot keeps its version while the writer moves on
+  int slot = faster_pavl_reader_register(&tree);
+  for (int i = 0; i < KEY_SPACE / 2; i++)
+    faster_pavl_insert_or_update(&tree, &keys[i], (faster_value_ptr)(intptr_t)(i + 1));
+  faster_pavl_snapshot_t before = faster_pavl_snapshot(&tree, slot);
+  for (int i = 0; i < KEY_SPACE / 2; i += 2)
+    faster_pavl_remove(&tree, &keys[i]);
+  for (int i = KEY_SPACE / 2; i < KEY_SPACE; i++)
+    faster_pavl_insert_or_update(&tree, &keys[i], (faster_value_ptr)(intptr_t)(i + 1));
+  for (int i = 0; i < KEY_SPACE / 2; i++) {
+    if (faster_pavl_get(&tree, &before, &keys[i]) != (faster_value_ptr)(intptr_t)(i + 1)) {
+      printf("Persistent AVL snapshot lost key %d\n", i + 1);
+      return -1;
+    }
+  }
+  if (faster_pavl_get(&tree, &before, &keys[KEY_SPACE - 1]) != NULL || !check_snapshot(&before)) {
+    printf("Persistent AVL snapshot sees later writes\n");
+    return -1;
+  }
+  faster_pavl_snapshot_release(&tree, &before);
+  faster_pavl_snapshot_t after = faster_pavl_snapshot(&tree, slot);
+  if (!check_snapshot(&after) || faster_pavl_get(&tree, &after, &keys[0]) != NULL ||
+      faster_pavl_get(&tree, &after, &keys[KEY_SPACE - 1]) != (faster_value_ptr)(intptr_t)KEY_SPACE) {
+    printf("Persistent AVL latest version wrong\n");
+    return -1;
+  }
+  faster_pavl_snapshot_release(&tree, &after);
+  faster_pavl_reader_unregister(&tree, slot);
+
+  // with no snapshot held, one more write reclaims everything that was retired
+  faster_pavl_remove(&tree, &keys[1]);
+  faster_indexing_t live = tree.allocated - tree.free_count;
+  if (tree.retired_count != 0 || live != tree.elements) {
+    printf("Persistent AVL keeps %u nodes for %u keys (%zu retired)\n", live, tree.elements, tree.retired_count);
+    return -1;
+  }
+
+  // readers check whole versions while the writer keeps publishing
+  pthread_t readers[READERS];
+  for (int i = 0; i < READERS; i++)
+    pthread_create(&readers[i], NULL, reader, NULL);
+  srand(0);
+  for (int i = 0; i < WRITES; i++) {
+    int number = rand() % KEY_SPACE;
+    if (rand() % 2) {
+      faster_pavl_insert_or_update(&tree, &keys[number], (faster_value_ptr)(intptr_t)(number + 1));
+    } else {
+      faster_pavl_remove(&tree, &keys[number]);
+    }
+  }
+  atomic_store(&writer_done, 1);
+  for (int i = 0; i < READERS; i++)
+    pthread_join(readers[i], NULL);
+  if (atomic_load(&reader_failures) != 0) {
+    printf("Persistent AVL readers saw %d inconsistent versions\n", atomic_load(&reader_failures));
+    return -1;
+  }
+  printf("Persistent AVL OK, %u keys, %u nodes allocated\n", tree.elements, tree.allocated);
+
+  faster_pavl_free(&tree);
+  return 0;
+}
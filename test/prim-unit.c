@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "aster/faster_prim.h"
+
+#define TEXT_UNITS 4096
+#define ROUNDS 2000
+
+// MurmurHash2 as faster_ht_hash computed it before, short keys must keep their values
+static uint32_t murmur2(const void *key, size_t len) {
+  const uint32_t m = 0x5bd1e995;
+  uint32_t h = 0x9747b28c ^ (uint32_t)len;
+  const unsigned char *data = (const unsigned char *)key;
+  while (len >= 4) {
+    uint32_t k;
+    memcpy(&k, data, sizeof(k));
+    k *= m;
+    k ^= k >> 24;
+    k *= m;
+    h *= m;
+    h ^= k;
+    data += 4;
+    len -= 4;
+  }
+  switch (len) {
+  case 3:
+    h ^= (uint32_t)data[2] << 16;
+    [[fallthrough]];
+  case 2:
+    h ^= (uint32_t)data[1] << 8;
+    [[fallthrough]];
+  case 1:
+    h ^= data[0];
+    h *= m;
+  }
+  h ^= h >> 13;
+  h *= m;
+  h ^= h >> 15;
+  return h;
+}
+
+static bool in_list(const fchar_t *list, size_t count, fchar_t item) {
+  for (size_t i = 0; i < count; i++) {
+    if (list[i] == item)
+      return true;
+  }
+  return false;
+}
+
+// units from the set, around it, and on the far side of the sign bit of every width
+static fchar_t random_unit(const fchar_t *list, size_t count) {
+  switch (rand() % 4) {
+  case 0:
+    return list[rand() % (int)count];
+  case 1:
+    return (fchar_t)(list[rand() % (int)count] + 1);
+  case 2:
+    return (fchar_t)(' ' + rand() % 95);
+  default:
+    return (fchar_t)(0x7F + rand() % 0x200);
+  }
+}
+
+static double seconds(struct timespec *start, struct timespec *end) {
+  return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main() {
+  FASTER_DECLARE_RAW_STR(space_chars, " \n\r\t");
+  FASTER_DECLARE_RAW_STR(symbol_chars, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789");
+  FASTER_DECLARE_RAW_STR(operator_chars, "+-*/%&|^!~<>=?:XORAND");
+  const fchar_t wide_chars[] = {'a', 'b', 'c', (fchar_t)0x80, (fchar_t)0x81, (fchar_t)0xFE, (fchar_t)0x1FE, (fchar_t)0x17F};
+  const fchar_t *lists[] = {space_chars, symbol_chars, operator_chars, wide_chars};
+  const size_t counts[] = {4, 63, 21, sizeof(wide_chars) / sizeof(fchar_t)};
+  faster_prim_set_t sets[4];
+  for (int s = 0; s < 4; s++) {
+    if (faster_prim_set_init(&sets[s], lists[s], counts[s]) != FAST_ERROR_NONE) {
+      printf("Set %d failed\n", s);
+      return -1;
+    }
+    for (int unit = 0; unit < 0x400; unit++) {
+      if (faster_prim_set_contains(&sets[s], (fchar_t)unit) != in_list(lists[s], counts[s], (fchar_t)unit)) {
+        printf("Set %d membership of %d wrong\n", s, unit);
+        return -1;
+      }
+    }
+  }
+  printf("Symbol characters in %u ranges, operators in %u\n", sets[1].ranges, sets[2].ranges);
+  // every other unit does not merge
+  fchar_t scattered[2 * FASTER_PRIM_SET_RANGES + 2];
+  for (int i = 0; i < 2 * FASTER_PRIM_SET_RANGES + 2; i++)
+    scattered[i] = (fchar_t)('!' + 2 * i);
+  faster_prim_set_t too_many;
+  if (faster_prim_set_init(&too_many, scattered, FASTER_PRIM_SET_RANGES + 1) == FAST_ERROR_NONE) {
+    printf("Set beyond %d ranges accepted\n", FASTER_PRIM_SET_RANGES);
+    return -1;
+  }
+
+  fchar_t *text1 = calloc(TEXT_UNITS + 128, sizeof(fchar_t));
+  fchar_t *text2 = calloc(TEXT_UNITS + 128, sizeof(fchar_t));
+  faster_simd_level_t supported = faster_simd_level();
+  printf("Kernels up to level %d\n", (int)supported);
+  srand(0);
+  for (int round = 0; round < ROUNDS; round++) {
+    size_t offset = (size_t)(rand() % 64);
+    size_t len = (size_t)(rand() % ((round % 10 == 0) ? TEXT_UNITS : 300));
+    int s = rand() % 4;
+    for (size_t i = 0; i < len; i++) {
+      text1[offset + i] = random_unit(lists[s], counts[s]);
+      if (text1[offset + i] == 0)
+        text1[offset + i] = 'x';
+    }
+    // long runs inside and outside the set
+    size_t run = (len > 0) ? (size_t)rand() % len : 0;
+    for (size_t i = 0; i < run; i++)
+      text1[offset + i] = (round % 2) ? lists[s][i % counts[s]] : (fchar_t)'~' + 1;
+    text1[offset + len] = 0;
+    memcpy(text2 + offset, text1 + offset, (len + 1) * sizeof(fchar_t));
+    size_t differ = (len > 0 && round % 3 != 0) ? (size_t)rand() % len : len;
+    if (differ < len)
+      text2[offset + differ] = (fchar_t)(text2[offset + differ] ^ (fchar_t)(1 << (rand() % (8 * (int)sizeof(fchar_t) - 1))));
+
+    size_t first_of = 0, span = 0;
+    while (first_of < len && !in_list(lists[s], counts[s], text1[offset + first_of]))
+      first_of++;
+    while (span < len && in_list(lists[s], counts[s], text1[offset + span]))
+      span++;
+    int order = memcmp(text1 + offset, text2 + offset, len * sizeof(fchar_t));
+    uint32_t hash = faster_prim_hash(text1 + offset, len * sizeof(fchar_t));
+    if (len * sizeof(fchar_t) < FASTER_PRIM_HASH_STRIPED_MIN && hash != murmur2(text1 + offset, len * sizeof(fchar_t))) {
+      printf("Short key hash differs from MurmurHash2\n");
+      return -1;
+    }
+
+    for (faster_simd_level_t level = FASTER_SIMD_SCALAR; level <= supported; level++) {
+      faster_simd_select(level);
+      int compare = faster_prim_compare(text1 + offset, text2 + offset, len);
+      if (faster_prim_strlen(text1 + offset) != len || faster_prim_mismatch(text1 + offset, text2 + offset, len) != differ ||
+          faster_prim_equal(text1 + offset, text2 + offset, len) != (differ == len) || (compare > 0) != (order > 0) ||
+          (compare < 0) != (order < 0) || faster_prim_find_first_of(text1 + offset, len, &sets[s]) != first_of ||
+          faster_prim_span(text1 + offset, len, &sets[s]) != span ||
+          faster_prim_hash(text1 + offset, len * sizeof(fchar_t)) != hash) {
+        printf("Level %d differs from the reference in round %d (%zu units at offset %zu)\n", (int)level, round, len, offset);
+        return -1;
+      }
+    }
+  }
+
+  // throughput on long strings
+  size_t long_units = 8 * 1024 * 1024 / sizeof(fchar_t);
+  fchar_t *long_text = malloc((long_units + 1) * sizeof(fchar_t));
+  fchar_t *long_copy = malloc((long_units + 1) * sizeof(fchar_t));
+  for (size_t i = 0; i < long_units; i++)
+    long_text[i] = (fchar_t)('a' + i % 26);
+  long_text[long_units] = 0;
+  memcpy(long_copy, long_text, (long_units + 1) * sizeof(fchar_t));
+  uint32_t long_hash = 0;
+  for (faster_simd_level_t level = FASTER_SIMD_SCALAR; level <= supported; level++) {
+    faster_simd_select(level);
+    struct timespec start, lengths, compares, scans, hashes;
+    timespec_get(&start, TIME_UTC);
+    size_t len = faster_prim_strlen(long_text);
+    timespec_get(&lengths, TIME_UTC);
+    bool equal = faster_prim_equal(long_text, long_copy, len);
+    timespec_get(&compares, TIME_UTC);
+    size_t span = faster_prim_span(long_text, len, &sets[1]);
+    timespec_get(&scans, TIME_UTC);
+    uint32_t hash = faster_prim_hash(long_text, len * sizeof(fchar_t));
+    timespec_get(&hashes, TIME_UTC);
+    if (level == FASTER_SIMD_SCALAR)
+      long_hash = hash;
+    if (len != long_units || !equal || span != long_units || hash != long_hash) {
+      printf("Level %d wrong on the long string\n", (int)level);
+      return -1;
+    }
+    double mb = (double)(long_units * sizeof(fchar_t)) / 1e6;
+    printf("Level %d: strlen %.0f MB/s, equal %.0f MB/s, span %.0f MB/s, hash %.0f MB/s\n", (int)level, mb / seconds(&start, &lengths),
+           mb / seconds(&lengths, &compares), mb / seconds(&compares, &scans), mb / seconds(&scans, &hashes));
+  }
+  faster_simd_select(supported);
+
+  printf("Primitives OK\n");
+  free(text1);
+  free(text2);
+  free(long_text);
+  free(long_copy);
+  return 0;
+}
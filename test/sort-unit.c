@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "aster/faster_sort.h"
+#include <time.h>
+
+#define KEY_SIZE 40
+
+static int str_cmp(const void *str1, const void *str2) {
+  return faster_str_cmp_binary((const faster_str_t *)str1, (const faster_str_t *)str2);
+}
+
+// identifiers of mixed lengths with long shared prefixes, duplicates and empty keys
+static faster_str_t make_key(int number, fchar_t *aster_text) {
+  char str_ptr[KEY_SIZE];
+  switch (number % 5) {
+  case 0:
+    sprintf(str_ptr, "v%d", number % 1000);
+    break;
+  case 1:
+    sprintf(str_ptr, "module.submodule.function_%d", number);
+    break;
+  case 2:
+    sprintf(str_ptr, "module.submodule.function_%d.local", number % 5000);
+    break;
+  case 3:
+    str_ptr[0] = 0;
+    if (number % 3)
+      sprintf(str_ptr, "%c%c%c", 'a' + number % 26, 'a' + (number / 26) % 26, 'a' + (number / 676) % 26);
+    break;
+  default:
+    sprintf(str_ptr, "x%08x", (unsigned int)number * 2654435761u);
+  }
+  faster_mb_to_unicode(str_ptr, aster_text, KEY_SIZE);
+  faster_str_t keyp = {aster_text, faster_strlen(aster_text)};
+  return keyp;
+}
+
+static bool same_order(const faster_str_t *sorted, const faster_str_t *expected, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (faster_str_cmp_binary(&sorted[i], &expected[i]) != 0)
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  srand(0);
+  size_t count = RAND_MAX / 4000;
+  if (argc > 1 && atoi(argv[1]) > 0)
+    count = (size_t)atoi(argv[1]);
+
+  fchar_t(*texts)[KEY_SIZE] = calloc(count, sizeof(*texts));
+  faster_str_t *keys = calloc(count, sizeof(faster_str_t));
+  faster_str_t *expected = calloc(count, sizeof(faster_str_t));
+  faster_str_t *sorted = calloc(count, sizeof(faster_str_t));
+  for (size_t i = 0; i < count; i++) {
+    faster_str_t keyp = make_key(rand(), texts[i]);
+    memcpy((void *)&keys[i], &keyp, sizeof(faster_str_t));
+  }
+  memcpy(expected, keys, count * sizeof(faster_str_t));
+  clock_t start_time = clock();
+  qsort(expected, count, sizeof(faster_str_t), str_cmp);
+  clock_t qsort_time = clock() - start_time;
+
+  // every size class: insertion sort, multikey quicksort and radix passes
+  size_t sizes[] = {0, 1, 2, 7, FASTER_SORT_INSERTION_MAX + 1, FASTER_SORT_RADIX_MIN - 1, FASTER_SORT_RADIX_MIN, 1000, 20000};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    faster_str_t *part = calloc(sizes[s] + 1, sizeof(faster_str_t));
+    memcpy(part, keys, sizes[s] * sizeof(faster_str_t));
+    memcpy(sorted, keys, sizes[s] * sizeof(faster_str_t));
+    qsort(part, sizes[s], sizeof(faster_str_t), str_cmp);
+    faster_str_sort(sorted, sizes[s]);
+    if (!same_order(sorted, part, sizes[s])) {
+      printf("Sort of %zu keys differs from qsort\n", sizes[s]);
+      return -1;
+    }
+    free(part);
+  }
+
+  memcpy(sorted, keys, count * sizeof(faster_str_t));
+  start_time = clock();
+  faster_str_sort(sorted, count);
+  clock_t sort_time = clock() - start_time;
+  if (!same_order(sorted, expected, count)) {
+    printf("Sort of %zu keys differs from qsort\n", count);
+    return -1;
+  }
+
+  memcpy(sorted, keys, count * sizeof(faster_str_t));
+  faster_str_sort_parallel(sorted, count, 4);
+  if (!same_order(sorted, expected, count)) {
+    printf("Parallel sort of %zu keys differs from qsort\n", count);
+    return -1;
+  }
+
+  // sorted and reversed input
+  faster_str_sort(sorted, count);
+  for (size_t i = 0; i < count / 2; i++) {
+    faster_str_t tmp;
+    memcpy((void *)&tmp, &sorted[i], sizeof(faster_str_t));
+    memcpy((void *)&sorted[i], &sorted[count - 1 - i], sizeof(faster_str_t));
+    memcpy((void *)&sorted[count - 1 - i], &tmp, sizeof(faster_str_t));
+  }
+  faster_str_sort_parallel(sorted, count, 3);
+  if (!same_order(sorted, expected, count)) {
+    printf("Sort of reversed keys differs from qsort\n");
+    return -1;
+  }
+
+  printf("Sorting %zu keys: %f seconds with qsort, %f seconds with radix sort\n", count,
+         (double)qsort_time / CLOCKS_PER_SEC, (double)sort_time / CLOCKS_PER_SEC);
+  printf("Sort OK\n");
+  free(texts);
+  free(keys);
+  free(expected);
+  free(sorted);
+  return 0;
+}
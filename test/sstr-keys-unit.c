@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "aster/faster_avl.h"
+#include "aster/faster_ht.h"
+#include "aster/faster_str.h"
+
+#define KEYS 200000
+#define MAX_UNITS 40
+#define LOOKUP_ROUNDS 5
+
+static double seconds(struct timespec *start, struct timespec *end) {
+  return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// identifiers as the interpreter sees them: mostly short, a fifth longer than any inline string
+static size_t make_key(int number, fchar_t *text) {
+  char letters[MAX_UNITS];
+  int prefix = (rand() % 5 == 0) ? 14 + rand() % 10 : 1 + rand() % 6;
+  for (int i = 0; i < prefix; i++)
+    letters[i] = (char)('a' + rand() % 26);
+  size_t len = (size_t)prefix + (size_t)sprintf(letters + prefix, "%x", number);
+  for (size_t i = 0; i < len; i++)
+    text[i] = (fchar_t)letters[i];
+  return len;
+}
+
+int main() {
+  DECLARE_AVL_NODE_TREE_WITH_DYNAMIC_ALLOCATION(avl_tree, 256);
+  faster_ht_t ht;
+  faster_ht_init(&ht, 256, faster_ht_hash);
+
+  // every key in its own allocation, the probes are separate copies so nothing matches by address
+  fchar_t **stored = malloc(KEYS * sizeof(fchar_t *));
+  fchar_t(*probes)[MAX_UNITS] = calloc(KEYS, sizeof(*probes));
+  size_t *lengths = malloc(KEYS * sizeof(size_t));
+  int *order = malloc(KEYS * sizeof(int));
+  srand(0);
+  size_t inline_count = 0;
+  for (int i = 0; i < KEYS; i++) {
+    lengths[i] = make_key(i, probes[i]);
+    stored[i] = malloc(FASTER_STRING_MEMORY_SIZE(lengths[i]));
+    memcpy(stored[i], probes[i], FASTER_STRING_MEMORY_SIZE(lengths[i]));
+    faster_str_t key = {stored[i], lengths[i]};
+    faster_ht_key_data_t key_data = {stored[i], (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(lengths[i])};
+    if (!AVL_insert_or_update(&avl_tree, &key, (faster_value_ptr)(intptr_t)(i + 1)) ||
+        faster_ht_set(&ht, &key_data, (faster_value_ptr)(intptr_t)(i + 1)) != FAST_ERROR_NONE) {
+      printf("Key %d not inserted\n", i);
+      return -1;
+    }
+    inline_count += lengths[i] <= FASTER_SSTR_INLINE_UNITS;
+    order[i] = i;
+  }
+  for (int i = KEYS - 1; i > 0; i--) {
+    int j = rand() % (i + 1);
+    int tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+  }
+#if FASTER_AVL_SSTR_KEYS && FASTER_HT_SSTR_KEYS
+  printf("Small string keys, %zu of %d keys inline\n", inline_count, KEYS);
+  // the inline keys were copied into the nodes and entries, their storage is no longer read
+  for (int i = 0; i < KEYS; i++) {
+    if (lengths[i] <= FASTER_SSTR_INLINE_UNITS)
+      memset(stored[i], 0xA5, FASTER_STRING_MEMORY_SIZE(lengths[i]));
+  }
+#else
+  printf("View keys, %zu of %d keys would be inline\n", inline_count, KEYS);
+#endif
+
+  // every key is found in both containers and the tree walks in order
+  for (int i = 0; i < KEYS; i++) {
+    faster_str_t key = {probes[i], lengths[i]};
+    faster_ht_key_data_t key_data = {probes[i], (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(lengths[i])};
+    if (AVL_get(&avl_tree, &key) != (faster_value_ptr)(intptr_t)(i + 1) ||
+        faster_ht_get(&ht, &key_data) != (faster_value_ptr)(intptr_t)(i + 1)) {
+      printf("Key %d not found\n", i);
+      return -1;
+    }
+  }
+  faster_avl_tree_iterator_helper_t it = FASTER_AVL_TREE_EMPTY_ITERATOR;
+  AVLNodeIndex node, previous = FASTER_AVL_NODE_INDEX_INVALID;
+  int walked = 0;
+  while ((node = AVL_iterator(&avl_tree, &it)) != FASTER_AVL_NODE_INDEX_INVALID) {
+    faster_str_t key = AVL_node_key(avl_tree.node_list.list + node);
+    if (FASTER_AVL_NODE_VALID(previous)) {
+      faster_str_t previous_key = AVL_node_key(avl_tree.node_list.list + previous);
+      if (faster_str_cmp_binary(&previous_key, &key) >= 0) {
+        printf("Tree walk out of order\n");
+        return -1;
+      }
+    }
+    previous = node;
+    walked++;
+  }
+  // keys that differ from a stored one in the last unit only are absent
+  fchar_t missing_text[MAX_UNITS];
+  for (int i = 0; i < KEYS; i += 7) {
+    memcpy(missing_text, probes[i], FASTER_STRING_MEMORY_SIZE(lengths[i]));
+    missing_text[lengths[i] - 1] = (fchar_t)'!';
+    faster_str_t missing = {missing_text, lengths[i]};
+    faster_ht_key_data_t missing_data = {missing_text, (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(lengths[i])};
+    if (AVL_get(&avl_tree, &missing) != NULL || faster_ht_get(&ht, &missing_data) != NULL) {
+      printf("Absent key %d found\n", i);
+      return -1;
+    }
+  }
+  if (walked != KEYS) {
+    printf("Tree walk visited %d of %d keys\n", walked, KEYS);
+    return -1;
+  }
+
+  // lookups in random order, the comparisons and matches are what the key form changes
+  intptr_t checksum = 0;
+  struct timespec start, middle, end;
+  timespec_get(&start, TIME_UTC);
+  for (int round = 0; round < LOOKUP_ROUNDS; round++) {
+    for (int i = 0; i < KEYS; i++) {
+      faster_str_t key = {probes[order[i]], lengths[order[i]]};
+      checksum += (intptr_t)AVL_get(&avl_tree, &key);
+    }
+  }
+  timespec_get(&middle, TIME_UTC);
+  for (int round = 0; round < LOOKUP_ROUNDS; round++) {
+    for (int i = 0; i < KEYS; i++) {
+      faster_ht_key_data_t key_data = {probes[order[i]], (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(lengths[order[i]])};
+      checksum -= (intptr_t)faster_ht_get(&ht, &key_data);
+    }
+  }
+  timespec_get(&end, TIME_UTC);
+  if (checksum != 0) {
+    printf("Timed lookups differ\n");
+    return -1;
+  }
+  printf("%d lookups: %f seconds in the AVL tree, %f seconds in the hash table\n", LOOKUP_ROUNDS * KEYS,
+         seconds(&start, &middle), seconds(&middle, &end));
+
+  // removals leave the other keys in place
+  for (int i = 0; i < KEYS; i += 3) {
+    faster_str_t key = {probes[i], lengths[i]};
+    faster_ht_key_data_t key_data = {probes[i], (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(lengths[i])};
+    if (!AVL_remove(&avl_tree, &key) || faster_ht_remove(&ht, &key_data) != FAST_ERROR_NONE) {
+      printf("Key %d not removed\n", i);
+      return -1;
+    }
+  }
+  for (int i = 0; i < KEYS; i++) {
+    faster_str_t key = {probes[i], lengths[i]};
+    faster_ht_key_data_t key_data = {probes[i], (faster_indexing_t)FASTER_STRING_MEMORY_SIZE(lengths[i])};
+    faster_value_ptr expected = (i % 3 == 0) ? NULL : (faster_value_ptr)(intptr_t)(i + 1);
+    if (AVL_get(&avl_tree, &key) != expected || faster_ht_get(&ht, &key_data) != expected) {
+      printf("Key %d wrong after removals\n", i);
+      return -1;
+    }
+  }
+
+  printf("Small string keys OK\n");
+  AVL_reset_and_free(&avl_tree);
+  faster_ht_free(&ht);
+  for (int i = 0; i < KEYS; i++)
+    free(stored[i]);
+  free(stored);
+  free(probes);
+  free(lengths);
+  free(order);
+  return 0;
+}
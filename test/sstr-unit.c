@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "aster/faster_prim.h"
+
+#define STRINGS 2000
+#define MAX_UNITS 40
+#define COMPARE_ROUNDS 200
+
+static int sign(int value) { return (value > 0) - (value < 0); }
+
+static double seconds(struct timespec *start, struct timespec *end) {
+  return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main() {
+  fchar_t(*texts)[MAX_UNITS] = calloc(STRINGS, sizeof(*texts));
+  faster_str_t *views = malloc(STRINGS * sizeof(faster_str_t));
+  faster_sstr_t *sstrs = malloc(STRINGS * sizeof(faster_sstr_t));
+  srand(0);
+  size_t inline_count = 0;
+  for (int i = 0; i < STRINGS; i++) {
+    // mostly short keys over a small alphabet, so equal lengths and shared prefixes are common
+    size_t len = (size_t)((rand() % 4 == 0) ? rand() % MAX_UNITS : rand() % (int)(FASTER_SSTR_INLINE_UNITS + 1));
+    for (size_t j = 0; j < len; j++)
+      texts[i][j] = (fchar_t)((rand() % 8 == 0) ? 0x7F + rand() % 0x80 : 'a' + rand() % 3);
+    faster_str_t view = {texts[i], len};
+    memcpy(&views[i], &view, sizeof(view));
+    if (!faster_sstr_init(&sstrs[i], &views[i]) ||
+        faster_sstr_is_inline(&sstrs[i]) != (len <= FASTER_SSTR_INLINE_UNITS) || faster_sstr_len(&sstrs[i]) != len ||
+        memcmp(faster_sstr_ptr(&sstrs[i]), texts[i], FASTER_STRING_MEMORY_SIZE(len)) != 0) {
+      printf("String %d of %zu units not kept\n", i, len);
+      return -1;
+    }
+    if (faster_sstr_hash(&sstrs[i]) != faster_prim_hash(texts[i], FASTER_STRING_MEMORY_SIZE(len))) {
+      printf("String %d hashes differently\n", i);
+      return -1;
+    }
+    inline_count += faster_sstr_is_inline(&sstrs[i]);
+  }
+  printf("%zu of %d strings inline, up to %zu units\n", inline_count, STRINGS, (size_t)FASTER_SSTR_INLINE_UNITS);
+
+  // every pair orders and matches as the views do
+  for (int i = 0; i < STRINGS; i += 3) {
+    for (int j = 0; j < STRINGS; j++) {
+      int expected = sign(faster_str_cmp_binary(&views[i], &views[j]));
+      if (sign(faster_sstr_cmp_binary(&sstrs[i], &sstrs[j])) != expected ||
+          faster_sstr_equal(&sstrs[i], &sstrs[j]) != (expected == 0)) {
+        printf("Strings %d and %d compare differently\n", i, j);
+        return -1;
+      }
+    }
+  }
+  // a copy moved elsewhere stays equal, the inline units move with it
+  faster_sstr_t moved[2];
+  memcpy(moved, &sstrs[0], sizeof(faster_sstr_t));
+  memcpy(moved + 1, &sstrs[1], sizeof(faster_sstr_t));
+  if (!faster_sstr_equal(&moved[0], &sstrs[0]) || faster_sstr_cmp_binary(&moved[1], &sstrs[1]) != 0) {
+    printf("Copies differ\n");
+    return -1;
+  }
+
+  // a length a reference cannot keep is refused rather than cut, nothing past the pointer is read
+  faster_str_t too_long = {texts[0], (size_t)FAST_LIMIT_INDEXING_MAX + 1};
+  faster_sstr_t refused;
+  if (faster_sstr_init(&refused, &too_long) || faster_sstr_len(&refused) != 0) {
+    printf("Over long string accepted\n");
+    return -1;
+  }
+
+  // short keys side by side: the views chase their pointers, the inline strings do not
+  int checksum1 = 0, checksum2 = 0;
+  struct timespec start, middle, end;
+  timespec_get(&start, TIME_UTC);
+  for (int round = 0; round < COMPARE_ROUNDS; round++) {
+    for (int i = 1; i < STRINGS; i++)
+      checksum1 += sign(faster_str_cmp_binary(&views[i - 1], &views[i]));
+  }
+  timespec_get(&middle, TIME_UTC);
+  for (int round = 0; round < COMPARE_ROUNDS; round++) {
+    for (int i = 1; i < STRINGS; i++)
+      checksum2 += sign(faster_sstr_cmp_binary(&sstrs[i - 1], &sstrs[i]));
+  }
+  timespec_get(&end, TIME_UTC);
+  if (checksum1 != checksum2) {
+    printf("Timed comparisons differ\n");
+    return -1;
+  }
+  printf("%d comparisons: %f seconds on views, %f seconds on small strings\n", COMPARE_ROUNDS * (STRINGS - 1),
+         seconds(&start, &middle), seconds(&middle, &end));
+
+  printf("Small strings OK\n");
+  free(texts);
+  free(views);
+  free(sstrs);
+  return 0;
+}